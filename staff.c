@@ -1,9 +1,48 @@
+// Request the POSIX.1-2008 declarations (fileno(), pread(), fcntl()) even when compiling with -std=c11.
+#define _POSIX_C_SOURCE 200809L
+
 #include<ctype.h>	// toupper()
+#include<limits.h>	// LONG_MAX, ULONG_MAX
+#include<stdarg.h>	// va_copy(), va_end(), va_list, va_start()
 #include<stdbool.h>	// bool, true, false
-#include<stdio.h>	// fclose(), fopen(), fread(), fseek(), ftell(), fwrite(), getchar(), perror(), printf(), rewind(), scanf(), ungetc(), EOF, FILE, SEEK_END, stdin
+#include<stdio.h>	// fclose(), ferror(), fflush(), fopen(), fread(), fseek(), ftell(), fwrite(), getchar(), perror(), printf(), remove(), rewind(), scanf(), sprintf(), sscanf(), ungetc(), vsnprintf(), EOF, FILE, SEEK_END, stdin, stdout
 #include<stdlib.h>	// atoi(), calloc(), free(), malloc(), realloc()
-#include<string.h>	// memmove(), memset(), strcmp(), strcpy(), strlen()
-#include<time.h>	// localtime(), time(), time_t, struct tm
+#include<string.h>	// memcmp(), memcpy(), memmove(), memset(), strchr(), strcmp(), strcpy(), strlen(), strcspn(), strncmp(), strncpy(), strspn()
+#include<time.h>	// clock(), localtime(), time(), clock_t, time_t, struct tm, CLOCKS_PER_SEC
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include<immintrin.h>	// __m128i, __m256i, _mm_*(), _mm256_*(), __rdtsc()
+// Define whether the SSSE3 and AVX2 BLAKE2b kernels can be compiled. They are only used if the CPU supports them.
+#define BLAKE2B_X86
+#endif
+
+#ifdef __unix__
+#include<errno.h>	// errno, EINTR
+#include<fcntl.h>	// fcntl(), struct flock, F_RDLCK, F_SETLKW, F_UNLCK, F_WRLCK
+#include<poll.h>	// poll(), struct pollfd, POLLIN
+#include<pthread.h>	// pthread_cond_*(), pthread_create(), pthread_join(), pthread_mutex_*(), pthread_once(), pthread_t
+#include<signal.h>	// pthread_sigmask(), sigaddset(), sigemptyset(), signal(), sig_atomic_t, sigset_t, SIGINT, SIGTERM
+#include<stdatomic.h>	// atomic_fetch_add(), atomic_init(), atomic_load(), atomic_store(), atomic_ulong, _Atomic
+#include<sys/ioctl.h>	// ioctl(), struct winsize, TIOCGWINSZ
+#include<sys/stat.h>	// fstat(), struct stat
+#include<sys/socket.h>	// accept(), bind(), connect(), listen(), recv(), send(), shutdown(), socket(), AF_UNIX, MSG_NOSIGNAL, SHUT_RDWR, SOCK_STREAM
+#include<sys/un.h>	// struct sockaddr_un
+#include<unistd.h>	// close(), fsync(), isatty(), pipe(), pread(), pwrite(), read(), sysconf(), unlink(), write(), STDOUT_FILENO, _SC_NPROCESSORS_ONLN
+// Define whether threads are available to split bulk operations on the staff file.
+#define STAFF_THREADS
+// Define whether records of the staff file are locked, so several terminals can share the staff file.
+#define STAFF_LOCKS
+// Define whether the staff daemon can serve terminals over a Unix domain socket.
+#define STAFF_DAEMON
+// Define whether writes to the staff file can be synced to the disk with fsync().
+#define STAFF_FSYNC
+// Define whether the staff file can be stat()ed, to tell when any program wrote it.
+#define STAFF_STAT
+// Define whether frames are written to the terminal with write(), bypassing stdio.
+#define FRAME_WRITE
+// Define whether the terminal understands ANSI escape sequences, so screens are cleared and redrawn in place.
+#define TERMINAL_ANSI
+#endif
 
 
 typedef unsigned long long u64;
@@ -19,15 +58,112 @@ enum StaffModifiableFields { SE_ID, SE_NAME, SE_POSITION, SE_PHONE, SE_IC };
 #define STAFF_ENUM_LENGTH 5
 
 
+/*
+	This enum list all the BLAKE2b compression kernels, from the slowest to the fastest.
+	BLAKE2bF() uses the fastest kernel supported by the CPU, unless another one is chosen with useBLAKE2bKernel().
+*/
+enum BLAKE2bKernels { BK_SCALAR, BK_SSSE3, BK_AVX2 };
+#define BLAKE2B_KERNEL_LENGTH 3
+
+
+/*
+	This enum list the types of record locks taken with lockStaff().
+	Shared locks are taken while reading records, exclusive locks while writing them.
+*/
+enum StaffLockTypes { SL_UNLOCK, SL_SHARED, SL_EXCLUSIVE };
+
+
+/*
+	This enum list what is known of the terminal screen, to decide how presentFrame() draws the next frame.
+	Unknown:	Append the frame, e.g. stdout is not a terminal.
+	Shown:		The screen shows the last frame from the top, only the lines that changed are redrawn.
+	Dirty:		Something else was printed over the last frame, clear the screen and draw the frame in full.
+*/
+enum ScreenStates { SS_UNKNOWN, SS_SHOWN, SS_DIRTY };
+
+
+/*
+	This enum list the formats exportStaff() writes, one staff per line.
+	TSV:	Tab separated fields, the output of the search command.
+	CSV:	Comma separated fields quoted as in RFC 4180, after a header row.
+	JSONL:	A JSON object per staff, keyed with the field names.
+*/
+enum StaffExportFormats { SX_TSV, SX_CSV, SX_JSONL };
+
+// Define the number of bytes in a BLAKE2b block.
+#define BLAKE2B_BLOCK_BYTES 128
+
+// Define the maximum number of bytes of a BLAKE2b digest (and key).
+#define BLAKE2B_OUT_MAX 64
+
+
 // Define maximum char array size needed for Staff struct elements buffer.
 #define STAFF_BUF_MAX 128
 
 // Define how many rows of records to display in displayStaff().
 #define ENTRIES_PER_PAGE 8
 
+// Define how many records to read per fread() when streaming through the staff file.
+#define STAFF_STREAM_CHUNK 512
+
+// Define how many bytes of output the command line mode buffers before writing them.
+#define COMMAND_FLUSH_BYTES 65536
+
+// Define the maximum length of a line read by the command line mode, including the newline.
+#define COMMAND_LINE_MAX 1024
+
+// Define the number of records of a scan task, smaller scans run on the calling thread. (See parallelFor())
+#define SCAN_TASK_RECORDS 65536
+
+// Define the number of pages of a hashing task, fewer pages are hashed on the calling thread. (See parallelFor())
+#define HASH_TASK_PAGES 256
+
+// Define the maximum number of workers of the task pool, including the thread calling parallelFor().
+#define POOL_THREADS_MAX 16
+
+// Define the number of tasks a worker deque of the task pool can hold, a power of 2.
+// Tasks are split in halves, so a deque holds at most one task per bit of the job length.
+#define POOL_DEQUE_MAX 64
+
+// Define the record locked while appending to the staff file, far past the last record so readers never wait for it.
+#define APPEND_LOCK_RECORD (LONG_MAX/(long) sizeof(Staff)-1)
+
 // Define a small macro to check if a staff is deleted.
 #define isStaffDeleted(_staff) (((_staff).passHash&0xFFFFFFFF00000000) == 0)
 
+// Define a small macro to repack the deletion date of a deleted staff as (year<<16)|(month<<8)|day, which sorts chronologically.
+#define staffDepartureDate(_staff) ((unsigned int) ((((_staff).passHash&0xFFFF)<<16) | (((_staff).passHash&0xFF0000)>>8) | (((_staff).passHash&0xFF000000)>>24)))
+
+// Define the file name of the departure date index. (See DepartureEntry{})
+#define DEPARTURE_INDEX_FILE "staffdel.bin"
+
+// Define the file name of the staff ID index. (See StaffIdSlot{})
+#define STAFF_ID_INDEX_FILE "staffid.bin"
+
+// Define the file name of the page checksums of the staff file. (See ChecksumHeader{})
+#define CHECKSUM_FILE "staffsum.bin"
+
+// Define the number of records in a checksummed page of the staff file. ($STAFF_STREAM_CHUNK must be a multiple of it)
+#define CHECKSUM_PAGE_RECORDS 64
+
+// Define the file name of the Merkle tree of the staff file pages. (See MerkleHeader{})
+#define MERKLE_FILE "staffmkl.bin"
+
+// Define the number of bytes of a Merkle tree node, a BLAKE2b-256 digest.
+#define MERKLE_DIGEST_BYTES 32
+
+// Define the socket file of the staff daemon. (See serveStaff())
+#define STAFF_SOCKET "staff.sock"
+
+// Define the maximum number of terminals connected to the staff daemon at once.
+#define DAEMON_CLIENTS_MAX 64
+
+// Define the maximum payload length of a request to the staff daemon, longer requests close the connection.
+#define DAEMON_REQUEST_MAX (16*1024*1024)
+
+// Define the number of slots of a page of the ID index of the staff daemon, a power of 2. (See StaffIdPage{})
+#define ID_INDEX_PAGE_SLOTS 1024
+
 // Define a small function to truncate remaining bytes in stdin.
 #define truncate()													\
 	do {															\
@@ -39,6 +175,7 @@ enum StaffModifiableFields { SE_ID, SE_NAME, SE_POSITION, SE_PHONE, SE_IC };
 // A portable solution instead of the Windows only system("pause").
 #define pause()									\
 	do {										\
+		dirtyScreen();							\
 		printf("Enter any key to proceed. ");	\
 		truncate();								\
 		putchar('\n');							\
@@ -47,11 +184,24 @@ enum StaffModifiableFields { SE_ID, SE_NAME, SE_POSITION, SE_PHONE, SE_IC };
 // Define whether or not to use clear screen function.
 #define ENABLE_CLS true
 
+// Define the glyph of the table dividers. Straight from DOS but Windows still doesn't support it.
+#ifdef __linux__
+#define DIVIDER_GLYPH "─"
+#else
+#define DIVIDER_GLYPH "-"
+#endif
+
+// Define a small macro to repeat a string literal 4 times, to precompute the runs of frameDivider() and frameSpaces().
+#define REPEAT4(_s) _s _s _s _s
+
+// Define the number of glyphs in the precomputed runs of frameDivider() and frameSpaces().
+#define FRAME_RUN_LENGTH 64
+
 // Define a small function to clear the screen.
 #define cls()						\
 	do {							\
 		if(ENABLE_CLS) {			\
-			system("clear || cls");	\
+			clearScreen();			\
 		} else {					\
 			putchar('\n');			\
 			putchar('\n');			\
@@ -91,6 +241,23 @@ typedef struct {
 } Staff;
 
 
+/*
+	A screen drawn in memory, then written to the terminal at once with flushFrame().
+
+	Drawing a table with printf() and putchar() costs thousands of stdio calls per page, each one a write over a slow
+	terminal when stdout is unbuffered. A frame is appended to with framePrintf(), frameAppend(), frameDivider() and
+	frameSpaces(), which copy the dividers and padding from precomputed runs, and is written with a single write().
+
+	NOTE:	Flush the frame before prompting for input, or the prompt is not shown.
+*/
+typedef struct {
+	char* text;		// The text drawn so far, not NUL terminated.
+	int length;		// Number of bytes in $text.
+	int capacity;	// Allocated length of $text.
+	bool failed;	// Set if the frame could not be grown, the text drawn after it is missing.
+} Frame;
+
+
 // Instead of initialising this with the normal struct initialisation,
 // get a copy of this from DisplayStaffOptionsInit(), filled with default values.
 // Then only modify the fields' value.
@@ -105,15 +272,493 @@ typedef struct {
 	bool isInteractive;						// Whether to prompt the user for page navigation or not.
 	bool displayDeleted;					// Print deleted staff details or ignore it.
 	bool displayExisting;					// Print deleted staff details or ignore it.
+	int orderBy;							// A StaffModifiableFields to sort the rows by, or -1 to keep the file order.
+	Frame* frame;							// A frame to draw the table into, presented by the caller if not interactive. (NULL to draw its own)
+	struct {								// The rows sorted so far by $orderBy. (Non-modifiable, free $rows after use)
+		int* rows;							// Indexes of the first $length matched staff in the staff file, in order.
+		int length;							// Reset this to 0 whenever $idList or $orderBy changes.
+	} ordered;
 	struct {								// A struct that contains the metadata of the current search. (Non-modifiable)
 		int totalBytes;						// Total bytes of the staff file.
 		int totalEntries;					// Total number of entries in the staff file.
 		int matchedLength;					// Total matched entries.
 	} metadata;
-	// No padding required yay.
 } DisplayStaffOptions;
 
 
+// Upper cased copies of the searchable fields of a Staff{}, computed once with foldStaff() when the staff is loaded.
+// Case insensitive matching then compares bytes directly instead of calling toupper() on every comparison.
+typedef struct {
+	char id[6];
+	char name[128];
+	char position[32];
+	char phone[16];
+	char ic[15];
+} StaffFolded;
+
+
+// The staff folded by foldStaffTask(), for searchStaff().
+typedef struct {
+	StaffFolded* foldedArr;
+	Staff* staffArr;
+} StaffFoldJob;
+
+
+// State of an incremental BLAKE2b hash. See BLAKE2bInit(), BLAKE2bUpdate() and BLAKE2bFinal().
+typedef struct {
+	u64 hash[8];								// Chained hash.
+	u64 counter[2];								// Number of bytes compressed so far, as a 128 bits integer (low word first).
+	unsigned char buf[BLAKE2B_BLOCK_BYTES];	// Bytes not compressed yet. The last block is kept until BLAKE2bFinal().
+	int bufLen;									// Number of bytes in $buf.
+	int outLen;									// Digest size (bytes).
+} BLAKE2bContext;
+
+
+// A search predicate on the staff file, matched with matchStaff().
+typedef struct {
+	int field;						// One of StaffModifiableFields to match, or -1 to match every existing staff.
+	char pattern[STAFF_BUF_MAX];	// A LIKE() pattern to match $field against, case insensitively. (Fold it with foldCase() first)
+	bool invert;					// Match the staff that do not match $pattern instead.
+} StaffQuery;
+
+
+// A hash set of staff IDs with open addressing, filled with addStaffId().
+typedef struct {
+	char (*ids)[6];		// The slots, case folded IDs. (Empty if the first byte is 0)
+	int capacity;		// Number of slots, a power of 2.
+	int length;			// Number of IDs in the set.
+} StaffIdSet;
+
+
+// What exportStaff() streams, and where.
+typedef struct {
+	int format;							// A StaffExportFormats.
+	bool fields[STAFF_ENUM_LENGTH];		// Fields to export, like DisplayStaffOptions{}.displayList.
+	StaffQuery* queries;				// Only export the staff matching every query.
+	int queriesLen;						// Length of $queries.
+	FILE* output;						// The stream to export to.
+} StaffExport;
+
+
+// The fields updateStaffWhere() sets on every matching staff.
+typedef struct {
+	bool fields[STAFF_ENUM_LENGTH];		// Fields to set, like StaffExport{}.fields. (Never the ID, IDs are unique)
+	Staff values;						// The values of the fields to set.
+} StaffUpdate;
+
+
+// A GROUP BY bucket of the staff report.
+// Position buckets are keyed by the case folded position, month buckets are keyed by $key.
+typedef struct {
+	bool used;			// Whether the bucket is in use. ($key can be 0, e.g. the departure month of a zeroed date)
+	char position[32];	// First seen spelling of the position. (Empty for month buckets)
+	unsigned int key;	// Departure month packed as (year<<8)|month. (0 for position buckets)
+	int active;			// Number of existing staff in this bucket.
+	int inactive;		// Number of deleted staff in this bucket.
+} ReportBucket;
+
+
+// An open addressing hash table of ReportBucket{}.
+typedef struct {
+	ReportBucket* buckets;	// NULL until the first insert.
+	int capacity;			// Always a power of 2.
+	int length;				// Number of buckets in use.
+} ReportTable;
+
+
+// Aggregates computed by computeStaffReport() in a single pass over the staff file.
+// Zero initialise this before passing it in.
+typedef struct {
+	ReportTable positions;	// Headcount grouped by position.
+	ReportTable months;		// Departures grouped by month.
+	int totalActive;		// Number of existing staff.
+	int totalInactive;		// Number of deleted staff (past employees).
+} ReportAggregate;
+
+
+// The partial aggregate of one worker of the task pool in computeStaffReport().
+typedef struct {
+	ReportAggregate agg;	// Partial aggregate of the ranges aggregated by the worker.
+	int retval;				// Error code of the worker, see computeStaffReport().
+} ReportWorker;
+
+
+// The records aggregated by reportTask(), for computeStaffReport().
+typedef struct {
+	FILE* staffFile;							// The opened staff file, shared by the workers.
+	Staff* records;								// Records read from the staff daemon, aggregated instead of $staffFile. (NULL if none)
+	ReportWorker workers[POOL_THREADS_MAX];
+} ReportJob;
+
+
+// The identity and last write of the staff file, read with statStaffFile().
+typedef struct {
+	u64 inode;	// Inode of the file. (0 without $STAFF_STAT)
+	u64 size;	// Size of the file in bytes.
+	u64 mtime;	// Time of the last write in nanoseconds. (0 without $STAFF_STAT)
+} StaffFileStamp;
+
+
+/*
+	The departure date index is a sidecar file ($DEPARTURE_INDEX_FILE) that lists every deleted staff ordered by deletion date.
+	It allows past employees to be queried by date range and paged in date order with a binary search, without scanning the staff file.
+
+	Layout: DepartureIndexHeader{} followed by $length DepartureEntry{}, sorted by $date.
+
+	XXX:	Deletions always happen "today", so deleteStaff() appends to the index most of the time.
+			The other writes delete nothing, they only move the stamp of the index on. (See addDepartures())
+			The index is rebuilt from the staff file if it is missing or the staff file was written since by another program.
+*/
+typedef struct {
+	unsigned int date;	// Deletion date packed as (year<<16)|(month<<8)|day. (See staffDepartureDate())
+	int record;			// Index of the deleted staff in the staff file.
+} DepartureEntry;
+
+
+typedef struct {
+	char magic[4];			// Always "SDI2".
+	int length;				// Number of DepartureEntry{} following the header.
+	StaffFileStamp stamp;	// The staff file when the index was last written. (Zeroed if it changed while being scanned)
+} DepartureIndexHeader;
+
+
+// The deleted staff collected by departuresTask(), for rebuildDepartureIndex().
+typedef struct {
+	FILE* staffFile;							// The opened staff file, shared by the workers.
+	DepartureEntry* entries[POOL_THREADS_MAX];	// Deleted staff found by every worker, in no particular order.
+	int lengths[POOL_THREADS_MAX];
+	int capacities[POOL_THREADS_MAX];
+	int retval[POOL_THREADS_MAX];				// Error code of every worker.
+} DepartureScanJob;
+
+
+/*
+	The staff ID index is a sidecar file ($STAFF_ID_INDEX_FILE) that maps a staff ID to its record in the staff file.
+	It allows a staff to be found and written back at its offset without scanning the staff file.
+
+	Layout: StaffIdIndexHeader{} followed by $capacity StaffIdSlot{}, an open addressing hash table keyed by hashStaffId().
+
+	Slots are never removed. A slot is only trusted after reading its record, which must still exist with the same ID,
+	so the slots of deleted staff and of changed IDs are simply skipped. A changed ID is indexed again with indexStaffIds(), before it is written.
+	Records appended since the index was written are indexed the next time it is opened, so adding staff does not touch it.
+	Every write to the staff file moves the stamp of the index on afterwards (See stampStaffIdIndex()), so a staff file replaced by another program is noticed.
+	The index is rebuilt from the existing staff when it is missing, does not match the staff file, or gets half full.
+*/
+typedef struct {
+	char id[6];		// Empty if the slot is unused.
+	int record;		// Index of the staff in the staff file.
+} StaffIdSlot;
+
+
+typedef struct {
+	char magic[4];			// Always "SII2".
+	int recordCount;		// Number of records in the staff file that are indexed.
+	int capacity;			// Number of StaffIdSlot{} following the header, a power of 2.
+	int length;				// Number of used slots, including the skipped ones.
+	StaffFileStamp stamp;	// The staff file when the index was last written.
+} StaffIdIndexHeader;
+
+
+/*
+	The page checksums are a sidecar file ($CHECKSUM_FILE) with a CRC32C of every page of the staff file.
+	A page is $CHECKSUM_PAGE_RECORDS consecutive records, only the last page can be shorter.
+
+	Layout: ChecksumHeader{} followed by one unsigned int checksum per page.
+
+	XXX:	Every write to the staff file is followed by updateChecksums() with the records as written, so a torn write
+			(or a crash before the update) leaves its page mismatched for verifyChecksums() to report.
+			Records appended by a terminal that crashed before its update are checksummed from the staff file as they are,
+			by the next update. A staff overwritten in that window is counted twice, and its page is reported.
+			The checksums are rebuilt from the staff file if they are missing, which trusts the staff file as it is.
+*/
+typedef struct {
+	char magic[4];		// Always "SCS1".
+	int pageRecords;	// Number of records per page, $CHECKSUM_PAGE_RECORDS when the file was written.
+	int recordCount;	// Number of records in the staff file when the checksums were last written.
+} ChecksumHeader;
+
+
+/*
+	The Merkle tree is a sidecar file ($MERKLE_FILE) with a BLAKE2b-256 hash tree over the same pages as the page checksums.
+	Two staff files with the same root hash have the same records, and differing pages are found by descending into the
+	differing nodes only, without reading either staff file. (See diffMerkleTree())
+
+	Layout: MerkleHeader{} followed by 2*$capacity nodes of $MERKLE_DIGEST_BYTES bytes, stored as a binary heap.
+			Node 1 is the root, node i has the children 2i and 2i+1, node $capacity+p is the leaf of page p. (Node 0 is unused)
+
+	Leaf:	BLAKE2b-256(0x00 || page), or all zeroes past the last page.
+	Node:	BLAKE2b-256(0x01 || left child || right child).
+
+	XXX:	A write updates its leaf and the O(log N) nodes up to the root. The tree is rebuilt with twice the capacity when
+			the staff file grows past $capacity pages, and rebuilt from the staff file if it is missing.
+*/
+typedef struct {
+	char magic[4];		// Always "SMT1".
+	int pageRecords;	// Number of records per page, $CHECKSUM_PAGE_RECORDS when the file was written.
+	int recordCount;	// Number of records in the staff file when the tree was last written.
+	int capacity;		// Number of leaves, always a power of 2.
+} MerkleHeader;
+
+
+// The pages of the staff file hashed by hashPagesTask(), for verifyChecksums() and the rebuilds.
+typedef struct {
+	FILE* staffFile;				// The opened staff file, shared by the workers. (See reportTask())
+	long recordCount;				// Number of records to hash, the last page may be partial.
+	unsigned int* checksums;		// CRC32C of every page. (NULL to skip)
+	unsigned char* leaves;			// Merkle leaf of every page, $MERKLE_DIGEST_BYTES each. (NULL to skip)
+	bool* missing;					// Set to true for every page not read whole, e.g. past the end of a truncated staff file.
+	int retval[POOL_THREADS_MAX];	// Error code of every worker.
+} PageHashJob;
+
+
+#ifdef STAFF_THREADS
+// A range of items of a parallelFor() job.
+typedef struct {
+	long first;
+	long count;
+} PoolTask;
+
+
+// The deque of tasks of one worker of the task pool.
+typedef struct {
+	pthread_mutex_t lock;
+	PoolTask tasks[POOL_DEQUE_MAX];	// Ring buffer, from the oldest task at $top to the newest before $bottom.
+	unsigned int top;				// The oldest task is stolen by other workers.
+	unsigned int bottom;			// The newest task is taken by the owner.
+	unsigned int seed;				// xorshift state of the owner, to pick the victims to steal from.
+} PoolDeque;
+
+
+/*
+	The task pool runs the parallelFor() jobs, so bulk operations share the cores instead of each starting its own threads.
+	It is started on first use with one worker per core (at most $POOL_THREADS_MAX), the calling thread being worker 0.
+
+	A job is a range of items. It starts as one task in the deque of the calling thread. A worker takes the newest task
+	of its own deque, and splits it in halves down to the grain of the job, pushing back the upper halves. An idle worker
+	steals the oldest task, the largest, from the deque of a random worker, and splits it the same way.
+*/
+typedef struct {
+	int workers;						// Number of workers, including the thread calling parallelFor().
+	pthread_t threads[POOL_THREADS_MAX];
+	PoolDeque deques[POOL_THREADS_MAX];
+	pthread_mutex_t run;				// Held while running a job, one job runs at a time. (Others run on their calling thread)
+	pthread_mutex_t lock;				// Protects the fields below.
+	pthread_cond_t wake;				// Broadcast when a task is pushed, and when the job is finished.
+	void (*body)(void* arg, int worker, long first, long count);
+	void* arg;
+	long grain;							// Tasks are not split below this many items.
+	long remaining;						// Number of items of the job not processed yet, 0 between jobs.
+	long pushes;						// Number of tasks pushed, idle workers sleep until it changes.
+	long jobs;							// Statistics, see TaskPoolStats{}.
+	long tasks;
+	long steals;
+} TaskPool;
+#endif
+
+
+// Statistics of the task pool, see getTaskPoolStats().
+typedef struct {
+	int workers;	// Number of workers, including the thread calling parallelFor().
+	long jobs;		// Number of jobs split between the workers.
+	long tasks;		// Number of tasks run by the split jobs.
+	long steals;	// Number of tasks stolen from another worker.
+} TaskPoolStats;
+
+
+/*
+	The staff daemon (staff --serve) owns an in-memory copy of the staff file with an ID index, and serves every terminal
+	over a Unix domain socket ($STAFF_SOCKET). The menus ask the daemon if it is running (see useStaffDaemon()), else they
+	read and write the staff file themselves. Changes are written through to the staff file, the departure date index and
+	the page checksums, so the staff file stays the source of truth.
+
+	A request is a StaffMessage{} followed by $length bytes of payload. The reply is a StaffMessage{} with the status in $op
+	(0 or one of the error codes), followed by $length bytes of payload.
+
+	Request		Payload							Reply payload
+	-------		-------							-------------
+	SR_PING		-								-
+	SR_FIND		char id[6]						StaffRecord{} of the existing staff with the ID. (-15 if none)
+	SR_LOGIN	StaffLogin{}					-	(-15 if the ID is not found, -16 if the password does not match)
+	SR_COUNT	StaffCount{}					int count
+	SR_PIN		-								StaffSnapshot{} of the current version, pinned until SR_UNPIN or disconnecting.
+	SR_READ		StaffRead{}						Staff records[] of a pinned version, at most $STAFF_STREAM_CHUNK.
+	SR_UNPIN	int version						-
+	SR_ADD		Staff[n]						int records[n] of the staff appended, in one write. (-16 if the ID exists)
+	SR_MODIFY	StaffModification[n]			int statuses[n]: 0 if saved, -16 if the new ID exists, -17 if the staff was changed in the meantime.
+	SR_DELETE	char ids[n][6]					int records[] of the staff deleted.
+	SR_UPDATE	StaffUpdate{}, StaffQuery[n]	int count of the staff updated, every staff matching all the queries.
+	SR_PURGE	StaffQuery[n]					int records[] of the staff deleted, every staff matching all the queries.
+
+	Every request replies -18 if its payload is malformed.
+
+	SR_PIN, SR_READ and the changes reply -19 unless the client logged in with SR_LOGIN, as a staff that still exists.
+	Before that, SR_FIND replies every password hash as ~0.
+
+	XXX:	Writes to the staff file by terminals that cannot reach the daemon (e.g. another directory) are detected by the
+			stamp of the file (see statStaffFile()), and the daemon reloads it on the next request. Without $STAFF_STAT
+			only appended records are detected.
+*/
+enum StaffRequests { SR_PING, SR_FIND, SR_LOGIN, SR_COUNT, SR_PIN, SR_READ, SR_UNPIN, SR_ADD, SR_MODIFY, SR_DELETE, SR_UPDATE, SR_PURGE };
+
+
+typedef struct {
+	int op;		// One of StaffRequests, or the status of a reply.
+	int length;	// Number of payload bytes following.
+} StaffMessage;
+
+
+typedef struct {
+	int record;		// Index of $staff in the staff file.
+	Staff staff;
+} StaffRecord;
+
+
+typedef struct {
+	char id[6];
+	u64 passHash;	// computeHash() of the entered password.
+} StaffLogin;
+
+
+typedef struct {
+	StaffQuery query;
+	int limit;		// Stop counting after $limit matches. (0 or less for no limit)
+} StaffCount;
+
+
+typedef struct {
+	int version;	// Version to pass to SR_READ and SR_UNPIN.
+	int length;		// Number of records in the version.
+} StaffSnapshot;
+
+
+typedef struct {
+	int version;	// A version pinned with SR_PIN.
+	int first;		// Index of the first record to read.
+	int count;		// Number of records to read.
+} StaffRead;
+
+
+typedef struct {
+	int record;			// Index of the staff in the staff file.
+	Staff original;		// The staff as read before modifying, the modification is rejected if it changed since.
+	Staff modified;
+} StaffModification;
+
+
+// A page of records of the in-memory staff file, shared by every version it is unchanged in.
+typedef struct {
+	int refs;								// Number of versions using the page.
+	Staff records[CHECKSUM_PAGE_RECORDS];
+	StaffFolded folded[CHECKSUM_PAGE_RECORDS];	// Folded copies of $records, folded again whenever a record is written.
+} StaffPage;
+
+
+// A version of the in-memory staff file. (See StaffTable{})
+typedef struct {
+	int id;				// Unique number of the version, sent to the readers that pin it.
+	int pins;			// Number of readers that pinned the version, plus one while it is the current version.
+	int length;			// Number of records.
+	int pageLength;		// Number of pages in $pages, they are allocated before the records are appended.
+	int pageCapacity;	// Allocated length of $pages.
+	StaffPage** pages;	// The records, $CHECKSUM_PAGE_RECORDS per page.
+} StaffVersion;
+
+
+// A version pinned by a client of the staff daemon.
+typedef struct {
+	int client;				// Socket of the client.
+	StaffVersion* version;
+} StaffPin;
+
+
+#ifdef STAFF_DAEMON
+// A page of the ID index of the staff daemon. Like the pages of the records, it is shared until written. (See StaffTable{})
+typedef struct {
+	int refs;						// Number of ID indexes using the page, of the table and of the views.
+	int slots[ID_INDEX_PAGE_SLOTS];	// Index of the staff in every slot. (-1 if empty)
+} StaffIdPage;
+
+
+// A published snapshot of the in-memory staff file, read by the lookups of the staff daemon without locking. (See StaffTable{})
+typedef struct StaffView {
+	StaffVersion* version;	// Pinned while the view exists.
+	StaffIdPage** ids;		// ID index of $version, never written once published.
+	int idCapacity;
+	int idLength;
+	bool ownsIds;			// Whether $ids is released with the view, false if the next view shares it.
+	StaffFileStamp stamp;	// The staff file $version was read or written as, the view is stale once the stamp changes.
+	unsigned long retired;	// Epoch the view was replaced in, it is freed once no reader entered before it.
+	struct StaffView* next;	// Next retired view.
+} StaffView;
+
+
+/*
+	The in-memory staff file of the staff daemon, with multiversion concurrency control.
+
+	Readers that read the table over several requests (reports, paged displays) pin the current version with SR_PIN,
+	and read it in chunks with SR_READ. The daemon serves other requests in between, and writers never wait for them:
+	if the current version is pinned, a write first copies it, sharing every page. (Copy on write)
+	Then the page written is copied too if another version shares it, so a write copies at most one page of records.
+
+	A version is freed once it is unpinned and no longer the current version, and a page once no version uses it.
+	Pins are released when the client disconnects.
+
+	Every terminal is served by its own thread. Changes (and pins) are serialized by $lock, and are made to private copies:
+	the current version is pinned by the published view, so it is copied on write, and so is the ID index. The ID index is
+	split in pages too: a write copies the page table, and the pages of the slots it writes. Once the request is done,
+	a new view of both is published with one atomic store. Lookups (SR_PING to SR_COUNT) never lock: they load the
+	published view and read it, so they never wait for a write, and never see a half applied change.
+
+	A replaced view is freed with epoch-based reclamation. A reader stores the epoch it entered in to its slot of $readers
+	before loading the view, and clears it when done. Replacing a view advances the epoch, and the view is freed by a later
+	write once no reader slot holds an older epoch.
+
+	Other programs may write the staff file too, e.g. terminals that cannot reach the daemon. Every request compares the
+	stamp of the staff file with the one it was last read or written as first, and reloads the table if it changed.
+	(See refreshStaffTable())
+
+	XXX:	Writes still copy the page table of the ID index, O(N/$ID_INDEX_PAGE_SLOTS) per change.
+*/
+typedef struct {
+	StaffVersion* current;	// The latest version, seen by every request except SR_READ.
+	int versions;			// Number of versions created so far, to number the next one.
+	StaffPin* pins;			// Versions pinned by the clients.
+	int pinLength;			// Number of pins in $pins.
+	int pinCapacity;		// Allocated length of $pins.
+	StaffIdPage** ids;		// Open addressing hash table of the indexes of the existing staff in $current, keyed by ID hashed case insensitively, by pages.
+	int idCapacity;			// Number of slots, always a power of 2 (at least $ID_INDEX_PAGE_SLOTS), at least twice the number of existing staff.
+	int idLength;			// Number of existing staff in $ids.
+	FILE* staffFile;		// The staff file opened for updating.
+	StaffFileStamp stamp;	// The staff file after the last read or write of the table, zeroed if another program wrote it in between.
+	_Atomic(StaffView*) view;						// The view read by the lookups.
+	StaffView* retired;								// Replaced views that readers may still be reading.
+	atomic_ulong epoch;								// Current epoch, starts at 1.
+	atomic_ulong readers[DAEMON_CLIENTS_MAX];		// Epoch every client thread entered its lookup in, 0 if none.
+	pthread_mutex_t lock;							// Held by the writers.
+} StaffTable;
+
+
+// A terminal served by its own thread of the staff daemon.
+typedef struct {
+	StaffTable* table;
+	int client;			// Socket of the terminal, -1 if the slot is free.
+	int reader;			// Index of the slot, also the reader slot of the thread in $table->readers.
+	int done;			// Pipe the thread writes $reader to once it is done, so serveStaff() joins it.
+	pthread_t thread;
+} StaffClient;
+#endif
+
+
+// An unlimited count, of a version by pages with countPagesTask() (SR_COUNT), or of the staff file with countRecordsTask().
+typedef struct {
+	StaffVersion* version;			// The version counted. (NULL when counting the staff file)
+	StaffQuery* query;
+	int counts[POOL_THREADS_MAX];	// Matches counted by every worker.
+	FILE* staffFile;				// The opened staff file counted, shared by the workers. (NULL when counting a version)
+	int retval[POOL_THREADS_MAX];	// Error code of every worker counting the staff file.
+} StaffCountJob;
+
+
 // ----- START OF HEADERS -----
 /*
 	Error codes:
@@ -136,6 +781,22 @@ typedef struct {
 int addStaff(void);
 
 
+/**
+ * @brief	Appends a staff to the staff file, through the staff daemon if it is running.
+ *
+ * The ID is checked again while holding the append lock, so a staff added by another terminal in the meantime is not duplicated.
+ *
+ * @param	staffFile	The staff file opened with "ab+", unused if the staff daemon is running.
+ * @param	newStaff	The validated staff to append.
+ *
+ * @retval	0	Staff successfully added.
+ * @retval	-3	Staff failed to be added (File operation error).
+ * @retval	-4	Staff failed to be added (Allocation error).
+ * @retval	-16	Staff not added (A staff with the same ID exists).
+ */
+int appendStaff(FILE* staffFile, Staff* newStaff);
+
+
 /**
  * @brief	Presents a screen to search for staffs that match a pattern in staff record.
  *
@@ -151,2267 +812,11163 @@ int searchStaff(void);
 
 
 /**
- * @brief	Select a staff to modify their details.
+ * @brief	Select staff to modify their details.
+ *
+ * The staff is found through the staff ID index, and written back at its offset with pwriteStaff().
+ * Modifications of many staff can be staged in one session (':n'), reviewed (':p') and saved together (':w', also at the ID prompt).
+ * Only the staff that differ from their details as read are staged. ':q' discards the changes of the staff shown only.
  *
  * @retval	0	Staff successfully modified.
  * @retval	EOF	Staff modification cancelled (EOF signal received).
  * @retval	-2	Staff modification cancelled (Modify operation was cancelled by user).
  * @retval	-3	Staff failed to be modified (File operation error).
+ * @retval	-4	Staff failed to be modified (Allocation error).
  */
 int modifyStaff(void);
 
 
 /**
- * @brief	Presents a screen with all the member details in a interactive table format.
+ * @brief	Saves the modifications of an edit session at once, through the staff daemon if it is running.
  *
- * @retval	0	Staffs details successfully displayed.
- * @return		Negative value indicating error. (See displaySelectedStaff() error codes)
+ * The modifications are sorted by record, every run of adjacent records is locked and checked against the staff file,
+ * then written with a single write. The staff file is synced once, and the page checksums are updated once.
+ * A staff changed by another terminal in the meantime, or given an ID that is taken by now, is skipped.
+ *
+ * @param	staffFile		The staff file opened with "rb+", unused if the staff daemon is running.
+ * @param	modifications	The staged modifications, sorted by record in place.
+ * @param	len				Number of modifications.
+ * @param	statuses		An array to store the status of every (sorted) modification:
+ *							0 if saved, -3 if it failed to be written, -16 if the new ID is taken, -17 if the staff was changed.
+ *
+ * @retval	-3	File operation or connection error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of staff saved.
  */
-int displayStaff(void);
+int saveStaffModifications(FILE* staffFile, StaffModification* modifications, int len, int* statuses);
 
 
 /**
- * @brief	Present a screen that show past employee with a brief summary.
+ * @brief	Asks to save the modifications of an edit session, saves them with saveStaffModifications(), and reports the staff skipped.
  *
- * @retval	0	Staffs details successfully displayed and quit normally.
- * @retval	EOF	Staff report opertion aborted (EOF received).
- * @retval	-3	Staff failed to be displayed (File operation error).
+ * @param	staffFile		The staff file opened with "rb+", unused if the staff daemon is running.
+ * @param	modifications	The staged modifications, sorted by record in place.
+ * @param	len				Number of modifications.
+ *
+ * @retval	EOF	Saving cancelled (EOF signal received).
+ * @retval	-2	Saving cancelled by the user.
+ * @retval	-3	File operation or connection error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of staff saved.
  */
-int reportStaff(void);
+int promptSaveStaffModifications(FILE* staffFile, StaffModification* modifications, int len);
+
 
 /**
- * @brief	Select staffs to delete.
+ * @brief	Prints the fields changed by the modifications of an edit session, old and new values.
  *
- * @retval	EOF	Staff deletion failed (EOF signal received).
- * @retval	-15	Staff deletion failed (An error occured).
- * @return		Number of staffs deleted.
+ * @param	modifications	The staged modifications.
+ * @param	len				Number of modifications.
  */
-int deleteStaff(void);
+void printStaffModifications(StaffModification* modifications, int len);
 
 
 /**
- * @brief	Prompts the user to enter selected staff details and validate them.
- *
- * This function handles the user input by validating them for correctness.
- * The inputted data will be truncated to the appropriate size to avoid buffer overflow.
- * This function makes the assumption that $buf is appropriately sized (>= to the size of corresponding field in Staff{}).
- * stdin buffer will always be read to after the newline character so next scanf() read will not be required to rewind() first.
- * If EOF is received during the prompt, $buf is left in an incomplete state. (May contain invalid data)
- *
- * @param	buf				A pointer to the appropriately sized buffer.
- * @param	selection		An enum containing the field that is going to be validated. Bit flip of enum will disable prompt message.
- * @param	specialStrings	A bool indicating whether to validate the data or not.
+ * @brief	qsort() comparator that orders staff modifications by record.
+ */
+int compareStaffModification(const void* a, const void* b);
+
+
+/**
+ * @brief	qsort() comparator that orders record indexes (int) ascending.
+ */
+int compareRecord(const void* a, const void* b);
+
+
+/**
+ * @brief	Presents a screen with all the member details in a interactive table format.
  *
- * @retval	0	Read and validated successfully.
- * @retval	EOF	EOF signal received, abort prompt.
- * @retval	-2	Read but not validated (Exited with :q or :w).
- * @retval	-14	Passing back control to callee (to reprint prompt) if bit flipped $selection is passed in.
- * @retval	-15	Read but not validated (Not implemented).
+ * @retval	0	Staffs details successfully displayed.
+ * @return		Negative value indicating error. (See displaySelectedStaff() error codes)
  */
-int promptStaffDetails(char* buf, enum StaffModifiableFields selection);
+int displayStaff(void);
 
 
 /**
- * @brief	Returns a copy of a DisplayStaffOptions{} filled with the default values.
+ * @brief	Locks a range of records of the staff file, waiting for conflicting locks of other processes (terminals) to be released.
  *
- * All modifiable fields are:					\n
- * Parameter				Default				\n
- * char* header;			(NULL)				\n
- * char** idList;			(NULL)				\n
- * bool displayList[$N];	(all set to false)	\n
- * int idListLen;			(0)					\n
- * int entriesPerPage;		($E)				\n
- * int page;				(0)					\n
- * bool isInclude;			(true)				\n
- * bool isInteractive;		(true)				\n
- * bool displayDeleted;		(false)				\n
- * bool displayExisting;	(true)				\n
+ * Locks are byte-range fcntl() locks, so readers and writers of different records never wait for each other.
  *
- * $N = $STAFF_ENUM_LENGTH, $E = $ENTRIES_PER_PAGE
+ * XXX:	fcntl() locks belong to the process. Closing any other FILE of the staff file releases them all, so only call functions
+ *		that open the staff file themselves (e.g. updateChecksums()) after unlocking. Locking a range again replaces the
+ *		lock already held on it, e.g. reading an exclusively locked record with freadStaff() downgrades it to shared.
  *
- * @return	A struct with the default values filled.
+ * @param	staffFile	The opened staff file (or sidecar file), opened for writing if $type is SL_EXCLUSIVE.
+ * @param	first		Index of the first record to lock.
+ * @param	count		Number of records to lock, 0 for every record from $first onwards (including records appended later).
+ * @param	type		One of StaffLockTypes.
+ *
+ * @retval	0	Records successfully locked (or unlocked). Always succeeds if locks are not supported.
+ * @retval	-3	File operation error.
  */
-DisplayStaffOptions displayStaffOptionsInit(void);
+int lockStaff(FILE* staffFile, long first, long count, int type);
 
 
 /**
- * @brief	Display the passed staff information in a nice table format.
+ * @brief	Reads records at the current position of the staff file like fread(), under a shared lock.
  *
- * @param	displayOptions	A pointer to the display options for the staff data.
+ * @param	staffArr	An array to store at least $count Staff{}.
+ * @param	count		Maximum number of records to read.
+ * @param	staffFile	The opened staff file.
  *
- * @retval	EOF	Print operation aborted (EOF signal received).
- * @retval	-3	Print operation failed (File operation error).
- * @retval	-4	Print operation failed (Allcoation operation error).
- * @return		Number of fields matched.
+ * @return	Number of records read, less than $count at the end of the staff file or on error.
  */
-int displaySelectedStaff(DisplayStaffOptions* options);
+size_t freadStaff(Staff* staffArr, size_t count, FILE* staffFile);
 
 
 /**
- * @brief	Presents the user with a login screen and prompts the user to login.
+ * @brief	Reads records from a position of the staff file, without locking them.
  *
- * A login screen that allows staffs to login.
- * The staff's ID will be used to determine which staff is planning to login.
- * If the staff's ID is valid and matched one of the records, a password will be prompted.
- * If the inputted password is incorrect thrice, staff ID will be prompted again in case the staff ID was entered incorrectly.
- * A complete Staff struct with the corresponding staff details will be returned, after the staff has logged in.
+ * Use it to read records already locked with lockStaff(). Reads bypass the stdio buffer, so no record is read outside the lock.
+ * The position of $staffFile is moved past the records read.
  *
- * @return	First byte of ID is filled with 0 to indicate error, the next byte will be filled with the error code.
- * @return	Logged in user's Staff struct.
+ * @param	staffFile	The opened staff file.
+ * @param	staffArr	An array to store at least $count Staff{}.
+ * @param	first		Index of the first record to read.
+ * @param	count		Maximum number of records to read.
+ *
+ * @return	Number of records read, less than $count at the end of the staff file or on error.
  */
-Staff loginStaff(void);
+size_t preadStaff(FILE* staffFile, Staff* staffArr, long first, size_t count);
 
 
 /**
- * @brief	Presents the user with a screen to choose which staff function to perform.
+ * @brief	Writes records to a position of the staff file, bypassing the stdio buffer.
  *
- * @param	loggedInUser	A pointer to the logged in user's struct.
+ * Use it to write records already locked with lockStaff(). The write is done once the function returns, no flush is needed.
+ * The position of $staffFile is moved past the records written.
  *
- * @retval	0	Quit normally.
- * @retval	EOF	EOF signal received.
+ * @param	staffFile	The staff file opened for writing.
+ * @param	staffArr	The records to write.
+ * @param	first		Index of the first record to write.
+ * @param	count		Number of records to write.
+ *
+ * @return	Number of records written, less than $count on error.
  */
-int menuStaff(Staff* loggedInUser);
+size_t pwriteStaff(FILE* staffFile, Staff* staffArr, long first, size_t count);
 
 
 /**
- * @brief	Hashes the inputted string (password) to a one-way BLAKE2 hash.
+ * @brief	Flushes the staff file and waits until its writes reach the disk.
  *
- * A BLAKE2 message digest hash function that takes in a message to produce a fixed sized hash.
- * This implementation of the BLAKE2 hash is in accordance with the BLAKE2b algorithm, designed for 64 bits system.
- * This implementation does not include keys.
- * Salting isn't in the scope of this hashing function.
+ * @param	staffFile	The staff file opened for writing.
  *
- * Message inputted to this function is also limited to only (2**64)-1 bytes due to the reduced size of length variable.
- * Any bytes after the null-terminated string will be ignored and will not affect the result of the hash.
+ * @retval	0	Staff file successfully synced. (Only flushed if syncing is not supported)
+ * @retval	-3	File operation error.
+ */
+int syncStaff(FILE* staffFile);
+
+
+/**
+ * @brief	Reads the stamp of the staff file, which changes whenever a program writes the file.
  *
- * References:
- * 	RFC 7693: https://datatracker.ietf.org/doc/html/rfc7693
+ * Without $STAFF_STAT only the size is known, so only appended records change the stamp.
  *
- * @param	msg	A pointer to a char array to be hashed.
- * @return		8 bytes hash of the string (password).
+ * @param	staffFile	The opened staff file. Flush it first, buffered writes are not in the stamp yet.
+ * @param	stamp		A pointer to store the stamp.
+ *
+ * @retval	0	Stamp successfully read.
+ * @retval	-3	File operation error.
  */
-u64 computeHash(char* msg);
+int statStaffFile(FILE* staffFile, StaffFileStamp* stamp);
 
 
 /**
- * @brief	Compress function defined by BLAKE2b.
+ * @brief	Reads every record of the staff file to memory, from the staff daemon if it is running.
  *
- * @param	hash		Pointer to the 64 bytes hash array.
- * @param	msg			Pointer to one of the 128 bytes chunk of the inputted message.
- * @param	compressed	Number of bytes that has been compressed (including $msg).
- * @param	isLastBlock	A boolean value that tells whether or not the current message chunk is the last one.
+ * @param	staffArr	A pointer to store the malloc()-ed records. Free it after use.
+ *
+ * @retval	-3	File operation or connection error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of records in $staffArr.
  */
-void BLAKE2bF(u64* hash, char* msg, u64 compressed, bool isLastBlock);
+int loadStaff(Staff** staffArr);
 
 
 /**
- * @brief	Mixing function defined by BLAKE2b.
+ * @brief	Marks a staff as deleted today, keeping the deletion date in $passHash. (See isStaffDeleted())
  *
- * @param	v	Pointer to $v array that contains hashes and IV constants.
- * @param	a	Defined index to take and mix.
- * @param	b	Defined index to take and mix.
- * @param	c	Defined index to take and mix.
- * @param	d	Defined index to take and mix.
- * @param	x	One of 4 bytes character from the 128 bytes message chunk chosen with SIGMA.
- * @param	y	One of 4 bytes character from the 128 bytes message chunk chosen with SIGMA.
+ * @param	staff	The staff to mark.
  */
-void BLAKE2bG(u64* v, u64 a, u64 b, u64 c, u64 d, u64 x, u64 y);
+void markStaffDeleted(Staff* staff);
 
 
 /**
- * @brief	Searches the current stirng and return index of first occurence if there is a match.
+ * @brief	Counts the existing staff matching a query without collecting their IDs.
  *
- * NOTE: This implementation is only limited to $STAFF_BUF_MAX-1 characters.
+ * If the staff daemon is running, it counts the query in memory.
+ * Otherwise a query with a negative $field is answered from the departure date index header without scanning the staff file,
+ * and other queries stream the staff file in chunks and count them with countStaffArray().
  *
- * @param	text		Text to be searched.
- * @param	query		Query to search the text provided.
- * @param	ignoreCase	Determine to be case sensitive or not.
+ * @param	query	A pointer to the query to count.
+ * @param	limit	Stop counting after $limit matches. (0 or less for no limit)
  *
- * @retval	-1	No match.
- * @return		Index of the first occurence.
+ * @retval	-3	Count failed (File operation error).
+ * @retval	-4	Count failed (Allocation operation error).
+ * @return		Number of staff matched, at most $limit.
  */
-int KMPSearch(char* text, char* query, bool ignoreCase);
+int countStaff(StaffQuery* query, int limit);
 
 
 /**
- * @brief	Matches $text and $query and see if they are the same.
+ * @brief	Checks if any existing staff matches a query, stopping at the first match.
  *
- * This function allows the use of SQL's LIKE's wildcards to match.
- * Wildcards:
- *   *	Matches zero or more characters.
- *   _	Matches exactly on character.
+ * @param	query	A pointer to the query to check.
  *
- * @param	text	The text to match against.
- * @param	query	The text that allow the use of wildcards.
- * @param	ignoreCase	Determine to be case sensitive or not.
+ * @retval	1	A staff matches.
+ * @retval	0	No staff matches.
+ * @return		Negative value indicating error. (See countStaff() error codes)
+ */
+int staffExists(StaffQuery* query);
+
+
+/**
+ * @brief	Counts the existing staff in an array that match a query.
  *
- * @return 	A true or false value indicating if they match.
+ * @param	staffArr	The records to count.
+ * @param	foldedArr	The folded copies of $staffArr. (See foldStaffArray())
+ * @param	len			Length of $staffArr.
+ * @param	query		A pointer to the query to count.
+ * @param	limit		Stop counting after $limit matches. (0 or less for no limit)
+ *
+ * @return	Number of staff matched, at most $limit.
  */
-bool LIKE(char* text, char* query, bool ignoreCase);
-// ----- END OF HEADERS -----
+int countStaffArray(Staff* staffArr, StaffFolded* foldedArr, int len, StaffQuery* query, int limit);
 
 
-int addStaff(void) {
-	int retval = 0;
+/**
+ * @brief	Checks if a staff exists and matches a query.
+ *
+ * @param	staff	A pointer to the staff to match.
+ * @param	folded	A pointer to the folded copy of $staff, which the query is matched against.
+ * @param	query	A pointer to the query to match.
+ *
+ * @return	A true or false value indicating if they match.
+ */
+bool matchStaff(Staff* staff, StaffFolded* folded, StaffQuery* query);
 
-	Staff newStaff;
-	FILE* staffFile = fopen("staff.bin", "ab+");
 
-	if(staffFile == NULL) {
-		perror("Error (Opening staff file)");
-		pause();
-		retval = -3;
-		goto CLEANUP;
-	}
+/**
+ * @brief	Checks if a staff exists and matches every query.
+ *
+ * @param	staff	A pointer to the staff to match.
+ * @param	folded	A pointer to the folded copy of $staff, which the queries are matched against.
+ * @param	queries	The queries to match.
+ * @param	len		Number of queries in $queries.
+ *
+ * @return	A true or false value indicating if they match.
+ */
+bool matchStaffQueries(Staff* staff, StaffFolded* folded, StaffQuery* queries, int len);
 
-	// Password max length is $STAFF_BUF_MAX-1.
-	// scanf() will scan an additional character to determine if password exceeds intended size.
-	// So an additional character is allocated for password's null character.
-	char buf[STAFF_BUF_MAX+1];
-	enum StaffModifiableFields curPrompt = SE_ID;
 
-	// XXX: Iterate through enum by incrementing.
-	// XXX: Added one to print the last field after prompting it.
-	while(curPrompt < (STAFF_ENUM_LENGTH+1)) {
-		cls();
-		printf(
-			"ADD STAFF\n"
-			"=========\n"
-		);
+/**
+ * @brief	Sets the fields of $update on a staff.
+ *
+ * @param	staff	A pointer to the staff to update.
+ * @param	update	A pointer to the fields to set.
+ *
+ * @return	A true or false value indicating if any field changed.
+ */
+bool applyStaffUpdate(Staff* staff, StaffUpdate* update);
 
-		// Print entered details after they have been filled.
-		if(curPrompt > SE_ID) {
-			printf("Staff ID       : %s\n", newStaff.id);
-		}
-		if(curPrompt > SE_NAME) {
-			printf("Staff name     : %s\n", newStaff.details.name);
-		}
-		if(curPrompt > SE_POSITION) {
-			printf("Staff position : %s\n", newStaff.details.position);
-		}
-		if(curPrompt > SE_PHONE) {
-			printf("Staff phone    : %s\n", newStaff.details.phone);
-		}
-		if(curPrompt > SE_IC) {
-			printf("Staff IC       : %s\n", newStaff.details.ic);
-		}
 
-		if(curPrompt > SE_ID) {
-			// Insert a line break to separate from the table.
-			putchar('\n');
-		}
-		printf("(Enter ':q' to abort.)\n\n");
+/**
+ * @brief	Returns the field of a staff as a string.
+ *
+ * @param	staff	A pointer to the staff.
+ * @param	field	One of StaffModifiableFields.
+ *
+ * @return	A pointer to the field inside $staff, or an empty string if $field is invalid.
+ */
+char* staffFieldText(Staff* staff, int field);
 
-		int res = -1; // Records the output of promptStaffDetails().
-		switch(curPrompt) {
-			case SE_ID:
-				while(res != 0) {
-					res = promptStaffDetails(buf, SE_ID);
-					if(res == EOF) {
-						retval = EOF;
-						goto CLEANUP;
-					}
-					if(res != 0) {
-						break;
-					}
 
-					// Ensure the Staff ID entered is unique.
-					Staff tmp;
-					bool exists = false;
-					while(fread(&tmp, sizeof(Staff), 1, staffFile) == 1) {
-						if(strcmp(tmp.id, buf) == 0 && !isStaffDeleted(tmp)) {
-							exists = true;
-							break;
-						}
-					}
-					rewind(staffFile);
+/**
+ * @brief	Returns the upper cased field of a staff as a string.
+ *
+ * @param	folded	A pointer to the folded staff.
+ * @param	field	One of StaffModifiableFields.
+ *
+ * @return	A pointer to the field inside $folded, or an empty string if $field is invalid.
+ */
+char* staffFoldedText(StaffFolded* folded, int field);
 
-					if(exists) {
-						printf("Staff with the same ID exists!\n\n");
-						res = -15;
-					} else {
-						strcpy(newStaff.id, buf);
-						res = 0;
-					}
-				}
-				break;
-			case SE_NAME:
-				res = promptStaffDetails(buf, SE_NAME);
-				if(res == 0) {
-					strcpy(newStaff.details.name, buf);
-				}
-				break;
-			case SE_POSITION:
-				res = promptStaffDetails(buf, SE_POSITION);
-				if(res == 0) {
-					strcpy(newStaff.details.position, buf);
-				}
-				break;
-			case SE_PHONE:
-				res = promptStaffDetails(buf, SE_PHONE);
-				if(res == 0) {
-					strcpy(newStaff.details.phone, buf);
-				}
-				break;
-			case SE_IC:
-				res = promptStaffDetails(buf, SE_IC);
-				if(res == 0) {
-					strcpy(newStaff.details.ic, buf);
-				}
-				break;
-			default: {
-				res = 0;
-			}
-		}
 
-		if(res == 0) {
-			++curPrompt;
-		} else if(res == -2) {
-			printf("Staff addition aborted!\n");
-			pause();
-			retval = -2;
-			goto CLEANUP;
-		} else if(res == EOF) {
-			retval = EOF;
-			goto CLEANUP;
-		}
-	}
+/**
+ * @brief	Fills the upper cased copies of the searchable fields of a staff.
+ *
+ * @param	folded	A pointer to the folded staff to fill.
+ * @param	staff	A pointer to the staff to fold.
+ */
+void foldStaff(StaffFolded* folded, Staff* staff);
 
-	// Prompt password
-	while(1) {
-		// NOTE: Implemented independantly because password hash should not be modifiable.
-		printf("Password (E.g. Ky54asdf' _.): ");
-		
-		// Scan an additional character to determine if user's password exceeds max length.
-		if(scanf("%128[^\n]", buf) == EOF) {
-			retval = EOF;
-			goto CLEANUP;
-		}
-		u64 hash1 = computeHash(buf);
-		int passLen = strlen(buf);
-		memset(buf, 0, STAFF_BUF_MAX); // Zero out buffer to erase sensitive data.
-		truncate();
 
-		if(passLen == STAFF_BUF_MAX) {
-			printf("Please enter a password that is shorter than %d characters!\n", STAFF_BUF_MAX-1);
-			pause();
-			continue;
-		}
+/**
+ * @brief	Folds every staff of an array, e.g. a chunk just read from the staff file.
+ *
+ * @param	foldedArr	The folded staff to fill, at least $len.
+ * @param	staffArr	The staff to fold.
+ * @param	len			Length of $staffArr.
+ */
+void foldStaffArray(StaffFolded* foldedArr, Staff* staffArr, int len);
 
-		printf("Re-enter password: ");
-		// Don't have to scan an additional character anymore.
-		if(scanf("%127[^\n]", buf) == EOF) {
-			retval = EOF;
-			goto CLEANUP;
-		}
-		u64 hash2 = computeHash(buf);
-		memset(buf, 0, STAFF_BUF_MAX-1); // null terminator is already zero, don't have to zero it again.
-		truncate();
 
-		if(hash1 == hash2) {
-			newStaff.passHash = hash1;
-			break;
-		} else {
-			printf("Passwords do not match!\n\n");
-		}
-	}
+/**
+ * @brief	Task of searchStaff() that folds a range of the loaded staff.
+ *
+ * @param	arg		A pointer to the StaffFoldJob{}.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first staff of the range.
+ * @param	count	Number of staff in the range.
+ */
+void foldStaffTask(void* arg, int worker, long first, long count);
 
-	printf("\nAre you sure you want to save the current staff detail? [Y/n]: ");
+
+/**
+ * @brief	Upper cases ASCII letters of a buffer, the same as toupper() in the "C" locale.
+ *
+ * All $size bytes are folded (including any past the null terminator), so the loop has no branches and can be vectorised.
+ *
+ * @param	dest	The buffer to write to. (Can be the same as $src)
+ * @param	src		The buffer to fold.
+ * @param	size	Number of bytes to fold.
+ */
+void foldCase(char* dest, char* src, int size);
+
+
+/**
+ * @brief	Converts a field name typed in by the user (case insensitive) to its enum.
+ *
+ * @param	name	Field name, such as "Position".
+ *
+ * @retval	-1	Field name does not match any of the fields.
+ * @return		One of StaffModifiableFields.
+ */
+int parseStaffField(char* name);
+
+
+/**
+ * @brief	Counts the bits set in a bitset.
+ *
+ * @param	bitset	The bitset, with bit i stored in bitset[i/8].
+ * @param	bits	Number of bits to count. Bits past $bits in the last byte are ignored.
+ *
+ * @return	Number of bits set.
+ */
+int popcountBitset(char* bitset, int bits);
+
+
+/**
+ * @brief	Present a screen that show past employee with a brief summary.
+ *
+ * @retval	0	Staffs details successfully displayed and quit normally.
+ * @retval	EOF	Staff report opertion aborted (EOF received).
+ * @retval	-3	Staff failed to be displayed (File operation error).
+ */
+int reportStaff(void);
+
+
+/**
+ * @brief	Computes the staff report aggregates in one streaming pass over the staff file.
+ *
+ * The staff file is read $STAFF_STREAM_CHUNK records at a time instead of being loaded whole.
+ * Ranges of $SCAN_TASK_RECORDS records are aggregated by the task pool, see parallelFor().
+ * Each worker keeps its own partial ReportAggregate{}, which are merged into $agg at the end.
+ * If the staff daemon is running, a pinned version is read in batches of $SCAN_TASK_RECORDS records instead,
+ * and every batch is split between the workers.
+ *
+ * @param	agg	A pointer to a zero initialised aggregate to fill. Free it with freeReportAggregate().
+ *
+ * @retval	0	Report successfully computed.
+ * @retval	-3	Report failed (File operation error).
+ * @retval	-4	Report failed (Allocation operation error).
+ */
+int computeStaffReport(ReportAggregate* agg);
+
+
+/**
+ * @brief	Presents a screen that pages through past employees in departure date order.
+ *
+ * Past employees are looked up with the departure date index, so only the displayed page is read from the staff file.
+ *
+ * @retval	0	Quit normally.
+ * @retval	EOF	EOF signal received.
+ * @retval	-3	File operation error.
+ */
+int reportDepartures(void);
+
+
+/**
+ * @brief	Opens the departure date index under an exclusive lock, rebuilding it if it is missing or does not match the staff file.
+ *
+ * @param	header	A pointer to store the header of the index. Its $stamp is set to the current stamp of the staff file.
+ * @param	before	The stamp of the staff file before the caller wrote it, which the index may still match. (Can be NULL)
+ * @param	rebuilt	A pointer to store whether the index was rebuilt from the staff file. (Can be NULL)
+ *
+ * @return	The index file opened in "rb+" mode, or NULL if it failed to open. Closing it releases the lock.
+ */
+FILE* openDepartureIndex(DepartureIndexHeader* header, StaffFileStamp* before, bool* rebuilt);
+
+
+/**
+ * @brief	Rebuilds the departure date index with a full scan of the staff file.
+ *
+ * Ranges of $SCAN_TASK_RECORDS records are scanned by the task pool, see departuresTask().
+ *
+ * @param	indexFile	The index file, locked by openDepartureIndex().
+ * @param	header		A pointer to store the header of the rebuilt index.
+ *
+ * @retval	0	Index successfully rebuilt.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int rebuildDepartureIndex(FILE* indexFile, DepartureIndexHeader* header);
+
+
+/**
+ * @brief	Task of rebuildDepartureIndex() that collects the deleted staff of a range of the staff file.
+ *
+ * @param	arg		A pointer to the DepartureScanJob{}, $retval of the worker is set to a negative value on error.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first record of the range.
+ * @param	count	Number of records in the range.
+ */
+void departuresTask(void* arg, int worker, long first, long count);
+
+
+/**
+ * @brief	Records newly deleted staff in the departure date index.
+ *
+ * Must be called after the deletions are flushed to the staff file.
+ * If the index has to be rebuilt, the deletions are already picked up from the staff file.
+ * Writes that delete nothing (adding, modifying) call it with no entries, so the index moves on to the stamp they wrote.
+ *
+ * @param	entries	The newly deleted staff, sorted by date. (Can be NULL if $len is 0)
+ * @param	len		Length of $entries.
+ * @param	before	The stamp of the staff file before the deletions were written. (Can be NULL to rebuild the index)
+ *
+ * @retval	0	Index successfully updated.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int addDepartures(DepartureEntry* entries, int len, StaffFileStamp* before);
+
+
+/**
+ * @brief	Finds the past employees that were deleted between two dates in O(log N + k).
+ *
+ * @param	from		First date of the range (inclusive), packed as (year<<16)|(month<<8)|day.
+ * @param	to			Last date of the range (inclusive), packed the same way as $from.
+ * @param	offset		Number of matching past employees to skip, in date order.
+ * @param	limit		Maximum number of past employees to read into $staffOut.
+ * @param	staffOut	An array of at least $limit Staff{} to fill, or NULL to only count.
+ *
+ * @retval	-3	File operation error.
+ * @return		Number of past employees deleted within the range.
+ */
+int queryDepartures(unsigned int from, unsigned int to, int offset, int limit, Staff* staffOut);
+
+
+/**
+ * @brief	Finds the index of the first entry with a date not less than $date.
+ *
+ * @param	indexFile	The opened departure date index.
+ * @param	length		Number of entries in $indexFile.
+ * @param	date		Packed date to search.
+ *
+ * @retval	-3	File operation error.
+ * @return		Index of the first entry that is not less than $date. ($length if none)
+ */
+int departureLowerBound(FILE* indexFile, int length, unsigned int date);
+
+
+/**
+ * @brief	Parses a departure date range typed in by the user.
+ *
+ * Accepted formats: (Empty for all dates)
+ *   2025                     (Whole year.)
+ *   2025-06                  (Whole month.)
+ *   Q2 2025                  (Quarter.)
+ *   2025-04-01..2025-06-30   (Inclusive date range.)
+ *
+ * @param	buf		The range typed in by the user.
+ * @param	from	A pointer to store the first packed date of the range.
+ * @param	to		A pointer to store the last packed date of the range.
+ *
+ * @return	Whether $buf is a valid range.
+ */
+bool parseDepartureRange(char* buf, unsigned int* from, unsigned int* to);
+
+
+/**
+ * @brief	qsort() comparator that orders departure entries by date, then by record.
+ */
+int compareDepartureEntry(const void* a, const void* b);
+
+
+/**
+ * @brief	Finds an existing staff by ID through the staff ID index, reading only its record from the staff file.
+ *
+ * @param	staffFile	The opened staff file. It is not closed, so the record locks held on it are kept.
+ * @param	id			The ID to find.
+ * @param	staff		A pointer to store the staff found. (Can be NULL)
+ *
+ * @retval	-3	File operation error.
+ * @retval	-15	No existing staff has the ID.
+ * @return		Index of the staff in the staff file.
+ */
+int findStaffId(FILE* staffFile, char* id, Staff* staff);
+
+
+/**
+ * @brief	Finds an existing staff by ID through a staff ID index opened with openStaffIdIndex().
+ *
+ * @param	staffFile	The opened staff file.
+ * @param	indexFile	The index file, locked by openStaffIdIndex(). Keep it open while the ID has to stay free.
+ * @param	header		A pointer to the header of the index.
+ * @param	id			The ID to find.
+ * @param	staff		A pointer to store the staff found. (Can be NULL)
+ *
+ * @retval	-3	File operation error.
+ * @retval	-15	No existing staff has the ID.
+ * @return		Index of the staff in the staff file.
+ */
+int findStaffIdSlot(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, char* id, Staff* staff);
+
+
+/**
+ * @brief	Records the new IDs of modified staff in the staff ID index, before the staff are written.
+ *
+ * Appended staff are picked up by openStaffIdIndex(), so only the modifications that change the ID of an existing record are indexed.
+ * A slot is only trusted once its record has the ID, so indexing first is safe, and another terminal waiting for the index
+ * finds the new ID as soon as the staff is written.
+ *
+ * @param	staffFile		The opened staff file. It is not closed, so the record locks held on it are kept.
+ * @param	indexFile		The index file, locked by openStaffIdIndex(). Keep it open until the staff are written.
+ * @param	header			A pointer to the header of the index, written back.
+ * @param	modifications	The modifications to index.
+ * @param	statuses		The status of every modification, only the ones with status 0 are indexed.
+ * @param	len				Length of $modifications.
+ *
+ * @retval	0	Index successfully updated.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int indexStaffIds(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, StaffModification* modifications, int* statuses, int len);
+
+
+/**
+ * @brief	Opens the staff ID index under an exclusive lock, indexing the records appended since, or rebuilding it.
+ *
+ * @param	staffFile	The opened staff file.
+ * @param	header		A pointer to store the header of the index. Its $stamp is set to the current stamp of the staff file.
+ * @param	before		The stamp of the staff file before the caller wrote it, which the index may still match. (Can be NULL)
+ *
+ * @return	The index file opened in "rb+" mode, NULL if it failed to open. Closing it releases the lock.
+ */
+FILE* openStaffIdIndex(FILE* staffFile, StaffIdIndexHeader* header, StaffFileStamp* before);
+
+
+/**
+ * @brief	Moves the staff ID index on to the stamp of the staff file after a write, indexing the records it appended.
+ *
+ * The staff file is not closed, so it can be called while holding record locks. A missing index is left to the next lookup.
+ *
+ * @param	staffFile	The opened staff file.
+ * @param	before		The stamp of the staff file before the write. (Can be NULL to rebuild the index)
+ *
+ * @retval	0	Index successfully updated.
+ * @retval	-3	File operation error.
+ */
+int stampStaffIdIndex(FILE* staffFile, StaffFileStamp* before);
+
+
+/**
+ * @brief	Rebuilds the staff ID index from the existing staff of the staff file.
+ *
+ * @param	staffFile	The opened staff file.
+ * @param	indexFile	The index file, locked by openStaffIdIndex().
+ * @param	header		A pointer to store the header of the rebuilt index.
+ * @param	extra		Number of slots to leave room for, for IDs not written to the staff file yet.
+ *
+ * @retval	0	Index successfully rebuilt.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int rebuildStaffIdIndex(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, int extra);
+
+
+/**
+ * @brief	Adds a slot to the staff ID index file, unless the same ID is already indexed at the same record.
+ *
+ * The header is not written back, write it after adding every slot.
+ *
+ * @param	indexFile	The index file, locked by openStaffIdIndex().
+ * @param	header		A pointer to the header of the index, its $length is updated.
+ * @param	id			The ID to add.
+ * @param	record		Index of the staff in the staff file.
+ *
+ * @retval	0	Slot successfully added.
+ * @retval	-3	File operation error.
+ */
+int addStaffIdSlot(FILE* indexFile, StaffIdIndexHeader* header, char* id, int record);
+
+
+/**
+ * @brief	Hashes a staff ID case insensitively with FNV-1a.
+ *
+ * @param	id	The ID to hash.
+ *
+ * @return	The hash of the ID.
+ */
+unsigned int hashStaffId(char* id);
+
+
+/**
+ * @brief	Adds a chunk of staff records into an aggregate.
+ *
+ * @param	agg		A pointer to the aggregate to add into.
+ * @param	staffArr	The records to add.
+ * @param	len		Length of $staffArr.
+ *
+ * @retval	0	Records successfully added.
+ * @retval	-4	Records failed to be added (Allocation operation error).
+ */
+int aggregateStaff(ReportAggregate* agg, Staff* staffArr, int len);
+
+
+/**
+ * @brief	Merges a partial aggregate into another one.
+ *
+ * @param	dest	A pointer to the aggregate to merge into.
+ * @param	src		A pointer to the aggregate to merge from. It is left untouched.
+ *
+ * @retval	0	Aggregates successfully merged.
+ * @retval	-4	Aggregates failed to be merged (Allocation operation error).
+ */
+int mergeReportAggregate(ReportAggregate* dest, ReportAggregate* src);
+
+
+/**
+ * @brief	Finds a bucket in the report table, inserting an empty one if it does not exist.
+ *
+ * @param	table		A pointer to the table to search.
+ * @param	position	Position to group by, or NULL to group by $key.
+ * @param	key			Packed departure month to group by, ignored if $position is not NULL.
+ *
+ * @return	A pointer to the bucket, or NULL if the table failed to grow.
+ */
+ReportBucket* reportTableFind(ReportTable* table, char* position, unsigned int key);
+
+
+/**
+ * @brief	Prints the summaries of the aggregate (totals, headcount by position and departures by month).
+ *
+ * @param	agg	A pointer to the aggregate to print.
+ */
+void printStaffReport(ReportAggregate* agg);
+
+
+/**
+ * @brief	Copies the used buckets out of a report table, and sorts them.
+ *
+ * @param	table	A pointer to the table to sort.
+ * @param	compare	The qsort() comparator to sort the buckets with.
+ * @param	length	A pointer to store the number of buckets listed.
+ *
+ * @return	The sorted buckets to free(), or NULL if they could not be allocated.
+ *			Then $length is set to the capacity of $table, to list its buckets unsorted, empty buckets included.
+ */
+ReportBucket* sortReportBuckets(ReportTable* table, int (*compare)(const void*, const void*), int* length);
+
+
+/**
+ * @brief	Frees the memory held by an aggregate.
+ *
+ * @param	agg	A pointer to the aggregate to free.
+ */
+void freeReportAggregate(ReportAggregate* agg);
+
+
+/**
+ * @brief	Task of computeStaffReport() that streams and aggregates a range of the staff file, or of the batch read from the staff daemon.
+ *
+ * @param	arg		A pointer to the ReportJob{}, $retval of the ReportWorker{} is set to a negative value on error.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first record of the range.
+ * @param	count	Number of records in the range.
+ */
+void reportTask(void* arg, int worker, long first, long count);
+
+
+/**
+ * @brief	Task of an unlimited countStaff(), counts the staff matching the query in a range of the staff file.
+ *
+ * @param	arg		A pointer to the StaffCountJob{}, $retval of the worker is set to a negative value on error.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first record of the range.
+ * @param	count	Number of records in the range.
+ */
+void countRecordsTask(void* arg, int worker, long first, long count);
+
+
+/**
+ * @brief	Hashes a report bucket key.
+ *
+ * @param	position	Position to hash case insensitively, or NULL to hash $key.
+ * @param	key			Packed departure month to hash if $position is NULL.
+ * @return				Hash of the key.
+ */
+unsigned int reportHash(char* position, unsigned int key);
+
+
+/**
+ * @brief	qsort() comparator that orders position buckets by headcount (descending), then by name.
+ */
+int compareReportPosition(const void* a, const void* b);
+
+
+/**
+ * @brief	qsort() comparator that orders month buckets chronologically.
+ */
+int compareReportMonth(const void* a, const void* b);
+
+/**
+ * @brief	Select staffs to delete.
+ *
+ * @retval	EOF	Staff deletion failed (EOF signal received).
+ * @retval	-15	Staff deletion failed (An error occured).
+ * @return		Number of staffs deleted.
+ */
+int deleteStaff(void);
+
+
+/**
+ * @brief	Deletes the existing staff with the listed IDs, through the staff daemon if it is running.
+ *
+ * Every deleted staff is recorded in the departure date index, and the page checksums are updated.
+ * The IDs found are emptied from $ids, so a staff listed twice is only deleted once.
+ *
+ * @param	staffFile	The staff file opened with "rb+", unused if the staff daemon is running.
+ * @param	staffArr	The whole staff file, as read by loadStaff(). (Unused if the staff daemon is running)
+ * @param	len			Number of staff in $staffArr.
+ * @param	ids			The IDs of the staff to delete.
+ * @param	idsLen		Number of IDs in $ids.
+ *
+ * @retval	-4	Staff deletion failed (Allocation error).
+ * @return		Number of staff deleted.
+ */
+int deleteStaffIds(FILE* staffFile, Staff* staffArr, int len, char** ids, int idsLen);
+
+
+/**
+ * @brief	Prompts the user to enter selected staff details and validate them.
+ *
+ * This function handles the user input by validating them for correctness.
+ * The inputted data will be truncated to the appropriate size to avoid buffer overflow.
+ * This function makes the assumption that $buf is appropriately sized (>= to the size of corresponding field in Staff{}).
+ * stdin buffer will always be read to after the newline character so next scanf() read will not be required to rewind() first.
+ * If EOF is received during the prompt, $buf is left in an incomplete state. (May contain invalid data)
+ *
+ * @param	buf				A pointer to the appropriately sized buffer.
+ * @param	selection		An enum containing the field that is going to be validated. Bit flip of enum will disable prompt message.
+ * @param	specialStrings	A bool indicating whether to validate the data or not.
+ *
+ * @retval	0	Read and validated successfully.
+ * @retval	EOF	EOF signal received, abort prompt.
+ * @retval	-2	Read but not validated (Exited with :q or :w).
+ * @retval	-14	Passing back control to callee (to reprint prompt) if bit flipped $selection is passed in.
+ * @retval	-15	Read but not validated (Not implemented).
+ */
+int promptStaffDetails(char* buf, enum StaffModifiableFields selection);
+
+
+/**
+ * @brief	Validates a staff detail with the same rules as promptStaffDetails(), without prompting.
+ *
+ * Hyphens and spaces are removed from phone and IC numbers in place.
+ *
+ * @param	buf		The NUL terminated value to validate, with its leading and trailing spaces removed.
+ * @param	field	The field that is validated.
+ *
+ * @return	NULL if $buf is valid, otherwise the message to show the user.
+ */
+char* checkStaffDetails(char* buf, enum StaffModifiableFields field);
+
+
+/**
+ * @brief	Returns a copy of a DisplayStaffOptions{} filled with the default values.
+ *
+ * All modifiable fields are:					\n
+ * Parameter				Default				\n
+ * char* header;			(NULL)				\n
+ * char** idList;			(NULL)				\n
+ * bool displayList[$N];	(all set to false)	\n
+ * int idListLen;			(0)					\n
+ * int entriesPerPage;		($E)				\n
+ * int page;				(0)					\n
+ * bool isInclude;			(true)				\n
+ * bool isInteractive;		(true)				\n
+ * bool displayDeleted;		(false)				\n
+ * bool displayExisting;	(true)				\n
+ * int orderBy;				(-1)				\n
+ *
+ * $N = $STAFF_ENUM_LENGTH, $E = $ENTRIES_PER_PAGE
+ *
+ * @return	A struct with the default values filled.
+ */
+DisplayStaffOptions displayStaffOptionsInit(void);
+
+
+/**
+ * @brief	Display the passed staff information in a nice table format.
+ *
+ * @param	displayOptions	A pointer to the display options for the staff data.
+ *
+ * @retval	EOF	Print operation aborted (EOF signal received).
+ * @retval	-3	Print operation failed (File operation error).
+ * @retval	-4	Print operation failed (Allcoation operation error).
+ * @return		Number of fields matched.
+ */
+int displaySelectedStaff(DisplayStaffOptions* options);
+
+
+/**
+ * @brief	Extends the sorted prefix of the matched staff ($ordered) to at least $want rows.
+ *
+ * Only the rows needed for the current page are selected, with a bounded max heap over the matched staff not in the prefix yet.
+ * This costs O(N log k) for k new rows, instead of sorting all N matches.
+ * Rows are ordered by $orderBy (case insensitive), then by their position in the staff file.
+ *
+ * @param	options		A pointer to the display options holding the prefix.
+ * @param	staffArr	The whole staff file.
+ * @param	includeFlag	Bitset of the matched staff.
+ * @param	want		Number of rows the prefix should hold. Must not exceed the number of matched staff.
+ *
+ * @retval	0	Prefix successfully extended.
+ * @retval	-4	Prefix failed to be extended (Allocation operation error).
+ */
+int extendStaffOrder(DisplayStaffOptions* options, Staff* staffArr, char* includeFlag, int want);
+
+
+/**
+ * @brief	Compares two staff by a field (case insensitive), then by their position in the staff file.
+ *
+ * @param	staffArr	The whole staff file.
+ * @param	a			Index of the first staff.
+ * @param	b			Index of the second staff.
+ * @param	field		One of StaffModifiableFields to compare.
+ *
+ * @return	Negative if $a goes before $b, positive if after, 0 if $a is $b.
+ */
+int compareStaffOrder(Staff* staffArr, int a, int b, int field);
+
+
+/**
+ * @brief	Moves a row down a max heap of staff indexes until the heap is valid again.
+ *
+ * @param	heap		The heap of staff indexes.
+ * @param	len			Length of $heap.
+ * @param	i			Index in $heap of the row to move down.
+ * @param	staffArr	The whole staff file.
+ * @param	field		One of StaffModifiableFields the heap is ordered by.
+ */
+void siftDownStaffOrder(int* heap, int len, int i, Staff* staffArr, int field);
+
+
+/**
+ * @brief	Presents the user with a login screen and prompts the user to login.
+ *
+ * A login screen that allows staffs to login.
+ * The staff's ID will be used to determine which staff is planning to login.
+ * If the staff's ID is valid and matched one of the records, a password will be prompted.
+ * If the inputted password is incorrect thrice, staff ID will be prompted again in case the staff ID was entered incorrectly.
+ * A complete Staff struct with the corresponding staff details will be returned, after the staff has logged in.
+ *
+ * @return	First byte of ID is filled with 0 to indicate error, the next byte will be filled with the error code.
+ * @return	Logged in user's Staff struct.
+ */
+Staff loginStaff(void);
+
+
+/**
+ * @brief	Presents the user with a screen to choose which staff function to perform.
+ *
+ * @param	loggedInUser	A pointer to the logged in user's struct.
+ *
+ * @retval	0	Quit normally.
+ * @retval	EOF	EOF signal received.
+ */
+int menuStaff(Staff* loggedInUser);
+
+
+/**
+ * @brief	Exports the staff matching every query, streamed from the staff file.
+ *
+ * Arguments:						\n
+ * --field FIELD					(The field the following queries match.)	\n
+ * --like QUERY / --not-like QUERY	(Match or exclude the staff whose field is like $QUERY.)	\n
+ * --fields FIELD,...				(Only export these fields, in the order of Staff{}.)	\n
+ * --format tsv/csv/jsonl			(Overrides $format.)	\n
+ * --output FILE					(Export to FILE instead of stdout.)	\n
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The arguments after the command.
+ * @param	format	A StaffExportFormats to export with if no --format is given.
+ *
+ * @retval	0	Staff file successfully exported.
+ * @retval	-3	Staff export failed (File operation error).
+ * @retval	-4	Staff export failed (Allocation error).
+ * @retval	-18	Staff export failed (Invalid arguments).
+ */
+int exportStaffCommand(int argc, char** argv, int format);
+
+
+/**
+ * @brief	Parses a query argument of a command, "--field FIELD", "--like QUERY" or "--not-like QUERY".
+ *
+ * @param	argc		Number of arguments after the command.
+ * @param	argv		The arguments after the command.
+ * @param	i			A pointer to the index of the argument, moved past its value if it is consumed.
+ * @param	field		A pointer to the field of the following queries, -1 before any --field.
+ * @param	queries		The queries parsed so far, sized for $argc/2 queries.
+ * @param	queriesLen	A pointer to the number of queries in $queries.
+ *
+ * @retval	1	The argument was parsed.
+ * @retval	0	The argument is not a query argument.
+ * @retval	-18	The argument is invalid.
+ */
+int parseStaffQueryArgument(int argc, char** argv, int* i, int* field, StaffQuery* queries, int* queriesLen);
+
+
+/**
+ * @brief	Streams the staff matching $options->queries to $options->output, through the staff daemon if it is running.
+ *
+ * @param	options	A pointer to the export options.
+ *
+ * @retval	0	Staff file successfully exported.
+ * @retval	-3	Staff export failed (File operation error).
+ * @retval	-4	Staff export failed (Allocation error).
+ */
+int exportStaff(StaffExport* options);
+
+
+/**
+ * @brief	Appends a staff to a frame as a row of an export.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	staff	The staff to export.
+ * @param	options	A pointer to the export options, for the format and fields.
+ */
+void frameStaffRow(Frame* frame, Staff* staff, StaffExport* options);
+
+
+/**
+ * @brief	Adds the staff read from a file, one staff per line with tab separated fields followed by the password.
+ *
+ * Every line is validated like promptStaffDetails(), the invalid lines and the lines with an existing ID are reported to stderr and skipped.
+ * The valid lines are read first, then appended together with appendStaffRows().
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The arguments after the command, "--from FILE" where FILE is "-" for stdin.
+ *
+ * @retval	0	Every staff successfully added.
+ * @retval	-3	Staff addition stopped (File operation error).
+ * @retval	-4	Staff addition stopped (Allocation error).
+ * @retval	-15	Some lines were skipped.
+ * @retval	-18	Staff addition failed (Invalid arguments).
+ */
+int addStaffCommand(int argc, char** argv);
+
+
+/**
+ * @brief	Deletes the staff with the IDs passed as arguments, or every staff matching the queries passed as arguments.
+ *
+ * Arguments, instead of IDs:		\n
+ * --field FIELD					(The field the following queries match.)	\n
+ * --like QUERY / --not-like QUERY	(Delete or keep the staff whose field is like $QUERY.)	\n
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The IDs of the staff to delete, or the queries.
+ *
+ * @retval	0	Every staff successfully deleted.
+ * @retval	-3	Staff deletion failed (File operation error).
+ * @retval	-4	Staff deletion failed (Allocation error).
+ * @retval	-15	Some IDs did not match an existing staff.
+ * @retval	-18	Staff deletion failed (Invalid arguments).
+ */
+int deleteStaffCommand(int argc, char** argv);
+
+
+/**
+ * @brief	Deletes every staff matching all the queries, in one pass over the staff file.
+ *
+ * The staff file is read in chunks of STAFF_STREAM_CHUNK staff, each chunk is locked while its matching staff are tombstoned,
+ * and every run of adjacent matching staff is written back with a single write.
+ * The departure date index and the page checksums are updated once, after the whole pass.
+ * If the staff daemon is running, it matches the queries and deletes the matching staff with one SR_PURGE request, while holding its lock.
+ *
+ * @param	queries		The queries every deleted staff matches.
+ * @param	queriesLen	Number of queries in $queries.
+ *
+ * @retval	-3	Staff deletion failed (File operation error).
+ * @retval	-4	Staff deletion failed (Allocation error).
+ * @return		Number of staff deleted.
+ */
+int deleteStaffWhere(StaffQuery* queries, int queriesLen);
+
+
+/**
+ * @brief	Sets fields of every staff matching the queries passed as arguments.
+ *
+ * Arguments:						\n
+ * --set FIELD=VALUE				(The value to set the field to, validated like promptStaffDetails(). The ID can not be set.)	\n
+ * --field FIELD					(The field the following queries match.)	\n
+ * --like QUERY / --not-like QUERY	(Update or skip the staff whose field is like $QUERY.)	\n
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The arguments after the command.
+ *
+ * @retval	0	Staff successfully updated.
+ * @retval	-3	Staff update failed (File operation error).
+ * @retval	-4	Staff update failed (Allocation error).
+ * @retval	-18	Staff update failed (Invalid arguments).
+ */
+int updateStaffCommand(int argc, char** argv);
+
+
+/**
+ * @brief	Sets the fields of $update on every staff matching all the queries, in one pass over the staff file.
+ *
+ * The staff file is read in chunks of STAFF_STREAM_CHUNK staff, each chunk is locked while its matching staff are updated,
+ * and every run of adjacent updated staff is written back in file order with a single write.
+ * The page checksums are updated once, after the whole pass.
+ * If the staff daemon is running, it updates its table with one request instead.
+ *
+ * @param	update		The fields to set and their values.
+ * @param	queries		The queries every updated staff matches.
+ * @param	queriesLen	Number of queries in $queries.
+ *
+ * @retval	-3	Staff update failed (File operation error).
+ * @retval	-4	Staff update failed (Allocation error).
+ * @return		Number of staff updated, the staff that already had every value are not counted.
+ */
+int updateStaffWhere(StaffUpdate* update, StaffQuery* queries, int queriesLen);
+
+
+/**
+ * @brief	Imports the staff of a CSV file in bulk: ID, name, position, phone, IC and password, after an optional header row.
+ *
+ * Every row is validated like promptStaffDetails(), the invalid rows and the rows with an existing ID are reported to stderr and skipped.
+ * The passwords are hashed together with computeHashBatch(), and the new staff are appended together with appendStaffRows().
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The arguments after the command, the CSV file or "-" for stdin.
+ *
+ * @retval	0	Every staff successfully imported.
+ * @retval	-3	Staff import failed (File operation error).
+ * @retval	-4	Staff import failed (Allocation error).
+ * @retval	-15	Some rows were skipped.
+ * @retval	-18	Staff import failed (Invalid arguments).
+ */
+int importStaffCommand(int argc, char** argv);
+
+
+/**
+ * @brief	Appends the staff of a bulk addition, skipping the rows whose ID already exists.
+ *
+ * The IDs of the staff file are read once into a StaffIdSet{}, while holding the append lock, so the IDs are checked against the file
+ * and against the earlier rows in O(1). The kept staff are appended with a single write, and the page checksums are updated once.
+ * Through the staff daemon, the staff are sent in as few SR_ADD requests as $DAEMON_REQUEST_MAX allows.
+ *
+ * @param	rows		The staff to append, the kept staff are moved to the front in order.
+ * @param	rowLines	The input line of each staff, for the messages. (Overwritten with the appended records)
+ * @param	rowsLen		Length of $rows.
+ * @param	added		A pointer to store the number of staff appended in.
+ *
+ * @retval	0	Every staff successfully appended.
+ * @retval	-3	Staff addition stopped (File operation error).
+ * @retval	-4	Staff addition stopped (Allocation error).
+ * @retval	-15	Some staff were skipped, their ID exists.
+ */
+int appendStaffRows(Staff* rows, int* rowLines, int rowsLen, int* added);
+
+
+/**
+ * @brief	Reads a CSV record (RFC 4180), unquoting its fields in place.
+ *
+ * @param	cursor		A pointer to the start of the record, moved to the start of the next record.
+ * @param	end			The end of the text, which has to be writable.
+ * @param	fields		An array to store a pointer to each NUL terminated field in.
+ * @param	maxFields	Length of $fields, the fields past it are not stored.
+ * @param	line		A pointer to the line number, incremented for each line read.
+ *
+ * @return	Number of fields of the record, which may be more than $maxFields.
+ */
+int readCSVRecord(char** cursor, char* end, char** fields, int maxFields, int* line);
+
+
+/**
+ * @brief	Validates the fields of a staff with checkStaffDetails(), and copies them to a staff.
+ *
+ * The staff fields are trimmed of leading and trailing spaces first, like promptStaffDetails() does. The password is kept as is.
+ *
+ * @param	fields	The ID, name, position, phone, IC and password of the staff. (The staff fields are trimmed in place)
+ * @param	staff	A pointer to store the staff in, without its password hash.
+ *
+ * @return	NULL if every field is valid, otherwise the message to show the user.
+ */
+char* parseStaffRow(char** fields, Staff* staff);
+
+
+/**
+ * @brief	Adds a staff ID to a set of IDs.
+ *
+ * @param	set	A pointer to the set, zero initialised at first. (Free $set->ids after use)
+ * @param	id	The ID to add.
+ *
+ * @retval	1	ID added.
+ * @retval	0	ID already in the set.
+ * @retval	-4	Allocation error.
+ */
+int addStaffId(StaffIdSet* set, char* id);
+
+
+/**
+ * @brief	Prints the staff report summaries, as printStaffReport() does or as a JSON object with "--json".
+ *
+ * @param	argc	Number of arguments after the command.
+ * @param	argv	The arguments after the command.
+ *
+ * @retval	0	Report successfully printed.
+ * @retval	-3	Report failed (File operation error).
+ * @retval	-4	Report failed (Allocation error).
+ * @retval	-18	Report failed (Invalid arguments).
+ */
+int reportStaffCommand(int argc, char** argv);
+
+
+/**
+ * @brief	Hashes the inputted string (password) to a one-way BLAKE2 hash.
+ *
+ * A BLAKE2 message digest hash function that takes in a message to produce a fixed sized hash.
+ * This is BLAKE2b with an 8 bytes digest and no key, hashed with BLAKE2bInit(), BLAKE2bUpdate() and BLAKE2bFinal().
+ * Salting isn't in the scope of this hashing function.
+ *
+ * Any bytes after the null-terminated string will be ignored and will not affect the result of the hash.
+ *
+ * References:
+ * 	RFC 7693: https://datatracker.ietf.org/doc/html/rfc7693
+ *
+ * @param	msg	A pointer to a char array to be hashed.
+ * @return		8 bytes hash of the string (password).
+ */
+u64 computeHash(char* msg);
+
+
+/**
+ * @brief	Starts an incremental BLAKE2b hash.
+ *
+ * References:
+ * 	RFC 7693: https://datatracker.ietf.org/doc/html/rfc7693
+ *
+ * @param	ctx		A pointer to the context to initialise.
+ * @param	outLen	Digest size in bytes, 1 to $BLAKE2B_OUT_MAX.
+ * @param	key		Key for keyed hashing (MAC), or NULL for no key.
+ * @param	keyLen	Length of $key in bytes, 0 to $BLAKE2B_OUT_MAX.
+ *
+ * @retval	0	Context successfully initialised.
+ * @retval	-15	Invalid $outLen or $keyLen.
+ */
+int BLAKE2bInit(BLAKE2bContext* ctx, int outLen, const void* key, int keyLen);
+
+
+/**
+ * @brief	Adds more bytes to an incremental BLAKE2b hash.
+ *
+ * Can be called any number of times, with any number of bytes each.
+ *
+ * @param	ctx		A pointer to the context.
+ * @param	data	The bytes to hash.
+ * @param	len		Number of bytes in $data.
+ */
+void BLAKE2bUpdate(BLAKE2bContext* ctx, const void* data, size_t len);
+
+
+/**
+ * @brief	Finishes an incremental BLAKE2b hash. The context is erased afterwards.
+ *
+ * @param	ctx		A pointer to the context.
+ * @param	out		A buffer of $outLen bytes (see BLAKE2bInit()) to store the digest in.
+ */
+void BLAKE2bFinal(BLAKE2bContext* ctx, void* out);
+
+
+/**
+ * @brief	Hashes a buffer with BLAKE2b in one go.
+ *
+ * @param	out		A buffer of $outLen bytes to store the digest in.
+ * @param	outLen	Digest size in bytes, 1 to $BLAKE2B_OUT_MAX.
+ * @param	data	The bytes to hash.
+ * @param	len		Number of bytes in $data.
+ * @param	key		Key for keyed hashing (MAC), or NULL for no key.
+ * @param	keyLen	Length of $key in bytes, 0 to $BLAKE2B_OUT_MAX.
+ *
+ * @retval	0	Buffer successfully hashed.
+ * @retval	-15	Invalid $outLen or $keyLen.
+ */
+int BLAKE2b(void* out, int outLen, const void* data, size_t len, const void* key, int keyLen);
+
+
+/**
+ * @brief	Hashes many strings (passwords) at once, giving the same hashes as computeHash().
+ *
+ * With the AVX2 kernel selected, 4 messages are compressed at once, one per 64 bits lane.
+ * Each state word of the 4 messages shares one register, so no shuffling is needed between the lanes.
+ * Messages that need less blocks than the others in their group keep their hash once they are done.
+ * Otherwise (and for the remaining messages) each message is hashed with computeHash().
+ *
+ * @param	msgs	An array of pointers to the null-terminated strings to hash.
+ * @param	hashes	An array to store the 8 bytes hash of each message in.
+ * @param	count	Length of $msgs and $hashes.
+ */
+void computeHashBatch(char** msgs, u64* hashes, int count);
+
+
+/**
+ * @brief	AVX2 BLAKE2b compression of 4 independent messages, one per 64 bits lane.
+ *
+ * @param	hash	The 8 words hash state of each message, $hash[word][lane].
+ * @param	m		The 16 words message block of each message, $m[word][lane].
+ * @param	t0		Number of bytes compressed of each message (including $m).
+ * @param	f0		Finalisation flag of each message, all bits set for the last block, else 0.
+ * @param	active	All bits set for the messages to compress, 0 for the messages whose $hash is left untouched.
+ */
+void BLAKE2bF4AVX2(u64 (*hash)[4], u64 (*m)[4], u64* t0, u64* f0, u64* active);
+
+
+/**
+ * @brief	Compress function defined by BLAKE2b.
+ *
+ * Dispatches to the selected BLAKE2b kernel. (See useBLAKE2bKernel())
+ * All kernels produce the same hash.
+ *
+ * @param	hash		Pointer to the 64 bytes hash array.
+ * @param	msg			Pointer to one of the 128 bytes chunk of the inputted message.
+ * @param	compressed	Number of bytes that has been compressed (including $msg).
+ * @param	isLastBlock	A boolean value that tells whether or not the current message chunk is the last one.
+ */
+void BLAKE2bF(u64* hash, char* msg, u64 compressed, bool isLastBlock);
+
+
+/**
+ * @brief	Selects the BLAKE2b kernel used by BLAKE2bF().
+ *
+ * @param	kernel	One of BLAKE2bKernels, or -1 to select the fastest kernel supported by the CPU.
+ *
+ * @return	The kernel selected. If $kernel is not supported by the CPU, the kernel is left unchanged.
+ */
+int useBLAKE2bKernel(int kernel);
+
+
+/**
+ * @brief	Selects the fastest BLAKE2b kernel supported by the CPU on first use, before BLAKE2bF() or useBLAKE2bKernel() read it.
+ *
+ * Workers may hash concurrently, so the kernel is selected exactly once. (See selectBLAKE2bKernel())
+ */
+void initBLAKE2bKernel(void);
+
+
+/**
+ * @brief	Selects the fastest BLAKE2b kernel supported by the CPU. (Run once with pthread_once())
+ */
+void selectBLAKE2bKernel(void);
+
+
+/**
+ * @brief	Checks if the CPU supports a BLAKE2b kernel.
+ *
+ * @param	kernel	One of BLAKE2bKernels.
+ *
+ * @return	A true or false value indicating if $kernel can be used.
+ */
+bool isBLAKE2bKernelSupported(int kernel);
+
+
+/**
+ * @brief	Portable BLAKE2b compression kernel.
+ *
+ * All kernels take the same parameters:
+ *
+ * @param	hash	Pointer to the 8 words hash state.
+ * @param	m		Pointer to the 16 words message block.
+ * @param	t0		Low word of the number of bytes compressed (including $m).
+ * @param	t1		High word of the number of bytes compressed.
+ * @param	f0		Finalisation flag, all bits set for the last block, else 0.
+ */
+void BLAKE2bFScalar(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0);
+
+
+/**
+ * @brief	SSSE3 BLAKE2b compression kernel, each row of the working vector is held in two 128 bits registers.
+ *
+ * See BLAKE2bFScalar() for the parameters.
+ */
+void BLAKE2bFSSSE3(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0);
+
+
+/**
+ * @brief	AVX2 BLAKE2b compression kernel, each row of the working vector is held in one 256 bits register.
+ *
+ * The 4 G functions of a column (or diagonal) step run in parallel in the 4 lanes.
+ * See BLAKE2bFScalar() for the parameters.
+ */
+void BLAKE2bFAVX2(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0);
+
+
+/**
+ * @brief	Runs the BLAKE2b known answer tests on every kernel supported by the CPU. (staff --selftest)
+ *
+ * Tests:
+ *   RFC 7693 Appendix A, the 64 bytes BLAKE2b digest of "abc".
+ *   RFC 7693 Appendix E, a hash of the digests of many lengths, digest sizes and keys.
+ *   computeHash() and computeHashBatch() against known 8 bytes digests.
+ * The 8 bytes digests are BLAKE2b with an 8 bytes digest size, which is not a truncated 64 bytes digest. (Digest size is hashed too)
+ *
+ * @return	Number of failed tests.
+ */
+int testHash(void);
+
+
+/**
+ * @brief	Measures the throughput of every BLAKE2b kernel supported by the CPU. (staff --bench)
+ *
+ * Prints MB/s, hashes/second and cycles/byte of BLAKE2b() for message sizes from 8 bytes to 1 MiB,
+ * followed by the passwords/second of computeHash() and computeHashBatch().
+ *
+ * @retval	0	Benchmark ran successfully.
+ * @retval	-4	Benchmark failed (Allocation operation error).
+ */
+int benchHash(void);
+
+
+/**
+ * @brief	Fills a buffer with the deterministic byte sequence of the RFC 7693 self-test.
+ *
+ * @param	out		The buffer to fill.
+ * @param	len		Number of bytes to fill.
+ * @param	seed	Seed of the sequence.
+ */
+void selftestSequence(unsigned char* out, int len, unsigned int seed);
+
+
+/**
+ * @brief	Reads the CPU timestamp counter.
+ *
+ * @return	Number of cycles since an arbitrary point, or 0 if there is no counter.
+ */
+u64 readCycleCounter(void);
+
+
+/**
+ * @brief	Computes the CRC32C (Castagnoli) of a buffer, using the SSE4.2 crc32 instruction if the CPU supports it.
+ *
+ * @param	crc		CRC32C of the preceding bytes, or 0 to start a new CRC32C.
+ * @param	data	The bytes to compute.
+ * @param	len		Number of bytes in $data.
+ *
+ * @return	CRC32C of the preceding bytes followed by $data.
+ */
+unsigned int crc32c(unsigned int crc, const void* data, size_t len);
+
+
+/**
+ * @brief	Portable CRC32C kernel, one table lookup per byte.
+ *
+ * All kernels take the same parameters, without the pre and post inversion done by crc32c():
+ *
+ * @param	crc		The CRC register.
+ * @param	data	The bytes to compute.
+ * @param	len		Number of bytes in $data.
+ *
+ * @return	The CRC register after $data.
+ */
+unsigned int crc32cScalar(unsigned int crc, const void* data, size_t len);
+
+
+/**
+ * @brief	SSE4.2 CRC32C kernel, 8 bytes per crc32 instruction.
+ *
+ * See crc32cScalar() for the parameters.
+ */
+unsigned int crc32cSSE42(unsigned int crc, const void* data, size_t len);
+
+
+/**
+ * @brief	Fills the lookup table of crc32cScalar() and selects the kernel used by crc32c(). (Run once with pthread_once())
+ */
+void selectCrc32cKernel(void);
+
+
+/**
+ * @brief	Records the writes to the staff file in the page checksums.
+ *
+ * Must be called after the writes are flushed to the staff file.
+ * The checksums are computed from the records as written, not read back, so a torn write leaves its page mismatched.
+ * Records appended by other terminals that did not update the checksums yet are read from the staff file.
+ * If the checksums have to be rebuilt, the writes are already picked up from the staff file.
+ * The Merkle tree is updated as well, see updateMerkleTree().
+ *
+ * @param	records		Indexes of the records written, sorted in ascending order.
+ * @param	originals	The records as they were before being overwritten. (NULL if every record was appended)
+ * @param	written		The records as written.
+ * @param	len			Length of $records, $originals and $written.
+ *
+ * @retval	0	Checksums successfully updated.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ * @retval	-15	Staff file is shorter than the checksums (or Merkle tree), left for verifyChecksums() to report.
+ */
+int updateChecksums(int* records, Staff* originals, Staff* written, int len);
+
+
+/**
+ * @brief	Rebuilds the page checksums with a full scan of the staff file.
+ *
+ * @retval	0	Checksums successfully rebuilt.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int rebuildChecksums(void);
+
+
+/**
+ * @brief	Reads or writes the checksum of one page in the page checksums.
+ *
+ * @param	checksumFile	The opened page checksums.
+ * @param	pageIndex		Index of the page.
+ * @param	checksum		A pointer to the checksum to read into, or to write.
+ * @param	write			Whether to write $checksum instead of reading it.
+ *
+ * @retval	0	Checksum successfully read or written.
+ * @retval	-3	File operation error.
+ */
+int accessPageChecksum(FILE* checksumFile, int pageIndex, unsigned int* checksum, bool write);
+
+
+/**
+ * @brief	Verifies every page of the staff file against its checksum, using the task pool. (staff --verify)
+ *
+ * Prints the pages that do not match. If there are no checksums yet, they are created from the staff file instead.
+ *
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of problems found, the mismatched pages plus 1 if the number of records does not match.
+ */
+int verifyChecksums(void);
+
+
+/**
+ * @brief	Task of verifyChecksums() and the rebuilds, hashes a range of pages of the staff file.
+ *
+ * @param	arg		A pointer to the PageHashJob{}.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first page of the range.
+ * @param	count	Number of pages in the range.
+ */
+void hashPagesTask(void* arg, int worker, long first, long count);
+
+
+/**
+ * @brief	Hashes the first $job->recordCount records of the staff file by pages, using the task pool.
+ *
+ * @param	job		A pointer to the job, with the arrays to fill.
+ *
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of workers the pages were split between.
+ */
+int hashPages(PageHashJob* job);
+
+
+/**
+ * @brief	Runs a function over a range of items, split in tasks run by the workers of the task pool.
+ *
+ * Ranges of at most $grain items are run on the calling thread without waking the pool, and so are the jobs started
+ * while the pool runs another job.
+ * $body must be safe to call from several threads at once, with different workers.
+ *
+ * @param	count	Number of items.
+ * @param	grain	Tasks are not split below this many items.
+ * @param	body	The function run by the tasks, with the index of the worker (less than $POOL_THREADS_MAX)
+ * 					and the range of items of the task.
+ * @param	arg		The argument passed to $body.
+ *
+ * @return	Number of workers the items were split between.
+ */
+int parallelFor(long count, long grain, void (*body)(void* arg, int worker, long first, long count), void* arg);
+
+
+/**
+ * @brief	Gets the worker count and the statistics of the jobs run by the task pool so far.
+ *
+ * @param	stats	A pointer to store the statistics.
+ */
+void getTaskPoolStats(TaskPoolStats* stats);
+
+
+#ifdef STAFF_THREADS
+/**
+ * @brief	Starts the threads of the task pool. (Run once with pthread_once())
+ */
+void startTaskPool(void);
+
+
+/**
+ * @brief	Thread entry of a worker of the task pool, runs the tasks of every job.
+ *
+ * @param	arg	A pointer to the PoolDeque{} of the worker.
+ * @return		Never returns.
+ */
+void* poolWorker(void* arg);
+
+
+/**
+ * @brief	Runs tasks of the current job until it is finished.
+ *
+ * @param	worker	Index of the worker.
+ */
+void runPoolTasks(int worker);
+
+
+/**
+ * @brief	Takes the newest task of a worker deque, or steals the oldest task of a random worker, waiting for one if needed.
+ *
+ * @param	worker	Index of the worker.
+ * @param	task	A pointer to store the task.
+ * @param	stolen	A pointer to store whether the task was stolen.
+ *
+ * @return	A true or false value indicating if a task was taken, false once the job is finished.
+ */
+bool nextPoolTask(int worker, PoolTask* task, bool* stolen);
+
+
+/**
+ * @brief	Pushes a task to the bottom of a worker deque, and wakes the idle workers.
+ *
+ * @param	worker	Index of the worker.
+ * @param	task	The task to push.
+ *
+ * @return	A true or false value indicating if the task was pushed, false if the deque is full.
+ */
+bool pushPoolTask(int worker, PoolTask task);
+#endif
+
+
+/**
+ * @brief	Records the writes to the staff file in the Merkle tree, updating the path from each written leaf to the root.
+ *
+ * Called by updateChecksums(), see it for the parameters.
+ * If the tree has to be rebuilt, the writes are already picked up from the staff file.
+ *
+ * @retval	0	Merkle tree successfully updated.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ * @retval	-15	Staff file is shorter than the Merkle tree.
+ */
+int updateMerkleTree(int* records, int len);
+
+
+/**
+ * @brief	Rebuilds the Merkle tree with a full scan of the staff file.
+ *
+ * @retval	0	Merkle tree successfully rebuilt.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int rebuildMerkleTree(void);
+
+
+/**
+ * @brief	Reads one page of the staff file, and writes its leaf and every ancestor of the leaf up to the root.
+ *
+ * @param	staffFile	The opened staff file.
+ * @param	merkleFile	The opened Merkle tree.
+ * @param	page		A buffer of $CHECKSUM_PAGE_RECORDS Staff{} to read the page into.
+ * @param	capacity	Number of leaves of the Merkle tree.
+ * @param	pageIndex	Index of the page.
+ *
+ * @retval	0	Path successfully written.
+ * @retval	-3	File operation error.
+ */
+int updateMerkleLeaf(FILE* staffFile, FILE* merkleFile, Staff* page, int capacity, int pageIndex);
+
+
+/**
+ * @brief	Computes the Merkle tree leaf of a page.
+ *
+ * @param	digest	A buffer of $MERKLE_DIGEST_BYTES bytes to store the leaf.
+ * @param	page	The records of the page.
+ * @param	len		Number of records in $page.
+ */
+void hashMerkleLeaf(unsigned char* digest, Staff* page, int len);
+
+
+/**
+ * @brief	Computes a Merkle tree node from its children.
+ *
+ * @param	digest		A buffer of $MERKLE_DIGEST_BYTES bytes to store the node.
+ * @param	children	The left child followed by the right child.
+ */
+void hashMerkleNode(unsigned char* digest, unsigned char* children);
+
+
+/**
+ * @brief	Opens a Merkle tree file and reads its header.
+ *
+ * @param	path	Path of the Merkle tree file.
+ * @param	mode	Mode to open the file with, "rb" (locked shared) or "rb+" (locked exclusively).
+ * @param	header	A pointer to store the header.
+ *
+ * @return	The opened file, or NULL if it failed to open or is not a valid Merkle tree. Closing it releases the lock.
+ */
+FILE* openMerkleTree(char* path, char* mode, MerkleHeader* header);
+
+
+/**
+ * @brief	Prints the root hash of the staff file from the Merkle tree. (staff --merkle-root)
+ *
+ * The Merkle tree is created from the staff file first if it is missing.
+ *
+ * @retval	0	Root hash printed.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int printMerkleRoot(void);
+
+
+/**
+ * @brief	Lists the pages that differ between the staff file and another Merkle tree, e.g. of a backup. (staff --merkle-diff)
+ *
+ * Only the differing nodes are read, O(k log N) for k differing pages.
+ *
+ * @param	path	Path of the other Merkle tree file.
+ *
+ * @retval	-3	File operation error.
+ * @return		Number of differing pages.
+ */
+int diffMerkleTree(char* path);
+
+
+/**
+ * @brief	Compares two subtrees that cover the same pages, and prints the differing pages.
+ *
+ * @param	ours		Our Merkle tree file.
+ * @param	theirs		Their Merkle tree file.
+ * @param	ourNode		Index of the subtree root in $ours.
+ * @param	theirNode	Index of the subtree root in $theirs.
+ * @param	firstPage	Index of the first page covered by the subtrees.
+ * @param	span		Number of pages covered by the subtrees, a power of 2.
+ * @param	recordCount	Number of records in the larger staff file, pages past it are not printed.
+ *
+ * @retval	-3	File operation error.
+ * @return		Number of differing pages.
+ */
+int diffMerkleNodes(FILE* ours, FILE* theirs, int ourNode, int theirNode, int firstPage, int span, int recordCount);
+
+
+/**
+ * @brief	Runs the staff daemon, serving the staff file from memory over $STAFF_SOCKET until interrupted. (staff --serve)
+ *
+ * Every client is served by its own thread with serveStaffClient(). (See StaffTable{})
+ *
+ * @retval	-3	File or socket operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int serveStaff(void);
+
+
+/**
+ * @brief	Signal handler that stops the staff daemon after the request being served.
+ *
+ * @param	sig		The signal received.
+ */
+void stopStaffDaemon(int sig);
+
+
+#ifdef STAFF_DAEMON
+/**
+ * @brief	Thread entry of the staff daemon serving one client, until it disconnects or its socket is shut down.
+ *
+ * @param	arg	A pointer to the StaffClient{} of the client.
+ * @return		Always NULL.
+ */
+void* serveStaffClient(void* arg);
+
+
+/**
+ * @brief	Reads one request from a client of the staff daemon and replies to it.
+ *
+ * Lookups read the published view, every other request holds the table lock.
+ * Both reload the table first if the staff file was written by another program. (See refreshStaffTable())
+ *
+ * @param	table	The in-memory staff file.
+ * @param	client	Socket of the client.
+ * @param	reader	Reader slot of the calling thread in $table->readers.
+ * @param	session	Index of the staff the client logged in as with SR_LOGIN, -1 if none. Updated by SR_LOGIN.
+ *
+ * @retval	0	Request served.
+ * @retval	-3	Connection closed or broken (or the request is longer than $DAEMON_REQUEST_MAX), close $client.
+ */
+int serveStaffRequest(StaffTable* table, int client, int reader, int* session);
+
+
+/**
+ * @brief	Enters a lookup of the staff daemon, and gets the published view of the table.
+ *
+ * The view stays valid until leaveStaffView(), without locking.
+ *
+ * @param	table	The in-memory staff file.
+ * @param	reader	Reader slot of the calling thread.
+ *
+ * @return	The published view.
+ */
+StaffView* enterStaffView(StaffTable* table, int reader);
+
+
+/**
+ * @brief	Leaves a lookup entered with enterStaffView().
+ *
+ * @param	table	The in-memory staff file.
+ * @param	reader	Reader slot of the calling thread.
+ */
+void leaveStaffView(StaffTable* table, int reader);
+
+
+/**
+ * @brief	Publishes the current version and ID index of a table as its new view, and retires the old view. (Hold the table lock)
+ *
+ * Then frees the retired views no reader can still be reading.
+ *
+ * @param	table	The in-memory staff file.
+ * @param	view	An allocated view to publish, it can not fail this way.
+ */
+void publishStaffView(StaffTable* table, StaffView* view);
+
+
+/**
+ * @brief	Frees the retired views of a table that no reader entered before. (Hold the table lock)
+ *
+ * @param	table	The in-memory staff file.
+ */
+void reclaimStaffViews(StaffTable* table);
+
+
+/**
+ * @brief	Unpins the version of a view, and frees the view with its ID index if it owns it.
+ *
+ * @param	view	The view to free.
+ */
+void freeStaffView(StaffView* view);
+
+
+/**
+ * @brief	Copies the page table of the ID index of a table if the published view shares it, so it can be written. (Hold the table lock)
+ *
+ * The pages stay shared, staffTableIndex() and staffTableUnindex() copy the pages they write.
+ *
+ * @param	table	The in-memory staff file.
+ *
+ * @retval	0	The index can be written.
+ * @retval	-4	Allocation operation error.
+ */
+int unshareStaffIds(StaffTable* table);
+
+
+/**
+ * @brief	Copies the pages of a run of slots of the ID index of a table that other indexes share, so they can be written.
+ *
+ * @param	table	The in-memory staff file, its page table unshared with unshareStaffIds().
+ * @param	slot	The first slot of the run, it runs up to the next empty slot after it (included).
+ *
+ * @retval	0	Every slot of the run can be written.
+ * @retval	-4	Allocation operation error, some pages may have been copied.
+ */
+int unshareStaffIdRun(StaffTable* table, unsigned int slot);
+
+
+/**
+ * @brief	Allocates an empty ID index.
+ *
+ * @param	capacity	Number of slots, a multiple of $ID_INDEX_PAGE_SLOTS.
+ *
+ * @retval	NULL	Allocation operation error.
+ * @return		The page table of the index, with a page for every $ID_INDEX_PAGE_SLOTS slots.
+ */
+StaffIdPage** allocStaffIds(int capacity);
+
+
+/**
+ * @brief	Releases the pages of an ID index, and frees its page table.
+ *
+ * @param	ids			The page table of the index. (Can be NULL)
+ * @param	capacity	Number of slots of the index.
+ */
+void releaseStaffIds(StaffIdPage** ids, int capacity);
+
+
+/**
+ * @brief	Gets a slot of an ID index.
+ *
+ * @param	ids		The page table of the index.
+ * @param	slot	Index of the slot, less than the capacity of the index.
+ *
+ * @return	A pointer to the slot, only write it once its page is unshared. (See unshareStaffIdRun())
+ */
+int* staffIdSlot(StaffIdPage** ids, unsigned int slot);
+
+
+/**
+ * @brief	Reads the staff file into an in-memory table, and indexes the existing staff by ID.
+ *
+ * @param	table	A pointer to the table to fill. Free it with freeStaffTable().
+ *
+ * @retval	0	Table successfully loaded.
+ * @retval	-3	File operation error.
+ * @retval	-4	Allocation operation error.
+ */
+int loadStaffTable(StaffTable* table);
+
+
+/**
+ * @brief	Reads the staff file into the current version of an in-memory table, replacing it and the ID index.
+ *
+ * The replaced version is released, pinned versions are kept. Hold $table->lock, and publish a new view afterwards.
+ *
+ * @param	table	The table to read, with the staff file opened.
+ *
+ * @retval	0	Table successfully read, stamped with the staff file before reading it.
+ * @retval	-3	File operation error, the table is unchanged.
+ * @retval	-4	Allocation operation error, the table is unchanged.
+ */
+int readStaffTable(StaffTable* table);
+
+
+/**
+ * @brief	Reloads an in-memory table if another program wrote the staff file since the table last read or wrote it.
+ *
+ * Compares the stamp of the staff file with $table->stamp. Hold $table->lock.
+ *
+ * @param	table	The table to refresh.
+ *
+ * @retval	0	Table up to date, a new view is published if it was reloaded.
+ * @retval	-3	File operation error, the table is unchanged.
+ * @retval	-4	Allocation operation error, the table is unchanged.
+ */
+int refreshStaffTable(StaffTable* table);
+
+
+/**
+ * @brief	Frees every version, pin and the index of an in-memory table, and closes its staff file.
+ *
+ * @param	table	The table to free.
+ */
+void freeStaffTable(StaffTable* table);
+
+
+/**
+ * @brief	Finds an existing staff in an in-memory table by ID, matched exactly like in the staff file.
+ *
+ * @param	table	The table to search.
+ * @param	id		The staff ID to find.
+ *
+ * @retval	-1	No existing staff has the ID.
+ * @return		Index of the staff in the table.
+ */
+int staffTableFind(StaffTable* table, char* id);
+
+
+/**
+ * @brief	Finds an existing staff in a view of an in-memory table by ID.
+ *
+ * @param	view		The view to search.
+ * @param	id			The staff ID to find.
+ * @param	ignoreCase	Whether to match the ID case insensitively, like LIKE() does.
+ *
+ * @retval	-1	No existing staff has the ID.
+ * @return		Index of the staff in the view.
+ */
+int staffViewFind(StaffView* view, char* id, bool ignoreCase);
+
+
+/**
+ * @brief	Adds an existing staff to the ID index of an in-memory table, growing the index if needed.
+ *
+ * The pages up to the end of the run of the staff are unshared too, so unindexing the staff right after never fails.
+ * Neither does indexing a staff right after unindexing it.
+ *
+ * @param	table	The table to index.
+ * @param	record	Index of the staff in the table.
+ *
+ * @retval	0	Staff successfully indexed.
+ * @retval	-4	Allocation operation error, the index is unchanged.
+ */
+int staffTableIndex(StaffTable* table, int record);
+
+
+/**
+ * @brief	Removes a staff from the ID index of an in-memory table.
+ *
+ * @param	table	The table to update.
+ * @param	record	Index of the staff in the table, it must have the ID it was indexed with.
+ *
+ * @retval	0	Staff successfully unindexed, or it was not indexed.
+ * @retval	-4	Allocation operation error, the index is unchanged.
+ */
+int staffTableUnindex(StaffTable* table, int record);
+
+
+/**
+ * @brief	Writes adjacent records of the current version of an in-memory table through to the staff file, under an exclusive record lock.
+ *
+ * Updates $table->stamp to the written file, or zeroes it if another program wrote the file since, so it is reloaded.
+ *
+ * @param	table	The table to write.
+ * @param	record	Index of the first record, the last one to append it.
+ * @param	count	Number of records to write.
+ *
+ * @retval	0	Records successfully written and flushed.
+ * @retval	-3	File operation error.
+ */
+int staffTableWrite(StaffTable* table, int record, int count);
+
+
+/**
+ * @brief	Deletes staff of the current version of an in-memory table, writing every run of adjacent records at once.
+ *
+ * The staff are unindexed, then written, then recorded in the departure date index and the page checksums.
+ * A run that can not be written is restored, and indexed again.
+ *
+ * @param	table	The table to delete from.
+ * @param	records	The sorted records of the staff to delete, a record can be listed twice. (Compacted to the records deleted)
+ * @param	len		Length of $records.
+ *
+ * @return	Number of staff deleted.
+ */
+int staffTableDelete(StaffTable* table, int* records, int len);
+
+
+/**
+ * @brief	Gets a record of a version of an in-memory table.
+ *
+ * @param	version	The version to read.
+ * @param	record	Index of the record, less than $version->length.
+ *
+ * @return	A pointer to the record, do not write it. (See staffTableUpdate())
+ */
+Staff* staffTableRecord(StaffVersion* version, int record);
+
+
+/**
+ * @brief	Gets the folded copy of a record of a version of an in-memory table, to match queries against.
+ *
+ * @param	version	The version to read.
+ * @param	record	Index of the record, less than $version->length.
+ *
+ * @return	A pointer to the folded copy, fold the record into it again after writing the record. (See foldStaff())
+ */
+StaffFolded* staffTableFolded(StaffVersion* version, int record);
+
+
+/**
+ * @brief	Task of an unlimited SR_COUNT, counts the staff matching the query in a range of pages of a version.
+ *
+ * @param	arg		A pointer to the StaffCountJob{}.
+ * @param	worker	Index of the worker running the task.
+ * @param	first	Index of the first page of the range.
+ * @param	count	Number of pages in the range.
+ */
+void countPagesTask(void* arg, int worker, long first, long count);
+
+
+
+/**
+ * @brief	Gets a record of the current version of an in-memory table to write, copying what pinned versions share first.
+ *
+ * If the current version is pinned, a new current version sharing every page replaces it.
+ * Then the page of the record is copied if another version shares it.
+ *
+ * @param	table	The table to write.
+ * @param	record	Index of the record, or $table->current->length to append a record.
+ *
+ * @retval	NULL	Allocation operation error.
+ * @return		A pointer to the record, only valid until the next update of the table.
+ */
+Staff* staffTableUpdate(StaffTable* table, int record);
+
+
+/**
+ * @brief	Pins the current version of an in-memory table for a client, so it is kept until unpinned.
+ *
+ * @param	table	The table to pin.
+ * @param	client	Socket of the client.
+ *
+ * @retval	0	Version successfully pinned, it is the last one of $table->pins.
+ * @retval	-4	Allocation operation error.
+ */
+int pinStaffVersion(StaffTable* table, int client);
+
+
+/**
+ * @brief	Finds a version pinned by a client.
+ *
+ * @param	table	The table to search.
+ * @param	client	Socket of the client.
+ * @param	version	ID of the version.
+ *
+ * @retval	-1	The client did not pin the version.
+ * @return		Index of the pin in $table->pins.
+ */
+int findStaffPin(StaffTable* table, int client, int version);
+
+
+/**
+ * @brief	Removes a pin of an in-memory table, freeing its version if nothing else uses it.
+ *
+ * @param	table	The table to update.
+ * @param	pin		Index of the pin in $table->pins.
+ */
+void unpinStaffVersion(StaffTable* table, int pin);
+
+
+/**
+ * @brief	Removes every pin of a client, e.g. after it disconnected.
+ *
+ * @param	table	The table to update.
+ * @param	client	Socket of the client.
+ */
+void releaseStaffPins(StaffTable* table, int client);
+
+
+/**
+ * @brief	Drops one pin of a version, and frees it with the pages only it used once it has no pin left.
+ *
+ * @param	version	The version to release.
+ */
+void releaseStaffVersion(StaffVersion* version);
+#endif
+
+
+/**
+ * @brief	Checks if the staff daemon is running, connecting to it on first use.
+ *
+ * @return	A true or false value indicating if requests should be sent with requestStaff().
+ */
+bool useStaffDaemon(void);
+
+
+/**
+ * @brief	Sends a request to the staff daemon and waits for the reply.
+ *
+ * If the connection breaks, later calls of useStaffDaemon() return false and the staff file is used directly.
+ * Requests that need a login log in as $STAFF_ID with $STAFF_PASSWORD (environment variables) first, unless the login
+ * screen already logged in with SR_LOGIN.
+ *
+ * @param	op			One of StaffRequests.
+ * @param	payload		The payload of the request.
+ * @param	length		Number of bytes in $payload.
+ * @param	reply		A pointer to store the malloc()-ed reply payload, or NULL if there is none. Free it after use. (Can be NULL)
+ * @param	replyLength	A pointer to store the number of bytes in $reply. (Can be NULL)
+ *
+ * @retval	0	Request successfully served.
+ * @retval	-3	Connection error.
+ * @retval	-4	Allocation operation error.
+ * @retval	-18	$length is over $DAEMON_REQUEST_MAX.
+ * @retval	-19	Not logged in.
+ * @return		Negative error code of the request. (See StaffRequests)
+ */
+int requestStaff(int op, const void* payload, int length, void** reply, int* replyLength);
+
+
+/**
+ * @brief	Reads records of a version pinned in the staff daemon, in requests of at most $STAFF_STREAM_CHUNK records.
+ *
+ * @param	snapshot	The version, pinned with SR_PIN.
+ * @param	staffArr	An array to store at least $count Staff{}.
+ * @param	first		Index of the first record to read.
+ * @param	count		Number of records to read.
+ *
+ * @retval	-3	Connection error.
+ * @retval	-4	Allocation operation error.
+ * @return		Number of records read, less than $count past the end of the version.
+ */
+int readStaffSnapshot(StaffSnapshot* snapshot, Staff* staffArr, int first, int count);
+
+
+/**
+ * @brief	Writes a whole buffer to a socket.
+ *
+ * @param	fd		The socket.
+ * @param	buf		The bytes to write.
+ * @param	len		Number of bytes in $buf.
+ *
+ * @retval	0	Buffer successfully written.
+ * @retval	-3	Connection error.
+ */
+int sendAll(int fd, const void* buf, size_t len);
+
+
+/**
+ * @brief	Reads a whole buffer from a socket.
+ *
+ * @param	fd		The socket.
+ * @param	buf		A buffer to store $len bytes.
+ * @param	len		Number of bytes to read.
+ *
+ * @retval	0	Buffer successfully read.
+ * @retval	-3	Connection closed or error.
+ */
+int recvAll(int fd, void* buf, size_t len);
+
+
+/**
+ * @brief	Appends text to a frame.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	text	The text to append.
+ * @param	len		Number of bytes of $text to append.
+ */
+void frameAppend(Frame* frame, const char* text, int len);
+
+
+/**
+ * @brief	Appends formatted text to a frame, like printf().
+ *
+ * @param	frame	The frame to draw to.
+ * @param	format	The printf() format string.
+ */
+void framePrintf(Frame* frame, const char* format, ...);
+
+
+/**
+ * @brief	Appends a divider of $n glyphs to a frame, copied from a precomputed run.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	n		Number of divider glyphs.
+ */
+void frameDivider(Frame* frame, int n);
+
+
+/**
+ * @brief	Appends $n spaces to a frame, copied from a precomputed run.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	n		Number of spaces.
+ */
+void frameSpaces(Frame* frame, int n);
+
+
+/**
+ * @brief	Appends text to a frame as a quoted JSON string.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	text	The text to quote.
+ * @param	len		Number of bytes of $text.
+ */
+void frameJSONString(Frame* frame, const char* text, int len);
+
+
+/**
+ * @brief	Appends text to a frame as a CSV field, quoted only if it has to be.
+ *
+ * @param	frame	The frame to draw to.
+ * @param	text	The text to quote.
+ * @param	len		Number of bytes of $text.
+ */
+void frameCSVField(Frame* frame, const char* text, int len);
+
+
+/**
+ * @brief	Makes room for $more bytes in a frame.
+ *
+ * @param	frame	The frame to grow.
+ * @param	more	Number of bytes to append.
+ *
+ * @return	A true or false value indicating if there is room, $frame->failed is set if not.
+ */
+bool growFrame(Frame* frame, int more);
+
+
+/**
+ * @brief	Writes a frame to the terminal with a single write(), after anything printed with stdio, and empties it.
+ *
+ * @param	frame	The frame to write.
+ *
+ * @retval	0	Frame successfully written.
+ * @retval	-3	Write operation error.
+ * @retval	-4	Part of the frame was not drawn. (Allocation operation error)
+ */
+int flushFrame(Frame* frame);
+
+
+/**
+ * @brief	Writes a frame to a stream as flushFrame() does, and empties it.
+ *
+ * @param	frame	The frame to write.
+ * @param	file	The stream to write to, anything buffered in it is written first.
+ *
+ * @retval	0	Frame successfully written.
+ * @retval	-3	Write operation error.
+ * @retval	-4	Part of the frame was not drawn. (Allocation operation error)
+ */
+int writeFrame(Frame* frame, FILE* file);
+
+
+/**
+ * @brief	Writes a frame over the last one shown, redrawing only the lines that changed, and empties it.
+ *
+ * The screen has to be cleared with cls() first, the frame is drawn from the top of the screen.
+ * Anything printed in between has to be followed by pause(), so the next frame is drawn in full.
+ * Frames are appended as with flushFrame() if stdout is not a terminal.
+ *
+ * @param	frame	The frame to present, ending with the line the cursor is left on. (e.g. A prompt)
+ *
+ * @retval	0	Frame successfully written.
+ * @retval	-3	Write operation error.
+ * @retval	-4	Part of the frame was not drawn. (Allocation operation error)
+ */
+int presentFrame(Frame* frame);
+
+
+/**
+ * @brief	Clears the screen with ANSI escape sequences, and starts a new series of frames for presentFrame(). (See cls())
+ */
+void clearScreen(void);
+
+
+/**
+ * @brief	Marks the last frame as printed over, so presentFrame() draws the next frame in full. (See pause())
+ */
+void dirtyScreen(void);
+
+
+/**
+ * @brief	Searches the current stirng and return index of first occurence if there is a match.
+ *
+ * NOTE: This implementation is only limited to $STAFF_BUF_MAX-1 characters.
+ *
+ * @param	text		Text to be searched.
+ * @param	query		Query to search the text provided.
+ * @param	ignoreCase	Determine to be case sensitive or not.
+ *
+ * @retval	-1	No match.
+ * @return		Index of the first occurence.
+ */
+int KMPSearch(char* text, char* query, bool ignoreCase);
+
+
+/**
+ * @brief	Matches $text and $query and see if they are the same.
+ *
+ * This function allows the use of SQL's LIKE's wildcards to match.
+ * Wildcards:
+ *   *	Matches zero or more characters.
+ *   _	Matches exactly on character.
+ *
+ * @param	text	The text to match against.
+ * @param	query	The text that allow the use of wildcards.
+ * @param	ignoreCase	Determine to be case sensitive or not.
+ *
+ * @return 	A true or false value indicating if they match.
+ */
+bool LIKE(char* text, char* query, bool ignoreCase);
+// ----- END OF HEADERS -----
+
+
+int addStaff(void) {
+	int retval = 0;
+
+	Staff newStaff;
+	FILE* staffFile = fopen("staff.bin", "ab+");
+
+	if(staffFile == NULL) {
+		perror("Error (Opening staff file)");
+		pause();
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// Password max length is $STAFF_BUF_MAX-1.
+	// scanf() will scan an additional character to determine if password exceeds intended size.
+	// So an additional character is allocated for password's null character.
+	char buf[STAFF_BUF_MAX+1];
+	enum StaffModifiableFields curPrompt = SE_ID;
+
+	// XXX: Iterate through enum by incrementing.
+	// XXX: Added one to print the last field after prompting it.
+	while(curPrompt < (STAFF_ENUM_LENGTH+1)) {
+		cls();
+		printf(
+			"ADD STAFF\n"
+			"=========\n"
+		);
+
+		// Print entered details after they have been filled.
+		if(curPrompt > SE_ID) {
+			printf("Staff ID       : %s\n", newStaff.id);
+		}
+		if(curPrompt > SE_NAME) {
+			printf("Staff name     : %s\n", newStaff.details.name);
+		}
+		if(curPrompt > SE_POSITION) {
+			printf("Staff position : %s\n", newStaff.details.position);
+		}
+		if(curPrompt > SE_PHONE) {
+			printf("Staff phone    : %s\n", newStaff.details.phone);
+		}
+		if(curPrompt > SE_IC) {
+			printf("Staff IC       : %s\n", newStaff.details.ic);
+		}
+
+		if(curPrompt > SE_ID) {
+			// Insert a line break to separate from the table.
+			putchar('\n');
+		}
+		printf("(Enter ':q' to abort.)\n\n");
+
+		int res = -1; // Records the output of promptStaffDetails().
+		switch(curPrompt) {
+			case SE_ID:
+				while(res != 0) {
+					res = promptStaffDetails(buf, SE_ID);
+					if(res == EOF) {
+						retval = EOF;
+						goto CLEANUP;
+					}
+					if(res != 0) {
+						break;
+					}
+
+					// Ensure the Staff ID entered is unique. (IDs never contain LIKE() wildcards)
+					StaffQuery query = { SE_ID, "", false };
+					foldCase(query.pattern, buf, strlen(buf)+1);
+					int exists = staffExists(&query);
+					if(exists < 0) {
+						perror("Error (Reading staff file)");
+						pause();
+						retval = -3;
+						goto CLEANUP;
+					}
+
+					if(exists) {
+						printf("Staff with the same ID exists!\n\n");
+						res = -15;
+					} else {
+						strcpy(newStaff.id, buf);
+						res = 0;
+					}
+				}
+				break;
+			case SE_NAME:
+				res = promptStaffDetails(buf, SE_NAME);
+				if(res == 0) {
+					strcpy(newStaff.details.name, buf);
+				}
+				break;
+			case SE_POSITION:
+				res = promptStaffDetails(buf, SE_POSITION);
+				if(res == 0) {
+					strcpy(newStaff.details.position, buf);
+				}
+				break;
+			case SE_PHONE:
+				res = promptStaffDetails(buf, SE_PHONE);
+				if(res == 0) {
+					strcpy(newStaff.details.phone, buf);
+				}
+				break;
+			case SE_IC:
+				res = promptStaffDetails(buf, SE_IC);
+				if(res == 0) {
+					strcpy(newStaff.details.ic, buf);
+				}
+				break;
+			default: {
+				res = 0;
+			}
+		}
+
+		if(res == 0) {
+			++curPrompt;
+		} else if(res == -2) {
+			printf("Staff addition aborted!\n");
+			pause();
+			retval = -2;
+			goto CLEANUP;
+		} else if(res == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+	}
+
+	// Prompt password
+	while(1) {
+		// NOTE: Implemented independantly because password hash should not be modifiable.
+		printf("Password (E.g. Ky54asdf' _.): ");
+		
+		// Scan an additional character to determine if user's password exceeds max length.
+		if(scanf("%128[^\n]", buf) == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+		u64 hash1 = computeHash(buf);
+		int passLen = strlen(buf);
+		memset(buf, 0, STAFF_BUF_MAX); // Zero out buffer to erase sensitive data.
+		truncate();
+
+		if(passLen == STAFF_BUF_MAX) {
+			printf("Please enter a password that is shorter than %d characters!\n", STAFF_BUF_MAX-1);
+			pause();
+			continue;
+		}
+
+		printf("Re-enter password: ");
+		// Don't have to scan an additional character anymore.
+		if(scanf("%127[^\n]", buf) == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+		u64 hash2 = computeHash(buf);
+		memset(buf, 0, STAFF_BUF_MAX-1); // null terminator is already zero, don't have to zero it again.
+		truncate();
+
+		if(hash1 == hash2) {
+			newStaff.passHash = hash1;
+			break;
+		} else {
+			printf("Passwords do not match!\n\n");
+		}
+	}
+
+	printf("\nAre you sure you want to save the current staff detail? [Y/n]: ");
+	if(scanf("%c", buf) == EOF) {
+		retval = EOF;
+		goto CLEANUP;
+	}
+	truncate();
+
+	if(toupper(*buf) == 'N') {
+		printf("\nStaff addition aborted!\n");
+		pause();
+		retval = -2;
+		goto CLEANUP;
+	}
+
+	retval = appendStaff(staffFile, &newStaff);
+	if(retval == -16) {
+		printf("A staff with the same ID was added by another terminal, staff addition aborted!\n");
+		pause();
+		retval = -2;
+	} else if(retval != 0) {
+		pause();
+	}
+
+CLEANUP:
+	if(staffFile != NULL && fclose(staffFile) == EOF) {
+		perror("Error (Closing staff file) ");
+		pause();
+		retval = -3;
+	} else if(retval == 0) {
+		printf("New staff details saved successfully!\n");
+		pause();
+		printf("Do you want to add another record? [Y/n]: ");
+
+		if(scanf("%c", buf) == EOF) {
+			retval = EOF;
+		} else {
+			truncate();
+			if(toupper(buf[0]) == 'N') {
+				printf("User chose to not add another record!\n");
+			} else {
+				// Hopefully tail call optimisation is performed...
+				return addStaff();
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+int appendStaff(FILE* staffFile, Staff* newStaff) {
+	if(useStaffDaemon()) {
+		// The daemon checks the ID again and appends the staff, one request at a time.
+		int* reply = NULL;
+		int replyBytes = 0;
+		int res = requestStaff(SR_ADD, newStaff, sizeof(*newStaff), (void**) &reply, &replyBytes);
+		if(res == 0) {
+			res = replyBytes == sizeof(int) ? (*reply < 0 ? *reply : 0) : -3;
+		}
+		free(reply);
+		if(res != 0 && res != -16) {
+			perror("Error (Requesting staff daemon)");
+			res = -3;
+		}
+		return res;
+	}
+
+	// Another terminal may have added the same ID since it was checked, so check again while holding the append lock.
+	// Scans never wait for the append lock, only other terminals appending do.
+	StaffQuery query = { SE_ID, "", false };
+	foldCase(query.pattern, newStaff->id, sizeof(newStaff->id));
+	if(lockStaff(staffFile, APPEND_LOCK_RECORD, 1, SL_EXCLUSIVE) != 0) {
+		perror("Error (Locking staff file)");
+		return -3;
+	}
+
+	int retval = 0;
+	int exists = 0;
+	int read;
+	int record = 0;
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	StaffFolded* folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+	rewind(staffFile);
+	while(chunk != NULL && folded != NULL && !exists && (read = freadStaff(chunk, STAFF_STREAM_CHUNK, staffFile)) > 0) {
+		foldStaffArray(folded, chunk, read);
+		exists = countStaffArray(chunk, folded, read, &query, 1);
+	}
+	free(chunk);
+	free(folded);
+
+	// The indexes are moved on past the append if nothing else wrote the staff file since it was last written.
+	StaffFileStamp before;
+	bool stamped = statStaffFile(staffFile, &before) == 0;
+
+	if(chunk == NULL || folded == NULL) {
+		perror("Error (malloc)");
+		retval = -4;
+	} else if(exists) {
+		retval = -16;
+	} else if(fwrite(newStaff, sizeof(*newStaff), 1, staffFile) == 0 || fflush(staffFile) == EOF) {
+		printf("An error occured while writing to file buffer!\n");
+		retval = -3;
+	} else {
+		record = ftell(staffFile)/(long) sizeof(Staff)-1;
+	}
+	if(retval == 0 && stampStaffIdIndex(staffFile, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating staff ID index)");
+	}
+	lockStaff(staffFile, APPEND_LOCK_RECORD, 1, SL_UNLOCK);
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	if(retval == 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating departure index)");
+	}
+	if(retval == 0 && updateChecksums(&record, NULL, newStaff, 1) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+	return retval;
+}
+
+
+int searchStaff(void) {
+	int retval = 0;
+	Staff* staffArr = NULL;
+	char* matches = NULL;
+	char** matchesPtr = NULL;
+	StaffFolded* foldedArr = NULL;
+	Frame frame = { 0 };
+	DisplayStaffOptions opt = displayStaffOptionsInit();
+
+	// Read whole file to memory.
+	int count = loadStaff(&staffArr);
+	if(count < 0) {
+		perror(count == -4 ? "Error (malloc)" : "Error (Reading staff file)");
+		pause();
+		retval = count;
+		goto CLEANUP;
+	}
+	int len = count*sizeof(Staff);
+
+	// Upper case the searchable fields once, instead of on every comparison.
+	foldedArr = malloc(len/sizeof(Staff)*sizeof(StaffFolded));
+	if(foldedArr == NULL && len != 0) {
+		perror("Error (malloc $foldedArr)");
+		pause();
+		retval = -4;
+		goto CLEANUP;
+	}
+	parallelFor(len/sizeof(Staff), SCAN_TASK_RECORDS, foldStaffTask, &(StaffFoldJob) { foldedArr, staffArr });
+
+	// Set up array to keep matches.
+	#define ID_SIZE 6
+
+	// Room for every staff, which are all included during the first print.
+	int curCapacity = count > 128 ? count : 128;
+	// NOTE: Code that determines if a record should be inserted depends on each string being ID_SIZE-d, please change the code if this has changed.
+	matches = malloc(ID_SIZE*curCapacity);
+	matchesPtr = malloc(curCapacity*sizeof(char*));
+
+	if(matches == NULL) {
+		perror("Error (malloc $matches)");
+		pause();
+		retval = -4;
+		goto CLEANUP;
+	}
+	if(matchesPtr == NULL) {
+		perror("Error (malloc $matchesPtr)");
+		pause();
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	// Include all during first print.
+	for(int i = 0; i < len/(int)sizeof(Staff); ++i) {
+		if(!isStaffDeleted(staffArr[i])) {
+			// XXX: Assuming matches is ID_SIZE sized.
+			strcpy(&matches[opt.idListLen++*6], staffArr[i].id);
+		}
+	}
+	int* matchesLen = &opt.idListLen;
+
+	for(int i = 0; i < curCapacity; ++i) {
+		// XXX: Assuming matches is ID_SIZE sized.
+		matchesPtr[i] = matches+i*ID_SIZE;
+	}
+	opt.idList = matchesPtr;
+	opt.displayList[SE_NAME] = true;
+	opt.displayList[SE_ID] = true;
+	opt.displayList[SE_POSITION] = true;
+	opt.displayList[SE_PHONE] = true;
+	opt.displayList[SE_IC] = true;
+
+	opt.isInteractive = false;
+
+	char buf[STAFF_BUF_MAX];
+
+	// Every search is drawn over the last one, only the rows that changed are redrawn.
+	opt.frame = &frame;
+	cls();
+
+	while(1) {
+		framePrintf(&frame,
+			"SEARCH STAFF\n"
+			"============\n"
+		);
+		displaySelectedStaff(&opt);
+
+		framePrintf(&frame,
+			"(Enter ':h' for help.)\n"
+			"(Enter ':q' for quit.)\n"
+			"(Field[!/+/-]=Query): "
+		);
+		if(presentFrame(&frame) != 0) {
+			perror("Error (Drawing staff table)");
+		}
+		int res;
+		res = scanf("%127[^=\n]", buf);
+		int delimiter = getchar(); // Consume newline or equal character.
+		// truncate() not needed anymore.
+
+		if(res == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+
+		// toupper $buf.
+		int i = 0;
+		while(buf[i]) {
+			buf[i] = toupper(buf[i]);
+			++i;
+		}
+
+		enum StaffModifiableFields field = -1;
+
+		// Checks if user wants to invert search.
+		bool invertSearch = false;
+		if(buf[strlen(buf)-1] == '!' && (buf[0] != ':' || strncmp(buf, ":COUNT ", 7) == 0)) {
+			invertSearch = true;
+			buf[strlen(buf)-1] = 0;
+		}
+
+		// Checks if user wants to append.
+		bool appendSearch = false;
+		if(buf[strlen(buf)-1] == '+') {
+			appendSearch = true;
+			buf[strlen(buf)-1] = 0;
+		}
+
+		// Checks if user wants to remove matches.
+		bool removeSearch = false;
+		if(buf[strlen(buf)-1] == '-') {
+			removeSearch = true;
+			buf[strlen(buf)-1] = 0;
+		}
+
+		if(buf[0] == ':') {
+			if(strncmp(buf, ":COUNT", 6) == 0) {
+				// Count without touching the displayed matches.
+				if(buf[6] == 0) {
+					printf("%d staff in the current search.\n", *matchesLen);
+				} else {
+					StaffQuery query = { parseStaffField(buf+6+strspn(buf+6, " ")), "", false };
+					if(delimiter == '=' && scanf("%127[^\n]", query.pattern) == EOF) {
+						retval = EOF;
+						goto CLEANUP;
+					}
+					if(delimiter == '=') {
+						truncate();
+					}
+					foldCase(query.pattern, query.pattern, STAFF_BUF_MAX);
+
+					if(query.field == -1 || delimiter != '=') {
+						printf("Usage: :count $FIELD[!]=$QUERY\n");
+					} else {
+						query.invert = invertSearch;
+						printf("%d staff matched.\n", countStaffArray(staffArr, foldedArr, len/sizeof(Staff), &query, 0));
+					}
+				}
+				pause();
+			} else if(buf[1] == 'O') {
+				// Order by a field, or go back to file order if no field is given.
+				char* name = strchr(buf, ' ');
+				if(name != NULL) {
+					name += strspn(name, " ");
+				}
+				int orderBy = name == NULL || *name == 0 ? -1 : parseStaffField(name);
+				if(orderBy == -1 && name != NULL && *name != 0) {
+					printf("Entered field does not match any of the field!\n");
+					pause();
+				} else {
+					opt.orderBy = orderBy;
+					opt.ordered.length = 0;
+					opt.page = 0;
+				}
+			} else if(buf[1] == 'Q' || buf[1] == 'W') {
+				retval = -2;
+				goto CLEANUP;
+			} else if(buf[1] == 'H') {
+				cls();
+				printf(
+					"Help\n"
+					"====\n"
+					"  Type in field name and search query to search.\n"
+					"  The search query may contain special characters such as:\n"
+					"    '%%' to match zero or more characters.\n"
+					"    '_' to match any character.\n"
+					"  Actions:\n"
+					"    $FIELD=$QUERY  (Display staffs that match with $QUERY.)\n"
+					"    $FIELD!=$QUERY (Display staffs that does not match with $QUERY.)\n"
+					"    $FIELD+=$QUERY (Append staffs that match with $QUERY to display list.)\n"
+					"    $FIELD-=$QUERY (Remove staffs that match with $QUERY in display list.)\n"
+					"    :count         (Count staffs in display list.)\n"
+					"    :count $FIELD=$QUERY  (Count staffs that match with $QUERY, without changing display list.)\n"
+					"    :count $FIELD!=$QUERY (Count staffs that does not match with $QUERY.)\n"
+					"    :o $FIELD      (Order display list by $FIELD.)\n"
+					"    :o             (Order display list by insertion order.)\n"
+					"    :h             (Help.)\n"
+					"    :q             (Quit.)\n"
+					"    :n             (Next page.)\n"
+					"    :b             (Go back a page.)\n"
+					"  Examples:\n"
+					"    :o Name\n"
+					"    (This orders the display list by name.)\n"
+					"    Name=J%%\n"
+					"    (This searches for any name that starts with a capital 'J'.)\n"
+					"    Phone!=01%%\n"
+					"    (This searches for any phone that does not starts with '01'.)\n\n"
+				);
+				pause();
+			} else if(buf[1] == 'N') {
+				++opt.page;
+			} else if(buf[1] == 'B') {
+				--opt.page;
+			} else {
+				printf("Invalid control code!\n");
+				pause();
+			}
+			continue;
+		} else if((field = parseStaffField(buf)) == (enum StaffModifiableFields) -1) {
+			printf("Entered field does not match any of the field!\n");
+			pause();
+			continue;
+		}
+
+		// Replace buffer again with search query.
+		if(scanf("%127[^\n]", buf) == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+		truncate();
+
+
+		// Will only enter here if a field is matched.
+
+		int queryLen = strlen(buf);
+		foldCase(buf, buf, queryLen);
+
+		if(!appendSearch && !removeSearch) {
+			*matchesLen = 0; // Reset to zero since it's not adding or removing from the search.
+		}
+		// Display list is changing, the rows have to be ordered again.
+		opt.ordered.length = 0;
+
+		for(int i = 0; i < (int) (len/sizeof(Staff)); ++i) {
+			if(!isStaffDeleted(staffArr[i])) {
+				char* text = staffFoldedText(&foldedArr[i], field);
+
+				bool insert = !invertSearch;
+				if(LIKE(text, buf, false)) {
+					if(appendSearch || removeSearch) {
+						for(int ii = 0; ii < *matchesLen; ++ii) {
+							if(strcmp(matchesPtr[ii], staffArr[i].id) == 0) {
+								if(removeSearch) {
+									if(ii+1 != *matchesLen) {
+										// XXX: Making the assumption each ID is ID_SIZE and no larger or smaller.
+										// Please change this if the size of string has changed.
+										// Using the same idea as deleteStaff();
+										strcpy(matchesPtr[ii], matchesPtr[*matchesLen-1]);
+									}
+									--*matchesLen; // SAFETY: $matchesLen is guaranteed to be positive non-zero here.
+								}
+								// Skips appending if it's a duplicate.
+								insert = false;
+								break;
+							}
+						}
+						if(removeSearch) {
+							insert = false;
+						}
+					}
+				} else {
+					insert = invertSearch;
+				}
+
+				if(insert) {
+					if(*matchesLen == curCapacity) {
+						curCapacity *= 2;
+						matches = realloc(matches, curCapacity*ID_SIZE);
+						matchesPtr = realloc(matchesPtr, curCapacity*sizeof(char*));
+						opt.idList = matchesPtr;
+
+						if(matches == NULL || matchesPtr == NULL) {
+							perror("Error (realloc)");
+							pause();
+							retval = -4;
+							goto CLEANUP;
+						} else {
+							// $matches may have moved to another location, so start again from 0.
+							for(int i = 0; i < curCapacity; ++i) {
+								matchesPtr[i] = matches + i*ID_SIZE;
+							}
+						}
+					}
+					strcpy(matchesPtr[(*matchesLen)++], staffArr[i].id);
+				}
+			}
+		}
+		buf[queryLen] = 0;
+	}
+
+CLEANUP:
+	#undef ID_SIZE
+	free(staffArr);
+	free(matches);
+	free(matchesPtr);
+	free(opt.ordered.rows);
+	free(frame.text);
+	free(foldedArr);
+	return retval;
+}
+
+
+int modifyStaff(void) {
+	int retval = 0;
+	int numModified = 0;
+	// Modifications staged in this session, saved together with saveStaffModifications().
+	StaffModification* session = NULL;
+	int sessionLen = 0;
+	int sessionCapacity = 0;
+	FILE* staffFile = fopen("staff.bin", "rb+");
+	
+	if(staffFile == NULL) {
+		perror("Error (Opening staff file)");
+		pause();
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	Staff chosenStaff;
+	Staff originalStaff; // $chosenStaff as read, to detect changes made by other terminals before saving.
+	int staged = -1; // Index of $chosenStaff in $session, -1 if it is not staged yet.
+	
+	char buf[STAFF_BUF_MAX];
+	char id[6];
+
+	while(1) {
+		cls();
+		printf(
+			"MODIFY STAFF\n"
+			"============\n"
+		);
+	
+		if(sessionLen > 0) {
+			printf("Type a staff ID to modify their staff details, ':w' to save the changes of %d staff or ':q' to quit.\n\n", sessionLen);
+		} else {
+			printf("Type a staff ID to modify their staff details or ':q' to quit.\n\n");
+		}
+		int res = promptStaffDetails(id, SE_ID);
+		if(res == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+
+		if(res == -2 && toupper(id[1]) == 'W') {
+			if(sessionLen == 0) {
+				printf("There are no modifications to save!\n");
+				pause();
+				continue;
+			}
+			break;
+		} else if(res == -2) {
+			if(sessionLen > 0) {
+				printf("Are you sure you want to discard the changes of %d staff? [y/N]: ", sessionLen);
+				res = scanf("%c", buf);
+				truncate();
+
+				if(res == EOF) {
+					retval = EOF;
+					goto CLEANUP;
+				} else if(toupper(buf[0]) != 'Y') {
+					continue;
+				}
+			}
+			printf("Staff modification aborted!\n");
+			pause();
+			retval = -2;
+			goto CLEANUP;
+		}
+
+		// Search for matching records.
+		bool found = false;
+		int record = -1; // Index of $chosenStaff in the staff file.
+		if(useStaffDaemon()) {
+			StaffRecord* reply = NULL;
+			res = requestStaff(SR_FIND, id, sizeof(id), (void**) &reply, NULL);
+			if(res == 0) {
+				found = true;
+				record = reply->record;
+				chosenStaff = reply->staff;
+			}
+			free(reply);
+			if(res != 0 && res != -15) {
+				perror("Error (Requesting staff daemon)");
+				retval = -3;
+				goto CLEANUP;
+			}
+		} else {
+			// The ID index gives the offset of the staff, only its record is read.
+			record = findStaffId(staffFile, id, &chosenStaff);
+			found = record >= 0;
+			if(record < 0 && record != -15) {
+				perror("Error (Reading staff ID index)");
+				retval = -3;
+				goto CLEANUP;
+			}
+		}
+
+		// A staff staged in this session is edited from its staged details, also under the new ID it was given.
+		staged = -1;
+		for(int i = 0; i < sessionLen; ++i) {
+			if(strcmp(session[i].modified.id, id) == 0 || (found && session[i].record == record)) {
+				staged = i;
+				found = true;
+				record = session[i].record;
+				chosenStaff = session[i].modified;
+				break;
+			}
+		}
+		
+		if(found) {
+			originalStaff = staged != -1 ? session[staged].original : chosenStaff;
+			bool next = false; // Whether to stage $chosenStaff and modify another staff.
+			while(true) {
+				cls();
+				printf(
+					"MODIFY STAFF\n"
+					"============\n"
+					"ID       : %s\n"
+					"Name     : %s\n"
+					"Position : %s\n"
+					"Phone    : %s\n"
+					"IC       : %s\n\n"
+					"(Enter ':h' for help.)\n"
+					"(Enter ':q' for quit.)\n"
+					"(Enter ':n' for next staff.)\n"
+					"(Enter ':w' for save.)\n"
+					"(Field=Value): ",
+					chosenStaff.id, chosenStaff.details.name, chosenStaff.details.position, chosenStaff.details.phone, chosenStaff.details.ic
+				);
+				scanf("%127[^=\n]", buf);
+				getchar(); // consume equal sign or newline.
+				// truncate() not needed anymore if newline.
+
+				// toupper() for string.
+				int i = 0;
+				while(buf[i]) {
+					buf[i] = toupper(buf[i]);
+					++i;
+				}
+
+				int res = 0;
+				if(strcmp(buf, "ID") == 0) {
+					res = promptStaffDetails(buf, ~SE_ID);
+					if(res == 0) {
+						// The IDs are checked as they were before the session, giving the staff its own ID back is allowed.
+						int other = -15;
+						if(useStaffDaemon()) {
+							// IDs are at most 5 characters.
+							StaffRecord* reply = NULL;
+							other = requestStaff(SR_FIND, buf, sizeof(chosenStaff.id), (void**) &reply, NULL);
+							other = other == 0 ? reply->record : other;
+							free(reply);
+						} else {
+							other = findStaffId(staffFile, buf, NULL);
+						}
+						bool exists = other != -15 && other != record;
+						// Other staff of the session may have been given the ID too.
+						for(int i = 0; !exists && i < sessionLen; ++i) {
+							exists = i != staged && strcmp(session[i].modified.id, buf) == 0;
+						}
+
+						if(exists) {
+							printf("A staff with the same ID exists!\n");
+							pause();
+						} else {
+							strcpy(chosenStaff.id, buf);
+						}
+					}
+				} else if(strcmp(buf, "NAME") == 0) {
+					res = promptStaffDetails(buf, ~SE_NAME);
+					if(res == 0) {
+						strcpy(chosenStaff.details.name, buf);
+					}
+				} else if(strcmp(buf, "POSITION") == 0) {
+					res = promptStaffDetails(buf, ~SE_POSITION);
+					if(res == 0) {
+						strcpy(chosenStaff.details.position, buf);
+					}
+				} else if(strcmp(buf, "PHONE") == 0) {
+					res = promptStaffDetails(buf, ~SE_PHONE);
+					if(res == 0) {
+						strcpy(chosenStaff.details.phone, buf);
+					}
+				} else if(strcmp(buf, "IC") == 0) {
+					res = promptStaffDetails(buf, ~SE_IC);
+					if(res == 0) {
+						strcpy(chosenStaff.details.ic, buf);
+					}
+				} else if(buf[0] == ':') {
+					// String is in uppercase.
+					if(buf[1] == 'Q') {
+						res = -2;
+					} else if(buf[1] == 'W' || buf[1] == 'N' || buf[1] == 'P') {
+						// Stage the staff if it differs from its details as read, then save, modify another staff, or show every staged change.
+						bool changed = false;
+						for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+							changed = changed || strcmp(staffFieldText(&chosenStaff, field), staffFieldText(&originalStaff, field)) != 0;
+						}
+						if(changed && staged == -1) {
+							if(sessionLen == sessionCapacity) {
+								sessionCapacity = sessionCapacity == 0 ? 8 : sessionCapacity*2;
+								StaffModification* tmp = realloc(session, sessionCapacity*sizeof(StaffModification));
+								if(tmp == NULL) {
+									perror("Error (realloc $session)");
+									pause();
+									retval = -4;
+									goto CLEANUP;
+								}
+								session = tmp;
+							}
+							staged = sessionLen++;
+							session[staged] = (StaffModification) { record, originalStaff, chosenStaff };
+						} else if(!changed && staged != -1) {
+							// Changed back to its details as read, nothing to save for it anymore.
+							memmove(&session[staged], &session[staged+1], (sessionLen-staged-1)*sizeof(StaffModification));
+							--sessionLen;
+							staged = -1;
+						}
+						if(staged != -1) {
+							session[staged].modified = chosenStaff;
+						}
+
+						if(buf[1] == 'P') {
+							cls();
+							printStaffModifications(session, sessionLen);
+							pause();
+							continue;
+						}
+						next = buf[1] == 'N';
+						break;
+					} else if(buf[1] == 'H') {
+						cls();
+						printf(
+							"Help\n"
+							"====\n"
+							"  Type in field and value to replace to modify.\n"
+							"  Actions:\n"
+							"    $FIELD=$VALUE (Modify the value of $FIELD.)\n"
+							"    :h            (Help.)\n"
+							"    :q            (Discard the changes of this staff, and type another staff ID.)\n"
+							"    :n            (Keep the modifications, and modify another staff before saving.)\n"
+							"    :p            (Show the modifications of every staff to save.)\n"
+							"    :w            (Save the modifications of every staff.)\n"
+							"  Example:\n"
+							"    Name=John Smith\n\n"
+						);
+						pause();
+						continue;
+					} else {
+						printf("Invalid control code!\n");
+						pause();
+						continue;
+					}
+				} else {
+					printf("Entered field does not match any of the fields!\n");
+					pause();
+					continue;
+				}
+
+				if(res == EOF) {
+					retval = EOF;
+					goto CLEANUP;
+				} else if(res == -2) {
+					// The other staged staff are kept, they are discarded at the ID prompt.
+					printf("Are you sure you want to discard the changes of this staff? [y/N]: ");
+					res = scanf("%c", buf);
+					truncate();
+
+					if(res == EOF) {
+						retval = EOF;
+						goto CLEANUP;
+					} else if(toupper(buf[0]) == 'Y') {
+						next = true;
+						break;
+					}
+				} else if(res == -14) {
+					// Add pause to see what error message was printed.
+					pause();
+				}
+			}
+
+			if(next) {
+				continue;
+			}
+			break;
+		} else {
+			printf("Staff ID entered does not match any records!\n");
+			pause();
+		}
+	}
+
+	// Saved with ':w', on the staff screen or at the ID prompt.
+	int res = promptSaveStaffModifications(staffFile, session, sessionLen);
+	if(res >= 0) {
+		numModified += res;
+	} else if(res != -2) {
+		retval = res;
+	}
+
+CLEANUP:
+	#undef ID_SIZE
+	free(session);
+	if(staffFile != NULL && fclose(staffFile) != 0) {
+		perror("Error (Closing staff file, file data might not be saved)");
+		pause();
+		return -3;
+	} else if(numModified != 0) {
+		printf("Staff data modified successfully!\n");
+		pause();
+	}
+	return retval;
+}
+
+
+int promptSaveStaffModifications(FILE* staffFile, StaffModification* modifications, int len) {
+	char buf[2];
+	if(len == 0) {
+		printf("There are no modifications to save!\n");
+		pause();
+		return 0;
+	}
+
+	if(len == 1) {
+		printf("Are you sure you want to save this staff's details? [Y/n]: ");
+	} else {
+		printf("Are you sure you want to save the details of %d staff? [Y/n]: ", len);
+	}
 	if(scanf("%c", buf) == EOF) {
-		retval = EOF;
+		return EOF;
+	}
+	truncate();
+
+	if(toupper(buf[0]) == 'N') {
+		printf("Modify operation aborted!\n");
+		pause();
+		return -2;
+	}
+
+	int* statuses = malloc(len*sizeof(int));
+	int res = statuses == NULL ? -4 : saveStaffModifications(staffFile, modifications, len, statuses);
+	if(res < 0) {
+		perror(res == -4 ? "Error (malloc)" : "Error (Saving staff)");
+		pause();
+		free(statuses);
+		return res;
+	}
+
+	// Report the staff that were skipped.
+	for(int i = 0; i < len; ++i) {
+		if(statuses[i] == -17) {
+			printf("%s was changed by another terminal in the meantime, it is not modified!\n", modifications[i].original.id);
+		} else if(statuses[i] == -16) {
+			printf("A staff with the ID %s was added by another terminal, %s is not modified!\n", modifications[i].modified.id, modifications[i].original.id);
+		} else if(statuses[i] != 0) {
+			printf("%s failed to be written, it is not modified!\n", modifications[i].original.id);
+		}
+	}
+	if(res < len) {
+		pause();
+	}
+	free(statuses);
+	return res;
+}
+
+
+int saveStaffModifications(FILE* staffFile, StaffModification* modifications, int len, int* statuses) {
+	// Runs of adjacent records are locked and written together.
+	qsort(modifications, len, sizeof(StaffModification), compareStaffModification);
+
+	if(useStaffDaemon()) {
+		// The daemon checks every staff did not change in the meantime, and writes them through to the staff file at once.
+		int* reply = NULL;
+		int replyBytes = 0;
+		int res = requestStaff(SR_MODIFY, modifications, len*sizeof(StaffModification), (void**) &reply, &replyBytes);
+		if(res == 0 && replyBytes == len*(int) sizeof(int)) {
+			memcpy(statuses, reply, replyBytes);
+		} else if(res == 0) {
+			res = -3;
+		}
+		free(reply);
+
+		int saved = 0;
+		for(int i = 0; res == 0 && i < len; ++i) {
+			saved += statuses[i] == 0;
+		}
+		return res != 0 ? res : saved;
+	}
+
+	Staff* current = malloc(len*sizeof(Staff)+1);
+	Staff* originals = malloc(len*sizeof(Staff)+1);
+	int* records = malloc(len*sizeof(int)+1);
+	int saved = 0;
+	if(current == NULL || originals == NULL || records == NULL) {
+		free(current);
+		free(originals);
+		free(records);
+		return -4;
+	}
+
+	// The staff ID index stays locked from checking the new IDs to writing them, so another terminal can not take them in between.
+	// It is locked before the records, like the other terminals do.
+	StaffIdIndexHeader header;
+	FILE* indexFile = NULL;
+	for(int i = 0; i < len; ++i) {
+		if(strcmp(modifications[i].modified.id, modifications[i].original.id) != 0) {
+			indexFile = openStaffIdIndex(staffFile, &header, NULL);
+			break;
+		}
+	}
+
+	// Lock and read every run first, so no staff is written unless it is unchanged while the whole session is saved.
+	for(int i = 0, end; i < len; i = end) {
+		int first = modifications[i].record;
+		for(end = i+1; end < len && modifications[end].record == first+end-i; ++end);
+		bool locked = lockStaff(staffFile, first, end-i, SL_EXCLUSIVE) == 0 && preadStaff(staffFile, &current[i], first, end-i) == (size_t) (end-i);
+
+		for(int ii = i; ii < end; ++ii) {
+			StaffModification* modification = &modifications[ii];
+			if(!locked) {
+				statuses[ii] = -3;
+			} else if(memcmp(&current[ii], &modification->original, sizeof(Staff)) != 0) {
+				statuses[ii] = -17;
+			} else if(strcmp(modification->modified.id, modification->original.id) != 0) {
+				// The new ID must still be free, and not given to another staff of the session already.
+				bool taken = indexFile == NULL || findStaffIdSlot(staffFile, indexFile, &header, modification->modified.id, NULL) != -15;
+				for(int other = 0; !taken && other < ii; ++other) {
+					taken = statuses[other] == 0 && strcmp(modifications[other].modified.id, modification->modified.id) == 0;
+				}
+				statuses[ii] = taken ? -16 : 0;
+			} else {
+				statuses[ii] = 0;
+			}
+
+			if(statuses[ii] == 0) {
+				// The password can not be modified, which also keeps the staff from being marked as deleted.
+				current[ii] = modification->modified;
+				current[ii].passHash = modification->original.passHash;
+			}
+		}
+	}
+
+	// Index the new IDs before writing them. The staff whose new ID could not be indexed are not saved.
+	if(indexFile != NULL && indexStaffIds(staffFile, indexFile, &header, modifications, statuses, len) != 0) {
+		perror("Error (Updating staff ID index)");
+		for(int i = 0; i < len; ++i) {
+			if(statuses[i] == 0 && strcmp(modifications[i].modified.id, modifications[i].original.id) != 0) {
+				statuses[i] = -3;
+			}
+		}
+	}
+
+	// The indexes are moved on past the writes if nothing else wrote the staff file since it was last written.
+	StaffFileStamp before;
+	bool stamped = statStaffFile(staffFile, &before) == 0;
+
+	// Write every run of adjacent saved staff at once, in file order.
+	for(int i = 0, end; i < len; i = end) {
+		int first = modifications[i].record;
+		for(end = i+1; end < len && statuses[i] == 0 && statuses[end] == 0 && modifications[end].record == first+end-i; ++end);
+		if(statuses[i] != 0) {
+			continue;
+		}
+
+		if(pwriteStaff(staffFile, &current[i], first, end-i) != (size_t) (end-i)) {
+			for(int ii = i; ii < end; ++ii) {
+				statuses[ii] = -3;
+			}
+			continue;
+		}
+		// Keep the saved staff at the front of $current for updateChecksums(), $saved never passes $ii.
+		for(int ii = i; ii < end; ++ii) {
+			originals[saved] = modifications[ii].original;
+			current[saved] = current[ii];
+			records[saved++] = modifications[ii].record;
+		}
+	}
+
+	// One sync for the whole session, before other terminals can read the staff.
+	if(saved > 0 && syncStaff(staffFile) != 0) {
+		perror("Error (Syncing staff file)");
+	}
+	for(int i = 0, end; i < len; i = end) {
+		int first = modifications[i].record;
+		for(end = i+1; end < len && modifications[end].record == first+end-i; ++end);
+		lockStaff(staffFile, first, end-i, SL_UNLOCK);
+	}
+	if(indexFile != NULL) {
+		fclose(indexFile);
+	}
+	if(saved > 0 && stampStaffIdIndex(staffFile, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating staff ID index)");
+	}
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	if(saved > 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating departure index)");
+	}
+	if(saved > 0 && updateChecksums(records, originals, current, saved) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+
+	free(current);
+	free(originals);
+	free(records);
+	return saved;
+}
+
+
+void printStaffModifications(StaffModification* modifications, int len) {
+	// Labels of the StaffModifiableFields, as on the modify screen.
+	const char* labels[STAFF_ENUM_LENGTH] = { "ID", "Name", "Position", "Phone", "IC" };
+
+	printf(
+		"PENDING MODIFICATIONS\n"
+		"=====================\n"
+	);
+	for(int i = 0; i < len; ++i) {
+		printf("%s\n", modifications[i].original.id);
+
+		bool changed = false;
+		for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+			char* before = staffFieldText(&modifications[i].original, field);
+			char* after = staffFieldText(&modifications[i].modified, field);
+			if(strcmp(before, after) != 0) {
+				printf("  %-9s: %s -> %s\n", labels[field], before, after);
+				changed = true;
+			}
+		}
+		if(!changed) {
+			printf("  (Unchanged)\n");
+		}
+	}
+	printf("\n%d staff to save.\n\n", len);
+}
+
+
+int compareStaffModification(const void* a, const void* b) {
+	const StaffModification* x = a;
+	const StaffModification* y = b;
+	return (x->record > y->record) - (x->record < y->record);
+}
+
+
+int compareRecord(const void* a, const void* b) {
+	int x = *(const int*) a;
+	int y = *(const int*) b;
+	return (x > y) - (x < y);
+}
+
+
+int displayStaff(void) {
+	DisplayStaffOptions s = displayStaffOptionsInit();
+	s.header =
+		"DISPLAY STAFF\n"
+		"=============\n";
+	s.displayList[SE_ID] = true;
+	s.displayList[SE_NAME] = true;
+	s.displayList[SE_POSITION] = true;
+	s.displayList[SE_PHONE] = true;
+	s.displayList[SE_IC] = true;
+	s.isInclude = false;
+
+	int res = displaySelectedStaff(&s);
+	return res < 0 ? res : 0;
+}
+
+
+int lockStaff(FILE* staffFile, long first, long count, int type) {
+	#ifdef STAFF_LOCKS
+	struct flock lock = { 0 };
+	lock.l_type = type == SL_SHARED ? F_RDLCK : (type == SL_EXCLUSIVE ? F_WRLCK : F_UNLCK);
+	lock.l_whence = SEEK_SET;
+	lock.l_start = (off_t) first*(off_t) sizeof(Staff);
+	lock.l_len = (off_t) count*(off_t) sizeof(Staff);
+
+	// Wait again if a signal interrupted the wait.
+	while(fcntl(fileno(staffFile), F_SETLKW, &lock) == -1) {
+		if(errno != EINTR) {
+			return -3;
+		}
+	}
+	#else
+	(void) staffFile, (void) first, (void) count, (void) type;
+	#endif
+	return 0;
+}
+
+
+size_t freadStaff(Staff* staffArr, size_t count, FILE* staffFile) {
+	long pos = ftell(staffFile);
+	if(pos == -1 || count == 0) {
+		return 0;
+	}
+
+	long first = pos/(long) sizeof(Staff);
+	if(lockStaff(staffFile, first, count, SL_SHARED) != 0) {
+		return 0;
+	}
+	size_t read = preadStaff(staffFile, staffArr, first, count);
+	lockStaff(staffFile, first, count, SL_UNLOCK);
+
+	return read;
+}
+
+
+size_t preadStaff(FILE* staffFile, Staff* staffArr, long first, size_t count) {
+	// Also flushes any write still in the stdio buffer.
+	if(fseek(staffFile, first*(long) sizeof(Staff), SEEK_SET) != 0) {
+		return 0;
+	}
+
+	#ifdef STAFF_LOCKS
+	// fread() could fill the stdio buffer with the records after the locked ones, read from the file directly instead.
+	size_t bytes = 0;
+	while(bytes < count*sizeof(Staff)) {
+		ssize_t res = pread(fileno(staffFile), (char*) staffArr + bytes, count*sizeof(Staff) - bytes, (off_t) first*(off_t) sizeof(Staff) + bytes);
+		if(res == -1 && errno == EINTR) {
+			continue;
+		}
+		if(res <= 0) {
+			break;
+		}
+		bytes += res;
+	}
+
+	size_t read = bytes/sizeof(Staff);
+	fseek(staffFile, (first+(long) read)*(long) sizeof(Staff), SEEK_SET);
+	return read;
+	#else
+	return fread(staffArr, sizeof(Staff), count, staffFile);
+	#endif
+}
+
+
+size_t pwriteStaff(FILE* staffFile, Staff* staffArr, long first, size_t count) {
+	// Buffered writes must not land after (and over) these records.
+	if(fflush(staffFile) == EOF) {
+		return 0;
+	}
+
+	#ifdef STAFF_LOCKS
+	size_t bytes = 0;
+	while(bytes < count*sizeof(Staff)) {
+		ssize_t res = pwrite(fileno(staffFile), (char*) staffArr + bytes, count*sizeof(Staff) - bytes, (off_t) first*(off_t) sizeof(Staff) + bytes);
+		if(res == -1 && errno == EINTR) {
+			continue;
+		}
+		if(res <= 0) {
+			break;
+		}
+		bytes += res;
+	}
+
+	// Also drops the records just written from the stdio buffer.
+	size_t written = bytes/sizeof(Staff);
+	fseek(staffFile, (first+(long) written)*(long) sizeof(Staff), SEEK_SET);
+	return written;
+	#else
+	if(fseek(staffFile, first*(long) sizeof(Staff), SEEK_SET) != 0) {
+		return 0;
+	}
+	size_t written = fwrite(staffArr, sizeof(Staff), count, staffFile);
+	return fflush(staffFile) == EOF ? 0 : written;
+	#endif
+}
+
+
+int syncStaff(FILE* staffFile) {
+	if(fflush(staffFile) == EOF) {
+		return -3;
+	}
+
+	#ifdef STAFF_FSYNC
+	while(fsync(fileno(staffFile)) == -1) {
+		if(errno != EINTR) {
+			return -3;
+		}
+	}
+	#endif
+	return 0;
+}
+
+
+int statStaffFile(FILE* staffFile, StaffFileStamp* stamp) {
+	memset(stamp, 0, sizeof(*stamp));
+
+	#ifdef STAFF_STAT
+	struct stat info;
+	if(fstat(fileno(staffFile), &info) != 0) {
+		return -3;
+	}
+	stamp->inode = info.st_ino;
+	stamp->size = info.st_size;
+	stamp->mtime = (u64) info.st_mtim.tv_sec*1000000000u + info.st_mtim.tv_nsec;
+	#else
+	long pos = ftell(staffFile);
+	if(pos == -1 || fseek(staffFile, 0, SEEK_END) != 0) {
+		return -3;
+	}
+	stamp->size = ftell(staffFile);
+	fseek(staffFile, pos, SEEK_SET);
+	#endif
+	return 0;
+}
+
+
+int loadStaff(Staff** staffArr) {
+	*staffArr = NULL;
+	if(useStaffDaemon()) {
+		// Read a pinned version in chunks, the daemon keeps serving writers in between.
+		StaffSnapshot* snapshot = NULL;
+		int res = requestStaff(SR_PIN, NULL, 0, (void**) &snapshot, NULL);
+		if(res != 0) {
+			return res;
+		}
+
+		*staffArr = malloc((snapshot->length+1)*sizeof(Staff));
+		if(*staffArr == NULL) {
+			res = -4;
+		} else {
+			res = readStaffSnapshot(snapshot, *staffArr, 0, snapshot->length);
+			if(res >= 0 && res != snapshot->length) {
+				res = -3;
+			}
+		}
+		requestStaff(SR_UNPIN, &snapshot->version, sizeof(snapshot->version), NULL, NULL);
+		free(snapshot);
+
+		if(res < 0) {
+			free(*staffArr);
+			*staffArr = NULL;
+		}
+		return res;
+	}
+
+	FILE* staffFile = fopen("staff.bin", "rb");
+	if(staffFile == NULL) {
+		return -3;
+	}
+
+	int retval = -3;
+	long size;
+	if(fseek(staffFile, 0, SEEK_END) == 0 && (size = ftell(staffFile)) != -1) {
+		int len = size/sizeof(Staff);
+		rewind(staffFile);
+
+		// Allocate one more record, so an empty staff file is not mistaken for an allocation error.
+		*staffArr = malloc((len+1)*sizeof(Staff));
+		if(*staffArr == NULL) {
+			retval = -4;
+		} else if(freadStaff(*staffArr, len, staffFile) == (size_t) len) {
+			retval = len;
+		}
+	}
+
+	if(retval < 0) {
+		free(*staffArr);
+		*staffArr = NULL;
+	}
+	fclose(staffFile);
+	return retval;
+}
+
+
+void markStaffDeleted(Staff* staff) {
+	time_t rawTime;
+	time(&rawTime);
+
+	struct tm* time = localtime(&rawTime);
+	staff->passHash = (((short) time->tm_year)+1900) | (((char) time->tm_mon+1)<<16) | (((unsigned int) (char) time->tm_mday)<<24);
+}
+
+
+int countStaff(StaffQuery* query, int limit) {
+	if(useStaffDaemon()) {
+		StaffCount count = { *query, limit };
+		int* reply = NULL;
+		int res = requestStaff(SR_COUNT, &count, sizeof(count), (void**) &reply, NULL);
+		if(res == 0) {
+			res = *reply;
+		}
+		free(reply);
+		return res;
+	}
+
+	int retval = 0;
+	FILE* staffFile = fopen("staff.bin", "rb");
+	Staff* chunk = NULL;
+	StaffFolded* folded = NULL;
+
+	if(staffFile == NULL) {
+		return -3;
+	}
+
+	if(query->field < 0) {
+		// Every existing staff matches, which is the number of records minus the number of deleted staff in the index.
+		DepartureIndexHeader header;
+		FILE* indexFile = openDepartureIndex(&header, NULL, NULL);
+		if(indexFile == NULL) {
+			retval = -3;
+		} else {
+			retval = header.stamp.size/sizeof(Staff) - header.length;
+			if(limit > 0 && retval > limit) {
+				retval = limit;
+			}
+		}
+		if(indexFile != NULL) {
+			fclose(indexFile);
+		}
+		goto CLEANUP;
+	}
+
+	chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+	if(chunk == NULL || folded == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	if(limit <= 0) {
+		// Full counts are split between the workers of the task pool, sharing the staff file.
+		long size;
+		if(fseek(staffFile, 0, SEEK_END) != 0 || (size = ftell(staffFile)) == -1) {
+			retval = -3;
+			goto CLEANUP;
+		}
+
+		StaffCountJob job = { NULL, query, { 0 }, staffFile, { 0 } };
+		parallelFor(size/sizeof(Staff), SCAN_TASK_RECORDS, countRecordsTask, &job);
+		for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+			if(job.retval[i] != 0) {
+				retval = job.retval[i];
+				goto CLEANUP;
+			}
+			retval += job.counts[i];
+		}
+		goto CLEANUP;
+	}
+
+	int read;
+	while(retval < limit && (read = freadStaff(chunk, STAFF_STREAM_CHUNK, staffFile)) > 0) {
+		foldStaffArray(folded, chunk, read);
+		retval += countStaffArray(chunk, folded, read, query, limit-retval);
+	}
+	if(ferror(staffFile)) {
+		retval = -3;
+	}
+
+CLEANUP:
+	free(chunk);
+	free(folded);
+	fclose(staffFile);
+	return retval;
+}
+
+
+int staffExists(StaffQuery* query) {
+	return countStaff(query, 1);
+}
+
+
+int countStaffArray(Staff* staffArr, StaffFolded* foldedArr, int len, StaffQuery* query, int limit) {
+	int count = 0;
+	for(int i = 0; i < len && (limit <= 0 || count < limit); ++i) {
+		count += matchStaff(&staffArr[i], &foldedArr[i], query);
+	}
+	return count;
+}
+
+
+bool matchStaff(Staff* staff, StaffFolded* folded, StaffQuery* query) {
+	if(isStaffDeleted(*staff)) {
+		return false;
+	}
+	if(query->field < 0) {
+		return true;
+	}
+
+	// Both the field and $pattern are already folded.
+	return LIKE(staffFoldedText(folded, query->field), query->pattern, false) != query->invert;
+}
+
+
+bool matchStaffQueries(Staff* staff, StaffFolded* folded, StaffQuery* queries, int len) {
+	bool match = !isStaffDeleted(*staff);
+	for(int i = 0; match && i < len; ++i) {
+		match = matchStaff(staff, folded, &queries[i]);
+	}
+	return match;
+}
+
+
+bool applyStaffUpdate(Staff* staff, StaffUpdate* update) {
+	bool changed = false;
+	for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+		char* text = staffFieldText(staff, field);
+		char* value = staffFieldText(&update->values, field);
+		if(update->fields[field] && strcmp(text, value) != 0) {
+			strcpy(text, value);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+
+char* staffFieldText(Staff* staff, int field) {
+	switch(field) {
+		case SE_ID:
+			return staff->id;
+		case SE_NAME:
+			return staff->details.name;
+		case SE_POSITION:
+			return staff->details.position;
+		case SE_PHONE:
+			return staff->details.phone;
+		case SE_IC:
+			return staff->details.ic;
+		default:
+			return "";
+	}
+}
+
+
+char* staffFoldedText(StaffFolded* folded, int field) {
+	switch(field) {
+		case SE_ID:
+			return folded->id;
+		case SE_NAME:
+			return folded->name;
+		case SE_POSITION:
+			return folded->position;
+		case SE_PHONE:
+			return folded->phone;
+		case SE_IC:
+			return folded->ic;
+		default:
+			return "";
+	}
+}
+
+
+void foldStaff(StaffFolded* folded, Staff* staff) {
+	foldCase(folded->id, staff->id, sizeof(folded->id));
+	foldCase(folded->name, staff->details.name, sizeof(folded->name));
+	foldCase(folded->position, staff->details.position, sizeof(folded->position));
+	foldCase(folded->phone, staff->details.phone, sizeof(folded->phone));
+	foldCase(folded->ic, staff->details.ic, sizeof(folded->ic));
+}
+
+
+void foldStaffArray(StaffFolded* foldedArr, Staff* staffArr, int len) {
+	for(int i = 0; i < len; ++i) {
+		foldStaff(&foldedArr[i], &staffArr[i]);
+	}
+}
+
+
+void foldStaffTask(void* arg, int worker, long first, long count) {
+	(void) worker;
+	StaffFoldJob* job = arg;
+	foldStaffArray(job->foldedArr+first, job->staffArr+first, count);
+}
+
+
+void foldCase(char* dest, char* src, int size) {
+	for(int i = 0; i < size; ++i) {
+		// Clear the lower case bit of 'a' to 'z'.
+		dest[i] = src[i] ^ (((unsigned char) (src[i]-'a') < 26) << 5);
+	}
+}
+
+
+// Names of the StaffModifiableFields, as parsed by parseStaffField() and exported by exportStaff().
+const char* STAFF_FIELD_NAMES[STAFF_ENUM_LENGTH] = { "id", "name", "position", "phone", "ic" };
+// Buffer sizes of the StaffModifiableFields in Staff{}.
+const int STAFF_FIELD_SIZES[STAFF_ENUM_LENGTH] = { 6, 128, 32, 16, 15 };
+
+
+int parseStaffField(char* name) {
+	for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+		const char* fieldName = STAFF_FIELD_NAMES[field];
+		int i = 0;
+		while(name[i] && toupper(name[i]) == toupper(fieldName[i])) {
+			++i;
+		}
+		if(name[i] == 0 && fieldName[i] == 0) {
+			return field;
+		}
+	}
+	return -1;
+}
+
+
+int popcountBitset(char* bitset, int bits) {
+	int total = 0;
+	int i = 0;
+
+	// Count 8 bytes at a time.
+	for(; i+64 <= bits; i += 64) {
+		u64 word;
+		memcpy(&word, bitset+i/8, sizeof(word));
+		#ifdef __GNUC__
+		total += __builtin_popcountll(word);
+		#else
+		word = word - ((word>>1) & 0x5555555555555555);
+		word = (word & 0x3333333333333333) + ((word>>2) & 0x3333333333333333);
+		total += (((word + (word>>4)) & 0x0F0F0F0F0F0F0F0F) * 0x0101010101010101) >> 56;
+		#endif
+	}
+
+	// Count the remaining bits one by one.
+	for(; i < bits; ++i) {
+		total += (bitset[i/8]>>(i%8)) & 1;
+	}
+	return total;
+}
+
+
+int reportStaff(void) {
+	int retval = 0;
+	ReportAggregate agg = { 0 };
+
+	// Summaries are computed first, so the detail table does not have to be aggregated while paging.
+	int res = computeStaffReport(&agg);
+	if(res < 0) {
+		pause();
+		retval = res;
+		goto CLEANUP;
+	}
+
+	cls();
+	printf(
+		"REPORT STAFF\n"
+		"============\n"
+	);
+	printStaffReport(&agg);
+	pause();
+
+	if(agg.totalInactive > 0) {
+		res = reportDepartures();
+		if(res < 0) {
+			retval = res;
+			goto CLEANUP;
+		}
+	}
+
+	DisplayStaffOptions s = displayStaffOptionsInit();
+	s.header =
+		"REPORT STAFF\n"
+		"============\n";
+	s.displayList[SE_ID] = true;
+	s.displayList[SE_NAME] = true;
+	s.displayList[SE_POSITION] = true;
+	s.displayList[SE_PHONE] = true;
+	s.displayList[SE_IC] = true;
+	s.displayDeleted = true;
+	s.displayExisting = true;
+	s.isInclude = false;
+
+	res = displaySelectedStaff(&s);
+	if(res < 0) {
+		retval = res;
+		goto CLEANUP;
+	}
+
+CLEANUP:
+	freeReportAggregate(&agg);
+	return retval;
+}
+
+
+int reportDepartures(void) {
+	int retval = 0;
+	Staff page[ENTRIES_PER_PAGE];
+	char buf[STAFF_BUF_MAX];
+	unsigned int from = 0;
+	unsigned int to = ~0u;
+	int pageNo = 0;
+
+	while(1) {
+		int total = queryDepartures(from, to, pageNo*ENTRIES_PER_PAGE, ENTRIES_PER_PAGE, page);
+		if(total < 0) {
+			perror("Error (Reading departure index)");
+			pause();
+			return total;
+		}
+
+		// Handle page out of bounds.
+		if(pageNo > 0 && pageNo*ENTRIES_PER_PAGE >= total) {
+			pageNo = total == 0 ? 0 : (total-1)/ENTRIES_PER_PAGE;
+			continue;
+		}
+		int shown = total-pageNo*ENTRIES_PER_PAGE < ENTRIES_PER_PAGE ? total-pageNo*ENTRIES_PER_PAGE : ENTRIES_PER_PAGE;
+
+		cls();
+		printf(
+			"REPORT STAFF\n"
+			"============\n"
+			"Past employees by departure date"
+		);
+		if(from == 0 && to == ~0u) {
+			printf(" (All):\n");
+		} else {
+			printf(" (%04u-%02u-%02u to %04u-%02u-%02u):\n", from>>16, (from>>8)&0xFF, from&0xFF, to>>16, (to>>8)&0xFF, to&0xFF);
+		}
+		printf(
+			"Number    DEPARTED      STAFF ID    NAME                              POSITION\n"
+			"------    ----------    --------    ----                              --------\n"
+		);
+		for(int i = 0; i < shown; ++i) {
+			unsigned int date = staffDepartureDate(page[i]);
+			printf(
+				"%6d    %04u-%02u-%02u    %-8s    %-30.30s    %.15s\n",
+				pageNo*ENTRIES_PER_PAGE+i+1, date>>16, (date>>8)&0xFF, date&0xFF,
+				page[i].id, page[i].details.name, page[i].details.position
+			);
+		}
+		if(total == 0) {
+			printf("  No matching entries!\n");
+		}
+		printf("\nDisplaying %d of %d entr%s. (Page %d)\n\n", shown, total, total < 2 ? "y" : "ies", pageNo+1);
+
+		printf(
+			"(Enter ':h' for help.)\n"
+			"(Enter ':q' for the full staff table.)\n"
+			"(Date range): "
+		);
+		buf[0] = 0;
+		int res = scanf("%127[^\n]", buf);
+		if(res == EOF) {
+			retval = EOF;
+			break;
+		}
+		truncate();
+
+		if(buf[0] == ':') {
+			if(toupper(buf[1]) == 'Q') {
+				break;
+			} else if(toupper(buf[1]) == 'N') {
+				++pageNo;
+			} else if(toupper(buf[1]) == 'B' && pageNo > 0) {
+				--pageNo;
+			} else if(toupper(buf[1]) == 'H') {
+				cls();
+				printf(
+					"HELP\n"
+					"====\n"
+					"  Enter a date range to only show staff that left within it.\n"
+					"  Actions:\n"
+					"    2025                   (Staff that left in 2025.)\n"
+					"    2025-06                (Staff that left in June 2025.)\n"
+					"    Q2 2025                (Staff that left in the second quarter of 2025.)\n"
+					"    2025-04-01..2025-06-30 (Staff that left between the two dates, inclusive.)\n"
+					"    (Empty)                (All past employees.)\n"
+					"    :h                     (Help.)\n"
+					"    :n                     (Next page.)\n"
+					"    :b                     (Go back a page.)\n"
+					"    :q                     (Quit to the full staff table.)\n\n"
+				);
+				pause();
+			}
+		} else if(parseDepartureRange(buf, &from, &to)) {
+			pageNo = 0;
+		} else {
+			printf("Invalid date range!\n");
+			pause();
+		}
+	}
+
+	return retval;
+}
+
+
+FILE* openDepartureIndex(DepartureIndexHeader* header, StaffFileStamp* before, bool* rebuilt) {
+	if(rebuilt != NULL) {
+		*rebuilt = false;
+	}
+
+	// The index is checked against the stamp of the staff file.
+	StaffFileStamp stamp;
+	FILE* staffFile = fopen("staff.bin", "rb");
+	if(staffFile == NULL || statStaffFile(staffFile, &stamp) != 0) {
+		if(staffFile != NULL) {
+			fclose(staffFile);
+		}
+		return NULL;
+	}
+	fclose(staffFile);
+
+	// Create a missing index without truncating one that another terminal just created.
+	FILE* indexFile = fopen(DEPARTURE_INDEX_FILE, "rb+");
+	if(indexFile == NULL) {
+		FILE* created = fopen(DEPARTURE_INDEX_FILE, "ab");
+		if(created != NULL) {
+			fclose(created);
+		}
+		indexFile = fopen(DEPARTURE_INDEX_FILE, "rb+");
+	}
+	// Other terminals wait until the index is closed, so it is checked and rebuilt or appended to at once.
+	if(indexFile == NULL || lockStaff(indexFile, 0, 0, SL_EXCLUSIVE) != 0) {
+		if(indexFile != NULL) {
+			fclose(indexFile);
+		}
+		return NULL;
+	}
+
+	// Any write to the staff file could have deleted staff, unless it is the caller's own write.
+	if(
+		fread(header, sizeof(*header), 1, indexFile) != 1 ||
+		memcmp(header->magic, "SDI2", 4) != 0 ||
+		header->length < 0 ||
+		(u64) header->length > stamp.size/sizeof(Staff) ||
+		(memcmp(&header->stamp, &stamp, sizeof(stamp)) != 0 && (before == NULL || memcmp(&header->stamp, before, sizeof(stamp)) != 0))
+	) {
+		if(rebuildDepartureIndex(indexFile, header) != 0) {
+			fclose(indexFile);
+			return NULL;
+		}
+		if(rebuilt != NULL) {
+			*rebuilt = true;
+		}
+	} else {
+		header->stamp = stamp;
+	}
+	return indexFile;
+}
+
+
+int rebuildDepartureIndex(FILE* indexFile, DepartureIndexHeader* header) {
+	int retval = 0;
+	DepartureScanJob job = { 0 };
+	DepartureEntry* entries = NULL;
+	long size;
+	StaffFileStamp after;
+	*header = (DepartureIndexHeader) { "SDI2", 0, { 0, 0, 0 } };
+
+	// Opened once for every worker, closing a descriptor of the staff file would release every record lock. (See lockStaff())
+	job.staffFile = fopen("staff.bin", "rb");
+	if(job.staffFile == NULL || statStaffFile(job.staffFile, &header->stamp) != 0 || fseek(job.staffFile, 0, SEEK_END) != 0 || (size = ftell(job.staffFile)) == -1) {
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// Collect every deleted staff, every worker into its own array. They are sorted together afterwards.
+	parallelFor(size/sizeof(Staff), SCAN_TASK_RECORDS, departuresTask, &job);
+	for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+		if(job.retval[i] != 0) {
+			retval = job.retval[i];
+			goto CLEANUP;
+		}
+		header->length += job.lengths[i];
+	}
+
+	entries = malloc(header->length*sizeof(DepartureEntry)+1);
+	if(entries == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	for(int i = 0, length = 0; i < POOL_THREADS_MAX; length += job.lengths[i++]) {
+		if(job.lengths[i] > 0) {
+			memcpy(&entries[length], job.entries[i], job.lengths[i]*sizeof(DepartureEntry));
+		}
+	}
+
+	// A write during the scan may or may not be in the entries, so the next open rebuilds the index again.
+	if(statStaffFile(job.staffFile, &after) != 0 || memcmp(&after, &header->stamp, sizeof(after)) != 0) {
+		memset(&header->stamp, 0, sizeof(header->stamp));
+	}
+
+	if(header->length > 0) {
+		qsort(entries, header->length, sizeof(DepartureEntry), compareDepartureEntry);
+	}
+
+	// Entries past $length from the previous index are left over, and never read.
+	rewind(indexFile);
+	if(
+		fwrite(header, sizeof(*header), 1, indexFile) != 1 ||
+		(header->length > 0 && fwrite(entries, sizeof(DepartureEntry), header->length, indexFile) != (size_t) header->length) ||
+		fflush(indexFile) == EOF
+	) {
+		retval = -3;
+	}
+
+CLEANUP:
+	for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+		free(job.entries[i]);
+	}
+	free(entries);
+	if(job.staffFile != NULL) {
+		fclose(job.staffFile);
+	}
+	return retval;
+}
+
+
+void departuresTask(void* arg, int worker, long first, long count) {
+	DepartureScanJob* job = arg;
+	if(job->retval[worker] != 0) {
+		// The scan already failed.
+		return;
+	}
+
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	if(chunk == NULL) {
+		job->retval[worker] = -4;
+		return;
+	}
+
+	// Every chunk is read at its offset under its own lock, like reportTask().
+	for(long record = first; record < first+count;) {
+		int want = first+count-record < STAFF_STREAM_CHUNK ? first+count-record : STAFF_STREAM_CHUNK;
+		if(lockStaff(job->staffFile, record, want, SL_SHARED) != 0) {
+			job->retval[worker] = -3;
+			break;
+		}
+		int read = preadStaff(job->staffFile, chunk, record, want);
+		lockStaff(job->staffFile, record, want, SL_UNLOCK);
+		if(read == 0) {
+			// File was truncated while reading, the stamp changed so the index is rebuilt again.
+			break;
+		}
+
+		for(int i = 0; i < read; ++i) {
+			if(!isStaffDeleted(chunk[i])) {
+				continue;
+			}
+
+			if(job->lengths[worker] == job->capacities[worker]) {
+				int capacity = job->capacities[worker] == 0 ? 128 : job->capacities[worker]*2;
+				DepartureEntry* tmp = realloc(job->entries[worker], capacity*sizeof(DepartureEntry));
+				if(tmp == NULL) {
+					job->retval[worker] = -4;
+					free(chunk);
+					return;
+				}
+				job->entries[worker] = tmp;
+				job->capacities[worker] = capacity;
+			}
+			job->entries[worker][job->lengths[worker]++] = (DepartureEntry) { staffDepartureDate(chunk[i]), record+i };
+		}
+		record += read;
+	}
+
+	free(chunk);
+}
+
+
+int addDepartures(DepartureEntry* entries, int len, StaffFileStamp* before) {
+	int retval = 0;
+	DepartureIndexHeader header;
+	bool rebuilt;
+	FILE* indexFile = openDepartureIndex(&header, before, &rebuilt);
+
+	if(indexFile == NULL) {
+		return -3;
+	}
+	if(rebuilt) {
+		// A rebuilt index already contains $entries.
+		goto CLEANUP;
+	}
+
+	DepartureEntry last = { 0, 0 };
+	if(
+		header.length > 0 && (
+			fseek(indexFile, sizeof(DepartureIndexHeader) + (header.length-1)*sizeof(DepartureEntry), SEEK_SET) != 0 ||
+			fread(&last, sizeof(DepartureEntry), 1, indexFile) != 1
+		)
+	) {
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// Appending is only valid if the dates stay sorted. (E.g. Not when the system clock was turned back.)
+	if(len > 0 && entries[0].date < last.date) {
+		retval = rebuildDepartureIndex(indexFile, &header);
+		goto CLEANUP;
+	}
+
+	// Append the entries, then update the header with the stamp of the staff file after the deletions.
+	if(
+		len > 0 && (
+			fseek(indexFile, sizeof(DepartureIndexHeader) + header.length*sizeof(DepartureEntry), SEEK_SET) != 0 ||
+			fwrite(entries, sizeof(DepartureEntry), len, indexFile) != (size_t) len
+		)
+	) {
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	header.length += len;
+	rewind(indexFile);
+	if(fwrite(&header, sizeof(header), 1, indexFile) != 1) {
+		retval = -3;
+	}
+
+CLEANUP:
+	if(fclose(indexFile) == EOF) {
+		retval = -3;
+	}
+	return retval;
+}
+
+
+int queryDepartures(unsigned int from, unsigned int to, int offset, int limit, Staff* staffOut) {
+	DepartureIndexHeader header;
+	FILE* indexFile = openDepartureIndex(&header, NULL, NULL);
+	FILE* staffFile = NULL;
+	int retval = 0;
+
+	if(indexFile == NULL) {
+		return -3;
+	}
+	int length = header.length;
+
+	int first = departureLowerBound(indexFile, length, from);
+	int last = to == ~0u ? length : departureLowerBound(indexFile, length, to+1);
+	if(first < 0 || last < 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+	retval = last-first;
+
+	if(staffOut == NULL || offset >= last-first) {
+		goto CLEANUP;
+	}
+	if(limit > last-first-offset) {
+		limit = last-first-offset;
+	}
+
+	// Read the page of entries, then read each staff it points to.
+	staffFile = fopen("staff.bin", "rb");
+	if(staffFile == NULL || fseek(indexFile, sizeof(DepartureIndexHeader) + (first+offset)*sizeof(DepartureEntry), SEEK_SET) != 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+	for(int i = 0; i < limit; ++i) {
+		DepartureEntry entry;
+		if(fread(&entry, sizeof(entry), 1, indexFile) != 1) {
+			retval = -3;
+			goto CLEANUP;
+		}
+
+		long pos = ftell(indexFile);
+		if(
+			fseek(staffFile, entry.record*(long) sizeof(Staff), SEEK_SET) != 0 ||
+			freadStaff(&staffOut[i], 1, staffFile) != 1 ||
+			pos == -1 ||
+			fseek(indexFile, pos, SEEK_SET) != 0
+		) {
+			retval = -3;
+			goto CLEANUP;
+		}
+	}
+
+CLEANUP:
+	fclose(indexFile);
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	return retval;
+}
+
+
+int departureLowerBound(FILE* indexFile, int length, unsigned int date) {
+	int l = 0;
+	int r = length;
+	while(l < r) {
+		int mid = l+(r-l)/2;
+		DepartureEntry entry;
+		if(
+			fseek(indexFile, sizeof(DepartureIndexHeader) + mid*sizeof(DepartureEntry), SEEK_SET) != 0 ||
+			fread(&entry, sizeof(entry), 1, indexFile) != 1
+		) {
+			return -3;
+		}
+
+		if(entry.date < date) {
+			l = mid+1;
+		} else {
+			r = mid;
+		}
+	}
+	return l;
+}
+
+
+bool parseDepartureRange(char* buf, unsigned int* from, unsigned int* to) {
+	// Last day of the month, for ranges that end at the end of a month.
+	#define lastDay(_year, _month) ((_month) == 2 ? (((_year)%4 == 0 && (_year)%100 != 0) || (_year)%400 == 0 ? 29 : 28) : ((_month) == 4 || (_month) == 6 || (_month) == 9 || (_month) == 11 ? 30 : 31))
+	// Years have 4 digits, like the deletion dates.
+	#define isValidDate(_year, _month, _day) ((_year) >= 1 && (_year) <= 9999 && (_month) >= 1 && (_month) <= 12 && (_day) >= 1 && (_day) <= lastDay(_year, _month))
+
+	int year, month, day, year2, month2, day2, consumed = 0;
+
+	// Skip leading spaces.
+	while(*buf == ' ') {
+		++buf;
+	}
+
+	if(*buf == 0) {
+		*from = 0;
+		*to = ~0u;
+		return true;
+	} else if(toupper(*buf) == 'Q' && sscanf(buf+1, "%d %d%n", &month, &year, &consumed) == 2 && buf[1+consumed] == 0) {
+		if(month < 1 || month > 4 || !isValidDate(year, 1, 1)) {
+			return false;
+		}
+		*from = (year<<16) | (((month-1)*3+1)<<8) | 1;
+		*to = (year<<16) | ((month*3)<<8) | lastDay(year, month*3);
+	} else if(sscanf(buf, "%d-%d-%d..%d-%d-%d%n", &year, &month, &day, &year2, &month2, &day2, &consumed) == 6 && buf[consumed] == 0) {
+		if(!isValidDate(year, month, day) || !isValidDate(year2, month2, day2)) {
+			return false;
+		}
+		*from = (year<<16) | (month<<8) | day;
+		*to = (year2<<16) | (month2<<8) | day2;
+	} else if(sscanf(buf, "%d-%d%n", &year, &month, &consumed) == 2 && buf[consumed] == 0) {
+		if(!isValidDate(year, month, 1)) {
+			return false;
+		}
+		*from = (year<<16) | (month<<8) | 1;
+		*to = (year<<16) | (month<<8) | lastDay(year, month);
+	} else if(sscanf(buf, "%d%n", &year, &consumed) == 1 && buf[consumed] == 0) {
+		if(!isValidDate(year, 1, 1)) {
+			return false;
+		}
+		*from = (year<<16) | (1<<8) | 1;
+		*to = (year<<16) | (12<<8) | 31;
+	} else {
+		return false;
+	}
+
+	#undef isValidDate
+	#undef lastDay
+	return *from <= *to;
+}
+
+
+int compareDepartureEntry(const void* a, const void* b) {
+	const DepartureEntry* x = a;
+	const DepartureEntry* y = b;
+	if(x->date != y->date) {
+		return (x->date > y->date) - (x->date < y->date);
+	}
+	return x->record - y->record;
+}
+
+
+int findStaffId(FILE* staffFile, char* id, Staff* staff) {
+	StaffIdIndexHeader header;
+	FILE* indexFile = openStaffIdIndex(staffFile, &header, NULL);
+	if(indexFile == NULL) {
+		return -3;
+	}
+
+	int retval = findStaffIdSlot(staffFile, indexFile, &header, id, staff);
+	fclose(indexFile);
+	return retval;
+}
+
+
+int findStaffIdSlot(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, char* id, Staff* staff) {
+	// Probe until an empty slot, skipping the slots whose record no longer exists with the ID.
+	int retval = -15;
+	int mask = header->capacity-1;
+	for(int slot = hashStaffId(id)&mask, probes = 0; probes < header->capacity; slot = (slot+1)&mask, ++probes) {
+		StaffIdSlot current;
+		if(
+			fseek(indexFile, sizeof(StaffIdIndexHeader) + slot*(long) sizeof(StaffIdSlot), SEEK_SET) != 0 ||
+			fread(&current, sizeof(current), 1, indexFile) != 1
+		) {
+			retval = -3;
+			break;
+		}
+		if(current.id[0] == 0) {
+			break;
+		}
+
+		Staff found;
+		current.id[5] = '\0';
+		if(
+			strcmp(current.id, id) != 0 ||
+			preadStaff(staffFile, &found, current.record, 1) != 1 ||
+			isStaffDeleted(found) ||
+			strcmp(found.id, id) != 0
+		) {
+			continue;
+		}
+		if(staff != NULL) {
+			*staff = found;
+		}
+		retval = current.record;
+		break;
+	}
+	return retval;
+}
+
+
+int indexStaffIds(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, StaffModification* modifications, int* statuses, int len) {
+	int renamed = 0;
+	for(int i = 0; i < len; ++i) {
+		renamed += statuses[i] == 0 && strcmp(modifications[i].modified.id, modifications[i].original.id) != 0;
+	}
+	if(renamed == 0) {
+		return 0;
+	}
+
+	// The new IDs are not written yet, so a rebuilt index leaves room for them instead.
+	int retval = 0;
+	if((header->length+renamed)*2 > header->capacity) {
+		retval = rebuildStaffIdIndex(staffFile, indexFile, header, renamed);
+	}
+	for(int i = 0; retval == 0 && i < len; ++i) {
+		if(statuses[i] == 0 && strcmp(modifications[i].modified.id, modifications[i].original.id) != 0) {
+			retval = addStaffIdSlot(indexFile, header, modifications[i].modified.id, modifications[i].record);
+		}
+	}
+
+	rewind(indexFile);
+	if(retval == 0 && (fwrite(header, sizeof(*header), 1, indexFile) != 1 || fflush(indexFile) == EOF)) {
+		retval = -3;
+	}
+	return retval;
+}
+
+
+FILE* openStaffIdIndex(FILE* staffFile, StaffIdIndexHeader* header, StaffFileStamp* before) {
+	bool opened = false;
+	Staff* chunk = NULL;
+	FILE* indexFile = NULL;
+
+	// The index is checked against the stamp of the staff file.
+	StaffFileStamp stamp;
+	if(statStaffFile(staffFile, &stamp) != 0) {
+		return NULL;
+	}
+	long recordCount = stamp.size/sizeof(Staff);
+
+	// Create a missing index without truncating one that another terminal just created.
+	indexFile = fopen(STAFF_ID_INDEX_FILE, "rb+");
+	if(indexFile == NULL) {
+		FILE* created = fopen(STAFF_ID_INDEX_FILE, "ab");
+		if(created != NULL) {
+			fclose(created);
+		}
+		indexFile = fopen(STAFF_ID_INDEX_FILE, "rb+");
+	}
+	// Other terminals wait until the index is closed, the header is read and written back.
+	if(indexFile == NULL || lockStaff(indexFile, 0, 0, SL_EXCLUSIVE) != 0) {
+		goto CLEANUP;
+	}
+
+	// Records are never removed, an index of more records than the staff file has is of another file.
+	// Every write moves the stamp on, so another stamp than the caller's own write means the staff file was replaced.
+	if(
+		fread(header, sizeof(*header), 1, indexFile) != 1 ||
+		memcmp(header->magic, "SII2", 4) != 0 ||
+		header->recordCount > recordCount ||
+		header->capacity <= 0 ||
+		(header->capacity&(header->capacity-1)) != 0 ||
+		header->length*2 > header->capacity ||
+		(memcmp(&header->stamp, &stamp, sizeof(stamp)) != 0 && (before == NULL || memcmp(&header->stamp, before, sizeof(stamp)) != 0))
+	) {
+		opened = rebuildStaffIdIndex(staffFile, indexFile, header, 0) == 0;
+		goto CLEANUP;
+	}
+	if(header->recordCount == recordCount && memcmp(&header->stamp, &stamp, sizeof(stamp)) == 0) {
+		opened = true;
+		goto CLEANUP;
+	}
+
+	// Index the records appended since, usually a few.
+	chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	if(chunk == NULL) {
+		goto CLEANUP;
+	}
+	int read;
+	while(header->recordCount < recordCount && (read = preadStaff(staffFile, chunk, header->recordCount, STAFF_STREAM_CHUNK)) > 0) {
+		for(int i = 0; i < read; ++i) {
+			if((header->length+1)*2 > header->capacity) {
+				// Half full, rebuild it with room for more.
+				opened = rebuildStaffIdIndex(staffFile, indexFile, header, 0) == 0;
+				goto CLEANUP;
+			}
+			if(!isStaffDeleted(chunk[i]) && addStaffIdSlot(indexFile, header, chunk[i].id, header->recordCount+i) != 0) {
+				goto CLEANUP;
+			}
+		}
+		header->recordCount += read;
+	}
+	header->stamp = stamp;
+	rewind(indexFile);
+	opened = fwrite(header, sizeof(*header), 1, indexFile) == 1;
+
+CLEANUP:
+	free(chunk);
+	if(!opened && indexFile != NULL) {
+		fclose(indexFile);
+		indexFile = NULL;
+	}
+	return indexFile;
+}
+
+
+int stampStaffIdIndex(FILE* staffFile, StaffFileStamp* before) {
+	FILE* indexFile = fopen(STAFF_ID_INDEX_FILE, "rb");
+	if(indexFile == NULL) {
+		return 0;
+	}
+	fclose(indexFile);
+
+	StaffIdIndexHeader header;
+	indexFile = openStaffIdIndex(staffFile, &header, before);
+	if(indexFile == NULL) {
+		return -3;
+	}
+	fclose(indexFile);
+	return 0;
+}
+
+
+int rebuildStaffIdIndex(FILE* staffFile, FILE* indexFile, StaffIdIndexHeader* header, int extra) {
+	int retval = 0;
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	StaffIdSlot* entries = NULL;
+	StaffIdSlot* slots = NULL;
+	int capacity = 0;
+	int length = 0;
+	*header = (StaffIdIndexHeader) { "SII2", 0, 1024, 0, { 0, 0, 0 } };
+
+	// Writes during the scan are at most appended records and IDs that are checked on lookup anyway, so the stamp before it is kept.
+	if(chunk == NULL || statStaffFile(staffFile, &header->stamp) != 0) {
+		retval = chunk == NULL ? -4 : -3;
+		goto CLEANUP;
+	}
+
+	// Collect every existing staff.
+	int read;
+	while((read = preadStaff(staffFile, chunk, header->recordCount, STAFF_STREAM_CHUNK)) > 0) {
+		for(int i = 0; i < read; ++i) {
+			if(isStaffDeleted(chunk[i])) {
+				continue;
+			}
+
+			if(length == capacity) {
+				capacity = capacity == 0 ? STAFF_STREAM_CHUNK : capacity*2;
+				StaffIdSlot* tmp = realloc(entries, capacity*sizeof(StaffIdSlot));
+				if(tmp == NULL) {
+					retval = -4;
+					goto CLEANUP;
+				}
+				entries = tmp;
+			}
+			entries[length] = (StaffIdSlot) { { 0 }, header->recordCount+i };
+			strncpy(entries[length++].id, chunk[i].id, sizeof(entries->id)-1);
+		}
+		header->recordCount += read;
+	}
+
+	// At most a quarter full, so it takes as many changes again before the next rebuild.
+	while(header->capacity < (length+extra)*4) {
+		header->capacity *= 2;
+	}
+	slots = calloc(header->capacity, sizeof(StaffIdSlot));
+	if(slots == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	int mask = header->capacity-1;
+	for(int i = 0; i < length; ++i) {
+		int slot = hashStaffId(entries[i].id)&mask;
+		while(slots[slot].id[0] != 0) {
+			slot = (slot+1)&mask;
+		}
+		slots[slot] = entries[i];
+	}
+	header->length = length;
+
+	rewind(indexFile);
+	if(
+		fwrite(header, sizeof(*header), 1, indexFile) != 1 ||
+		fwrite(slots, sizeof(StaffIdSlot), header->capacity, indexFile) != (size_t) header->capacity ||
+		fflush(indexFile) == EOF
+	) {
+		retval = -3;
+	}
+
+CLEANUP:
+	free(chunk);
+	free(entries);
+	free(slots);
+	return retval;
+}
+
+
+int addStaffIdSlot(FILE* indexFile, StaffIdIndexHeader* header, char* id, int record) {
+	int mask = header->capacity-1;
+	for(int slot = hashStaffId(id)&mask; ; slot = (slot+1)&mask) {
+		long offset = sizeof(StaffIdIndexHeader) + slot*(long) sizeof(StaffIdSlot);
+		StaffIdSlot current;
+		if(fseek(indexFile, offset, SEEK_SET) != 0 || fread(&current, sizeof(current), 1, indexFile) != 1) {
+			return -3;
+		}
+
+		if(current.id[0] != 0) {
+			current.id[5] = '\0';
+			if(current.record == record && strcmp(current.id, id) == 0) {
+				return 0;
+			}
+			continue;
+		}
+
+		current = (StaffIdSlot) { { 0 }, record };
+		strncpy(current.id, id, sizeof(current.id)-1);
+		if(fseek(indexFile, offset, SEEK_SET) != 0 || fwrite(&current, sizeof(current), 1, indexFile) != 1) {
+			return -3;
+		}
+		++header->length;
+		return 0;
+	}
+}
+
+
+unsigned int hashStaffId(char* id) {
+	// IDs are matched case insensitively, as staffExists() does.
+	char key[6] = { 0 };
+	foldCase(key, id, sizeof(key)-1);
+	unsigned int hash = 2166136261u;
+	for(int i = 0; i < 5 && key[i]; ++i) {
+		hash = (hash^(unsigned char) key[i])*16777619u;
+	}
+	return hash;
+}
+
+
+int computeStaffReport(ReportAggregate* agg) {
+	int retval = 0;
+	ReportJob job = { 0 };
+	bool daemon = useStaffDaemon();
+
+	if(daemon) {
+		// Aggregate a pinned version, so the report is consistent while writers keep going.
+		// The connection is read by this thread only, so every batch read is aggregated by the task pool from memory.
+		StaffSnapshot* snapshot = NULL;
+		job.records = malloc(SCAN_TASK_RECORDS*sizeof(Staff));
+		retval = job.records == NULL ? -4 : requestStaff(SR_PIN, NULL, 0, (void**) &snapshot, NULL);
+
+		for(int i = 0; retval == 0 && i < snapshot->length; i += SCAN_TASK_RECORDS) {
+			int read = readStaffSnapshot(snapshot, job.records, i, SCAN_TASK_RECORDS);
+			if(read < 0) {
+				retval = read;
+				break;
+			}
+			parallelFor(read, STAFF_STREAM_CHUNK, reportTask, &job);
+		}
+		if(snapshot != NULL) {
+			requestStaff(SR_UNPIN, &snapshot->version, sizeof(snapshot->version), NULL, NULL);
+		}
+		free(snapshot);
+		free(job.records);
+	} else {
+		// Opened once for every worker, closing a descriptor of the staff file would release every record lock. (See lockStaff())
+		job.staffFile = fopen("staff.bin", "rb");
+		long len;
+		if(job.staffFile == NULL || fseek(job.staffFile, 0, SEEK_END) != 0 || (len = ftell(job.staffFile)) == -1) {
+			retval = -3;
+		} else {
+			parallelFor(len/sizeof(Staff), SCAN_TASK_RECORDS, reportTask, &job);
+		}
+		if(job.staffFile != NULL) {
+			fclose(job.staffFile);
+		}
+	}
+
+	// Merge the partial aggregates.
+	for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+		if(retval == 0) {
+			retval = job.workers[i].retval != 0 ? job.workers[i].retval : mergeReportAggregate(agg, &job.workers[i].agg);
+		}
+		freeReportAggregate(&job.workers[i].agg);
+	}
+
+	if(retval == -3) {
+		perror(daemon ? "Error (Requesting staff daemon)" : "Error (Reading staff file)");
+	} else if(retval == -4) {
+		perror("Error (malloc report)");
+	}
+	return retval;
+}
+
+
+void reportTask(void* arg, int worker, long first, long count) {
+	ReportJob* job = arg;
+	ReportWorker* self = &job->workers[worker];
+	if(self->retval != 0) {
+		// The report already failed.
+		return;
+	}
+	if(job->records != NULL) {
+		self->retval = aggregateStaff(&self->agg, job->records+first, count);
+		return;
+	}
+
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	if(chunk == NULL) {
+		self->retval = -4;
+		return;
+	}
+
+	// The workers share the position of the staff file, so every chunk is read at its offset.
+	// Ranges of workers never overlap, so unlocking a chunk does not release the chunk of another worker.
+	for(long record = first; record < first+count;) {
+		int want = first+count-record < STAFF_STREAM_CHUNK ? first+count-record : STAFF_STREAM_CHUNK;
+		if(lockStaff(job->staffFile, record, want, SL_SHARED) != 0) {
+			self->retval = -3;
+			break;
+		}
+		int read = preadStaff(job->staffFile, chunk, record, want);
+		lockStaff(job->staffFile, record, want, SL_UNLOCK);
+		if(read == 0) {
+			// File was truncated while reading, aggregate what was read.
+			break;
+		}
+		self->retval = aggregateStaff(&self->agg, chunk, read);
+		if(self->retval != 0) {
+			break;
+		}
+		record += read;
+	}
+
+	free(chunk);
+}
+
+
+void countRecordsTask(void* arg, int worker, long first, long count) {
+	StaffCountJob* job = arg;
+	if(job->retval[worker] != 0) {
+		// The count already failed.
+		return;
+	}
+
+	// LIKE() writes to the pattern temporarily, so every task matches with its own copy.
+	StaffQuery query = *job->query;
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	StaffFolded* folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+	if(chunk == NULL || folded == NULL) {
+		job->retval[worker] = -4;
+		free(chunk);
+		free(folded);
+		return;
+	}
+
+	// Every chunk is read at its offset under its own lock, like reportTask().
+	for(long record = first; record < first+count;) {
+		int want = first+count-record < STAFF_STREAM_CHUNK ? first+count-record : STAFF_STREAM_CHUNK;
+		if(lockStaff(job->staffFile, record, want, SL_SHARED) != 0) {
+			job->retval[worker] = -3;
+			break;
+		}
+		int read = preadStaff(job->staffFile, chunk, record, want);
+		lockStaff(job->staffFile, record, want, SL_UNLOCK);
+		if(read == 0) {
+			// File was truncated while reading, count what was read.
+			break;
+		}
+		foldStaffArray(folded, chunk, read);
+		job->counts[worker] += countStaffArray(chunk, folded, read, &query, 0);
+		record += read;
+	}
+
+	free(chunk);
+	free(folded);
+}
+
+
+int aggregateStaff(ReportAggregate* agg, Staff* staffArr, int len) {
+	for(int i = 0; i < len; ++i) {
+		// Group staff without a position together instead of creating an empty key.
+		ReportBucket* bucket = reportTableFind(&agg->positions, staffArr[i].details.position[0] ? staffArr[i].details.position : "-", 0);
+		if(bucket == NULL) {
+			return -4;
+		}
+
+		if(isStaffDeleted(staffArr[i])) {
+			++bucket->inactive;
+			++agg->totalInactive;
+
+			bucket = reportTableFind(&agg->months, NULL, staffDepartureDate(staffArr[i])>>8);
+			if(bucket == NULL) {
+				return -4;
+			}
+			++bucket->inactive;
+		} else {
+			++bucket->active;
+			++agg->totalActive;
+		}
+	}
+	return 0;
+}
+
+
+int mergeReportAggregate(ReportAggregate* dest, ReportAggregate* src) {
+	ReportTable* tables[2][2] = {
+		{ &dest->positions, &src->positions },
+		{ &dest->months, &src->months }
+	};
+
+	for(int t = 0; t < 2; ++t) {
+		for(int i = 0; i < tables[t][1]->capacity; ++i) {
+			ReportBucket* from = &tables[t][1]->buckets[i];
+			if(!from->used) {
+				continue;
+			}
+
+			ReportBucket* to = reportTableFind(tables[t][0], from->position[0] ? from->position : NULL, from->key);
+			if(to == NULL) {
+				return -4;
+			}
+			to->active += from->active;
+			to->inactive += from->inactive;
+		}
+	}
+	dest->totalActive += src->totalActive;
+	dest->totalInactive += src->totalInactive;
+	return 0;
+}
+
+
+ReportBucket* reportTableFind(ReportTable* table, char* position, unsigned int key) {
+	#define isBucketEmpty(_bucket) (!(_bucket).used)
+
+	// Keep the load factor below half so probing stays short. Also allocates the table on the first insert.
+	if(table->length*2 >= table->capacity) {
+		int newCapacity = table->capacity == 0 ? 16 : table->capacity*2;
+		ReportBucket* newBuckets = calloc(newCapacity, sizeof(ReportBucket));
+		if(newBuckets == NULL) {
+			return NULL;
+		}
+
+		for(int i = 0; i < table->capacity; ++i) {
+			if(isBucketEmpty(table->buckets[i])) {
+				continue;
+			}
+			unsigned int idx = reportHash(table->buckets[i].position[0] ? table->buckets[i].position : NULL, table->buckets[i].key) & (newCapacity-1);
+			while(!isBucketEmpty(newBuckets[idx])) {
+				idx = (idx+1) & (newCapacity-1);
+			}
+			newBuckets[idx] = table->buckets[i];
+		}
+		free(table->buckets);
+		table->buckets = newBuckets;
+		table->capacity = newCapacity;
+	}
+
+	unsigned int idx = reportHash(position, key) & (table->capacity-1);
+	while(!isBucketEmpty(table->buckets[idx])) {
+		ReportBucket* bucket = &table->buckets[idx];
+		if(position == NULL ? bucket->key == key : bucket->position[0] != 0) {
+			if(position == NULL) {
+				return bucket;
+			}
+
+			// Compare positions case insensitively.
+			int i = 0;
+			while(i < 31 && position[i] && toupper(position[i]) == toupper(bucket->position[i])) {
+				++i;
+			}
+			if(i == 31 || toupper(position[i]) == toupper(bucket->position[i])) {
+				return bucket;
+			}
+		}
+		idx = (idx+1) & (table->capacity-1);
+	}
+
+	// Not found, insert a new bucket.
+	ReportBucket* bucket = &table->buckets[idx];
+	bucket->used = true;
+	if(position != NULL) {
+		strncpy(bucket->position, position, 31);
+		bucket->position[31] = 0;
+	} else {
+		bucket->key = key;
+	}
+	++table->length;
+
+	#undef isBucketEmpty
+	return bucket;
+}
+
+
+unsigned int reportHash(char* position, unsigned int key) {
+	if(position == NULL) {
+		// Knuth's multiplicative hash.
+		return key * 2654435761u;
+	}
+
+	// FNV-1a of the upper cased position.
+	unsigned int hash = 2166136261u;
+	for(int i = 0; i < 31 && position[i]; ++i) {
+		hash = (hash ^ (unsigned char) toupper(position[i])) * 16777619u;
+	}
+	return hash;
+}
+
+
+int compareReportPosition(const void* a, const void* b) {
+	const ReportBucket* x = a;
+	const ReportBucket* y = b;
+	// Largest headcount first, then alphabetically.
+	if(x->active != y->active) {
+		return y->active - x->active;
+	}
+	return strcmp(x->position, y->position);
+}
+
+
+int compareReportMonth(const void* a, const void* b) {
+	const ReportBucket* x = a;
+	const ReportBucket* y = b;
+	return (x->key > y->key) - (x->key < y->key);
+}
+
+
+void printStaffReport(ReportAggregate* agg) {
+	Frame frame = { 0 };
+	framePrintf(
+		&frame,
+		"Summary:\n"
+		"--------\n"
+		"Active staff   : %d\n"
+		"Past employees : %d\n"
+		"Total records  : %d\n\n",
+		agg->totalActive, agg->totalInactive, agg->totalActive+agg->totalInactive
+	);
+
+	ReportTable* tables[2] = { &agg->positions, &agg->months };
+	for(int t = 0; t < 2; ++t) {
+		// If the buckets cannot be sorted, the hash table is printed unsorted.
+		int listLen;
+		ReportBucket* sorted = sortReportBuckets(tables[t], t == 0 ? compareReportPosition : compareReportMonth, &listLen);
+		ReportBucket* list = sorted != NULL ? sorted : tables[t]->buckets;
+
+		if(t == 0) {
+			framePrintf(
+				&frame,
+				"Headcount by position:\n"
+				"----------------------\n"
+				"POSITION                           ACTIVE    LEFT\n"
+			);
+		} else {
+			framePrintf(
+				&frame,
+				"Departures by month:\n"
+				"--------------------\n"
+				"MONTH      DEPARTURES\n"
+			);
+		}
+
+		for(int i = 0; i < listLen; ++i) {
+			if(!list[i].used) {
+				continue;
+			}
+			if(t == 0) {
+				framePrintf(&frame, "%-31s    %6d    %4d\n", list[i].position, list[i].active, list[i].inactive);
+			} else {
+				framePrintf(&frame, "%04u-%02u    %10d\n", list[i].key>>8, list[i].key&0xFF, list[i].inactive);
+			}
+		}
+		if(tables[t]->length == 0) {
+			framePrintf(&frame, "  No entries!\n");
+		}
+		frameAppend(&frame, "\n", 1);
+		free(sorted);
+	}
+
+	if(flushFrame(&frame) != 0) {
+		perror("Error (Drawing staff report)");
+	}
+	free(frame.text);
+}
+
+
+ReportBucket* sortReportBuckets(ReportTable* table, int (*compare)(const void*, const void*), int* length) {
+	// Copy the used buckets out of the hash table to sort them.
+	ReportBucket* sorted = malloc(table->length*sizeof(ReportBucket)+1);
+	*length = sorted != NULL ? 0 : table->capacity;
+
+	if(sorted != NULL) {
+		for(int i = 0; i < table->capacity; ++i) {
+			if(table->buckets[i].used) {
+				sorted[(*length)++] = table->buckets[i];
+			}
+		}
+		qsort(sorted, *length, sizeof(ReportBucket), compare);
+	}
+	return sorted;
+}
+
+
+void freeReportAggregate(ReportAggregate* agg) {
+	free(agg->positions.buckets);
+	free(agg->months.buckets);
+	*agg = (ReportAggregate) { 0 };
+}
+
+
+int deleteStaff(void) {
+	int retval = 0;
+	FILE* staffFile = fopen("staff.bin", "rb+");
+	Staff* staffArr = NULL;
+	
+	if(staffFile == NULL) {
+		perror("Error (Opening staff file)");
+		pause();
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	int len = loadStaff(&staffArr);
+	if(len < 0) {
+		perror(len == -4 ? "Error (malloc failed)" : "Error (Reading staff file)");
+		pause();
+		retval = len;
+		goto CLEANUP;
+	}
+
+	// Limit delete amount.
+	// $ENTRIES_PER_PAGE + 1 to store user prompt.
+	// $ID_SIZE + 1 to check for overflows.
+	// $ID_SIZE + 1 to store exclamation mark.
+	#define ID_SIZE 6
+	char deleteListData[ENTRIES_PER_PAGE+1][ID_SIZE+2];
+	// Create another array that contains the address of each string.
+	char* deleteList[ENTRIES_PER_PAGE+1];
+	for(int i = 0; i < ENTRIES_PER_PAGE+1; ++i) {
+		deleteList[i] = &deleteListData[i][0];
+	}
+
+
+	// Options for staff selected for delete.
+	DisplayStaffOptions delOpt = displayStaffOptionsInit();
+	delOpt.idList = deleteList;
+	delOpt.displayList[SE_ID] = true;
+	delOpt.displayList[SE_NAME] = true;
+	delOpt.isInteractive = false;
+
+	int* listCursor = &delOpt.idListLen;
+
+	// Options for staff remaining that have not been chosen for deletion.
+	DisplayStaffOptions disOpt = displayStaffOptionsInit();
+	disOpt.idList = deleteList;
+	disOpt.displayList[SE_ID] = true;
+	disOpt.displayList[SE_NAME] = true;
+	disOpt.isInclude = false;
+	disOpt.isInteractive = false;
+
+	while(1) {
+		cls();
+		printf(
+			"DELETE STAFF\n"
+			"============\n"
+		);
+
+		if(*listCursor > 0) {
+			printf(
+				"Delete List:\n"
+				"------------\n"
+			);
+
+			// Auto discard value if it's invalid or repeaated.
+			int displayed = displaySelectedStaff(&delOpt);
+			// In case where listCuror is at max and should not be incresed.
+			if(displayed < *listCursor) {
+				*listCursor = displayed;
+			}
+
+			if(*listCursor == 0) {
+				// Reprint again since table is empty.
+				continue;
+			} else if(*listCursor < 0) {
+				retval = *listCursor;
+				goto CLEANUP;
+			}
+			putchar('\n');
+		}
+
+		printf(
+			"Employee List:\n"
+			"--------------\n"
+		);
+
+		disOpt.idListLen = *listCursor;
+		int res = displaySelectedStaff(&disOpt);
+		if(res < 0) {
+			retval = res;
+			goto CLEANUP;
+		}
+
+		printf(
+			"(Enter ':h' for help.)\n"
+			"(Enter ':q' for help.)\n"
+			"Enter command: "
+		);
+
+		res = scanf("%7s", deleteList[*listCursor]);
+
+		if(res == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+		truncate();
+
+		// Check for overflow.
+		int inputLen = strlen(deleteList[*listCursor]);
+		if(deleteList[*listCursor][0] == '!' ? inputLen > ID_SIZE : inputLen > ID_SIZE-1) {
+			printf("Please enter a valid ID!\n");
+			pause();
+			continue;
+		}
+
+		// Check if it's numbers only.
+		bool isNumber = true;
+		for(char* i = deleteList[*listCursor]; *i; ++i) {
+			if(*i < '0' || *i > '9') {
+				isNumber = false;
+				break;
+			}
+		}
+
+		int selected = -1;
+		if(isNumber && atoi(deleteList[*listCursor]) <= len) {
+			selected = atoi(deleteList[*listCursor]);
+		}
+		if(selected == 0) {
+			selected = -1;
+		}
+
+		if(deleteListData[*listCursor][0] == ':') {
+			if(toupper(deleteListData[*listCursor][1]) == 'W') {
+				break;
+			} else if(toupper(deleteListData[*listCursor][1]) == 'Q') {
+				retval = -2;
+				goto CLEANUP;
+			} else if(toupper(deleteListData[*listCursor][1]) == 'H') {
+				cls();
+				printf(
+					"HELP\n"
+					"====\n"
+					"  Enter a staff's ID to put it into delete list.\n"
+					"  Prefix a staff ID with an exclamation mark to remove it from delete list.\n"
+					"  Actions:\n"
+					"    S0001  (Insert to delete list.)\n"
+					"    !S0001 (Remove from delete list.)\n"
+					"    2      (Insert staff on row 2 to delete list.)\n"
+					"    :h     (Help.)\n"
+					"    :b     (Go back a page.)\n"
+					"    :n     (Next page.)\n"
+					"    :w     (Proceed to delete.)\n"
+					"    :q     (Abort delete.)\n\n"
+				);
+				pause();
+				continue;
+			} else if(toupper(deleteListData[*listCursor][1]) == 'N') {
+				// Out of bounds error are handled inside displaySelectedStaff();
+				++disOpt.page;
+			} else if (toupper(deleteListData[*listCursor][1]) == 'B') {
+				// Out of bounds error are handled inside displaySelectedStaff();
+				--disOpt.page;
+			} else {
+				printf("Invalid control code!\n");
+				pause();
+			}
+			continue;
+		} else if(deleteList[*listCursor][0] == '!' && *listCursor > 0) {
+			int i = 0;
+			for(; i < *listCursor; ++i) {
+				if(strcmp(deleteList[i], &deleteList[*listCursor][1]) == 0) {
+					break;
+				}
+			}
+
+			if(i != *listCursor) {
+				// Matches.
+				if(i+1 != *listCursor) {
+					// Move (n-1)th staff to i.
+					// Only do it if there are data after i.
+					/* Demonstration:
+								i			n (cursor)
+						0	1	2	3	4	!2
+						(to remove 2, move 4 (n-1 th element) to 2.)
+								i			n
+						0	1	4	3	4	!2
+						(decrease cursor by one. to remove leftover and remove the remove command (!2).)
+								i		n
+						0	1	4	3	4	<uninit>
+						(original 4 will be overwritten next loop)
+
+						Q.E.D.
+					*/
+					memmove(deleteListData[i], deleteListData[*listCursor-1], ID_SIZE);
+				}
+				--*listCursor;
+			}
+			continue;
+		} else if(*listCursor >= ENTRIES_PER_PAGE) {
+			printf(
+				"\n"
+				"You have reached the maximum entries limit per deletion request!\n"
+				"To reduce the number of mistake that will occur, the deletion limit has been set to %d!\n", ENTRIES_PER_PAGE
+			);
+			pause();
+			continue; // So that $listCursor is not incremented.
+		} else if(selected != -1) {
+			// $acc should be guaranteed to be within bounds, I think.
+			int acc = 0;
+			int i = 0;
+			for(; acc != selected; ++i) {
+				if(!isStaffDeleted(staffArr[i])) {
+					// Check if the current staff is in delete list.
+					bool inDelete = false;
+					for(int ii = 0; ii < *listCursor; ++ii) {
+						if(strcmp(staffArr[i].id, deleteList[ii]) == 0) {
+							inDelete = true;
+							break;
+						}
+					}
+					if(!inDelete) {
+						++acc;
+					}
+				}
+			}
+			strcpy(deleteList[*listCursor], staffArr[i-1].id);
+		}
+
+		++*listCursor;
+	}
+	int departuresLen = deleteStaffIds(staffFile, staffArr, len, deleteList, *listCursor);
+	if(departuresLen < 0) {
+		perror("Error (malloc)");
+		departuresLen = 0;
+	}
+	retval = departuresLen;
+
+	if(departuresLen == 0) {
+		printf("No staff record deleted!\n");
+	} else if(departuresLen == 1) {
+		printf("1 staff record deleted!\n");
+	} else {
+		printf("%d staff records deleted!\n", departuresLen);
+	}
+	pause();
+
+CLEANUP:
+	#undef ID_SIZE
+	free(staffArr);
+
+	if(staffFile != NULL && fclose(staffFile) == EOF) {
+		perror("Error (Closing staff file, file data might not be saved.) ");
+		pause();
+		retval = 1;
+	}
+	return retval;
+}
+
+
+int deleteStaffIds(FILE* staffFile, Staff* staffArr, int len, char** ids, int idsLen) {
+	#define ID_SIZE 6
+	// Deleted staff to record in the departure date index.
+	DepartureEntry* departures = malloc(idsLen*sizeof(DepartureEntry)+1);
+	int* records = malloc(idsLen*sizeof(int)+1);
+	Staff* originals = NULL;
+	Staff* written = NULL;
+	char* payload = NULL;
+	int departuresLen = 0;
+
+	bool served = useStaffDaemon(); // Whether the staff daemon deleted the staff.
+	if(served) {
+		payload = calloc(idsLen+1, ID_SIZE);
+	} else {
+		originals = malloc(idsLen*sizeof(Staff)+1);
+		written = malloc(idsLen*sizeof(Staff)+1);
+	}
+	if(departures == NULL || records == NULL || (served ? payload == NULL : originals == NULL || written == NULL)) {
+		departuresLen = -4;
+		goto CLEANUP;
+	}
+
+	if(served) {
+		// The daemon deletes the staff that still exist, and updates the departure index and page checksums itself.
+		for(int i = 0; i < idsLen; ++i) {
+			strncpy(payload+i*ID_SIZE, ids[i], ID_SIZE-1);
+		}
+
+		int* deleted = NULL;
+		int deletedBytes = 0;
+		if(requestStaff(SR_DELETE, payload, idsLen*ID_SIZE, (void**) &deleted, &deletedBytes) != 0) {
+			perror("Error (Requesting staff daemon)");
+		}
+		free(deleted);
+		departuresLen = deletedBytes/sizeof(int);
+		goto CLEANUP;
+	}
+
+	// The departure index is only appended to if nothing else wrote the staff file since it was last written.
+	StaffFileStamp before;
+	bool stamped = fflush(staffFile) != EOF && statStaffFile(staffFile, &before) == 0;
+
+	// Modify staff's $passHash to zero.
+	for(int i = 0; i < len; ++i) {
+		bool match = false;
+		for(int ii = 0; ii < idsLen; ++ii) {
+			if(!isStaffDeleted(staffArr[i]) != 0 && strcmp(staffArr[i].id, ids[ii]) == 0) {
+				match = true;
+				// Remove ids[ii]. Staff ID is unique, so continue to next staff.
+				ids[ii][0] = '\0';
+				break;
+			}
+		}
+
+		if(match) {
+			// Read the record again under an exclusive lock, another terminal may have modified or deleted it in the meantime.
+			// Only $passHash is changed, so modifications made by other terminals are kept.
+			Staff current;
+			if(lockStaff(staffFile, i, 1, SL_EXCLUSIVE) != 0 || preadStaff(staffFile, &current, i, 1) != 1) {
+				perror("Error (Locking staff record)");
+				lockStaff(staffFile, i, 1, SL_UNLOCK);
+				continue;
+			}
+			if(isStaffDeleted(current) || strcmp(current.id, staffArr[i].id) != 0) {
+				lockStaff(staffFile, i, 1, SL_UNLOCK);
+				printf("%s was changed by another terminal in the meantime, it is not deleted!\n", staffArr[i].id);
+				continue;
+			}
+
+			originals[departuresLen] = current;
+			markStaffDeleted(&current);
+
+			// The deletion has to be flushed before unlocking.
+			fseek(staffFile, sizeof(Staff)*i, SEEK_SET);
+			fwrite(&current, sizeof(Staff), 1, staffFile);
+			fflush(staffFile);
+			lockStaff(staffFile, i, 1, SL_UNLOCK);
+			staffArr[i] = current;
+
+			written[departuresLen] = current;
+			records[departuresLen] = i;
+			departures[departuresLen++] = (DepartureEntry) { staffDepartureDate(staffArr[i]), i };
+		}
+	}
+
+	if(departuresLen > 0 && stampStaffIdIndex(staffFile, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating staff ID index)");
+	}
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	if(addDepartures(departures, departuresLen, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating departure index)");
+	}
+	if(departuresLen > 0 && updateChecksums(records, originals, written, departuresLen) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+
+CLEANUP:
+	#undef ID_SIZE
+	free(departures);
+	free(records);
+	free(originals);
+	free(written);
+	free(payload);
+	return departuresLen;
+}
+
+
+int promptStaffDetails(char* buf, enum StaffModifiableFields selection) {
+	char* promptMessage;
+	int maxLen = STAFF_BUF_MAX;
+	bool valid = false;
+
+	bool isFlipped = false;
+	selection = (selection&(1<<(sizeof(selection)*8-1))) != 0 ? isFlipped=true, ~selection : selection;
+
+	// All uses the same length as their buffer size to check for user input overflow.
+	switch(selection) {
+		case SE_ID:
+			promptMessage = "ID (S0001)";
+			maxLen = 6;
+			break;
+		case SE_NAME:
+			promptMessage = "Name (John Smith)";
+			maxLen = 128;
+			break;
+		case SE_POSITION:
+			promptMessage = "Position (Admin)";
+			maxLen = 32;
+			break;
+		case SE_PHONE:
+			promptMessage = "Phone (0123456789)";
+			maxLen = 16;
+			break;
+		case SE_IC:
+			promptMessage = "IC (000101070000)";
+			maxLen = 15;
+			break;
+		default:
+			printf("Error (Unimplemented)\n");
+			return -15;
+	};
+
+	while(!valid) {
+		valid = true;
+		if(!isFlipped) {
+			printf("Staff's %s: ", promptMessage);
+		}
+
+		// Scan for input. Also discards any leading spaces.
+		int i = 0;
+		int c = 0;
+		while((c = getchar(), c != '\r' && c != '\n') && i < maxLen) {
+			if(i == 0 && c == ' ') {
+				continue;
+			}
+			if(c == EOF) {
+				return EOF;
+			}
+
+			buf[i++] = c;
+		}
+		if(c != '\n') {
+			truncate();
+		}
+
+		if(i == maxLen) {
+			printf("Please enter a shorter value!\n\n");
+			valid = false;
+		}
+		// Remove trailing spaces.
+		while(buf[--i] == ' ');
+		buf[i+1] = 0;
+
+		// Control characters detection.
+		if(buf[0] == ':') {
+			if(toupper(buf[1]) == 'Q' || toupper(buf[1]) == 'W') {
+				return -2;
+			} else if(toupper(buf[1]) == 'H') {
+				printf(
+					"HELP: Enter a value according to what is prompted.\n"
+					"      It shows the prompted item, and an example of it enclosed in brackets.\n\n"
+				);
+				return promptStaffDetails(buf, selection^~(isFlipped-1));
+			}
+		}
+
+		if(buf[0] == 0) {
+			printf("Please enter a value!\n\n");
+			valid = false;
+		}
+
+		if(valid) {
+			char* error = checkStaffDetails(buf, selection);
+			if(error != NULL) {
+				printf("%s\n\n", error);
+				valid = false;
+			}
+		}
+		// Hands back control to callee if enum is passed in with its bits flipped.
+		if(isFlipped && !valid) {
+			return -14;
+		}
+	}
+
+	// No error.
+	return 0;
+}
+
+
+char* checkStaffDetails(char* buf, enum StaffModifiableFields field) {
+	if((int) field < 0 || field >= STAFF_ENUM_LENGTH) {
+		return "Error (Unimplemented)";
+	}
+	if(buf[0] == 0) {
+		return "Please enter a value!";
+	}
+	if((int) strlen(buf) >= STAFF_FIELD_SIZES[field]) {
+		return "Please enter a shorter value!";
+	}
+
+	switch(field) {
+		case SE_ID:
+			if(buf[0] == 's') {
+				return "Please ensure that the alphabet entered is in uppercase!";
+			} else if(buf[0] != 'S') {
+				return "Invalid Staff ID format!";
+			}
+
+			for(int i = 1; i < 5; ++i) {
+				if(buf[i] < '0' || buf[i] > '9') {
+					return "Invalid Staff ID format!";
+				}
+			}
+			break;
+		case SE_PHONE: { // Interesting... https://stackoverflow.com/questions/2036819/compile-error-with-switch-expected-expression-before
+			int i = 0;
+			if(buf[0] != '0') {
+				return "Please enter a valid phone number!";
+			}
+
+			int phoneLen = strlen(buf);
+			int numbersLen = 0;
+
+			for(; buf[i]; ++i) {
+				if(buf[i] == '-' || buf[i] == ' ') {
+					// Remove hyphens or space for the user.
+					memmove(buf+i, buf+i+1, phoneLen-numbersLen); // Moves the null character too.
+					--phoneLen;
+					--i; // Stay on the same index.
+				} else if(buf[i] < '0' || buf[i] > '9') {
+					return "The phone number should only contain numbers!";
+				} else {
+					++numbersLen;
+				}
+			}
+
+			// All are numbers, but invalid length.
+			if(numbersLen < 9 || numbersLen > 12) {
+				return "Please enter a valid phone number!";
+			}
+			break;
+		}
+		case SE_IC: {
+			// Check if it's all numbers.
+			int icLen = strlen(buf);
+			int i = 0;
+			int numbersLen = 0;
+			for(i = 0; i < buf[i]; ++i) {
+				if(buf[i] == '-' || buf[i] == ' ') {
+					// Same method as phone number.
+					// O(n^2) but should be fast enough for n < 16.
+					memmove(buf+i, buf+i+1, icLen-numbersLen);
+					--icLen;
+					--i; // Stay on the same index.
+				} else if(buf[i] < '0' || buf[i] > '9') {
+					return "IC number should only contain numbers!";
+				} else {
+					++numbersLen;
+				}
+			}
+			if(i != 12) {
+				return "Please enter IC number with the correct length!";
+			}
+
+			// Extract year.
+			char c = buf[2];
+			buf[2] = 0;
+			short year = atoi(buf);
+			buf[2] = c;
+
+			// Extract month.
+			c = buf[4];
+			buf[4] = 0;
+			short month = atoi(buf+2);
+			buf[4] = c;
+
+			// Extract day.
+			c = buf[6];
+			buf[6] = 0;
+			short day = atoi(buf+4);
+			buf[6] = c;
+
+			// Extract state code.
+			c = buf[8];
+			buf[8] = 0;
+			short state = atoi(buf+6);
+			buf[8] = c;
+
+			// NOTE: Year in IC is not validated since humans can live past 99 years old lol.
+
+			// Validate month.
+			if(month < 1 || month > 12) {
+				return "Please enter a valid month!";
+			}
+
+			// Validate day.
+			if(
+				day < 1 || // Day should not be less than 1.
+				(
+					month != 2 && (
+						(buf[3]+(buf[3] >= '8' || buf[2] == '1'))%2 == 1 ? // Months that have 31 days.
+							day > 31 :
+							day > 30
+					)
+				) ||
+				(
+					month == 2 && (
+						(
+							(year%100 == 0 && year%400 != 0) ? // End of century years that is not a leap year.
+							day > 28 :
+							day > 29
+						) ||
+						year%4 == 0 ? day > 29 : day > 28
+					)
+				)
+			) {
+				return "Please enter a valid day of month!";
+			}
+
+			if(state == 0 || (state >= 17 && state <= 20) || state == 69 || state == 70 || state == 73 || state == 80 || state == 81 || (state >= 94 && state <= 97)) {
+				return "Please enter a valid state number!";
+			}
+			break;
+		}
+		default:;
+			// Do nothing.
+	}
+
+	return NULL;
+}
+
+
+DisplayStaffOptions displayStaffOptionsInit(void) {
+	return (DisplayStaffOptions) {
+		NULL,
+		NULL,
+		{ 0, 0, 0, 0, 0 },
+		0,
+		ENTRIES_PER_PAGE,
+		0,
+		true,
+		true,
+		false,
+		true,
+		-1,
+		NULL,
+		{
+			NULL,
+			0
+		},
+		{
+			0,
+			0,
+			0
+		}
+	};
+}
+
+
+int displaySelectedStaff(DisplayStaffOptions* options) {
+	int retval = 0;
+	Frame ownFrame = { 0 };
+	Frame* frame = options->frame != NULL ? options->frame : &ownFrame;
+	Staff* staffArr = NULL;
+	char* includeFlag = NULL;
+	int* arrCursorHist = NULL;
+
+	// Read the whole file to memory.
+	int len = loadStaff(&staffArr);
+	if(len < 0) {
+		perror(len == -4 ? "Error (malloc)" : "Error (Reading staff file)");
+		pause();
+		retval = len;
+		goto CLEANUP;
+	}
+	options->metadata.totalBytes = len*sizeof(Staff);
+	options->metadata.totalEntries = len;
+
+	// If isInclude, set all flag to false, else true.
+	// Include: Set all to exclude then build up include list.
+	// Exclude: Set all to include then build up exclude list.
+	// A bitset to record which ID to print.
+	if(options->isInclude) {
+		includeFlag = calloc((options->metadata.totalEntries+7)/8, 1);
+	} else {
+		includeFlag = malloc((options->metadata.totalEntries+7)/8);
+		if(includeFlag != NULL) {
+			memset(includeFlag, ~0, (options->metadata.totalEntries+7)/8);
+		}
+	}
+	
+	if(includeFlag == NULL) {
+		perror("Error (malloc bitset)");
+		pause();
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	// Traverse the file and mark ith bit of $includeFlag as 0/1 to determine if it should be included/excluded from print.
+	int total = 0; // Total number of matches (Will be printed).
+
+	for(int i = 0; i < options->metadata.totalEntries; ++i) {
+		if(isStaffDeleted(staffArr[i]) ? !options->displayDeleted : !options->displayExisting) {
+			// Hide staff.
+			includeFlag[i/8] &= ~(1 << (i%8));
+			continue;
+		}
+
+		for(int ii = 0; ii < options->idListLen; ++ii) {
+			if(strcmp(staffArr[i].id, options->idList[ii]) == 0) {
+				// If exclude mode, set bit as 0.
+				// If include mode, set bit as 1.
+				if(!options->isInclude) {
+					includeFlag[i/8] &= ~(1 << (i%8));
+				} else {
+					includeFlag[i/8] |= (1 << (i%8));
+				}
+				break; // Marked as include, don't need to check against other IDs.
+			}
+		}
+	}
+
+	total = popcountBitset(includeFlag, options->metadata.totalEntries);
+	options->metadata.matchedLength = total;
+
+	// Handle page out of bounds.
+	if(options->page < 0) {
+		options->page = 0;
+	} else if(options->page * options->entriesPerPage >= total) {
+		options->page = options->metadata.matchedLength/(options->entriesPerPage+1);
+	}
+
+	// Stores each starting position of the page. Indexed with $curPage.
+	arrCursorHist = calloc(1, sizeof(int) * ((options->metadata.totalEntries+(options->entriesPerPage-1))/options->entriesPerPage));
+	if(arrCursorHist == NULL) {
+		perror("Error (malloc $arrCursorHist)");
+		pause();
+		retval = -4;
+		goto CLEANUP;
+	}
+	arrCursorHist[0] = 0;
+
+	// Fill in each starting index of match from staff file to each page.
+	for(int i = 0, acc = 0, curPage = 1; i < options->metadata.totalEntries; ++i) {
+		if((includeFlag[i/8] & (1<<(i%8))) != 0) {
+			if(++acc > options->entriesPerPage) {
+				arrCursorHist[curPage] = i;
+				acc = 1; // Already included staffArr[i].
+
+				++curPage;
+			}
+		}
+	}
+
+	if(options->isInteractive) {
+		cls();
+	}
+
+	while(1) {
+		if(options->orderBy >= 0) {
+			// Only sort as far as the current page.
+			int want = (options->page+1)*options->entriesPerPage;
+			if(extendStaffOrder(options, staffArr, includeFlag, want < total ? want : total) != 0) {
+				perror("Error (malloc $ordered)");
+				pause();
+				retval = -4;
+				goto CLEANUP;
+			}
+		}
+
+		if(options->header != NULL) {
+			framePrintf(frame, "%s", options->header);
+		}
+		// ith index stores the width of dashes.
+		// i+1th index stores the width of the column (including the dashes).
+		short printWidth[STAFF_ENUM_LENGTH*2] = {
+			8, 8,
+			4, 30,
+			8, 15,
+			5, 13,
+			2, 14
+		};
+
+		int cols = 0;
+		// Print headers.
+		framePrintf(frame, "Number    "); // Column of the number of current row.
+		for(int i = 0; i < STAFF_ENUM_LENGTH; ++i) {
+			if(!options->displayList[i]) {
+				continue;
+			}
+			++cols;
+
+			switch(i) {
+				case SE_ID:
+					framePrintf(frame, "STAFF ID");
+					break;
+				case SE_NAME:
+					// Allocate a width of 30 cols for name.
+					// If a name exceeds 27 characters (excluding null), ellipsis will be added.
+					framePrintf(frame, "%-30s", "NAME");
+					break;
+				case SE_POSITION:
+					framePrintf(frame, "%-15s", "POSITION");
+					break;
+				case SE_PHONE:
+					// <16 because of max valid phone length.
+					// Two additional characters to prettify print.
+					framePrintf(frame, "%-13s", "PHONE");
+					break;
+				case SE_IC:
+					framePrintf(frame, "%-14s", "IC");
+				default:;
+					// Do nothing.
+			}
+			frameSpaces(frame, 4);
+		}
+		if(options->displayDeleted) {
+			framePrintf(frame, "DELETED");
+		}
+		frameAppend(frame, "\n", 1);
+
+		// Print header and content divider.
+		frameDivider(frame, 6); // Divider for number column.
+		frameSpaces(frame, 4);
+		for(int i = 0; i < STAFF_ENUM_LENGTH*2; i += 2) {
+			if(!options->displayList[i/2]) {
+				continue;
+			}
+
+			// Plus 4 for row divider.
+			frameDivider(frame, printWidth[i]);
+			frameSpaces(frame, printWidth[i+1]+4-printWidth[i]);
+		}
+		if(options->displayDeleted) {
+			frameDivider(frame, 7);
+		}
+		frameAppend(frame, "\n", 1);
+
+		// Print staff details from staffArray.
+		int arrCursor = arrCursorHist[options->page];
+		int read = options->page * options->entriesPerPage;
+
+		// If this is the last page, read until $total, else read a full page.
+		int pageEnd = total-read <= options->entriesPerPage ? total : read+options->entriesPerPage;
+		for(; read < pageEnd; ++arrCursor) {
+			if(options->orderBy >= 0) {
+				// Ordered pages are taken from the sorted prefix instead.
+				arrCursor = options->ordered.rows[read];
+			} else if((includeFlag[arrCursor/8]&(1<<(arrCursor%8))) == 0) {
+				continue;
+			}
+
+			if(read != options->page*options->entriesPerPage) {
+				// Print newline first then staff data.
+				frameAppend(frame, "\n", 1);
+			}
+
+			// Print column number.
+			framePrintf(frame, "%6d    ", ++read);
+
+			Staff* staff = &staffArr[arrCursor];
+			for(int i = 0; i < STAFF_ENUM_LENGTH; ++i) {
+				if(!options->displayList[i]) {
+					continue;
+				}
+				switch(i) {
+					case SE_ID:
+						framePrintf(frame, "%s   ", staff->id);
+						break;
+					case SE_NAME:
+						if(strlen(staff->details.name) > 28) {
+							framePrintf(frame, "%.28s..", staff->details.name);
+						} else {
+							framePrintf(frame, "%-28s  ", staff->details.name);
+						}
+						break;
+					case SE_POSITION:
+						if(strlen(staff->details.position) > 13) {
+							framePrintf(frame, "%.13s..", staff->details.position);
+						} else {
+							framePrintf(frame, "%-13s  ", staff->details.position);
+						}
+						break;
+					case SE_PHONE: {
+						// Mobile numbers (01x) have a 3 digit prefix, landlines a 2 digit prefix padded to 3.
+						// The rest is split in halves.
+						int prefix = staff->details.phone[1] != '1' ? 2 : 3;
+						int remaining = strlen(staff->details.phone+prefix);
+						framePrintf(
+							frame, "0%.*s%s %.*s%s %-4s",
+							prefix-1, staff->details.phone+1, prefix == 2 ? " " : "",
+							remaining/2, staff->details.phone+prefix, remaining != 8 ? " " : "",
+							staff->details.phone+prefix+remaining/2
+						);
+						break;
+					}
+					case SE_IC:
+						framePrintf(frame, "%.6s-%.2s-%.4s", staff->details.ic, staff->details.ic+6, staff->details.ic+8);
+					default:;
+						// Do nothing.
+				}
+				frameSpaces(frame, 4);
+			}
+
+			if(options->displayDeleted) {
+				if(isStaffDeleted(*staff)) {
+					framePrintf(
+						frame, "%04llu-%02llu-%02llu",
+						staff->passHash&0xFFFF,
+						(staff->passHash&0xFF0000)>>16,
+						(staff->passHash&0xFF000000)>>24
+					);
+				} else {
+					framePrintf(frame, "False");
+				}
+			}
+			frameAppend(frame, "\n", 1);
+		}
+
+		if(total == 0) {
+			framePrintf(frame, "  No matching entries!\n");
+		}
+
+		// Print table border
+		for(int i = 1; i < STAFF_ENUM_LENGTH*2; i += 2) {
+			if(!options->displayList[i/2]) {
+				continue;
+			}
+			frameDivider(frame, printWidth[i]+4*(i+1 != STAFF_ENUM_LENGTH*2 || options->displayDeleted));
+		}
+		frameDivider(frame, 10); // Number column.
+		if(options->displayDeleted) {
+			frameDivider(frame, 10);
+		}
+		frameAppend(frame, "\n", 1);
+
+		if(total <= 1) {
+			framePrintf(frame, "Displaying %d entry", read);
+		} else {
+			framePrintf(frame, "Displaying %d entries", read);
+		}
+
+		if(options->metadata.totalEntries >= 0) {
+			framePrintf(frame, " of %d entr%s.", total, total < 2 ? "y" : "ies");
+		}
+		framePrintf(frame, " (Page %d)\n", options->page+1);
+
+		if(options->isInteractive) {
+			// To keep the system consistent, precedes with a colon. (Optional now).
+			framePrintf(frame, "\nEnter 'n' for next page, 'b' to go back a page, 'q' to quit: ");
+		} else {
+			frameAppend(frame, "\n", 1);
+		}
+
+		if(!options->isInteractive) {
+			// The caller presents its own frame.
+			if(frame == &ownFrame && flushFrame(frame) != 0) {
+				perror("Error (Drawing staff table)");
+			}
+			break;
+		}
+
+		// The whole screen is written at once, only the rows that changed since the last page are redrawn.
+		if(presentFrame(frame) != 0) {
+			perror("Error (Drawing staff table)");
+		}
+
+		char action[3];
+
+		if(scanf("%2s", action) == EOF) {
+			retval = EOF;
+			goto CLEANUP;
+		}
+		truncate();
+		if(action[0] == ':') {
+			action[0] = action[1];
+		}
+
+		if(toupper(action[0]) == 'Q') {
+			break;
+		} else if(toupper(action[0]) == 'B' && options->page > 0) {
+			--options->page;
+		} else if(toupper(action[0]) == 'N' && read < total) {
+			++options->page;
+		} else if(toupper(action[0]) == 'H') {
+			cls();
+			printf(
+				"HELP\n"
+				"====\n"
+				"  Uses 'n' or 'b' to turn to the next page or go back a page.\n"
+				"  Enter 'q' to quit interactive mode.\n"
+				"  Actions:\n"
+				"    n (Next page.)\n"
+				"    b (Go back a page.)\n"
+				"    q (Quit.)\n\n"
+			);
+			pause();
+		}
+	}
+	retval = total;
+
+CLEANUP:
+	free(ownFrame.text);
+	free(staffArr);
+	free(includeFlag);
+	free(arrCursorHist);
+	return retval;
+}
+
+
+int extendStaffOrder(DisplayStaffOptions* options, Staff* staffArr, char* includeFlag, int want) {
+	int have = options->ordered.length;
+	if(have > options->metadata.matchedLength) {
+		// Stale prefix from a different search.
+		have = 0;
+	}
+	if(have >= want) {
+		return 0;
+	}
+
+	int* rows = realloc(options->ordered.rows, want*sizeof(int));
+	if(rows == NULL) {
+		return -4;
+	}
+	options->ordered.rows = rows;
+
+	// Build the heap right after the prefix, so it ends up in place after sorting.
+	int* heap = rows+have;
+	int need = want-have;
+	int heapLen = 0;
+	int last = have > 0 ? rows[have-1] : -1;
+
+	for(int i = 0; i < options->metadata.totalEntries; ++i) {
+		if((includeFlag[i/8]&(1<<(i%8))) == 0) {
+			continue;
+		}
+		if(last != -1 && compareStaffOrder(staffArr, i, last, options->orderBy) <= 0) {
+			// Already in the prefix.
+			continue;
+		}
+
+		if(heapLen < need) {
+			// Sift up.
+			int child = heapLen++;
+			while(child > 0 && compareStaffOrder(staffArr, heap[(child-1)/2], i, options->orderBy) < 0) {
+				heap[child] = heap[(child-1)/2];
+				child = (child-1)/2;
+			}
+			heap[child] = i;
+		} else if(compareStaffOrder(staffArr, i, heap[0], options->orderBy) < 0) {
+			// Replace the largest row of the heap.
+			heap[0] = i;
+			siftDownStaffOrder(heap, heapLen, 0, staffArr, options->orderBy);
+		}
+	}
+
+	// Heap sort the selected rows into ascending order.
+	for(int n = heapLen-1; n > 0; --n) {
+		int tmp = heap[0];
+		heap[0] = heap[n];
+		heap[n] = tmp;
+		siftDownStaffOrder(heap, n, 0, staffArr, options->orderBy);
+	}
+
+	options->ordered.length = have+heapLen;
+	return 0;
+}
+
+
+int compareStaffOrder(Staff* staffArr, int a, int b, int field) {
+	char* x = staffFieldText(&staffArr[a], field);
+	char* y = staffFieldText(&staffArr[b], field);
+
+	int i = 0;
+	while(x[i] && toupper(x[i]) == toupper(y[i])) {
+		++i;
+	}
+	if(toupper(x[i]) != toupper(y[i])) {
+		return toupper(x[i]) - toupper(y[i]);
+	}
+	return a-b;
+}
+
+
+void siftDownStaffOrder(int* heap, int len, int i, Staff* staffArr, int field) {
+	while(1) {
+		int largest = i;
+		for(int child = 2*i+1; child <= 2*i+2 && child < len; ++child) {
+			if(compareStaffOrder(staffArr, heap[child], heap[largest], field) > 0) {
+				largest = child;
+			}
+		}
+		if(largest == i) {
+			return;
+		}
+
+		int tmp = heap[i];
+		heap[i] = heap[largest];
+		heap[largest] = tmp;
+		i = largest;
+	}
+}
+
+
+Staff loginStaff(void) {
+	Staff s;
+	char buf[STAFF_BUF_MAX];
+	FILE* staffFile = fopen("staff.bin", "rb");
+
+	if(staffFile == NULL) {
+		perror("Error (Opening staff file)");
+		// Do not pause(). The file may not been initialised and it is being done silently.
+		s.id[0] = 0;
+		s.id[1] = -3;
+		goto CLEANUP;
+	}
+
+	while(1) {
+		printf(
+			"LOGIN\n"
+			"=====\n"
+		);
+		int res = promptStaffDetails(buf, SE_ID);
+		if(res == EOF) {
+			s.id[0] = 0;
+			s.id[1] = EOF;
+			goto CLEANUP;
+		}
+
+		// Do not allow abort.
+		if(res == -2) {
+			continue;
+		}
+
+		// Iterate through staff data and find the matching staff ID.
+		bool found = false;
+
+		if(useStaffDaemon()) {
+			StaffRecord* reply = NULL;
+			found = requestStaff(SR_FIND, buf, sizeof(s.id), (void**) &reply, NULL) == 0;
+			if(found) {
+				s = reply->staff;
+			}
+			free(reply);
+		} else {
+			rewind(staffFile);
+			while(freadStaff(&s, 1, staffFile) != 0) {
+				if(strcmp(s.id, buf) == 0) {
+					// Found matching staff details, stop searching.
+					found = true;
+					break;
+				}
+			}
+		}
+
+		if(found) {
+			bool match = false;
+
+			for(int i = 3; ~i; --i) {
+				printf("Password: ");
+
+				if(scanf("%127[^\n]", buf) == EOF) {
+					s.id[0] = 0;
+					s.id[1] = EOF;
+					goto CLEANUP;
+				}
+				u64 enteredPassHash = computeHash(buf);
+				memset(buf, 0, STAFF_BUF_MAX); // Zero out sensitive data.
+				truncate();
+
+				if(useStaffDaemon()) {
+					// Let the daemon check the password, it may have been changed since the staff was found.
+					StaffLogin login = { "", enteredPassHash };
+					memcpy(login.id, s.id, sizeof(login.id));
+					match = requestStaff(SR_LOGIN, &login, sizeof(login), NULL, NULL) == 0;
+					if(match) {
+						// SR_FIND does not reply the password hash before logging in.
+						s.passHash = enteredPassHash;
+					}
+				} else {
+					match = enteredPassHash == s.passHash;
+				}
+
+				if(match) {
+					// A valid password is entered.
+					break;
+				} else if(i > 0) {
+					printf("Password incorrect! %d attempts left\n", i);
+				}
+			}
+
+			if(match) {
+				// Password matches, break out of login loop.
+				printf("Logged in successfully.\n\n");
+				pause();
+				break;
+			} else {
+				printf("Password and staff ID does not match! Please try again!\n\n");
+				pause();
+			}
+		} else {
+			// Staff ID inputted not found in record, proceed to prompt again.
+			printf("Staff ID not found!\n\n");
+			pause();
+		}
+	}
+
+CLEANUP:
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	return s;
+}
+
+
+int menuStaff(Staff* loggedInUser) {
+	while(1) {
+		cls();
+		char action[3];
+		printf(
+			"STAFF MODULE\n"
+			"============\n"
+			"Welcome %s!\n\n"
+			"- Add\n"
+			"- Display\n"
+			"- Delete\n"
+			"- Modify\n"
+			"- Search\n"
+			"- Report\n\n"
+			"- Quit menu\n\n"
+			"Enter a function: ",
+			loggedInUser->details.name
+		);
+
+		if(scanf("%2s", action) == EOF) {
+			return EOF;
+		}
+		truncate();
+		if(action[0] == ':') {
+			action[0] = action[1];
+		}
+
+		switch(toupper(*action)) {
+			case 'A':
+				addStaff();
+				break;
+			case 'D':
+				if(action[1] == '\0') {
+					printf("\nPlease enter one more character (DI[SPLAY] / DE[LETE]) to distinguish between 2 similar functions!\n");
+					pause();
+				} else if(toupper(action[1]) == 'I') {
+					displayStaff();
+				} else if(toupper(action[1]) == 'E') {
+					deleteStaff();
+				} else {
+					printf("Please enter an existing function!\n");
+					pause();
+				}
+				break;
+			case 'M':
+				modifyStaff();
+				break;
+			case 'S':
+				searchStaff();
+				break;
+			case 'R':
+				reportStaff();
+				break;
+			case 'Q':
+				return 0;
+				// No break here because of return.
+			case 'H':
+				cls();
+				printf(
+					"HELP\n"
+					"====\n"
+					"  Choose one of the function of the staff module by typing the first few characters of the corresponding function.\n"
+					"  Action:\n"
+					"    :h (Help.)\n"
+					"    :q (Quit.)\n"
+					"    A  (Add staff page.)\n"
+					"  Examples:\n"
+					"    A\n"
+					"    (Goes to add staff page.)\n"
+					"    Se\n"
+					"    (Goes to search staff page.)\n\n"
+					"  (Congrats on finding this unindexed page!)\n\n"
+				);
+				pause();
+				break;
+			default:
+				printf("Please enter an existing function!\n");
+				pause();
+		}
+	}
+	return 0;
+}
+
+
+// Initialisation vector constants from the BLAKE2 specification.
+// Equivalent to the fractional part of the square root of the first 8 prime numbers.
+const u64 BLAKE2B_IV[8] = {
+	0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+	0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+};
+
+// Sigma array taken from the BLAKE2 specification to determine which index of the msg to take and mix.
+// Row 11 and 12 are equivalent to row 1 and 2.
+const unsigned char BLAKE2B_SIGMA[12][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+	{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+	{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+	{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+	{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+	{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+	{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+	{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+// Kernels indexed with BLAKE2bKernels.
+void (*const BLAKE2B_KERNELS[BLAKE2B_KERNEL_LENGTH])(u64*, const u64*, u64, u64, u64) = {
+	BLAKE2bFScalar, BLAKE2bFSSSE3, BLAKE2bFAVX2
+};
+
+// Names of the kernels indexed with BLAKE2bKernels, for testHash() and benchHash().
+const char* BLAKE2B_KERNEL_NAMES[BLAKE2B_KERNEL_LENGTH] = { "Scalar", "SSSE3", "AVX2" };
+
+// Kernel used by BLAKE2bF(), -1 until it is selected on first use. (See initBLAKE2bKernel())
+int blake2bKernel = -1;
+
+#ifdef STAFF_THREADS
+pthread_once_t blake2bOnce = PTHREAD_ONCE_INIT;
+#endif
+
+
+int exportStaffCommand(int argc, char** argv, int format) {
+	int retval = 0;
+	StaffExport options = { format, { true, true, true, true, true }, NULL, 0, stdout };
+	// Every --like takes two arguments, so there are at most $argc/2 queries.
+	options.queries = malloc((argc/2+1)*sizeof(StaffQuery));
+
+	if(options.queries == NULL) {
+		perror("Error (malloc $queries)");
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	int field = -1;
+	for(int i = 0; i < argc; ++i) {
+		int parsed = parseStaffQueryArgument(argc, argv, &i, &field, options.queries, &options.queriesLen);
+		if(parsed != 0) {
+			if(parsed < 0) {
+				retval = parsed;
+				goto CLEANUP;
+			}
+		} else if(strcmp(argv[i], "--fields") == 0 && i+1 < argc) {
+			// Comma separated field names, exported in the order of Staff{}.
+			memset(options.fields, 0, sizeof(options.fields));
+			for(char* name = argv[++i]; name != NULL;) {
+				char* next = strchr(name, ',');
+				if(next != NULL) {
+					*next++ = 0;
+				}
+				int projected = parseStaffField(name);
+				if(projected == -1) {
+					fprintf(stderr, "%s: Entered field does not match any of the field!\n", name);
+					retval = -18;
+					goto CLEANUP;
+				}
+				options.fields[projected] = true;
+				name = next;
+			}
+		} else if(strcmp(argv[i], "--format") == 0 && i+1 < argc) {
+			char* formats[] = { "tsv", "csv", "jsonl" };
+			options.format = -1;
+			++i;
+			for(int f = 0; f < (int) (sizeof(formats)/sizeof(*formats)); ++f) {
+				if(strcmp(argv[i], formats[f]) == 0) {
+					options.format = f;
+				}
+			}
+			if(options.format == -1) {
+				retval = -18;
+				goto CLEANUP;
+			}
+		} else if(strcmp(argv[i], "--output") == 0 && i+1 < argc && options.output == stdout) {
+			options.output = fopen(argv[++i], "w");
+			if(options.output == NULL) {
+				perror("Error (Opening output file)");
+				retval = -3;
+				goto CLEANUP;
+			}
+		} else {
+			retval = -18;
+			goto CLEANUP;
+		}
+	}
+
+	retval = exportStaff(&options);
+	if(retval == -3) {
+		perror("Error (Exporting staff file)");
+	} else if(retval == -4) {
+		perror("Error (malloc)");
+	}
+
+CLEANUP:
+	free(options.queries);
+	if(options.output != NULL && options.output != stdout && fclose(options.output) == EOF) {
+		perror("Error (Closing output file)");
+		retval = -3;
+	}
+	return retval;
+}
+
+
+int parseStaffQueryArgument(int argc, char** argv, int* i, int* field, StaffQuery* queries, int* queriesLen) {
+	if(strcmp(argv[*i], "--field") == 0 && *i+1 < argc) {
+		*field = parseStaffField(argv[++*i]);
+		if(*field == -1) {
+			fprintf(stderr, "Entered field does not match any of the field!\n");
+			return -18;
+		}
+	} else if((strcmp(argv[*i], "--like") == 0 || strcmp(argv[*i], "--not-like") == 0) && *i+1 < argc && *field != -1) {
+		StaffQuery* query = &queries[(*queriesLen)++];
+		query->field = *field;
+		query->invert = argv[*i][2] == 'n';
+		if(strlen(argv[++*i]) >= sizeof(query->pattern)) {
+			fprintf(stderr, "Please enter a shorter query!\n");
+			return -18;
+		}
+		foldCase(query->pattern, argv[*i], strlen(argv[*i])+1);
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+int exportStaff(StaffExport* options) {
+	int retval = 0;
+	Frame frame = { 0 };
+	FILE* staffFile = NULL;
+	StaffSnapshot* snapshot = NULL;
+	// Records are streamed through one chunk, and rows are drawn into one frame, nothing is allocated per row.
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	StaffFolded* folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+
+	if(chunk == NULL || folded == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	if(useStaffDaemon()) {
+		// Export a pinned version, so the export is consistent while writers keep going.
+		retval = requestStaff(SR_PIN, NULL, 0, (void**) &snapshot, NULL);
+		if(retval != 0) {
+			goto CLEANUP;
+		}
+	} else {
+		staffFile = fopen("staff.bin", "rb");
+		if(staffFile == NULL) {
+			retval = -3;
+			goto CLEANUP;
+		}
+	}
+
+	if(options->format == SX_CSV) {
+		// Header row.
+		bool first = true;
+		for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+			if(options->fields[field]) {
+				framePrintf(&frame, first ? "%s" : ",%s", STAFF_FIELD_NAMES[field]);
+				first = false;
+			}
+		}
+		frameAppend(&frame, "\n", 1);
+	}
+
+	int read;
+	for(int first = 0; (read = snapshot != NULL ? readStaffSnapshot(snapshot, chunk, first, STAFF_STREAM_CHUNK) : (int) freadStaff(chunk, STAFF_STREAM_CHUNK, staffFile)) > 0; first += read) {
+		if(options->queriesLen > 0) {
+			foldStaffArray(folded, chunk, read);
+		}
+		for(int i = 0; i < read; ++i) {
+			if(matchStaffQueries(&chunk[i], &folded[i], options->queries, options->queriesLen)) {
+				frameStaffRow(&frame, &chunk[i], options);
+			}
+		}
+
+		if(frame.length >= COMMAND_FLUSH_BYTES && (retval = writeFrame(&frame, options->output)) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(read < 0 || (staffFile != NULL && ferror(staffFile))) {
+		retval = read == -4 ? -4 : -3;
+		goto CLEANUP;
+	}
+	retval = writeFrame(&frame, options->output);
+
+CLEANUP:
+	if(snapshot != NULL) {
+		requestStaff(SR_UNPIN, &snapshot->version, sizeof(snapshot->version), NULL, NULL);
+		free(snapshot);
+	}
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	free(chunk);
+	free(folded);
+	free(frame.text);
+	return retval;
+}
+
+
+void frameStaffRow(Frame* frame, Staff* staff, StaffExport* options) {
+	// Separator between fields, indexed with StaffExportFormats.
+	const char separators[] = { '\t', ',', ',' };
+	bool first = true;
+
+	if(options->format == SX_JSONL) {
+		frameAppend(frame, "{", 1);
+	}
+	for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+		if(!options->fields[field]) {
+			continue;
+		}
+		if(!first) {
+			frameAppend(frame, &separators[options->format], 1);
+		}
+		first = false;
+
+		// Fields read from the file are not trusted to be NUL terminated.
+		char* text = staffFieldText(staff, field);
+		char* end = memchr(text, 0, STAFF_FIELD_SIZES[field]);
+		int len = end != NULL ? end-text : STAFF_FIELD_SIZES[field];
+
+		switch(options->format) {
+			case SX_CSV:
+				frameCSVField(frame, text, len);
+				break;
+			case SX_JSONL:
+				framePrintf(frame, "\"%s\":", STAFF_FIELD_NAMES[field]);
+				frameJSONString(frame, text, len);
+				break;
+			default:
+				frameAppend(frame, text, len);
+		}
+	}
+	if(options->format == SX_JSONL) {
+		frameAppend(frame, "}", 1);
+	}
+	frameAppend(frame, "\n", 1);
+}
+
+
+int addStaffCommand(int argc, char** argv) {
+	if(argc != 2 || strcmp(argv[0], "--from") != 0) {
+		return -18;
+	}
+
+	int retval = 0;
+	FILE* inputFile = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+	Staff* rows = NULL;
+	int* rowLines = NULL;
+	int rowsLen = 0;
+	int rowsCapacity = 0;
+	int added = 0;
+
+	if(inputFile == NULL) {
+		perror("Error (Opening input file)");
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	char line[COMMAND_LINE_MAX];
+	for(int lineNo = 1; fgets(line, sizeof(line), inputFile) != NULL; ++lineNo) {
+		int lineLen = strlen(line);
+		if(lineLen == sizeof(line)-1 && line[lineLen-1] != '\n') {
+			// Skip the rest of the line.
+			int c;
+			while((c = fgetc(inputFile)) != '\n' && c != EOF);
+			fprintf(stderr, "Line %d: Please enter a shorter line!\n", lineNo);
+			retval = -15;
+			continue;
+		}
+		while(lineLen > 0 && (line[lineLen-1] == '\n' || line[lineLen-1] == '\r')) {
+			line[--lineLen] = 0;
+		}
+		if(lineLen == 0) {
+			continue;
+		}
+
+		// Split the tab separated fields in place, the password follows the staff fields.
+		char* fields[STAFF_ENUM_LENGTH+1];
+		int fieldsLen = 0;
+		for(char* field = line; field != NULL && fieldsLen < STAFF_ENUM_LENGTH+1; ++fieldsLen) {
+			fields[fieldsLen] = field;
+			field = strchr(field, '\t');
+			if(field != NULL) {
+				*field++ = 0;
+			}
+			if(fieldsLen == STAFF_ENUM_LENGTH && field != NULL) {
+				fieldsLen = -1;
+				break;
+			}
+		}
+		if(fieldsLen != STAFF_ENUM_LENGTH+1) {
+			fprintf(stderr, "Line %d: Expected %d tab separated fields!\n", lineNo, STAFF_ENUM_LENGTH+1);
+			retval = -15;
+			continue;
+		}
+
+		if(rowsLen == rowsCapacity) {
+			rowsCapacity = rowsCapacity == 0 ? STAFF_STREAM_CHUNK : rowsCapacity*2;
+			Staff* grownRows = realloc(rows, rowsCapacity*sizeof(Staff));
+			rows = grownRows != NULL ? grownRows : rows;
+			int* grownLines = realloc(rowLines, rowsCapacity*sizeof(int));
+			rowLines = grownLines != NULL ? grownLines : rowLines;
+			if(grownRows == NULL || grownLines == NULL) {
+				perror("Error (malloc $rows)");
+				retval = -4;
+				goto CLEANUP;
+			}
+		}
+
+		char* error = parseStaffRow(fields, &rows[rowsLen]);
+		if(error != NULL) {
+			fprintf(stderr, "Line %d: %s\n", lineNo, error);
+			retval = -15;
+			continue;
+		}
+		rows[rowsLen].passHash = computeHash(fields[STAFF_ENUM_LENGTH]);
+		memset(line, 0, sizeof(line)); // Zero out buffer to erase sensitive data.
+		rowLines[rowsLen++] = lineNo;
+	}
+	if(ferror(inputFile)) {
+		perror("Error (Reading input file)");
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// The staff are added together, with one scan of the IDs and one checksum update.
+	int res = appendStaffRows(rows, rowLines, rowsLen, &added);
+	retval = res != 0 ? res : retval;
+
+CLEANUP:
+	printf("%d staff added.\n", added);
+	if(inputFile != NULL && inputFile != stdin) {
+		fclose(inputFile);
+	}
+	free(rows);
+	free(rowLines);
+	return retval;
+}
+
+
+int importStaffCommand(int argc, char** argv) {
+	if(argc != 1) {
+		return -18;
+	}
+
+	int retval = 0;
+	FILE* inputFile = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "r");
+	char* text = NULL;
+	int textLen = 0;
+	int textCapacity = 0;
+	Staff* rows = NULL;
+	char** passwords = NULL;
+	u64* hashes = NULL;
+	int* rowLines = NULL;
+	int rowsLen = 0;
+	int rowsCapacity = 0;
+	int added = 0;
+
+	if(inputFile == NULL) {
+		perror("Error (Opening input file)");
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// Read the whole input at once, the fields are unquoted in place.
+	while(1) {
+		if(textLen+COMMAND_LINE_MAX >= textCapacity) {
+			int capacity = textCapacity == 0 ? COMMAND_FLUSH_BYTES : textCapacity*2;
+			char* grown = realloc(text, capacity);
+			if(grown == NULL) {
+				perror("Error (malloc $text)");
+				retval = -4;
+				goto CLEANUP;
+			}
+			text = grown;
+			textCapacity = capacity;
+		}
+		size_t read = fread(text+textLen, 1, textCapacity-textLen-1, inputFile);
+		if(read == 0) {
+			break;
+		}
+		textLen += read;
+	}
+	if(ferror(inputFile)) {
+		perror("Error (Reading input file)");
+		retval = -3;
+		goto CLEANUP;
+	}
+	text[textLen] = 0;
+
+	// Validate every row first, like promptStaffDetails() does.
+	char* cursor = text;
+	for(int line = 1; cursor < text+textLen;) {
+		int rowLine = line;
+		char* fields[STAFF_ENUM_LENGTH+2];
+		int fieldsLen = readCSVRecord(&cursor, text+textLen, fields, STAFF_ENUM_LENGTH+2, &line);
+		if(fieldsLen == 1 && fields[0][0] == 0) {
+			// Blank line.
+			continue;
+		}
+		if(rowLine == 1 && parseStaffField(fields[0]) == SE_ID) {
+			// Header row.
+			continue;
+		}
+		if(fieldsLen != STAFF_ENUM_LENGTH+1) {
+			fprintf(stderr, "Line %d: Expected %d comma separated fields!\n", rowLine, STAFF_ENUM_LENGTH+1);
+			retval = -15;
+			continue;
+		}
+
+		if(rowsLen == rowsCapacity) {
+			rowsCapacity = rowsCapacity == 0 ? STAFF_STREAM_CHUNK : rowsCapacity*2;
+			Staff* grownRows = realloc(rows, rowsCapacity*sizeof(Staff));
+			rows = grownRows != NULL ? grownRows : rows;
+			char** grownPasswords = realloc(passwords, rowsCapacity*sizeof(char*));
+			passwords = grownPasswords != NULL ? grownPasswords : passwords;
+			int* grownLines = realloc(rowLines, rowsCapacity*sizeof(int));
+			rowLines = grownLines != NULL ? grownLines : rowLines;
+			if(grownRows == NULL || grownPasswords == NULL || grownLines == NULL) {
+				perror("Error (malloc $rows)");
+				retval = -4;
+				goto CLEANUP;
+			}
+		}
+
+		char* error = parseStaffRow(fields, &rows[rowsLen]);
+		if(error != NULL) {
+			fprintf(stderr, "Line %d: %s\n", rowLine, error);
+			retval = -15;
+			continue;
+		}
+		passwords[rowsLen] = fields[STAFF_ENUM_LENGTH];
+		rowLines[rowsLen++] = rowLine;
+	}
+
+	// Hash the passwords of every row together, several at once.
+	hashes = malloc(rowsLen*sizeof(u64)+1);
+	if(hashes == NULL) {
+		perror("Error (malloc $hashes)");
+		retval = -4;
+		goto CLEANUP;
+	}
+	computeHashBatch(passwords, hashes, rowsLen);
+	for(int i = 0; i < rowsLen; ++i) {
+		rows[i].passHash = hashes[i];
+	}
+	memset(text, 0, textLen); // Zero out buffer to erase sensitive data.
+
+	int res = appendStaffRows(rows, rowLines, rowsLen, &added);
+	retval = res != 0 ? res : retval;
+
+CLEANUP:
+	printf("%d staff imported.\n", added);
+	if(inputFile != NULL && inputFile != stdin) {
+		fclose(inputFile);
+	}
+	free(text);
+	free(rows);
+	free(passwords);
+	free(hashes);
+	free(rowLines);
+	return retval;
+}
+
+
+int appendStaffRows(Staff* rows, int* rowLines, int rowsLen, int* added) {
+	int retval = 0;
+	FILE* staffFile = NULL;
+	StaffIdSet ids = { 0 };
+
+	*added = 0;
+	if(useStaffDaemon()) {
+		// The daemon checks and appends the staff itself, as many as a request can take at once.
+		int batch = DAEMON_REQUEST_MAX/sizeof(Staff);
+		for(int first = 0; first < rowsLen; first += batch) {
+			int len = rowsLen-first < batch ? rowsLen-first : batch;
+			int* records = NULL;
+			int recordsBytes = 0;
+			int res = requestStaff(SR_ADD, &rows[first], len*sizeof(Staff), (void**) &records, &recordsBytes);
+			if(res != 0 || recordsBytes != len*(int) sizeof(int)) {
+				free(records);
+				perror("Error (Requesting staff daemon)");
+				return -3;
+			}
+
+			for(int i = 0; i < len; ++i) {
+				if(records[i] == -16) {
+					fprintf(stderr, "Line %d: Staff with the same ID exists!\n", rowLines[first+i]);
+					retval = -15;
+				} else {
+					++*added;
+				}
+			}
+			free(records);
+		}
+		return retval;
+	}
+
+	staffFile = fopen("staff.bin", "ab+");
+	if(staffFile == NULL) {
+		perror("Error (Opening staff file)");
+		return -3;
+	}
+
+	// Other terminals cannot append while the IDs are collected, so they stay unique.
+	if(lockStaff(staffFile, APPEND_LOCK_RECORD, 1, SL_EXCLUSIVE) != 0) {
+		perror("Error (Locking staff file)");
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	// Collect the IDs of the existing staff once, then check every row against them in O(1).
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	int res = chunk == NULL ? -4 : 0;
+	int read;
+	rewind(staffFile);
+	while(res >= 0 && chunk != NULL && (read = freadStaff(chunk, STAFF_STREAM_CHUNK, staffFile)) > 0) {
+		for(int i = 0; res >= 0 && i < read; ++i) {
+			if(!isStaffDeleted(chunk[i])) {
+				res = addStaffId(&ids, chunk[i].id);
+			}
+		}
+	}
+	free(chunk);
+
+	// Keep the rows with new IDs, in order. The earlier of two rows with the same ID is kept.
+	int kept = 0;
+	for(int i = 0; res >= 0 && i < rowsLen; ++i) {
+		res = addStaffId(&ids, rows[i].id);
+		if(res == 0) {
+			fprintf(stderr, "Line %d: Staff with the same ID exists!\n", rowLines[i]);
+			retval = -15;
+		} else if(res > 0) {
+			rows[kept++] = rows[i];
+		}
+	}
+
+	// The indexes are moved on past the append if nothing else wrote the staff file since it was last written.
+	StaffFileStamp before;
+	bool stamped = statStaffFile(staffFile, &before) == 0;
+
+	if(res < 0 || ferror(staffFile)) {
+		perror(res == -4 ? "Error (malloc $ids)" : "Error (Reading staff file)");
+		retval = res == -4 ? -4 : -3;
+	} else if(fwrite(rows, sizeof(Staff), kept, staffFile) != (size_t) kept || fflush(staffFile) == EOF) {
+		// Appended in one sequential write.
+		perror("Error (Writing staff file)");
+		retval = -3;
+	} else {
+		*added = kept;
+	}
+	int first = ftell(staffFile)/(long) sizeof(Staff)-*added;
+
+	// Index the IDs of the whole batch now, instead of on the next lookup. The index is a file of its own, so the append lock is kept.
+	StaffIdIndexHeader header;
+	FILE* indexFile = *added > 0 ? openStaffIdIndex(staffFile, &header, stamped ? &before : NULL) : NULL;
+	if(*added > 0 && indexFile == NULL) {
+		perror("Error (Updating staff ID index)");
+	}
+	if(indexFile != NULL) {
+		fclose(indexFile);
+	}
+	lockStaff(staffFile, APPEND_LOCK_RECORD, 1, SL_UNLOCK);
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	if(*added > 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating departure index)");
+	}
+
+	// Appended records are checksummed once, after the whole batch. $rowLines is not needed anymore, it is reused for the records.
+	for(int i = 0; i < *added; ++i) {
+		rowLines[i] = first+i;
+	}
+	if(*added > 0 && updateChecksums(rowLines, NULL, rows, *added) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+
+CLEANUP:
+	if(fclose(staffFile) == EOF) {
+		perror("Error (Closing staff file)");
+		retval = -3;
+	}
+	free(ids.ids);
+	return retval;
+}
+
+
+int readCSVRecord(char** cursor, char* end, char** fields, int maxFields, int* line) {
+	char* in = *cursor;
+	int fieldsLen = 0;
+
+	while(1) {
+		// Unquote the field in place, $out never passes $in.
+		char* out = in;
+		if(fieldsLen < maxFields) {
+			fields[fieldsLen] = out;
+		}
+		++fieldsLen;
+
+		if(in < end && *in == '"') {
+			for(++in; in < end; ++in) {
+				if(*in == '"') {
+					if(in+1 == end || in[1] != '"') {
+						++in;
+						break;
+					}
+					// An escaped quote.
+					++in;
+				} else if(*in == '\n') {
+					++*line;
+				}
+				*out++ = *in;
+			}
+		}
+		// The unquoted field, or what follows the closing quote, runs to the next separator.
+		while(in < end && *in != ',' && *in != '\n' && *in != '\r') {
+			*out++ = *in++;
+		}
+
+		char separator = in < end ? *in++ : '\n';
+		*out = 0;
+		if(separator == '\r' && in < end && *in == '\n') {
+			++in;
+		}
+		if(separator != ',') {
+			++*line;
+			break;
+		}
+	}
+
+	*cursor = in;
+	return fieldsLen;
+}
+
+
+char* parseStaffRow(char** fields, Staff* staff) {
+	for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+		// Remove leading and trailing spaces, like promptStaffDetails() does.
+		while(fields[field][0] == ' ') {
+			++fields[field];
+		}
+		int len = strlen(fields[field]);
+		while(len > 0 && fields[field][len-1] == ' ') {
+			fields[field][--len] = 0;
+		}
+
+		char* error = checkStaffDetails(fields[field], field);
+		if(error != NULL) {
+			return error;
+		}
+	}
+	if(strlen(fields[STAFF_ENUM_LENGTH]) >= STAFF_BUF_MAX) {
+		return "Please enter a shorter password!";
+	}
+
+	*staff = (Staff) { 0 };
+	strcpy(staff->id, fields[SE_ID]);
+	strcpy(staff->details.name, fields[SE_NAME]);
+	strcpy(staff->details.position, fields[SE_POSITION]);
+	strcpy(staff->details.phone, fields[SE_PHONE]);
+	strcpy(staff->details.ic, fields[SE_IC]);
+	return NULL;
+}
+
+
+int addStaffId(StaffIdSet* set, char* id) {
+	if((set->length+1)*2 > set->capacity) {
+		// Keep the set at most half full, rehash into twice the slots.
+		int capacity = set->capacity == 0 ? 1024 : set->capacity*2;
+		StaffIdSet grown = { calloc(capacity, sizeof(*set->ids)), capacity, 0 };
+		if(grown.ids == NULL) {
+			return -4;
+		}
+		for(int i = 0; i < set->capacity; ++i) {
+			if(set->ids[i][0] != 0) {
+				addStaffId(&grown, set->ids[i]);
+			}
+		}
+		free(set->ids);
+		*set = grown;
+	}
+
+	// IDs are matched case insensitively, as staffExists() does.
+	char key[6] = { 0 };
+	foldCase(key, id, sizeof(key)-1);
+
+	for(int slot = hashStaffId(key)&(set->capacity-1); ; slot = (slot+1)&(set->capacity-1)) {
+		if(set->ids[slot][0] == 0) {
+			memcpy(set->ids[slot], key, sizeof(key));
+			++set->length;
+			return 1;
+		}
+		if(memcmp(set->ids[slot], key, sizeof(key)) == 0) {
+			return 0;
+		}
+	}
+}
+
+
+int deleteStaffCommand(int argc, char** argv) {
+	if(argc == 0) {
+		return -18;
+	}
+
+	int retval = 0;
+	FILE* staffFile = NULL;
+	Staff* staffArr = NULL;
+	StaffQuery* queries = NULL;
+	int len = 0;
+
+	if(strncmp(argv[0], "--", 2) == 0) {
+		// Delete by queries, every --like takes two arguments.
+		queries = malloc((argc/2+1)*sizeof(StaffQuery));
+		if(queries == NULL) {
+			perror("Error (malloc $queries)");
+			retval = -4;
+			goto CLEANUP;
+		}
+
+		int field = -1;
+		int queriesLen = 0;
+		for(int i = 0; i < argc; ++i) {
+			retval = parseStaffQueryArgument(argc, argv, &i, &field, queries, &queriesLen);
+			if(retval <= 0) {
+				retval = -18;
+				goto CLEANUP;
+			}
+		}
+		if(queriesLen == 0) {
+			// Deleting every staff takes at least one query, e.g. --like %.
+			retval = -18;
+			goto CLEANUP;
+		}
+
+		retval = deleteStaffWhere(queries, queriesLen);
+		if(retval < 0) {
+			perror(retval == -4 ? "Error (malloc)" : "Error (Deleting staff)");
+			goto CLEANUP;
+		}
+		printf("%d staff deleted.\n", retval);
+		retval = 0;
+		goto CLEANUP;
+	}
+
+	for(int i = 0; i < argc; ++i) {
+		if(strlen(argv[i]) > 5) {
+			fprintf(stderr, "%s: Please enter a valid ID!\n", argv[i]);
+			return -18;
+		}
+	}
+
+	// An ID given twice is deleted once, and only counted once.
+	int idsLen = 0;
+	for(int i = 0; i < argc; ++i) {
+		bool repeated = false;
+		for(int ii = 0; ii < idsLen && !repeated; ++ii) {
+			repeated = strcmp(argv[ii], argv[i]) == 0;
+		}
+		if(!repeated) {
+			argv[idsLen++] = argv[i];
+		}
+	}
+
+	// The staff daemon deletes the staff from its own table.
+	if(!useStaffDaemon()) {
+		staffFile = fopen("staff.bin", "rb+");
+		if(staffFile == NULL) {
+			perror("Error (Opening staff file)");
+			retval = -3;
+			goto CLEANUP;
+		}
+
+		len = loadStaff(&staffArr);
+		if(len < 0) {
+			perror(len == -4 ? "Error (malloc)" : "Error (Reading staff file)");
+			retval = len;
+			goto CLEANUP;
+		}
+	}
+
+	int deleted = deleteStaffIds(staffFile, staffArr, len, argv, idsLen);
+	if(deleted < 0) {
+		perror("Error (malloc)");
+		retval = deleted;
+		goto CLEANUP;
+	}
+	printf("%d staff deleted.\n", deleted);
+	if(deleted < idsLen) {
+		// Some IDs did not match an existing staff.
+		retval = -15;
+	}
+
+CLEANUP:
+	free(staffArr);
+	free(queries);
+	if(staffFile != NULL && fclose(staffFile) == EOF) {
+		perror("Error (Closing staff file, file data might not be saved.)");
+		retval = -3;
+	}
+	return retval;
+}
+
+
+int deleteStaffWhere(StaffQuery* queries, int queriesLen) {
+	int retval = 0;
+	FILE* staffFile = NULL;
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	StaffFolded* folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+	DepartureEntry* departures = NULL;
+	int* records = NULL;
+	Staff* originals = NULL;
+	Staff* written = NULL;
+	int deleted = 0;
+	int capacity = 0;
+
+	if(chunk == NULL || folded == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	if(useStaffDaemon()) {
+		// The daemon matches the queries and deletes the matching staff in one request, while holding its lock.
+		int* reply = NULL;
+		int replyBytes = 0;
+		retval = requestStaff(SR_PURGE, queries, queriesLen*sizeof(StaffQuery), (void**) &reply, &replyBytes);
+		free(reply);
+		deleted = replyBytes/sizeof(int);
+		goto CLEANUP;
+	}
+
+	staffFile = fopen("staff.bin", "rb+");
+	StaffFileStamp before;
+	if(staffFile == NULL || statStaffFile(staffFile, &before) != 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	for(long first = 0; ; first += STAFF_STREAM_CHUNK) {
+		// The chunk stays locked from reading it to writing it, so changes of other terminals in between are not lost.
+		if(lockStaff(staffFile, first, STAFF_STREAM_CHUNK, SL_EXCLUSIVE) != 0) {
+			retval = -3;
+			goto CLEANUP;
+		}
+		int read = preadStaff(staffFile, chunk, first, STAFF_STREAM_CHUNK);
+		foldStaffArray(folded, chunk, read);
+
+		for(int i = 0; i < read;) {
+			if(!matchStaffQueries(&chunk[i], &folded[i], queries, queriesLen)) {
+				++i;
+				continue;
+			}
+
+			// Tombstone the run of adjacent matching staff, and write it at once.
+			int end = i;
+			for(; end < read && matchStaffQueries(&chunk[end], &folded[end], queries, queriesLen); ++end) {
+				if(deleted == capacity) {
+					capacity = capacity == 0 ? STAFF_STREAM_CHUNK : capacity*2;
+					DepartureEntry* grownDepartures = realloc(departures, capacity*sizeof(DepartureEntry));
+					departures = grownDepartures != NULL ? grownDepartures : departures;
+					int* grownRecords = realloc(records, capacity*sizeof(int));
+					records = grownRecords != NULL ? grownRecords : records;
+					Staff* grownOriginals = realloc(originals, capacity*sizeof(Staff));
+					originals = grownOriginals != NULL ? grownOriginals : originals;
+					Staff* grownWritten = realloc(written, capacity*sizeof(Staff));
+					written = grownWritten != NULL ? grownWritten : written;
+					if(grownDepartures == NULL || grownRecords == NULL || grownOriginals == NULL || grownWritten == NULL) {
+						// Only write the staff tombstoned so far.
+						retval = -4;
+						break;
+					}
+				}
+				originals[deleted] = chunk[end];
+				markStaffDeleted(&chunk[end]);
+				written[deleted] = chunk[end];
+				records[deleted] = first+end;
+				departures[deleted++] = (DepartureEntry) { staffDepartureDate(chunk[end]), first+end };
+			}
+
+			if(
+				fseek(staffFile, (first+i)*(long) sizeof(Staff), SEEK_SET) != 0 ||
+				fwrite(&chunk[i], sizeof(Staff), end-i, staffFile) != (size_t) (end-i)
+			) {
+				retval = -3;
+			}
+			if(retval != 0) {
+				break;
+			}
+			i = end;
+		}
+
+		// The deletions have to be flushed before unlocking.
+		if(fflush(staffFile) == EOF) {
+			retval = -3;
+		}
+		lockStaff(staffFile, first, STAFF_STREAM_CHUNK, SL_UNLOCK);
+		if(retval != 0 || read < STAFF_STREAM_CHUNK) {
+			break;
+		}
+	}
+
+	if(deleted > 0 && stampStaffIdIndex(staffFile, &before) != 0) {
+		perror("Error (Updating staff ID index)");
+	}
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	fclose(staffFile);
+	staffFile = NULL;
+	if(addDepartures(departures, deleted, &before) != 0) {
+		perror("Error (Updating departure index)");
+	}
+	if(deleted > 0 && updateChecksums(records, originals, written, deleted) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+
+CLEANUP:
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	free(chunk);
+	free(folded);
+	free(departures);
+	free(records);
+	free(originals);
+	free(written);
+	return retval < 0 ? retval : deleted;
+}
+
+
+int updateStaffCommand(int argc, char** argv) {
+	int retval = 0;
+	StaffUpdate update = { 0 };
+	// Every --set and --like takes two arguments.
+	StaffQuery* queries = malloc((argc/2+1)*sizeof(StaffQuery));
+	int queriesLen = 0;
+	bool set = false;
+
+	if(queries == NULL) {
+		perror("Error (malloc $queries)");
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	int field = -1;
+	for(int i = 0; i < argc; ++i) {
+		int parsed = parseStaffQueryArgument(argc, argv, &i, &field, queries, &queriesLen);
+		if(parsed != 0) {
+			if(parsed < 0) {
+				retval = parsed;
+				goto CLEANUP;
+			}
+		} else if(strcmp(argv[i], "--set") == 0 && i+1 < argc) {
+			char* value = strchr(argv[++i], '=');
+			if(value == NULL) {
+				retval = -18;
+				goto CLEANUP;
+			}
+			*value++ = '\0';
+
+			int updated = parseStaffField(argv[i]);
+			if(updated == -1 || updated == SE_ID) {
+				fprintf(stderr, "%s: %s\n", argv[i], updated == -1 ? "Entered field does not match any of the field!" : "IDs are unique, they can not be set on many staff!");
+				retval = -18;
+				goto CLEANUP;
+			}
+			char* error = checkStaffDetails(value, updated);
+			if(error != NULL) {
+				fprintf(stderr, "%s: %s\n", argv[i], error);
+				retval = -18;
+				goto CLEANUP;
+			}
+			strcpy(staffFieldText(&update.values, updated), value);
+			update.fields[updated] = true;
+			set = true;
+		} else {
+			retval = -18;
+			goto CLEANUP;
+		}
+	}
+	if(!set || queriesLen == 0) {
+		// Updating every staff takes at least one query, e.g. --like %.
+		retval = -18;
+		goto CLEANUP;
+	}
+
+	retval = updateStaffWhere(&update, queries, queriesLen);
+	if(retval < 0) {
+		perror(retval == -4 ? "Error (malloc)" : "Error (Updating staff)");
+		goto CLEANUP;
+	}
+	printf("%d staff updated.\n", retval);
+	retval = 0;
+
+CLEANUP:
+	free(queries);
+	return retval;
+}
+
+
+int updateStaffWhere(StaffUpdate* update, StaffQuery* queries, int queriesLen) {
+	int retval = 0;
+	FILE* staffFile = NULL;
+	Staff* chunk = NULL;
+	StaffFolded* folded = NULL;
+	int* records = NULL;
+	Staff* originals = NULL;
+	Staff* written = NULL;
+	int updated = 0;
+	int capacity = 0;
+
+	if(useStaffDaemon()) {
+		// The daemon evaluates the queries against its table, and writes the updated staff itself.
+		char* payload = malloc(sizeof(StaffUpdate)+queriesLen*sizeof(StaffQuery));
+		int* reply = NULL;
+		if(payload == NULL) {
+			return -4;
+		}
+		memcpy(payload, update, sizeof(StaffUpdate));
+		memcpy(payload+sizeof(StaffUpdate), queries, queriesLen*sizeof(StaffQuery));
+		retval = requestStaff(SR_UPDATE, payload, sizeof(StaffUpdate)+queriesLen*sizeof(StaffQuery), (void**) &reply, NULL);
+		if(retval == 0) {
+			updated = *reply;
+		}
+		free(payload);
+		free(reply);
+		return retval != 0 ? retval : updated;
+	}
+
+	chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	folded = malloc(STAFF_STREAM_CHUNK*sizeof(StaffFolded));
+	staffFile = fopen("staff.bin", "rb+");
+	StaffFileStamp before;
+	if(chunk == NULL || folded == NULL || staffFile == NULL || statStaffFile(staffFile, &before) != 0) {
+		retval = chunk == NULL || folded == NULL ? -4 : -3;
+		goto CLEANUP;
+	}
+
+	for(long first = 0; ; first += STAFF_STREAM_CHUNK) {
+		// The chunk stays locked from reading it to writing it, so changes of other terminals in between are not lost.
+		if(lockStaff(staffFile, first, STAFF_STREAM_CHUNK, SL_EXCLUSIVE) != 0) {
+			retval = -3;
+			goto CLEANUP;
+		}
+		int read = preadStaff(staffFile, chunk, first, STAFF_STREAM_CHUNK);
+		foldStaffArray(folded, chunk, read);
+
+		// Runs of adjacent updated staff are written at once, the loop goes one past the chunk to write the last run.
+		for(int i = 0, run = -1; i <= read && retval == 0; ++i) {
+			// The staff as read is kept for updateChecksums().
+			Staff original;
+			bool changed = false;
+			if(i < read && matchStaffQueries(&chunk[i], &folded[i], queries, queriesLen)) {
+				original = chunk[i];
+				changed = applyStaffUpdate(&chunk[i], update);
+			}
+			if(changed && updated == capacity) {
+				capacity = capacity == 0 ? STAFF_STREAM_CHUNK : capacity*2;
+				int* grownRecords = realloc(records, capacity*sizeof(int));
+				records = grownRecords != NULL ? grownRecords : records;
+				Staff* grownOriginals = realloc(originals, capacity*sizeof(Staff));
+				originals = grownOriginals != NULL ? grownOriginals : originals;
+				Staff* grownWritten = realloc(written, capacity*sizeof(Staff));
+				written = grownWritten != NULL ? grownWritten : written;
+				if(grownRecords == NULL || grownOriginals == NULL || grownWritten == NULL) {
+					// Undo this staff, and only write the pending run of staff updated so far.
+					chunk[i] = original;
+					changed = false;
+					retval = -4;
+				}
+			}
+			if(changed) {
+				originals[updated] = original;
+				written[updated] = chunk[i];
+				records[updated++] = first+i;
+				run = run == -1 ? i : run;
+				continue;
+			}
+
+			if(run != -1 && (
+				fseek(staffFile, (first+run)*(long) sizeof(Staff), SEEK_SET) != 0 ||
+				fwrite(&chunk[run], sizeof(Staff), i-run, staffFile) != (size_t) (i-run)
+			)) {
+				retval = -3;
+			}
+			run = -1;
+		}
+
+		// The updates have to be flushed before unlocking.
+		if(fflush(staffFile) == EOF) {
+			retval = -3;
+		}
+		lockStaff(staffFile, first, STAFF_STREAM_CHUNK, SL_UNLOCK);
+		if(retval != 0 || read < STAFF_STREAM_CHUNK) {
+			break;
+		}
+	}
+
+	if(updated > 0 && stampStaffIdIndex(staffFile, &before) != 0) {
+		perror("Error (Updating staff ID index)");
+	}
+
+	// The index and checksums open the staff file themselves, which releases every record lock. (See lockStaff())
+	fclose(staffFile);
+	staffFile = NULL;
+	if(updated > 0 && addDepartures(NULL, 0, &before) != 0) {
+		perror("Error (Updating departure index)");
+	}
+	if(updated > 0 && updateChecksums(records, originals, written, updated) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+
+CLEANUP:
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	free(chunk);
+	free(folded);
+	free(originals);
+	free(written);
+	free(records);
+	return retval < 0 ? retval : updated;
+}
+
+
+int reportStaffCommand(int argc, char** argv) {
+	bool json = argc == 1 && strcmp(argv[0], "--json") == 0;
+	if(argc > 0 && !json) {
+		return -18;
+	}
+
+	ReportAggregate agg = { 0 };
+	int retval = computeStaffReport(&agg);
+	if(retval < 0) {
+		goto CLEANUP;
+	}
+	if(!json) {
+		printStaffReport(&agg);
+		goto CLEANUP;
+	}
+
+	Frame frame = { 0 };
+	framePrintf(
+		&frame, "{\"active\":%d,\"inactive\":%d,\"total\":%d",
+		agg.totalActive, agg.totalInactive, agg.totalActive+agg.totalInactive
+	);
+
+	ReportTable* tables[2] = { &agg.positions, &agg.months };
+	for(int t = 0; t < 2; ++t) {
+		int listLen;
+		ReportBucket* sorted = sortReportBuckets(tables[t], t == 0 ? compareReportPosition : compareReportMonth, &listLen);
+		ReportBucket* list = sorted != NULL ? sorted : tables[t]->buckets;
+
+		framePrintf(&frame, t == 0 ? ",\"positions\":[" : ",\"departures\":[");
+		bool first = true;
+		for(int i = 0; i < listLen; ++i) {
+			if(!list[i].used) {
+				continue;
+			}
+			if(!first) {
+				frameAppend(&frame, ",", 1);
+			}
+			frameAppend(&frame, "{", 1);
+			first = false;
+			if(t == 0) {
+				frameAppend(&frame, "\"position\":", 11);
+				frameJSONString(&frame, list[i].position, strlen(list[i].position));
+				framePrintf(&frame, ",\"active\":%d,\"inactive\":%d}", list[i].active, list[i].inactive);
+			} else {
+				framePrintf(&frame, "\"month\":\"%04u-%02u\",\"departures\":%d}", list[i].key>>8, list[i].key&0xFF, list[i].inactive);
+			}
+		}
+		frameAppend(&frame, "]", 1);
+		free(sorted);
+	}
+	frameAppend(&frame, "}\n", 2);
+
+	retval = flushFrame(&frame);
+	if(retval != 0) {
+		perror("Error (Writing staff report)");
+	}
+	free(frame.text);
+
+CLEANUP:
+	freeReportAggregate(&agg);
+	return retval;
+}
+
+
+u64 computeHash(char* msg) {
+	BLAKE2bContext ctx;
+	u64 hash;
+
+	BLAKE2bInit(&ctx, sizeof(hash), NULL, 0);
+	BLAKE2bUpdate(&ctx, msg, strlen(msg));
+	BLAKE2bFinal(&ctx, &hash);
+
+	return hash;
+}
+
+
+int BLAKE2bInit(BLAKE2bContext* ctx, int outLen, const void* key, int keyLen) {
+	if(outLen < 1 || outLen > BLAKE2B_OUT_MAX || keyLen < 0 || keyLen > BLAKE2B_OUT_MAX || (key == NULL && keyLen != 0)) {
+		return -15;
+	}
+
+	// Hash starts off as the initialisation vector, mixed with the parameter block (digest size, key size, fanout and depth of 1).
+	memcpy(ctx->hash, BLAKE2B_IV, sizeof(ctx->hash));
+	ctx->hash[0] ^= 0x01010000 ^ (keyLen<<8) ^ outLen;
+	ctx->counter[0] = 0;
+	ctx->counter[1] = 0;
+	ctx->bufLen = 0;
+	ctx->outLen = outLen;
+
+	// A key is hashed as a whole block of its own, padded with zeroes.
+	if(keyLen > 0) {
+		memset(ctx->buf, 0, BLAKE2B_BLOCK_BYTES);
+		memcpy(ctx->buf, key, keyLen);
+		ctx->bufLen = BLAKE2B_BLOCK_BYTES;
+	}
+	return 0;
+}
+
+
+void BLAKE2bUpdate(BLAKE2bContext* ctx, const void* data, size_t len) {
+	// Advances the 128 bits counter by $_n bytes, then compresses $_block.
+	#define compress(_block, _n)																				\
+		do {																									\
+			u64 _m[16];																							\
+			memcpy(_m, (_block), sizeof(_m));																	\
+			ctx->counter[0] += (_n);																			\
+			ctx->counter[1] += ctx->counter[0] < (u64) (_n);													\
+			BLAKE2B_KERNELS[blake2bKernel](ctx->hash, _m, ctx->counter[0], ctx->counter[1], 0);				\
+		} while(0)
+
+	const unsigned char* in = data;
+
+	initBLAKE2bKernel();
+
+	// The last block has to be compressed with the finalisation flag, so a full block is only compressed once more bytes arrive.
+	if(len > 0 && ctx->bufLen + len > BLAKE2B_BLOCK_BYTES) {
+		int fill = BLAKE2B_BLOCK_BYTES - ctx->bufLen;
+		memcpy(ctx->buf + ctx->bufLen, in, fill);
+		compress(ctx->buf, BLAKE2B_BLOCK_BYTES);
+		ctx->bufLen = 0;
+		in += fill;
+		len -= fill;
+
+		// Compress whole blocks straight from $data.
+		while(len > BLAKE2B_BLOCK_BYTES) {
+			compress(in, BLAKE2B_BLOCK_BYTES);
+			in += BLAKE2B_BLOCK_BYTES;
+			len -= BLAKE2B_BLOCK_BYTES;
+		}
+	}
+
+	memcpy(ctx->buf + ctx->bufLen, in, len);
+	ctx->bufLen += len;
+
+	#undef compress
+}
+
+
+void BLAKE2bFinal(BLAKE2bContext* ctx, void* out) {
+	u64 m[16];
+
+	ctx->counter[0] += ctx->bufLen;
+	ctx->counter[1] += ctx->counter[0] < (u64) ctx->bufLen;
+
+	// Pad the last block with zeroes.
+	memset(ctx->buf + ctx->bufLen, 0, BLAKE2B_BLOCK_BYTES - ctx->bufLen);
+	memcpy(m, ctx->buf, sizeof(m));
+	BLAKE2B_KERNELS[blake2bKernel](ctx->hash, m, ctx->counter[0], ctx->counter[1], ~0ull);
+
+	// Digest is the hash in little endian.
+	unsigned char digest[BLAKE2B_OUT_MAX];
+	for(int i = 0; i < BLAKE2B_OUT_MAX; ++i) {
+		digest[i] = ctx->hash[i/8] >> (8*(i%8));
+	}
+	memcpy(out, digest, ctx->outLen);
+
+	// Erase sensitive data.
+	memset(m, 0, sizeof(m));
+	memset(digest, 0, sizeof(digest));
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+
+int BLAKE2b(void* out, int outLen, const void* data, size_t len, const void* key, int keyLen) {
+	BLAKE2bContext ctx;
+	int res = BLAKE2bInit(&ctx, outLen, key, keyLen);
+	if(res != 0) {
+		return res;
+	}
+	BLAKE2bUpdate(&ctx, data, len);
+	BLAKE2bFinal(&ctx, out);
+	return 0;
+}
+
+
+void computeHashBatch(char** msgs, u64* hashes, int count) {
+	int i = 0;
+
+	initBLAKE2bKernel();
+
+	#ifdef BLAKE2B_X86
+	for(; blake2bKernel == BK_AVX2 && i+4 <= count; i += 4) {
+		// Same parameter block as computeHash(). (8 bytes digest, no key)
+		u64 hash[8][4];
+		for(int w = 0; w < 8; ++w) {
+			for(int lane = 0; lane < 4; ++lane) {
+				hash[w][lane] = BLAKE2B_IV[w] ^ (w == 0 ? 0x01010000 ^ 8 : 0);
+			}
+		}
+
+		int lens[4];
+		int blocks[4];
+		int maxBlocks = 0;
+		for(int lane = 0; lane < 4; ++lane) {
+			lens[lane] = strlen(msgs[i+lane]);
+			blocks[lane] = lens[lane] == 0 ? 1 : (lens[lane]+BLAKE2B_BLOCK_BYTES-1)/BLAKE2B_BLOCK_BYTES;
+			if(blocks[lane] > maxBlocks) {
+				maxBlocks = blocks[lane];
+			}
+		}
+
+		for(int b = 0; b < maxBlocks; ++b) {
+			u64 m[16][4];
+			u64 t0[4];
+			u64 f0[4];
+			u64 active[4];
+
+			for(int lane = 0; lane < 4; ++lane) {
+				// Split the message the same way as BLAKE2bUpdate(), every block but the last is full.
+				char buf[BLAKE2B_BLOCK_BYTES] = { 0 };
+				active[lane] = b < blocks[lane] ? ~0ull : 0;
+				f0[lane] = b == blocks[lane]-1 ? ~0ull : 0;
+				if(b < blocks[lane]-1) {
+					memcpy(buf, &msgs[i+lane][b*BLAKE2B_BLOCK_BYTES], BLAKE2B_BLOCK_BYTES);
+					t0[lane] = (b+1)*BLAKE2B_BLOCK_BYTES;
+				} else if(b == blocks[lane]-1) {
+					memcpy(buf, &msgs[i+lane][b*BLAKE2B_BLOCK_BYTES], lens[lane] - b*BLAKE2B_BLOCK_BYTES);
+					t0[lane] = lens[lane];
+				} else {
+					t0[lane] = 0;
+				}
+
+				for(int w = 0; w < 16; ++w) {
+					memcpy(&m[w][lane], buf+w*8, 8);
+				}
+				memset(buf, 0, BLAKE2B_BLOCK_BYTES); // Erase sensitive data.
+			}
+
+			BLAKE2bF4AVX2(hash, m, t0, f0, active);
+			memset(m, 0, sizeof(m)); // Erase sensitive data.
+		}
+
+		for(int lane = 0; lane < 4; ++lane) {
+			hashes[i+lane] = hash[0][lane];
+		}
+	}
+	#endif
+
+	for(; i < count; ++i) {
+		hashes[i] = computeHash(msgs[i]);
+	}
+}
+
+
+void BLAKE2bF(u64* hash, char* msg, u64 bytesCompressed, bool isLastBlock) {
+	initBLAKE2bKernel();
+
+	// Copy the message to aligned words, $msg may not be aligned.
+	u64 m[16];
+	memcpy(m, msg, sizeof(m));
+
+	// High word of the counter is always 0 as $bytesCompressed is limited to 8 bytes.
+	BLAKE2B_KERNELS[blake2bKernel](hash, m, bytesCompressed, 0, isLastBlock ? ~0ull : 0);
+}
+
+
+int useBLAKE2bKernel(int kernel) {
+	// Selected once first, so a kernel chosen here is not replaced on first use.
+	initBLAKE2bKernel();
+	if(kernel == -1) {
+		selectBLAKE2bKernel();
+	} else if(kernel >= 0 && kernel < BLAKE2B_KERNEL_LENGTH && isBLAKE2bKernelSupported(kernel)) {
+		blake2bKernel = kernel;
+	}
+	return blake2bKernel;
+}
+
+
+void initBLAKE2bKernel(void) {
+	#ifdef STAFF_THREADS
+	pthread_once(&blake2bOnce, selectBLAKE2bKernel);
+	#else
+	if(blake2bKernel == -1) {
+		selectBLAKE2bKernel();
+	}
+	#endif
+}
+
+
+void selectBLAKE2bKernel(void) {
+	int kernel = BLAKE2B_KERNEL_LENGTH-1;
+	while(!isBLAKE2bKernelSupported(kernel)) {
+		--kernel;
+	}
+	blake2bKernel = kernel;
+}
+
+
+bool isBLAKE2bKernelSupported(int kernel) {
+	switch(kernel) {
+		case BK_SCALAR:
+			return true;
+		#ifdef BLAKE2B_X86
+		case BK_SSSE3:
+			return __builtin_cpu_supports("ssse3");
+		case BK_AVX2:
+			return __builtin_cpu_supports("avx2");
+		#endif
+		default:
+			return false;
+	}
+}
+
+
+void BLAKE2bFScalar(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0) {
+	#define rotateRight64Bits(a,n) (((a)>>(n))^((a)<<(64-(n))))
+
+	// Mixing function defined by BLAKE2b.
+	// Only called with constant indexes, so $v is kept in registers instead of memory.
+	#define G(a,b,c,d,x,y)									\
+		do {												\
+			v[a] += v[b] + (x);								\
+			v[d] = rotateRight64Bits(v[d]^v[a], 32);		\
+			v[c] += v[d];									\
+			v[b] = rotateRight64Bits(v[b]^v[c], 24);		\
+			v[a] += v[b] + (y);								\
+			v[d] = rotateRight64Bits(v[d]^v[a], 16);		\
+			v[c] += v[d];									\
+			v[b] = rotateRight64Bits(v[b]^v[c], 63);		\
+		} while(0)
+
+	u64 v[16] = {
+		hash[0], hash[1], hash[2], hash[3],
+		hash[4], hash[5], hash[6], hash[7],
+		BLAKE2B_IV[0], BLAKE2B_IV[1], BLAKE2B_IV[2], BLAKE2B_IV[3],
+		BLAKE2B_IV[4] ^ t0, BLAKE2B_IV[5] ^ t1, BLAKE2B_IV[6] ^ f0, BLAKE2B_IV[7]
+	};
+
+	// Number of rounds to mix the message specified for BLAKE2b.
+	for(int i = 0; i < 12; ++i) {
+		// Choose the specified sigma array for the current round.
+		const unsigned char* S = BLAKE2B_SIGMA[i];
+
+		G(0, 4,  8, 12, m[S[ 0]], m[S[ 1]]);
+		G(1, 5,  9, 13, m[S[ 2]], m[S[ 3]]);
+		G(2, 6, 10, 14, m[S[ 4]], m[S[ 5]]);
+		G(3, 7, 11, 15, m[S[ 6]], m[S[ 7]]);
+
+		G(0, 5, 10, 15, m[S[ 8]], m[S[ 9]]);
+		G(1, 6, 11, 12, m[S[10]], m[S[11]]);
+		G(2, 7,  8, 13, m[S[12]], m[S[13]]);
+		G(3, 4,  9, 14, m[S[14]], m[S[15]]);
+	}
+
+	for(int i = 0; i < 8; ++i) {
+		hash[i] ^= v[i] ^ v[i+8];
+	}
+
+	#undef G
+	#undef rotateRight64Bits
+}
+
+
+#ifdef BLAKE2B_X86
+__attribute__((target("ssse3")))
+void BLAKE2bFSSSE3(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0) {
+	// Byte shuffles that rotate each 64 bits lane right by 24 and 16 bits.
+	const __m128i R24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m128i R16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+
+	// Rotations of each 64 bits lane. Rotating by 32 only swaps the 32 bits halves.
+	#define rotr32(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+	#define rotr24(x) _mm_shuffle_epi8((x), R24)
+	#define rotr16(x) _mm_shuffle_epi8((x), R16)
+	#define rotr63(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+	// G function on the 4 columns (or diagonals) at once, with $x* and $y* holding the message words of each G.
+	#define G(xl,xh,yl,yh)															\
+		do {																		\
+			al = _mm_add_epi64(_mm_add_epi64(al, bl), (xl));						\
+			ah = _mm_add_epi64(_mm_add_epi64(ah, bh), (xh));						\
+			dl = rotr32(_mm_xor_si128(dl, al));										\
+			dh = rotr32(_mm_xor_si128(dh, ah));										\
+			cl = _mm_add_epi64(cl, dl);												\
+			ch = _mm_add_epi64(ch, dh);												\
+			bl = rotr24(_mm_xor_si128(bl, cl));									\
+			bh = rotr24(_mm_xor_si128(bh, ch));									\
+			al = _mm_add_epi64(_mm_add_epi64(al, bl), (yl));						\
+			ah = _mm_add_epi64(_mm_add_epi64(ah, bh), (yh));						\
+			dl = rotr16(_mm_xor_si128(dl, al));									\
+			dh = rotr16(_mm_xor_si128(dh, ah));									\
+			cl = _mm_add_epi64(cl, dl);												\
+			ch = _mm_add_epi64(ch, dh);												\
+			bl = rotr63(_mm_xor_si128(bl, cl));									\
+			bh = rotr63(_mm_xor_si128(bh, ch));									\
+		} while(0)
+
+	// Load a pair of message words, $lo goes to the lower lane.
+	#define load(lo,hi) _mm_set_epi64x((long long) m[S[hi]], (long long) m[S[lo]])
+
+	__m128i al = _mm_loadu_si128((const __m128i*) &hash[0]);
+	__m128i ah = _mm_loadu_si128((const __m128i*) &hash[2]);
+	__m128i bl = _mm_loadu_si128((const __m128i*) &hash[4]);
+	__m128i bh = _mm_loadu_si128((const __m128i*) &hash[6]);
+	__m128i cl = _mm_loadu_si128((const __m128i*) &BLAKE2B_IV[0]);
+	__m128i ch = _mm_loadu_si128((const __m128i*) &BLAKE2B_IV[2]);
+	__m128i dl = _mm_xor_si128(_mm_loadu_si128((const __m128i*) &BLAKE2B_IV[4]), _mm_set_epi64x((long long) t1, (long long) t0));
+	__m128i dh = _mm_xor_si128(_mm_loadu_si128((const __m128i*) &BLAKE2B_IV[6]), _mm_set_epi64x(0, (long long) f0));
+
+	for(int i = 0; i < 12; ++i) {
+		const unsigned char* S = BLAKE2B_SIGMA[i];
+		__m128i t;
+
+		G(load(0, 2), load(4, 6), load(1, 3), load(5, 7));
+
+		// Diagonalise: rotate row b left by 1 lane, row c by 2 and row d by 3.
+		t = bl;
+		bl = _mm_unpackhi_epi64(bl, _mm_unpacklo_epi64(bh, bh));
+		bh = _mm_unpackhi_epi64(bh, _mm_unpacklo_epi64(t, t));
+		t = cl;
+		cl = ch;
+		ch = t;
+		t = dl;
+		dl = _mm_unpackhi_epi64(dh, _mm_unpacklo_epi64(dl, dl));
+		dh = _mm_unpackhi_epi64(t, _mm_unpacklo_epi64(dh, dh));
+
+		G(load(8, 10), load(12, 14), load(9, 11), load(13, 15));
+
+		// Undiagonalise.
+		t = bl;
+		bl = _mm_unpackhi_epi64(bh, _mm_unpacklo_epi64(bl, bl));
+		bh = _mm_unpackhi_epi64(t, _mm_unpacklo_epi64(bh, bh));
+		t = cl;
+		cl = ch;
+		ch = t;
+		t = dl;
+		dl = _mm_unpackhi_epi64(dl, _mm_unpacklo_epi64(dh, dh));
+		dh = _mm_unpackhi_epi64(dh, _mm_unpacklo_epi64(t, t));
+	}
+
+	_mm_storeu_si128((__m128i*) &hash[0], _mm_xor_si128(_mm_loadu_si128((const __m128i*) &hash[0]), _mm_xor_si128(al, cl)));
+	_mm_storeu_si128((__m128i*) &hash[2], _mm_xor_si128(_mm_loadu_si128((const __m128i*) &hash[2]), _mm_xor_si128(ah, ch)));
+	_mm_storeu_si128((__m128i*) &hash[4], _mm_xor_si128(_mm_loadu_si128((const __m128i*) &hash[4]), _mm_xor_si128(bl, dl)));
+	_mm_storeu_si128((__m128i*) &hash[6], _mm_xor_si128(_mm_loadu_si128((const __m128i*) &hash[6]), _mm_xor_si128(bh, dh)));
+
+	#undef load
+	#undef G
+	#undef rotr63
+	#undef rotr16
+	#undef rotr24
+	#undef rotr32
+}
+
+
+__attribute__((target("avx2")))
+void BLAKE2bFAVX2(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0) {
+	// Byte shuffles that rotate each 64 bits lane right by 24 and 16 bits.
+	const __m256i R24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10
+	);
+	const __m256i R16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9
+	);
+
+	// G function on the 4 columns (or diagonals) at once.
+	// Rotating right by 63 is the same as rotating left by 1, which is x+x (shift left) plus the top bit.
+	#define G(x,y)																	\
+		do {																		\
+			a = _mm256_add_epi64(_mm256_add_epi64(a, b), (x));						\
+			d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), _MM_SHUFFLE(2, 3, 0, 1));	\
+			c = _mm256_add_epi64(c, d);												\
+			b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), R24);					\
+			a = _mm256_add_epi64(_mm256_add_epi64(a, b), (y));						\
+			d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), R16);					\
+			c = _mm256_add_epi64(c, d);												\
+			b = _mm256_xor_si256(b, c);												\
+			b = _mm256_xor_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b));	\
+		} while(0)
+
+	// Load 4 message words, $w0 goes to the lowest lane.
+	#define load(w0,w1,w2,w3) _mm256_set_epi64x((long long) m[S[w3]], (long long) m[S[w2]], (long long) m[S[w1]], (long long) m[S[w0]])
+
+	__m256i a = _mm256_loadu_si256((const __m256i*) &hash[0]);
+	__m256i b = _mm256_loadu_si256((const __m256i*) &hash[4]);
+	__m256i c = _mm256_loadu_si256((const __m256i*) &BLAKE2B_IV[0]);
+	__m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) &BLAKE2B_IV[4]), _mm256_set_epi64x(0, (long long) f0, (long long) t1, (long long) t0));
+
+	for(int i = 0; i < 12; ++i) {
+		const unsigned char* S = BLAKE2B_SIGMA[i];
+
+		G(load(0, 2, 4, 6), load(1, 3, 5, 7));
+
+		// Diagonalise: rotate row b left by 1 lane, row c by 2 and row d by 3.
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+		c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+		d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+		G(load(8, 10, 12, 14), load(9, 11, 13, 15));
+
+		// Undiagonalise.
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+		c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+		d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+	}
+
+	_mm256_storeu_si256((__m256i*) &hash[0], _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) &hash[0]), _mm256_xor_si256(a, c)));
+	_mm256_storeu_si256((__m256i*) &hash[4], _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) &hash[4]), _mm256_xor_si256(b, d)));
+
+	#undef load
+	#undef G
+}
+
+
+__attribute__((target("avx2")))
+void BLAKE2bF4AVX2(u64 (*hash)[4], u64 (*m)[4], u64* t0, u64* f0, u64* active) {
+	const __m256i R24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10
+	);
+	const __m256i R16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9
+	);
+
+	// Same G function as BLAKE2bFScalar(), on the same word of 4 messages at once.
+	#define G(a,b,c,d,x,y)																	\
+		do {																				\
+			v[a] = _mm256_add_epi64(_mm256_add_epi64(v[a], v[b]), w[x]);					\
+			v[d] = _mm256_shuffle_epi32(_mm256_xor_si256(v[d], v[a]), _MM_SHUFFLE(2, 3, 0, 1));	\
+			v[c] = _mm256_add_epi64(v[c], v[d]);											\
+			v[b] = _mm256_shuffle_epi8(_mm256_xor_si256(v[b], v[c]), R24);					\
+			v[a] = _mm256_add_epi64(_mm256_add_epi64(v[a], v[b]), w[y]);					\
+			v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), R16);					\
+			v[c] = _mm256_add_epi64(v[c], v[d]);											\
+			v[b] = _mm256_xor_si256(v[b], v[c]);											\
+			v[b] = _mm256_xor_si256(_mm256_srli_epi64(v[b], 63), _mm256_add_epi64(v[b], v[b]));	\
+		} while(0)
+
+	__m256i w[16];
+	for(int i = 0; i < 16; ++i) {
+		w[i] = _mm256_loadu_si256((const __m256i*) m[i]);
+	}
+
+	__m256i v[16];
+	for(int i = 0; i < 8; ++i) {
+		v[i] = _mm256_loadu_si256((const __m256i*) hash[i]);
+		v[i+8] = _mm256_set1_epi64x((long long) BLAKE2B_IV[i]);
+	}
+	v[12] = _mm256_xor_si256(v[12], _mm256_loadu_si256((const __m256i*) t0));
+	v[14] = _mm256_xor_si256(v[14], _mm256_loadu_si256((const __m256i*) f0));
+
+	for(int i = 0; i < 12; ++i) {
+		const unsigned char* S = BLAKE2B_SIGMA[i];
+
+		G(0, 4,  8, 12, S[ 0], S[ 1]);
+		G(1, 5,  9, 13, S[ 2], S[ 3]);
+		G(2, 6, 10, 14, S[ 4], S[ 5]);
+		G(3, 7, 11, 15, S[ 6], S[ 7]);
+
+		G(0, 5, 10, 15, S[ 8], S[ 9]);
+		G(1, 6, 11, 12, S[10], S[11]);
+		G(2, 7,  8, 13, S[12], S[13]);
+		G(3, 4,  9, 14, S[14], S[15]);
+	}
+
+	// Only update the hash of the active messages.
+	__m256i mask = _mm256_loadu_si256((const __m256i*) active);
+	for(int i = 0; i < 8; ++i) {
+		__m256i h = _mm256_loadu_si256((const __m256i*) hash[i]);
+		h = _mm256_xor_si256(h, _mm256_and_si256(mask, _mm256_xor_si256(v[i], v[i+8])));
+		_mm256_storeu_si256((__m256i*) hash[i], h);
+	}
+
+	#undef G
+}
+#else
+// Never selected, see isBLAKE2bKernelSupported().
+void BLAKE2bFSSSE3(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0) {
+	BLAKE2bFScalar(hash, m, t0, t1, f0);
+}
+
+
+void BLAKE2bFAVX2(u64* hash, const u64* m, u64 t0, u64 t1, u64 f0) {
+	BLAKE2bFScalar(hash, m, t0, t1, f0);
+}
+#endif
+
+
+int testHash(void) {
+	// RFC 7693 Appendix A, BLAKE2b-512("abc").
+	const unsigned char ABC_512[64] = {
+		0xBA, 0x80, 0xA5, 0x3F, 0x98, 0x1C, 0x4D, 0x0D, 0x6A, 0x27, 0x97, 0xB6, 0x9F, 0x12, 0xF6, 0xE9,
+		0x4C, 0x21, 0x2F, 0x14, 0x68, 0x5A, 0xC4, 0xB7, 0x4B, 0x12, 0xBB, 0x6F, 0xDB, 0xFF, 0xA2, 0xD1,
+		0x7D, 0x87, 0xC5, 0x39, 0x2A, 0xAB, 0x79, 0x2D, 0xC2, 0x52, 0xD5, 0xDE, 0x45, 0x33, 0xCC, 0x95,
+		0x18, 0xD3, 0x8A, 0xA8, 0xDB, 0xF1, 0x92, 0x5A, 0xB9, 0x23, 0x86, 0xED, 0xD4, 0x00, 0x99, 0x23
+	};
+	// RFC 7693 Appendix E, hash of all the self-test digests.
+	const unsigned char SELFTEST_RESULT[32] = {
+		0xC2, 0x3A, 0x78, 0x00, 0xD9, 0x81, 0x23, 0xBD, 0x10, 0xF5, 0x06, 0xC6, 0x1E, 0x29, 0xDA, 0x56,
+		0x03, 0xD7, 0x63, 0xB8, 0xBB, 0xAD, 0x2E, 0x73, 0x7F, 0x5E, 0x76, 0x5A, 0x7B, 0xCC, 0xD4, 0x75
+	};
+	const int SELFTEST_OUT_LEN[4] = { 20, 32, 48, 64 };
+	const int SELFTEST_IN_LEN[6] = { 0, 3, 128, 129, 255, 1024 };
+
+	// 8 bytes digests, as stored in $passHash.
+	char* passwords[5] = { "", "abc", "ADMIN", "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwx", "ADMIN" };
+	const u64 PASSWORD_HASHES[5] = { 0xb4b2797457a0a6e4, 0x5995d533d814bbd8, 0x5fa759654e457c84, 0x21d2352f6f7091eb, 0x5fa759654e457c84 };
+
+	int failed = 0;
+	int previous = blake2bKernel;
+
+	printf(
+		"BLAKE2B KNOWN ANSWER TESTS\n"
+		"==========================\n"
+		"KERNEL    RFC 7693 A    RFC 7693 E    computeHash()    computeHashBatch()\n"
+	);
+
+	for(int kernel = 0; kernel < BLAKE2B_KERNEL_LENGTH; ++kernel) {
+		if(!isBLAKE2bKernelSupported(kernel)) {
+			printf("%-6s    (Not supported by this CPU.)\n", BLAKE2B_KERNEL_NAMES[kernel]);
+			continue;
+		}
+		useBLAKE2bKernel(kernel);
+
+		unsigned char md[BLAKE2B_OUT_MAX];
+		BLAKE2b(md, 64, "abc", 3, NULL, 0);
+		bool passA = memcmp(md, ABC_512, 64) == 0;
+
+		unsigned char in[1024];
+		unsigned char key[BLAKE2B_OUT_MAX];
+		BLAKE2bContext ctx;
+		BLAKE2bInit(&ctx, 32, NULL, 0);
+		for(int i = 0; i < 4; ++i) {
+			int outLen = SELFTEST_OUT_LEN[i];
+			for(int j = 0; j < 6; ++j) {
+				int inLen = SELFTEST_IN_LEN[j];
+
+				selftestSequence(in, inLen, inLen);
+				BLAKE2b(md, outLen, in, inLen, NULL, 0);
+				BLAKE2bUpdate(&ctx, md, outLen);
+
+				selftestSequence(key, outLen, outLen);
+				BLAKE2b(md, outLen, in, inLen, key, outLen);
+				BLAKE2bUpdate(&ctx, md, outLen);
+			}
+		}
+		BLAKE2bFinal(&ctx, md);
+		bool passE = memcmp(md, SELFTEST_RESULT, 32) == 0;
+
+		bool passHash = true;
+		u64 batch[5];
+		for(int i = 0; i < 5; ++i) {
+			passHash &= computeHash(passwords[i]) == PASSWORD_HASHES[i];
+		}
+		// 5 passwords, so the SIMD lanes and the leftover path are both used.
+		computeHashBatch(passwords, batch, 5);
+		bool passBatch = memcmp(batch, PASSWORD_HASHES, sizeof(batch)) == 0;
+
+		printf(
+			"%-6s    %-10s    %-10s    %-13s    %s\n",
+			BLAKE2B_KERNEL_NAMES[kernel],
+			passA ? "Pass" : "FAIL", passE ? "Pass" : "FAIL", passHash ? "Pass" : "FAIL", passBatch ? "Pass" : "FAIL"
+		);
+		failed += !passA + !passE + !passHash + !passBatch;
+	}
+
+	useBLAKE2bKernel(previous);
+	printf("\n%d test%s failed.\n", failed, failed == 1 ? "" : "s");
+	return failed;
+}
+
+
+int benchHash(void) {
+	const size_t SIZES[6] = { 8, 64, 128, 1024, 16384, 1048576 };
+	unsigned char* data = malloc(SIZES[5]);
+	char** passwords = malloc(1024*sizeof(char*));
+	char* passwordData = malloc(1024*16);
+	u64* hashes = malloc(1024*sizeof(u64));
+	int previous = blake2bKernel;
+	int retval = 0;
+
+	if(data == NULL || passwords == NULL || passwordData == NULL || hashes == NULL) {
+		perror("Error (malloc benchmark)");
+		retval = -4;
+		goto CLEANUP;
+	}
+	selftestSequence(data, SIZES[5], 1);
+	for(int i = 0; i < 1024; ++i) {
+		passwords[i] = passwordData+i*16;
+		sprintf(passwords[i], "Pass%011d", i);
+	}
+
+	printf(
+		"BLAKE2B BENCHMARK\n"
+		"=================\n"
+		"KERNEL       BYTES         MB/s       HASHES/s    CYCLES/BYTE\n"
+	);
+
+	for(int kernel = 0; kernel < BLAKE2B_KERNEL_LENGTH; ++kernel) {
+		if(!isBLAKE2bKernelSupported(kernel)) {
+			continue;
+		}
+		useBLAKE2bKernel(kernel);
+
+		for(int i = 0; i < 6; ++i) {
+			// Repeat until a quarter of a second of CPU time has passed, in rounds of about 1 MiB.
+			int rounds = SIZES[i] >= 1048576 ? 1 : 1048576/SIZES[i];
+			long iterations = 0;
+			unsigned char md[8];
+			clock_t start = clock();
+			u64 startCycles = readCycleCounter();
+			do {
+				for(int r = 0; r < rounds; ++r) {
+					BLAKE2b(md, 8, data, SIZES[i], NULL, 0);
+				}
+				iterations += rounds;
+			} while(clock()-start < CLOCKS_PER_SEC/4);
+			u64 cycles = readCycleCounter()-startCycles;
+			double seconds = (double) (clock()-start)/CLOCKS_PER_SEC;
+
+			printf("%-6s    %8zu    %9.1f    %11.0f    ", BLAKE2B_KERNEL_NAMES[kernel], SIZES[i], iterations*SIZES[i]/seconds/1e6, iterations/seconds);
+			if(cycles != 0) {
+				printf("%11.2f\n", (double) cycles/(iterations*SIZES[i]));
+			} else {
+				printf("%11s\n", "-");
+			}
+		}
+	}
+
+	printf(
+		"\n"
+		"KERNEL    computeHash()/s    computeHashBatch()/s\n"
+	);
+	for(int kernel = 0; kernel < BLAKE2B_KERNEL_LENGTH; ++kernel) {
+		if(!isBLAKE2bKernelSupported(kernel)) {
+			continue;
+		}
+		useBLAKE2bKernel(kernel);
+
+		double rates[2];
+		for(int batch = 0; batch < 2; ++batch) {
+			long iterations = 0;
+			clock_t start = clock();
+			do {
+				if(batch) {
+					computeHashBatch(passwords, hashes, 1024);
+				} else {
+					for(int i = 0; i < 1024; ++i) {
+						hashes[i] = computeHash(passwords[i]);
+					}
+				}
+				iterations += 1024;
+			} while(clock()-start < CLOCKS_PER_SEC/4);
+			rates[batch] = iterations/((double) (clock()-start)/CLOCKS_PER_SEC);
+		}
+		printf("%-6s    %15.0f    %20.0f\n", BLAKE2B_KERNEL_NAMES[kernel], rates[0], rates[1]);
+	}
+
+CLEANUP:
+	useBLAKE2bKernel(previous);
+	free(data);
+	free(passwords);
+	free(passwordData);
+	free(hashes);
+	return retval;
+}
+
+
+void selftestSequence(unsigned char* out, int len, unsigned int seed) {
+	// Fibonacci like sequence, from RFC 7693 Appendix E.
+	unsigned int a = 0xDEAD4BAD * seed;
+	unsigned int b = 1;
+	for(int i = 0; i < len; ++i) {
+		unsigned int t = a+b;
+		a = b;
+		b = t;
+		out[i] = t>>24;
+	}
+}
+
+
+u64 readCycleCounter(void) {
+	#ifdef BLAKE2B_X86
+	return __rdtsc();
+	#else
+	return 0;
+	#endif
+}
+
+
+// Kernel used by crc32c(), NULL until it is selected on first use.
+unsigned int (*crc32cKernel)(unsigned int, const void*, size_t) = NULL;
+
+// Lookup table of crc32cScalar(), filled when the kernel is selected.
+unsigned int crc32cTable[256];
+
+#ifdef STAFF_THREADS
+pthread_once_t crc32cOnce = PTHREAD_ONCE_INIT;
+#endif
+
+
+unsigned int crc32c(unsigned int crc, const void* data, size_t len) {
+	// Workers may compute the first CRC32C concurrently, so the table is filled exactly once before any is computed.
+	#ifdef STAFF_THREADS
+	pthread_once(&crc32cOnce, selectCrc32cKernel);
+	#else
+	if(crc32cKernel == NULL) {
+		selectCrc32cKernel();
+	}
+	#endif
+
+	return ~crc32cKernel(~crc, data, len);
+}
+
+
+void selectCrc32cKernel(void) {
+	for(unsigned int i = 0; i < 256; ++i) {
+		unsigned int entry = i;
+		for(int bit = 0; bit < 8; ++bit) {
+			// 0x82F63B78 is the reversed Castagnoli polynomial.
+			entry = (entry>>1) ^ (0x82F63B78 & -(entry&1));
+		}
+		crc32cTable[i] = entry;
+	}
+
+	crc32cKernel = crc32cScalar;
+	#ifdef BLAKE2B_X86
+	if(__builtin_cpu_supports("sse4.2")) {
+		crc32cKernel = crc32cSSE42;
+	}
+	#endif
+}
+
+
+unsigned int crc32cScalar(unsigned int crc, const void* data, size_t len) {
+	const unsigned char* bytes = data;
+	for(size_t i = 0; i < len; ++i) {
+		crc = (crc>>8) ^ crc32cTable[(crc^bytes[i])&0xFF];
+	}
+	return crc;
+}
+
+
+#ifdef BLAKE2B_X86
+__attribute__((target("sse4.2")))
+unsigned int crc32cSSE42(unsigned int crc, const void* data, size_t len) {
+	const unsigned char* bytes = data;
+
+	#ifdef __x86_64__
+	u64 crc64 = crc;
+	for(; len >= 8; len -= 8, bytes += 8) {
+		// $data may not be aligned.
+		u64 word;
+		memcpy(&word, bytes, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = crc64;
+	#endif
+
+	for(; len > 0; --len, ++bytes) {
+		crc = _mm_crc32_u8(crc, *bytes);
+	}
+	return crc;
+}
+#else
+// Never selected, see crc32c().
+unsigned int crc32cSSE42(unsigned int crc, const void* data, size_t len) {
+	return crc32cScalar(crc, data, len);
+}
+#endif
+
+
+int updateChecksums(int* records, Staff* originals, Staff* written, int len) {
+	int retval = 0;
+	FILE* staffFile = fopen("staff.bin", "rb");
+	FILE* checksumFile = NULL;
+	Staff* page = malloc(CHECKSUM_PAGE_RECORDS*sizeof(Staff));
+	ChecksumHeader header;
+
+	if(staffFile == NULL || fseek(staffFile, 0, SEEK_END) != 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+	if(page == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	long recordCount = ftell(staffFile)/(long) sizeof(Staff);
+
+	// Other terminals wait for the whole update, the header is read and written back.
+	checksumFile = fopen(CHECKSUM_FILE, "rb+");
+	if(
+		checksumFile == NULL ||
+		lockStaff(checksumFile, 0, 0, SL_EXCLUSIVE) != 0 ||
+		fread(&header, sizeof(header), 1, checksumFile) != 1 ||
+		memcmp(header.magic, "SCS1", 4) != 0 ||
+		header.pageRecords != CHECKSUM_PAGE_RECORDS
+	) {
+		// Missing or written with another page size, checksum the whole file instead.
+		free(page);
+		fclose(staffFile);
+		if(checksumFile != NULL) {
+			fclose(checksumFile);
+		}
+		int res = rebuildChecksums();
+		return res != 0 ? res : updateMerkleTree(records, len);
+	}
+
+	// Records are never removed. Do not hide a truncated staff file by checksumming it again.
+	if(header.recordCount > recordCount) {
+		retval = -15;
+		goto CLEANUP;
+	}
+
+	// CRC32C is linear, so overwriting records changes the checksum of their page by the CRC32C of the changed bits
+	// (without the inversions), which is zero for unchanged bytes and follows from the records as they were and as written.
+	int i = 0;
+	for(int end; originals != NULL && i < len && records[i] < header.recordCount; i = end) {
+		int pageIndex = records[i]/CHECKSUM_PAGE_RECORDS;
+		int pageFirst = pageIndex*CHECKSUM_PAGE_RECORDS;
+		int pageLen = header.recordCount-pageFirst < CHECKSUM_PAGE_RECORDS ? header.recordCount-pageFirst : CHECKSUM_PAGE_RECORDS;
+
+		// A record written twice changes by both writes.
+		memset(page, 0, pageLen*sizeof(Staff));
+		int offset = records[i]-pageFirst;
+		for(end = i; end < len && records[end] >= pageFirst && records[end] < pageFirst+pageLen; ++end) {
+			unsigned char* changed = (unsigned char*) &page[records[end]-pageFirst];
+			for(size_t byte = 0; byte < sizeof(Staff); ++byte) {
+				changed[byte] ^= ((unsigned char*) &originals[end])[byte] ^ ((unsigned char*) &written[end])[byte];
+			}
+			offset = records[end]-pageFirst < offset ? records[end]-pageFirst : offset;
+		}
+
+		// Leading zeroes do not change a CRC32C without the inversions.
+		unsigned int checksum;
+		retval = accessPageChecksum(checksumFile, pageIndex, &checksum, false);
+		checksum ^= ~crc32c(~0u, &page[offset], (pageLen-offset)*sizeof(Staff));
+		if(retval != 0 || (retval = accessPageChecksum(checksumFile, pageIndex, &checksum, true)) != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	// Appended records continue the checksum of their page. Appended records already checksummed by another update are skipped.
+	for(; i < len && records[i] < header.recordCount; ++i);
+	unsigned int checksum = 0;
+	for(long record = header.recordCount; record < recordCount; ++record) {
+		int pageIndex = record/CHECKSUM_PAGE_RECORDS;
+		if(record == header.recordCount && record%CHECKSUM_PAGE_RECORDS != 0 && (retval = accessPageChecksum(checksumFile, pageIndex, &checksum, false)) != 0) {
+			goto CLEANUP;
+		}
+
+		Staff* staff = page;
+		if(i < len && records[i] == record) {
+			staff = &written[i++];
+		} else if(fseek(staffFile, record*(long) sizeof(Staff), SEEK_SET) != 0 || freadStaff(page, 1, staffFile) != 1) {
+			retval = -3;
+			goto CLEANUP;
+		}
+		checksum = crc32c(record%CHECKSUM_PAGE_RECORDS == 0 ? 0 : checksum, staff, sizeof(Staff));
+
+		if(((record+1)%CHECKSUM_PAGE_RECORDS == 0 || record+1 == recordCount) && (retval = accessPageChecksum(checksumFile, pageIndex, &checksum, true)) != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	header.recordCount = recordCount;
+	rewind(checksumFile);
+	if(fwrite(&header, sizeof(header), 1, checksumFile) != 1) {
+		retval = -3;
+	}
+
+	// The Merkle tree covers the same pages.
+	if(retval == 0) {
+		retval = updateMerkleTree(records, len);
+	}
+
+CLEANUP:
+	free(page);
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	if(checksumFile != NULL && fclose(checksumFile) == EOF) {
+		retval = -3;
+	}
+	return retval;
+}
+
+
+int rebuildChecksums(void) {
+	int retval = 0;
+	FILE* staffFile = fopen("staff.bin", "rb");
+	FILE* checksumFile = NULL;
+	unsigned int* checksums = NULL;
+	bool* missing = NULL;
+	ChecksumHeader header = { "SCS1", CHECKSUM_PAGE_RECORDS, 0 };
+
+	if(staffFile == NULL || fseek(staffFile, 0, SEEK_END) != 0) {
+		retval = -3;
 		goto CLEANUP;
 	}
-	truncate();
+	header.recordCount = ftell(staffFile)/(long) sizeof(Staff);
+	int pageCount = (header.recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
+
+	checksums = malloc((pageCount > 0 ? pageCount : 1)*sizeof(unsigned int));
+	missing = calloc(pageCount > 0 ? pageCount : 1, sizeof(bool));
+	if(checksums == NULL || missing == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	PageHashJob job = { staffFile, header.recordCount, checksums, NULL, missing, { 0 } };
+	int workers = hashPages(&job);
+	if(workers < 0) {
+		retval = workers;
+		goto CLEANUP;
+	}
+	for(int i = 0; i < pageCount; ++i) {
+		if(missing[i]) {
+			// The staff file was truncated in the meantime.
+			retval = -3;
+			goto CLEANUP;
+		}
+	}
 
-	if(toupper(*buf) == 'N') {
-		printf("\nStaff addition aborted!\n");
-		pause();
-		retval = -2;
+	// The header is written last, so an interrupted rebuild is rebuilt again.
+	checksumFile = fopen(CHECKSUM_FILE, "wb");
+	if(
+		checksumFile == NULL ||
+		fwrite(&(ChecksumHeader) { "", 0, 0 }, sizeof(header), 1, checksumFile) != 1 ||
+		fwrite(checksums, sizeof(unsigned int), pageCount, checksumFile) != (size_t) pageCount
+	) {
+		retval = -3;
 		goto CLEANUP;
 	}
 
-	if(fwrite(&newStaff, sizeof(newStaff), 1, staffFile) == 0) {
-		printf("An error occured while writing to file buffer!\n");
-		pause();
+	rewind(checksumFile);
+	if(fwrite(&header, sizeof(header), 1, checksumFile) != 1) {
 		retval = -3;
-		goto CLEANUP;
 	}
 
 CLEANUP:
-	if(staffFile != NULL && fclose(staffFile) == EOF) {
-		perror("Error (Closing staff file) ");
-		pause();
+	free(checksums);
+	free(missing);
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	if(checksumFile != NULL && fclose(checksumFile) == EOF) {
 		retval = -3;
-	} else if(retval == 0) {
-		printf("New staff details saved successfully!\n");
-		pause();
-		printf("Do you want to add another record? [Y/n]: ");
-
-		if(scanf("%c", buf) == EOF) {
-			retval = EOF;
-		} else {
-			truncate();
-			if(toupper(buf[0]) == 'N') {
-				printf("User chose to not add another record!\n");
-			} else {
-				// Hopefully tail call optimisation is performed...
-				return addStaff();
-			}
-		}
 	}
-
 	return retval;
 }
 
 
-int searchStaff(void) {
+int accessPageChecksum(FILE* checksumFile, int pageIndex, unsigned int* checksum, bool write) {
+	// Seeking also allows switching between reading and writing the file.
+	if(
+		fseek(checksumFile, sizeof(ChecksumHeader) + pageIndex*sizeof(*checksum), SEEK_SET) != 0 ||
+		(write ? fwrite(checksum, sizeof(*checksum), 1, checksumFile) : fread(checksum, sizeof(*checksum), 1, checksumFile)) != 1
+	) {
+		return -3;
+	}
+	return 0;
+}
+
+
+int verifyChecksums(void) {
 	int retval = 0;
 	FILE* staffFile = fopen("staff.bin", "rb");
-	Staff* staffArr = NULL;
-	char* matches = NULL;
-	char** matchesPtr = NULL;
-
-	if(staffFile == NULL) {
+	FILE* checksumFile = NULL;
+	unsigned int* checksums = NULL;
+	unsigned int* actual = NULL;
+	bool* mismatched = NULL;
+	ChecksumHeader header;
+
+	printf(
+		"VERIFY STAFF FILE\n"
+		"=================\n"
+	);
+
+	if(staffFile == NULL || fseek(staffFile, 0, SEEK_END) != 0) {
 		perror("Error (Opening staff file)");
-		pause();
-		retval = 1;
+		retval = -3;
 		goto CLEANUP;
 	}
+	long recordCount = ftell(staffFile)/(long) sizeof(Staff);
 
-	// Read whole file to memory.
-	if(fseek(staffFile, 0, SEEK_END) != 0) {
-		perror("Error (fseek)");
-		pause();
+	checksumFile = fopen(CHECKSUM_FILE, "rb");
+	if(checksumFile != NULL && lockStaff(checksumFile, 0, 0, SL_SHARED) != 0) {
+		perror("Error (Locking page checksums)");
 		retval = -3;
 		goto CLEANUP;
 	}
-
-	int len = ftell(staffFile);
-	rewind(staffFile); // Resets file cursor after fseek()-ed.
-
-	if(len == -1L) {
-		perror("Error (ftell)");
-		pause();
-		retval = -3;
+	if(checksumFile == NULL) {
+		printf("No page checksums found, creating them from the staff file as it is.\n");
+		retval = rebuildChecksums();
+		if(retval != 0) {
+			perror("Error (Creating page checksums)");
+		}
+		goto CLEANUP;
+	}
+	if(
+		fread(&header, sizeof(header), 1, checksumFile) != 1 ||
+		memcmp(header.magic, "SCS1", 4) != 0 ||
+		header.pageRecords != CHECKSUM_PAGE_RECORDS ||
+		header.recordCount < 0
+	) {
+		printf("Page checksums are corrupted or unfinished, delete %s to create them again.\n", CHECKSUM_FILE);
+		retval = 1;
 		goto CLEANUP;
 	}
 
-	staffArr = malloc(len);
-	if(staffArr == NULL) {
-		perror("Error (malloc)");
-		pause();
+	int pageCount = (header.recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
+	checksums = malloc((pageCount > 0 ? pageCount : 1)*sizeof(unsigned int));
+	actual = malloc((pageCount > 0 ? pageCount : 1)*sizeof(unsigned int));
+	mismatched = calloc(pageCount > 0 ? pageCount : 1, sizeof(bool));
+	if(checksums == NULL || actual == NULL || mismatched == NULL) {
+		perror("Error (malloc checksums)");
 		retval = -4;
 		goto CLEANUP;
 	}
+	if(fread(checksums, sizeof(unsigned int), pageCount, checksumFile) != (size_t) pageCount) {
+		printf("Page checksums are truncated, delete %s to create them again.\n", CHECKSUM_FILE);
+		retval = 1;
+		goto CLEANUP;
+	}
 
-	if(fread(staffArr, len, 1, staffFile) != 1) {
-		perror("Error (fread)");
-		pause();
-		retval = -3;
+	// Hash the pages as they are now, the pages that can not be read whole mismatch.
+	PageHashJob job = { staffFile, header.recordCount, actual, NULL, mismatched, { 0 } };
+	int workers = hashPages(&job);
+	if(workers < 0) {
+		retval = workers;
+		perror(retval == -4 ? "Error (malloc checksums)" : "Error (Reading staff file)");
 		goto CLEANUP;
 	}
-	rewind(staffFile);
+	for(int i = 0; i < pageCount; ++i) {
+		mismatched[i] = mismatched[i] || actual[i] != checksums[i];
+	}
 
-	// Set up array to keep matches.
-	#define ID_SIZE 6
+	for(int i = 0; i < pageCount; ++i) {
+		if(mismatched[i]) {
+			long first = (long) i*CHECKSUM_PAGE_RECORDS;
+			long last = first+CHECKSUM_PAGE_RECORDS > header.recordCount ? header.recordCount : first+CHECKSUM_PAGE_RECORDS;
+			printf("Page %d (records %ld to %ld) does not match its checksum!\n", i, first+1, last);
+			++retval;
+		}
+	}
+	if(recordCount != header.recordCount) {
+		printf(
+			"Staff file has %ld records, but the checksums cover %d records! (%s)\n",
+			recordCount, header.recordCount, recordCount < header.recordCount ? "Truncated" : "Unchecked records appended"
+		);
+		++retval;
+	}
 
-	DisplayStaffOptions opt = displayStaffOptionsInit();
+	TaskPoolStats stats;
+	getTaskPoolStats(&stats);
+	printf("%d pages (%d records) verified with %d worker%s, %d problem%s found.\n", pageCount, header.recordCount, workers, workers == 1 ? "" : "s", retval, retval == 1 ? "" : "s");
+	if(stats.workers > 1) {
+		printf("Task pool: %d workers, %ld jobs split into %ld tasks, %ld tasks stolen.\n", stats.workers, stats.jobs, stats.tasks, stats.steals);
+	}
 
-	int curCapacity = 128;
-	// NOTE: Code that determines if a record should be inserted depends on each string being ID_SIZE-d, please change the code if this has changed.
-	matches = malloc(ID_SIZE*curCapacity);
-	matchesPtr = malloc(curCapacity*sizeof(char*));
+CLEANUP:
+	free(checksums);
+	free(actual);
+	free(mismatched);
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	if(checksumFile != NULL) {
+		fclose(checksumFile);
+	}
+	return retval;
+}
 
-	if(matches == NULL) {
-		perror("Error (malloc $matches)");
-		pause();
-		retval = -4;
-		goto CLEANUP;
+
+void hashPagesTask(void* arg, int worker, long first, long count) {
+	PageHashJob* job = arg;
+	if(job->retval[worker] != 0) {
+		// The job already failed.
+		return;
 	}
-	if(matchesPtr == NULL) {
-		perror("Error (malloc $matchesPtr)");
-		pause();
-		retval = -4;
-		goto CLEANUP;
+
+	Staff* chunk = malloc(STAFF_STREAM_CHUNK*sizeof(Staff));
+	if(chunk == NULL) {
+		job->retval[worker] = -4;
+		return;
 	}
 
-	// Include all during first print.
-	for(int i = 0; i < len/(int)sizeof(Staff); ++i) {
-		if(!isStaffDeleted(staffArr[i])) {
-			// XXX: Assuming matches is ID_SIZE sized.
-			strcpy(&matches[opt.idListLen++*6], staffArr[i].id);
+	// Pages are read a chunk at a time, $STAFF_STREAM_CHUNK is a multiple of the page size.
+	// Every chunk is read at its offset and locked on its own, like in reportTask().
+	long record = first*CHECKSUM_PAGE_RECORDS;
+	long end = (first+count)*CHECKSUM_PAGE_RECORDS;
+	if(end > job->recordCount) {
+		end = job->recordCount;
+	}
+	while(record < end) {
+		int want = end-record < STAFF_STREAM_CHUNK ? end-record : STAFF_STREAM_CHUNK;
+		if(lockStaff(job->staffFile, record, want, SL_SHARED) != 0) {
+			job->retval[worker] = -3;
+			break;
+		}
+		int read = preadStaff(job->staffFile, chunk, record, want);
+		lockStaff(job->staffFile, record, want, SL_UNLOCK);
+
+		for(int i = 0; i < want; i += CHECKSUM_PAGE_RECORDS) {
+			long pageIndex = (record+i)/CHECKSUM_PAGE_RECORDS;
+			int pageLen = want-i < CHECKSUM_PAGE_RECORDS ? want-i : CHECKSUM_PAGE_RECORDS;
+
+			if(i+pageLen > read) {
+				job->missing[pageIndex] = true;
+				continue;
+			}
+			if(job->checksums != NULL) {
+				job->checksums[pageIndex] = crc32c(0, &chunk[i], pageLen*sizeof(Staff));
+			}
+			if(job->leaves != NULL) {
+				hashMerkleLeaf(&job->leaves[pageIndex*MERKLE_DIGEST_BYTES], &chunk[i], pageLen);
+			}
+		}
+		if(read < want) {
+			// Mark the rest of the range, it is past the end of the staff file.
+			for(long pageIndex = (record+want)/CHECKSUM_PAGE_RECORDS; pageIndex < first+count; ++pageIndex) {
+				job->missing[pageIndex] = true;
+			}
+			break;
 		}
+		record += want;
 	}
-	int* matchesLen = &opt.idListLen;
 
-	for(int i = 0; i < curCapacity; ++i) {
-		// XXX: Assuming matches is ID_SIZE sized.
-		matchesPtr[i] = matches+i*ID_SIZE;
+	free(chunk);
+}
+
+
+int hashPages(PageHashJob* job) {
+	long pageCount = (job->recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
+	int workers = parallelFor(pageCount, HASH_TASK_PAGES, hashPagesTask, job);
+
+	for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+		if(job->retval[i] != 0) {
+			return job->retval[i];
+		}
 	}
-	opt.idList = matchesPtr;
-	opt.displayList[SE_NAME] = true;
-	opt.displayList[SE_ID] = true;
-	opt.displayList[SE_POSITION] = true;
-	opt.displayList[SE_PHONE] = true;
-	opt.displayList[SE_IC] = true;
+	return workers;
+}
 
-	opt.isInteractive = false;
 
-	char buf[STAFF_BUF_MAX];
+#ifdef STAFF_THREADS
+// Task pool shared by every parallelFor() job, started on first use.
+TaskPool taskPool;
+pthread_once_t taskPoolOnce = PTHREAD_ONCE_INIT;
+#endif
 
-	while(1) {
-		cls();
-		printf(
-			"SEARCH STAFF\n"
-			"============\n"
-		);
-		displaySelectedStaff(&opt);
+int parallelFor(long count, long grain, void (*body)(void* arg, int worker, long first, long count), void* arg) {
+	if(count <= 0) {
+		return 1;
+	}
+	if(grain < 1) {
+		grain = 1;
+	}
 
-		printf(
-			"(Enter ':h' for help.)\n"
-			"(Enter ':q' for quit.)\n"
-			"(Field[!/+/-]=Query): "
-		);
-		int res;
-		res = scanf("%127[^=\n]", buf);
-		getchar(); // Consume newline or equal character.
-		// truncate() not needed anymore.
+	#ifdef STAFF_THREADS
+	if(count > grain) {
+		pthread_once(&taskPoolOnce, startTaskPool);
+	}
+	// One job runs at a time. Jobs started meanwhile (e.g. by other terminals of the staff daemon) run on their calling
+	// thread instead of waiting for it, those threads are busy anyway.
+	if(count > grain && taskPool.workers > 1 && pthread_mutex_trylock(&taskPool.run) == 0) {
+		TaskPool* pool = &taskPool;
+
+		pthread_mutex_lock(&pool->lock);
+		pool->body = body;
+		pool->arg = arg;
+		pool->grain = grain;
+		pool->remaining = count;
+		++pool->jobs;
+		pthread_mutex_unlock(&pool->lock);
+
+		// The calling thread is worker 0, the whole range starts in its deque.
+		// runPoolTasks() only returns once every task is finished.
+		pushPoolTask(0, (PoolTask) { 0, count });
+		runPoolTasks(0);
+
+		pthread_mutex_unlock(&pool->run);
+		return pool->workers;
+	}
+	#endif
 
-		if(res == EOF) {
-			retval = EOF;
-			goto CLEANUP;
-		}
+	body(arg, 0, 0, count);
+	return 1;
+}
 
-		// toupper $buf.
-		int i = 0;
-		while(buf[i]) {
-			buf[i] = toupper(buf[i]);
-			++i;
+
+void getTaskPoolStats(TaskPoolStats* stats) {
+	*stats = (TaskPoolStats) { 1, 0, 0, 0 };
+	#ifdef STAFF_THREADS
+	pthread_once(&taskPoolOnce, startTaskPool);
+	pthread_mutex_lock(&taskPool.lock);
+	*stats = (TaskPoolStats) { taskPool.workers, taskPool.jobs, taskPool.tasks, taskPool.steals };
+	pthread_mutex_unlock(&taskPool.lock);
+	#endif
+}
+
+
+#ifdef STAFF_THREADS
+void startTaskPool(void) {
+	TaskPool* pool = &taskPool;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int workers = cpus < 1 ? 1 : (cpus > POOL_THREADS_MAX ? POOL_THREADS_MAX : cpus);
+
+	pthread_mutex_init(&pool->run, NULL);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	for(int i = 0; i < workers; ++i) {
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+		pool->deques[i].seed = 2654435761u*(i+1);
+	}
+
+	// Workers are numbered in order, stop at the first thread that fails to start.
+	pool->workers = 1;
+	for(int i = 1; i < workers; ++i) {
+		if(pthread_create(&pool->threads[i], NULL, poolWorker, &pool->deques[i]) != 0) {
+			break;
 		}
+		++pool->workers;
+	}
+}
 
-		enum StaffModifiableFields field = -1;
 
-		// Checks if user wants to invert search.
-		bool invertSearch = false;
-		if(buf[strlen(buf)-1] == '!' && buf[0] != ':') {
-			invertSearch = true;
-			buf[strlen(buf)-1] = 0;
+void* poolWorker(void* arg) {
+	TaskPool* pool = &taskPool;
+	int worker = (PoolDeque*) arg - pool->deques;
+
+	while(1) {
+		// Sleep between jobs.
+		pthread_mutex_lock(&pool->lock);
+		while(pool->remaining == 0) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
 		}
+		pthread_mutex_unlock(&pool->lock);
 
-		// Checks if user wants to append.
-		bool appendSearch = false;
-		if(buf[strlen(buf)-1] == '+') {
-			appendSearch = true;
-			buf[strlen(buf)-1] = 0;
+		runPoolTasks(worker);
+	}
+	return NULL;
+}
+
+
+void runPoolTasks(int worker) {
+	TaskPool* pool = &taskPool;
+	PoolTask task;
+	bool stolen;
+
+	while(nextPoolTask(worker, &task, &stolen)) {
+		// Split the task in halves down to the grain, the upper halves can be stolen in the meantime.
+		while(task.count > pool->grain && pushPoolTask(worker, (PoolTask) { task.first+task.count/2, task.count-task.count/2 })) {
+			task.count /= 2;
+		}
+		pool->body(pool->arg, worker, task.first, task.count);
+
+		pthread_mutex_lock(&pool->lock);
+		++pool->tasks;
+		pool->steals += stolen;
+		pool->remaining -= task.count;
+		if(pool->remaining == 0) {
+			// Release the idle workers.
+			pthread_cond_broadcast(&pool->wake);
 		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
 
-		// Checks if user wants to remove matches.
-		bool removeSearch = false;
-		if(buf[strlen(buf)-1] == '-') {
-			removeSearch = true;
-			buf[strlen(buf)-1] = 0;
+
+bool nextPoolTask(int worker, PoolTask* task, bool* stolen) {
+	TaskPool* pool = &taskPool;
+	PoolDeque* self = &pool->deques[worker];
+
+	while(1) {
+		*stolen = false;
+		pthread_mutex_lock(&self->lock);
+		bool taken = self->bottom != self->top;
+		if(taken) {
+			*task = self->tasks[--self->bottom%POOL_DEQUE_MAX];
+		}
+		pthread_mutex_unlock(&self->lock);
+		if(taken) {
+			return true;
 		}
 
-		if(buf[0] == ':') {
-			if(buf[1] == 'Q' || buf[1] == 'W') {
-				retval = -2;
-				goto CLEANUP;
-			} else if(buf[1] == 'H') {
-				cls();
-				printf(
-					"Help\n"
-					"====\n"
-					"  Type in field name and search query to search.\n"
-					"  The search query may contain special characters such as:\n"
-					"    '%%' to match zero or more characters.\n"
-					"    '_' to match any character.\n"
-					"  Actions:\n"
-					"    $FIELD=$QUERY  (Display staffs that match with $QUERY.)\n"
-					"    $FIELD!=$QUERY (Display staffs that does not match with $QUERY.)\n"
-					"    $FIELD+=$QUERY (Append staffs that match with $QUERY to display list.)\n"
-					"    $FIELD-=$QUERY (Remove staffs that match with $QUERY in display list.)\n"
-					"    :h             (Help.)\n"
-					"    :q             (Quit.)\n"
-					"    :n             (Next page.)\n"
-					"    :b             (Go back a page.)\n"
-					"  Examples:\n"
-					"    Name=J%%\n"
-					"    (This searches for any name that starts with a capital 'J'.)\n"
-					"    Phone!=01%%\n"
-					"    (This searches for any phone that does not starts with '01'.)\n\n"
-				);
-				pause();
-			} else if(buf[1] == 'N') {
-				++opt.page;
-			} else if(buf[1] == 'B') {
-				--opt.page;
-			} else {
-				printf("Invalid control code!\n");
-				pause();
+		// Tasks pushed from now on wake this worker up, even if they are pushed before it sleeps.
+		pthread_mutex_lock(&pool->lock);
+		long pushes = pool->pushes;
+		pthread_mutex_unlock(&pool->lock);
+
+		// Steal from a random victim first, then from the others in turn.
+		self->seed ^= self->seed<<13;
+		self->seed ^= self->seed>>17;
+		self->seed ^= self->seed<<5;
+		int start = self->seed%pool->workers;
+		for(int i = 0; i < pool->workers; ++i) {
+			int victim = (start+i)%pool->workers;
+			if(victim == worker) {
+				continue;
+			}
+
+			PoolDeque* deque = &pool->deques[victim];
+			pthread_mutex_lock(&deque->lock);
+			taken = deque->bottom != deque->top;
+			if(taken) {
+				*task = deque->tasks[deque->top++%POOL_DEQUE_MAX];
+			}
+			pthread_mutex_unlock(&deque->lock);
+			if(taken) {
+				*stolen = true;
+				return true;
 			}
-			continue;
-		} else if(strcmp(buf, "ID") == 0) {
-			field = SE_ID;
-		} else if(strcmp(buf, "NAME") == 0) {
-			field = SE_NAME;
-		} else if(strcmp(buf, "POSITION") == 0) {
-			field = SE_POSITION;
-		} else if(strcmp(buf, "PHONE") == 0) {
-			field = SE_PHONE;
-		} else if(strcmp(buf, "IC") == 0) {
-			field = SE_IC;
-		} else {
-			printf("Entered field does not match any of the field!\n");
-			pause();
-			continue;
 		}
 
-		// Replace buffer again with search query.
-		if(scanf("%127[^\n]", buf) == EOF) {
-			retval = EOF;
-			goto CLEANUP;
+		// Nothing to steal, sleep until a task is pushed or the job is finished.
+		pthread_mutex_lock(&pool->lock);
+		while(pool->remaining > 0 && pool->pushes == pushes) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
 		}
-		truncate();
+		bool finished = pool->remaining == 0;
+		pthread_mutex_unlock(&pool->lock);
+		if(finished) {
+			return false;
+		}
+	}
+}
+
 
+bool pushPoolTask(int worker, PoolTask task) {
+	TaskPool* pool = &taskPool;
+	PoolDeque* deque = &pool->deques[worker];
 
-		// Will only enter here if a field is matched.
+	pthread_mutex_lock(&deque->lock);
+	bool pushed = deque->bottom-deque->top < POOL_DEQUE_MAX;
+	if(pushed) {
+		deque->tasks[deque->bottom++%POOL_DEQUE_MAX] = task;
+	}
+	pthread_mutex_unlock(&deque->lock);
 
-		int queryLen = strlen(buf);
+	if(pushed) {
+		pthread_mutex_lock(&pool->lock);
+		++pool->pushes;
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return pushed;
+}
+#endif
 
-		if(!appendSearch && !removeSearch) {
-			*matchesLen = 0; // Reset to zero since it's not adding or removing from the search.
-		}
 
-		for(int i = 0; i < (int) (len/sizeof(Staff)); ++i) {
-			if(!isStaffDeleted(staffArr[i])) {
-				char* text = "";
+int updateMerkleTree(int* records, int len) {
+	int retval = 0;
+	FILE* staffFile = fopen("staff.bin", "rb");
+	FILE* merkleFile = NULL;
+	Staff* page = malloc(CHECKSUM_PAGE_RECORDS*sizeof(Staff));
+	MerkleHeader header;
 
-				switch(field) {
-					case SE_ID:
-						text = staffArr[i].id;
-						break;
-					case SE_NAME:
-						text = staffArr[i].details.name;
-						break;
-					case SE_POSITION:
-						text = staffArr[i].details.position;
-						break;
-					case SE_PHONE:
-						text = staffArr[i].details.phone;
-						break;
-					case SE_IC:
-						text = staffArr[i].details.ic;
-						break;
-					default:
-						retval = -15;
-						break;
-				}
+	if(staffFile == NULL || fseek(staffFile, 0, SEEK_END) != 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+	if(page == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	long recordCount = ftell(staffFile)/(long) sizeof(Staff);
+	long pageCount = (recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
 
-				bool insert = !invertSearch;
-				if(LIKE(text, buf, true)) {
-					if(appendSearch || removeSearch) {
-						for(int ii = 0; ii < *matchesLen; ++ii) {
-							if(strcmp(matchesPtr[ii], staffArr[i].id) == 0) {
-								if(removeSearch) {
-									if(ii+1 != *matchesLen) {
-										// XXX: Making the assumption each ID is ID_SIZE and no larger or smaller.
-										// Please change this if the size of string has changed.
-										// Using the same idea as deleteStaff();
-										strcpy(matchesPtr[ii], matchesPtr[*matchesLen-1]);
-									}
-									--*matchesLen; // SAFETY: $matchesLen is guaranteed to be positive non-zero here.
-								}
-								// Skips appending if it's a duplicate.
-								insert = false;
-								break;
-							}
-						}
-						if(removeSearch) {
-							insert = false;
-						}
-					}
-				} else {
-					insert = invertSearch;
-				}
+	// Missing, written with another page size, or too small for the appended pages.
+	merkleFile = openMerkleTree(MERKLE_FILE, "rb+", &header);
+	if(merkleFile == NULL || header.pageRecords != CHECKSUM_PAGE_RECORDS || pageCount > header.capacity) {
+		free(page);
+		fclose(staffFile);
+		if(merkleFile != NULL) {
+			fclose(merkleFile);
+		}
+		return rebuildMerkleTree();
+	}
 
-				if(insert) {
-					if(*matchesLen == curCapacity) {
-						curCapacity *= 2;
-						matches = realloc(matches, curCapacity*ID_SIZE);
-						matchesPtr = realloc(matchesPtr, curCapacity*sizeof(char*));
-						opt.idList = matchesPtr;
+	if(header.recordCount > recordCount) {
+		retval = -15;
+		goto CLEANUP;
+	}
 
-						if(matches == NULL || matchesPtr == NULL) {
-							perror("Error (realloc)");
-							pause();
-							retval = -4;
-							goto CLEANUP;
-						} else {
-							// $matches may have moved to another location, so start again from 0.
-							for(int i = 0; i < curCapacity; ++i) {
-								matchesPtr[i] = matches + i*ID_SIZE;
-							}
-						}
-					}
-					strcpy(matchesPtr[(*matchesLen)++], staffArr[i].id);
-				}
-			}
+	// Leaves of the overwritten records, then every leaf with appended records.
+	int firstAppended = header.recordCount/CHECKSUM_PAGE_RECORDS;
+	int lastPage = -1;
+	for(int i = 0; i < len; ++i) {
+		int pageIndex = records[i]/CHECKSUM_PAGE_RECORDS;
+		if(pageIndex == lastPage || pageIndex >= firstAppended) {
+			continue;
 		}
-		buf[queryLen] = 0;
+		lastPage = pageIndex;
+
+		retval = updateMerkleLeaf(staffFile, merkleFile, page, header.capacity, pageIndex);
+		if(retval != 0) {
+			goto CLEANUP;
+		}
+	}
+	for(int pageIndex = firstAppended; pageIndex < pageCount; ++pageIndex) {
+		retval = updateMerkleLeaf(staffFile, merkleFile, page, header.capacity, pageIndex);
+		if(retval != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	header.recordCount = recordCount;
+	rewind(merkleFile);
+	if(fwrite(&header, sizeof(header), 1, merkleFile) != 1) {
+		retval = -3;
 	}
 
 CLEANUP:
-	#undef ID_SIZE
+	free(page);
 	if(staffFile != NULL) {
 		fclose(staffFile);
 	}
-	free(staffArr);
-	free(matches);
-	free(matchesPtr);
+	if(merkleFile != NULL && fclose(merkleFile) == EOF) {
+		retval = -3;
+	}
 	return retval;
 }
 
 
-int modifyStaff(void) {
+int rebuildMerkleTree(void) {
 	int retval = 0;
-	int numModified = 0;
-	FILE* staffFile = fopen("staff.bin", "rb+");
-	
-	if(staffFile == NULL) {
-		perror("Error (Opening staff file)");
-		pause();
+	FILE* staffFile = fopen("staff.bin", "rb");
+	FILE* merkleFile = NULL;
+	unsigned char* nodes = NULL;
+	bool* missing = NULL;
+	MerkleHeader header = { "SMT1", CHECKSUM_PAGE_RECORDS, 0, 1 };
+
+	if(staffFile == NULL || fseek(staffFile, 0, SEEK_END) != 0) {
 		retval = -3;
 		goto CLEANUP;
 	}
+	header.recordCount = ftell(staffFile)/(long) sizeof(Staff);
+	long pageCount = (header.recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
+	while(header.capacity < pageCount) {
+		header.capacity *= 2;
+	}
 
-	Staff chosenStaff;
-	
-	char buf[STAFF_BUF_MAX];
-	char id[6];
-
-	while(1) {
-		cls();
-		printf(
-			"MODIFY STAFF\n"
-			"============\n"
-		);
-	
-		printf("Type a staff ID to modify their staff details or ':q' to quit.\n\n");
-		int res = promptStaffDetails(id, SE_ID);
-		if(res == EOF) {
-			retval = EOF;
-			goto CLEANUP;
-		}
-
-		if(res == -2) {
-			printf("Staff modification aborted!\n");
-			pause();
-			retval = -2;
-			goto CLEANUP;
-		}
-
-		// Search for matching records.
-		bool found = false;
-		while(fread(&chosenStaff, sizeof(Staff), 1, staffFile) != 0) {
-			if(strcmp(chosenStaff.id, id) == 0 && !isStaffDeleted(chosenStaff)) {
-				found = true;
-				break;
-			}
-		}
+	// Leaves past the last page stay zeroed.
+	nodes = calloc(2*header.capacity, MERKLE_DIGEST_BYTES);
+	missing = calloc(pageCount > 0 ? pageCount : 1, sizeof(bool));
+	if(nodes == NULL || missing == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
 
-		int curFilePos = ftell(staffFile); // Records current location to start writing modified record later from here (and rewind back a record).
-		if(curFilePos == -1) {
-			perror("Error (ftell)");
+	// The leaves are hashed by the task pool, the internal nodes are few enough to hash here.
+	PageHashJob job = { staffFile, header.recordCount, NULL, &nodes[header.capacity*MERKLE_DIGEST_BYTES], missing, { 0 } };
+	int workers = hashPages(&job);
+	if(workers < 0) {
+		retval = workers;
+		goto CLEANUP;
+	}
+	for(long i = 0; i < pageCount; ++i) {
+		if(missing[i]) {
+			// The staff file was truncated in the meantime, the next update rebuilds it.
 			retval = -3;
 			goto CLEANUP;
 		}
-		rewind(staffFile);
-		
-		if(found) {
-			while(true) {
-				cls();
-				printf(
-					"MODIFY STAFF\n"
-					"============\n"
-					"ID       : %s\n"
-					"Name     : %s\n"
-					"Position : %s\n"
-					"Phone    : %s\n"
-					"IC       : %s\n\n"
-					"(Enter ':h' for help.)\n"
-					"(Enter ':q' for quit.)\n"
-					"(Enter ':w' for save.)\n"
-					"(Field=Value): ",
-					chosenStaff.id, chosenStaff.details.name, chosenStaff.details.position, chosenStaff.details.phone, chosenStaff.details.ic
-				);
-				scanf("%127[^=\n]", buf);
-				getchar(); // consume equal sign or newline.
-				// truncate() not needed anymore if newline.
-
-				// toupper() for string.
-				int i = 0;
-				while(buf[i]) {
-					buf[i] = toupper(buf[i]);
-					++i;
-				}
+	}
 
-				int res = 0;
-				if(strcmp(buf, "ID") == 0) {
-					res = promptStaffDetails(buf, ~SE_ID);
-					if(res == 0) {
-						bool exists = false;
-						while(fread(&chosenStaff, sizeof(Staff), 1, staffFile)) {
-							if(!isStaffDeleted(chosenStaff) && strcmp(chosenStaff.id, buf) == 0) {
-								exists = true;
-								break;
-							}
-						}
-						rewind(staffFile);
+	for(int node = header.capacity-1; node >= 1; --node) {
+		hashMerkleNode(&nodes[node*MERKLE_DIGEST_BYTES], &nodes[node*2*MERKLE_DIGEST_BYTES]);
+	}
 
-						if(exists) {
-							printf("A staff with the same ID exists!\n");
-							pause();
-						} else {
-							strcpy(chosenStaff.id, buf);
-						}
-					}
-				} else if(strcmp(buf, "NAME") == 0) {
-					res = promptStaffDetails(buf, ~SE_NAME);
-					if(res == 0) {
-						strcpy(chosenStaff.details.name, buf);
-					}
-				} else if(strcmp(buf, "POSITION") == 0) {
-					res = promptStaffDetails(buf, ~SE_POSITION);
-					if(res == 0) {
-						strcpy(chosenStaff.details.position, buf);
-					}
-				} else if(strcmp(buf, "PHONE") == 0) {
-					res = promptStaffDetails(buf, ~SE_PHONE);
-					if(res == 0) {
-						strcpy(chosenStaff.details.phone, buf);
-					}
-				} else if(strcmp(buf, "IC") == 0) {
-					res = promptStaffDetails(buf, ~SE_IC);
-					if(res == 0) {
-						strcpy(chosenStaff.details.ic, buf);
-					}
-				} else if(buf[0] == ':') {
-					// String is in uppercase.
-					if(buf[1] == 'Q') {
-						res = -2;
-					} else if(buf[1] == 'W') {
-						break;
-					} else if(buf[1] == 'H') {
-						cls();
-						printf(
-							"Help\n"
-							"====\n"
-							"  Type in field and value to replace to modify.\n"
-							"  Actions:\n"
-							"    $FIELD=$VALUE (Modify the value of $FIELD.)\n"
-							"    :h            (Help.)\n"
-							"    :q            (Abort modifications.)\n"
-							"    :w            (Save modifications.)\n"
-							"  Example:\n"
-							"    Name=John Smith\n\n"
-						);
-						pause();
-						continue;
-					} else {
-						printf("Invalid control code!\n");
-						pause();
-						continue;
-					}
-				} else {
-					printf("Entered field does not match any of the fields!\n");
-					pause();
-					continue;
-				}
+	merkleFile = fopen(MERKLE_FILE, "wb");
+	if(
+		merkleFile == NULL ||
+		fwrite(&header, sizeof(header), 1, merkleFile) != 1 ||
+		fwrite(nodes, MERKLE_DIGEST_BYTES, 2*header.capacity, merkleFile) != (size_t) 2*header.capacity
+	) {
+		retval = -3;
+		goto CLEANUP;
+	}
 
-				if(res == EOF) {
-					retval = EOF;
-					goto CLEANUP;
-				} else if(res == -2) {
-					printf("Are you sure you want to abort? [y/N]: ");
-					res = scanf("%c", buf);
-					truncate();
+CLEANUP:
+	free(nodes);
+	free(missing);
+	if(staffFile != NULL) {
+		fclose(staffFile);
+	}
+	if(merkleFile != NULL && fclose(merkleFile) == EOF) {
+		retval = -3;
+	}
+	if(retval != 0) {
+		// Never leave a tree that does not match the staff file behind.
+		remove(MERKLE_FILE);
+	}
+	return retval;
+}
 
-					if(res == EOF) {
-						retval = EOF;
-						goto CLEANUP;
-					} else if(toupper(buf[0]) == 'Y') {
-						retval = -2;
-						goto CLEANUP;
-					}
-				} else if(res == -14) {
-					// Add pause to see what error message was printed.
-					pause();
-				}
-			}
 
-			printf("Are you sure you want to save this staff's details? [Y/n]: ");
-			if(scanf("%c", buf) == EOF) {
-				retval = EOF;
-			}
-			truncate();
+int updateMerkleLeaf(FILE* staffFile, FILE* merkleFile, Staff* page, int capacity, int pageIndex) {
+	if(fseek(staffFile, (long) pageIndex*CHECKSUM_PAGE_RECORDS*sizeof(Staff), SEEK_SET) != 0) {
+		return -3;
+	}
+	int read = freadStaff(page, CHECKSUM_PAGE_RECORDS, staffFile);
+	if(read == 0) {
+		return -3;
+	}
 
-			if(toupper(buf[0]) == 'N') {
-				printf("Modify operation aborted!\n");
-				pause();
-				break;
-			} else {
-				// Go back one entry, since current pointer is at the end of the current Staff{}.
-				fseek(staffFile, curFilePos-sizeof(Staff), SEEK_SET);
-				fwrite(&chosenStaff, sizeof(Staff), 1, staffFile);
-				++numModified;
-				break;
-			}
-		} else {
-			printf("Staff ID entered does not match any records!\n");
-			pause();
+	// Write the leaf, then rehash each ancestor from its children.
+	unsigned char nodes[2*MERKLE_DIGEST_BYTES];
+	int node = capacity+pageIndex;
+	hashMerkleLeaf(nodes, page, read);
+	while(1) {
+		if(
+			fseek(merkleFile, sizeof(MerkleHeader) + (long) node*MERKLE_DIGEST_BYTES, SEEK_SET) != 0 ||
+			fwrite(nodes, MERKLE_DIGEST_BYTES, 1, merkleFile) != 1
+		) {
+			return -3;
+		}
+		if(node == 1) {
+			return 0;
 		}
+
+		node /= 2;
+		if(
+			fseek(merkleFile, sizeof(MerkleHeader) + (long) node*2*MERKLE_DIGEST_BYTES, SEEK_SET) != 0 ||
+			fread(nodes, 2*MERKLE_DIGEST_BYTES, 1, merkleFile) != 1
+		) {
+			return -3;
+		}
+		hashMerkleNode(nodes, nodes);
 	}
+}
 
-CLEANUP:
-	#undef ID_SIZE
-	if(staffFile != NULL && fclose(staffFile) != 0) {
-		perror("Error (Closing staff file, file data might not be saved)");
-		pause();
-		return -3;
-	} else if(numModified != 0) {
-		printf("Staff data modified successfully!\n");
-		pause();
+
+void hashMerkleLeaf(unsigned char* digest, Staff* page, int len) {
+	BLAKE2bContext ctx;
+	BLAKE2bInit(&ctx, MERKLE_DIGEST_BYTES, NULL, 0);
+	BLAKE2bUpdate(&ctx, "\x00", 1);
+	BLAKE2bUpdate(&ctx, page, len*sizeof(Staff));
+	BLAKE2bFinal(&ctx, digest);
+}
+
+
+void hashMerkleNode(unsigned char* digest, unsigned char* children) {
+	// $digest may be $children, so hash into a separate buffer first.
+	unsigned char node[MERKLE_DIGEST_BYTES];
+	BLAKE2bContext ctx;
+	BLAKE2bInit(&ctx, MERKLE_DIGEST_BYTES, NULL, 0);
+	BLAKE2bUpdate(&ctx, "\x01", 1);
+	BLAKE2bUpdate(&ctx, children, 2*MERKLE_DIGEST_BYTES);
+	BLAKE2bFinal(&ctx, node);
+	memcpy(digest, node, MERKLE_DIGEST_BYTES);
+}
+
+
+FILE* openMerkleTree(char* path, char* mode, MerkleHeader* header) {
+	FILE* merkleFile = fopen(path, mode);
+
+	if(merkleFile == NULL) {
+		return NULL;
 	}
-	return retval;
+	// Lock the whole file until it is closed, so the tree is not read while another terminal updates it.
+	if(
+		lockStaff(merkleFile, 0, 0, strcmp(mode, "rb") == 0 ? SL_SHARED : SL_EXCLUSIVE) != 0 ||
+		fread(header, sizeof(MerkleHeader), 1, merkleFile) != 1 ||
+		memcmp(header->magic, "SMT1", 4) != 0 ||
+		header->pageRecords <= 0 ||
+		header->recordCount < 0 ||
+		header->capacity <= 0 ||
+		(header->capacity & (header->capacity-1)) != 0 ||
+		(header->recordCount+header->pageRecords-1)/header->pageRecords > header->capacity
+	) {
+		fclose(merkleFile);
+		return NULL;
+	}
+	return merkleFile;
 }
 
 
-int displayStaff(void) {
-	DisplayStaffOptions s = displayStaffOptionsInit();
-	s.header =
-		"DISPLAY STAFF\n"
-		"=============\n";
-	s.displayList[SE_ID] = true;
-	s.displayList[SE_NAME] = true;
-	s.displayList[SE_POSITION] = true;
-	s.displayList[SE_PHONE] = true;
-	s.displayList[SE_IC] = true;
-	s.isInclude = false;
+int printMerkleRoot(void) {
+	MerkleHeader header;
+	unsigned char root[MERKLE_DIGEST_BYTES];
+	FILE* merkleFile = openMerkleTree(MERKLE_FILE, "rb", &header);
 
-	int res = displaySelectedStaff(&s);
-	return res < 0 ? res : 0;
+	if(merkleFile == NULL) {
+		int res = rebuildMerkleTree();
+		if(res != 0) {
+			perror("Error (Creating Merkle tree)");
+			return res;
+		}
+		merkleFile = openMerkleTree(MERKLE_FILE, "rb", &header);
+	}
+	if(
+		merkleFile == NULL ||
+		fseek(merkleFile, sizeof(MerkleHeader) + MERKLE_DIGEST_BYTES, SEEK_SET) != 0 ||
+		fread(root, MERKLE_DIGEST_BYTES, 1, merkleFile) != 1
+	) {
+		perror("Error (Reading Merkle tree)");
+		if(merkleFile != NULL) {
+			fclose(merkleFile);
+		}
+		return -3;
+	}
+	fclose(merkleFile);
+
+	for(int i = 0; i < MERKLE_DIGEST_BYTES; ++i) {
+		printf("%02x", root[i]);
+	}
+	printf("  %d records, %d records per page\n", header.recordCount, header.pageRecords);
+	return 0;
 }
 
 
-int reportStaff(void) {
+int diffMerkleTree(char* path) {
 	int retval = 0;
-	FILE* staffFile = fopen("staff.bin", "rb");
+	MerkleHeader ourHeader;
+	MerkleHeader theirHeader;
+	FILE* ours = openMerkleTree(MERKLE_FILE, "rb", &ourHeader);
+	FILE* theirs = openMerkleTree(path, "rb", &theirHeader);
 
-	if(staffFile == NULL) {
-		perror("Error (opening staff file)");
-		pause();
+	if(ours == NULL) {
+		printf("%s is missing or corrupted, run --merkle-root to create it.\n", MERKLE_FILE);
+		retval = -3;
+		goto CLEANUP;
+	}
+	if(theirs == NULL) {
+		printf("%s is missing or not a Merkle tree!\n", path);
+		retval = -3;
+		goto CLEANUP;
+	}
+	if(ourHeader.pageRecords != CHECKSUM_PAGE_RECORDS || theirHeader.pageRecords != CHECKSUM_PAGE_RECORDS) {
+		printf("Merkle trees have different page sizes and cannot be compared!\n");
 		retval = -3;
 		goto CLEANUP;
 	}
 
-	DisplayStaffOptions s = displayStaffOptionsInit();
-	s.header =
-		"REPORT STAFF\n"
-		"============\n";
-	s.displayList[SE_ID] = true;
-	s.displayList[SE_NAME] = true;
-	s.displayList[SE_POSITION] = true;
-	s.displayList[SE_PHONE] = true;
-	s.displayList[SE_IC] = true;
-	s.displayDeleted = true;
-	s.displayExisting = true;
-	s.isInclude = false;
+	int recordCount = ourHeader.recordCount > theirHeader.recordCount ? ourHeader.recordCount : theirHeader.recordCount;
+	int pageCount = (recordCount+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS;
 
-	int res = displaySelectedStaff(&s);
-	if(res < 0) {
-		retval = res;
-		goto CLEANUP;
+	// The smaller tree covers the same pages as the leftmost subtree of the larger tree with the same number of leaves.
+	// Pages past the smaller tree only exist in the larger staff file.
+	int span = ourHeader.capacity < theirHeader.capacity ? ourHeader.capacity : theirHeader.capacity;
+	retval = diffMerkleNodes(ours, theirs, ourHeader.capacity/span, theirHeader.capacity/span, 0, span, recordCount);
+	if(retval >= 0 && pageCount > span) {
+		printf(
+			"Pages %d to %d (records %ld to %d) only exist in %s!\n",
+			span, pageCount-1, (long) span*CHECKSUM_PAGE_RECORDS+1, recordCount,
+			ourHeader.recordCount > theirHeader.recordCount ? "staff.bin" : path
+		);
+		retval += pageCount-span;
+	}
+
+	if(retval == 0) {
+		printf("Staff file matches %s.\n", path);
+	} else if(retval > 0) {
+		printf("%d page%s differ%s.\n", retval, retval == 1 ? "" : "s", retval == 1 ? "s" : "");
+	} else {
+		perror("Error (Reading Merkle tree)");
 	}
 
 CLEANUP:
-	if(staffFile != NULL) {
-		fclose(staffFile);
+	if(ours != NULL) {
+		fclose(ours);
+	}
+	if(theirs != NULL) {
+		fclose(theirs);
 	}
 	return retval;
 }
 
 
-int deleteStaff(void) {
+int diffMerkleNodes(FILE* ours, FILE* theirs, int ourNode, int theirNode, int firstPage, int span, int recordCount) {
+	unsigned char ourDigest[MERKLE_DIGEST_BYTES];
+	unsigned char theirDigest[MERKLE_DIGEST_BYTES];
+
+	if((long) firstPage*CHECKSUM_PAGE_RECORDS >= recordCount) {
+		// Only zeroed leaves from here.
+		return 0;
+	}
+	if(
+		fseek(ours, sizeof(MerkleHeader) + (long) ourNode*MERKLE_DIGEST_BYTES, SEEK_SET) != 0 ||
+		fread(ourDigest, MERKLE_DIGEST_BYTES, 1, ours) != 1 ||
+		fseek(theirs, sizeof(MerkleHeader) + (long) theirNode*MERKLE_DIGEST_BYTES, SEEK_SET) != 0 ||
+		fread(theirDigest, MERKLE_DIGEST_BYTES, 1, theirs) != 1
+	) {
+		return -3;
+	}
+	if(memcmp(ourDigest, theirDigest, MERKLE_DIGEST_BYTES) == 0) {
+		return 0;
+	}
+
+	if(span == 1) {
+		long last = (long) (firstPage+1)*CHECKSUM_PAGE_RECORDS;
+		printf("Page %d (records %ld to %ld) differs!\n", firstPage, (long) firstPage*CHECKSUM_PAGE_RECORDS+1, last < recordCount ? last : recordCount);
+		return 1;
+	}
+
+	int left = diffMerkleNodes(ours, theirs, ourNode*2, theirNode*2, firstPage, span/2, recordCount);
+	if(left < 0) {
+		return left;
+	}
+	int right = diffMerkleNodes(ours, theirs, ourNode*2+1, theirNode*2+1, firstPage+span/2, span/2, recordCount);
+	return right < 0 ? right : left+right;
+}
+
+
+#ifdef STAFF_DAEMON
+// Socket connected to the staff daemon, -1 if it is not running, -2 until useStaffDaemon() first connects.
+int staffDaemonFd = -2;
+
+// Whether $staffDaemonFd is logged in with SR_LOGIN.
+bool staffDaemonLoggedIn = false;
+
+// Set by stopStaffDaemon() to stop serveStaff().
+volatile sig_atomic_t staffDaemonStopped = 0;
+#endif
+
+
+int serveStaff(void) {
+	#ifdef STAFF_DAEMON
 	int retval = 0;
-	FILE* staffFile = fopen("staff.bin", "rb+");
-	Staff* staffArr = NULL;
-	
-	if(staffFile == NULL) {
-		perror("Error (Opening staff file)");
-		pause();
+	StaffTable table = { 0 };
+	StaffClient clients[DAEMON_CLIENTS_MAX];
+	int clientCount = 0;
+	int done[2] = { -1, -1 };
+	int listener = -1;
+	bool bound = false;
+
+	if(pipe(done) != 0) {
+		perror("Error (pipe)");
+		return -3;
+	}
+	for(int i = 0; i < DAEMON_CLIENTS_MAX; ++i) {
+		clients[i].table = &table;
+		clients[i].client = -1;
+		clients[i].reader = i;
+		clients[i].done = done[1];
+	}
+
+	// Refuse to serve twice. The daemon itself reads and writes the staff file directly.
+	if(useStaffDaemon()) {
+		printf("The staff daemon is already running!\n");
+		close(staffDaemonFd);
+		staffDaemonFd = -1;
 		retval = -3;
 		goto CLEANUP;
 	}
 
-	int size = -1;
-	if(fseek(staffFile, 0, SEEK_END) != 0) {
-		// fseek failed.
-		perror("Error (fseek failed) ");
-		pause();
-	} else {
-		size = ftell(staffFile);
-		rewind(staffFile);
-	}
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, STAFF_SOCKET, sizeof(address.sun_path)-1);
 
-	int arrCapacity = size;
-	if(size == -1) {
-		// fseek failed. Set a default size for malloc().
-		// Allocate memory that can fit 128 entries of Staff{}. (26KiB)
-		arrCapacity = 128;
+	// Nothing listens on the socket file, it was left behind by a daemon that was killed.
+	unlink(STAFF_SOCKET);
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener == -1 || bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0) {
+		perror("Error (Binding staff socket)");
+		retval = -3;
+		goto CLEANUP;
+	}
+	bound = true;
+	if(listen(listener, DAEMON_CLIENTS_MAX) != 0) {
+		perror("Error (Listening on staff socket)");
+		retval = -3;
+		goto CLEANUP;
 	}
-	staffArr = malloc(arrCapacity*sizeof(Staff));
 
-	int len = 0;
-	if(staffArr == NULL) {
-		// malloc() failed.
-		perror("Error (malloc failed)");
-		retval = -4;
+	retval = loadStaffTable(&table);
+	if(retval != 0) {
+		perror(retval == -4 ? "Error (malloc)" : "Error (Reading staff file)");
 		goto CLEANUP;
-	} else if(size != -1) {
-		// malloc() suceeded and fseek suceeded.
-		fread(staffArr, 1, size, staffFile);
-		len = size/sizeof(Staff);
-	} else {
-		// malloc() suceeded but fseek failed.
-		while(fread(staffArr+len, sizeof(Staff), 1, staffFile) == 1) {
-			if(++len > arrCapacity) {
-				arrCapacity *= 2;
-				staffArr = realloc(staffArr, arrCapacity*sizeof(Staff));
-
-				if(staffArr == NULL) {
-					perror("Error (realloc failed)");
-					retval = -4;
-					goto CLEANUP;
+	}
+
+	signal(SIGINT, stopStaffDaemon);
+	signal(SIGTERM, stopStaffDaemon);
+	printf("Serving %d staff records on %s. (Press Ctrl+C to stop.)\n", table.current->length, STAFF_SOCKET);
+	fflush(stdout);
+
+	// The client threads block the stop signals, so they interrupt poll() here.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+
+	struct pollfd fds[2] = { { listener, POLLIN, 0 }, { done[0], POLLIN, 0 } };
+	while(!staffDaemonStopped) {
+		// Leave new terminals waiting in the listen queue while every slot is taken.
+		fds[0].events = clientCount < DAEMON_CLIENTS_MAX ? POLLIN : 0;
+		if(poll(fds, 2, -1) == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			perror("Error (poll)");
+			retval = -3;
+			break;
+		}
+
+		if(fds[1].revents & POLLIN) {
+			// A client disconnected, its thread already released its pins.
+			int reader;
+			if(read(done[0], &reader, sizeof(reader)) == sizeof(reader)) {
+				pthread_join(clients[reader].thread, NULL);
+				close(clients[reader].client);
+				clients[reader].client = -1;
+				--clientCount;
+			}
+		}
+
+		if(fds[0].revents & POLLIN) {
+			int client = accept(listener, NULL, NULL);
+			if(client != -1) {
+				int reader = 0;
+				while(clients[reader].client != -1) {
+					++reader;
+				}
+
+				sigset_t previous;
+				clients[reader].client = client;
+				pthread_sigmask(SIG_BLOCK, &signals, &previous);
+				if(pthread_create(&clients[reader].thread, NULL, serveStaffClient, &clients[reader]) == 0) {
+					++clientCount;
+				} else {
+					perror("Error (pthread_create)");
+					close(client);
+					clients[reader].client = -1;
 				}
+				pthread_sigmask(SIG_SETMASK, &previous, NULL);
 			}
 		}
 	}
-	rewind(staffFile);
+	printf("Staff daemon stopped.\n");
 
-	// Limit delete amount.
-	// $ENTRIES_PER_PAGE + 1 to store user prompt.
-	// $ID_SIZE + 1 to check for overflows.
-	// $ID_SIZE + 1 to store exclamation mark.
-	#define ID_SIZE 6
-	char deleteListData[ENTRIES_PER_PAGE+1][ID_SIZE+2];
-	// Create another array that contains the address of each string.
-	char* deleteList[ENTRIES_PER_PAGE+1];
-	for(int i = 0; i < ENTRIES_PER_PAGE+1; ++i) {
-		deleteList[i] = &deleteListData[i][0];
+CLEANUP:
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	for(int i = 0; i < DAEMON_CLIENTS_MAX; ++i) {
+		if(clients[i].client != -1) {
+			// Wake the thread up from waiting for a request.
+			shutdown(clients[i].client, SHUT_RDWR);
+			pthread_join(clients[i].thread, NULL);
+			close(clients[i].client);
+		}
+	}
+	if(listener != -1) {
+		close(listener);
 	}
+	if(bound) {
+		unlink(STAFF_SOCKET);
+	}
+	close(done[0]);
+	close(done[1]);
+	freeStaffTable(&table);
+	return retval;
+	#else
+	printf("The staff daemon is only supported on Unix!\n");
+	return -3;
+	#endif
+}
 
 
-	// Options for staff selected for delete.
-	DisplayStaffOptions delOpt = displayStaffOptionsInit();
-	delOpt.idList = deleteList;
-	delOpt.displayList[SE_ID] = true;
-	delOpt.displayList[SE_NAME] = true;
-	delOpt.isInteractive = false;
+void stopStaffDaemon(int sig) {
+	(void) sig;
+	#ifdef STAFF_DAEMON
+	staffDaemonStopped = 1;
+	#endif
+}
 
-	int* listCursor = &delOpt.idListLen;
 
-	// Options for staff remaining that have not been chosen for deletion.
-	DisplayStaffOptions disOpt = displayStaffOptionsInit();
-	disOpt.idList = deleteList;
-	disOpt.displayList[SE_ID] = true;
-	disOpt.displayList[SE_NAME] = true;
-	disOpt.isInclude = false;
-	disOpt.isInteractive = false;
+#ifdef STAFF_DAEMON
+void* serveStaffClient(void* arg) {
+	StaffClient* client = arg;
+	StaffTable* table = client->table;
 
-	while(1) {
-		cls();
-		printf(
-			"DELETE STAFF\n"
-			"============\n"
-		);
+	int session = -1;	// Logged in staff of the connection.
+	while(serveStaffRequest(table, client->client, client->reader, &session) == 0);
+
+	pthread_mutex_lock(&table->lock);
+	releaseStaffPins(table, client->client);
+	pthread_mutex_unlock(&table->lock);
+
+	// serveStaff() joins the thread and closes the socket.
+	if(write(client->done, &client->reader, sizeof(client->reader)) != sizeof(client->reader)) {
+		perror("Error (Writing to pipe)");
+	}
+	return NULL;
+}
+
+
+int serveStaffRequest(StaffTable* table, int client, int reader, int* session) {
+	StaffMessage request;
+	if(recvAll(client, &request, sizeof(request)) != 0 || request.length < 0 || request.length > DAEMON_REQUEST_MAX) {
+		return -3;
+	}
+
+	char* payload = NULL;
+	if(request.length > 0) {
+		payload = malloc(request.length);
+		if(payload == NULL || recvAll(client, payload, request.length) != 0) {
+			free(payload);
+			return -3;
+		}
+	}
+
+	// Minimum payload length of every request, indexed with StaffRequests.
+	const int minLength[] = { 0, 6, sizeof(StaffLogin), sizeof(StaffCount), 0, sizeof(StaffRead), sizeof(int), sizeof(Staff), sizeof(StaffModification), 0, sizeof(StaffUpdate), sizeof(StaffQuery) };
+
+	StaffMessage reply = { 0, 0 };
+	if(request.op < 0 || request.op >= (int) (sizeof(minLength)/sizeof(*minLength)) || request.length < minLength[request.op]) {
+		reply.op = -18;
+		free(payload);
+		return sendAll(client, &reply, sizeof(reply));
+	}
+
+	StaffView* view = NULL;	// The published view, read by the lookups.
+	StaffView* next = NULL;	// The view published after a change.
+	if(request.op <= SR_COUNT) {
+		view = enterStaffView(table, reader);
+
+		// Without $STAFF_STAT, statStaffFile() seeks the staff file, so only the writers (holding the lock) check it.
+		#ifdef STAFF_STAT
+		StaffFileStamp stamp;
+		if(statStaffFile(table->staffFile, &stamp) == 0 && memcmp(&stamp, &view->stamp, sizeof(stamp)) != 0) {
+			// Another program wrote the staff file, reload it first. (A failed reload serves the stale view)
+			leaveStaffView(table, reader);
+			pthread_mutex_lock(&table->lock);
+			refreshStaffTable(table);
+			pthread_mutex_unlock(&table->lock);
+			view = enterStaffView(table, reader);
+		}
+		#endif
+	} else {
+		pthread_mutex_lock(&table->lock);
+		reply.op = refreshStaffTable(table);
+		if(reply.op == 0 && request.op != SR_UNPIN && (*session < 0 || *session >= table->current->length || isStaffDeleted(*staffTableRecord(table->current, *session)))) {
+			// Not logged in, or the staff was deleted since.
+			reply.op = -19;
+		} else if(reply.op == 0 && request.op >= SR_ADD) {
+			// Allocate the next view first, so the change is always published.
+			next = malloc(sizeof(StaffView));
+			if(next == NULL || unshareStaffIds(table) != 0) {
+				reply.op = -4;
+			}
+		}
+	}
+
+	StaffVersion* current = view != NULL ? view->version : table->current;
+	const void* out = NULL;	// Reply payload.
+	void* allocated = NULL;	// Reply payload to free after replying.
+	int value;				// Reply payload of the requests replying an int.
+	StaffRecord found;		// Reply payload of SR_FIND.
+	StaffSnapshot snapshot;	// Reply payload of SR_PIN.
+
+	if(reply.op == 0) switch(request.op) {
+		case SR_PING:
+			break;
+		case SR_FIND:
+			payload[5] = '\0';
+			found.record = staffViewFind(view, payload, false);
+			if(found.record < 0) {
+				reply.op = -15;
+			} else {
+				found.staff = *staffTableRecord(current, found.record);
+				if(*session < 0) {
+					// Only the existence of the staff is known to the login screen.
+					found.staff.passHash = ~0ull;
+				}
+				out = &found;
+				reply.length = sizeof(found);
+			}
+			break;
+		case SR_LOGIN: {
+			StaffLogin* login = (StaffLogin*) payload;
+			login->id[5] = '\0';
+			int record = staffViewFind(view, login->id, false);
+			if(record < 0) {
+				reply.op = -15;
+			} else if(staffTableRecord(current, record)->passHash != login->passHash) {
+				reply.op = -16;
+			}
+			*session = reply.op == 0 ? record : -1;
+			break;
+		}
+		case SR_COUNT: {
+			StaffCount* count = (StaffCount*) payload;
+			StaffQuery* query = &count->query;
+			query->pattern[STAFF_BUF_MAX-1] = '\0';
+
+			if(query->field < 0) {
+				value = view->idLength;
+				if(count->limit > 0 && value > count->limit) {
+					value = count->limit;
+				}
+			} else if(query->field == SE_ID && !query->invert && strcspn(query->pattern, "%_") == strlen(query->pattern)) {
+				// ID checks are answered from the ID index.
+				value = staffViewFind(view, query->pattern, true) >= 0;
+			} else if(count->limit <= 0) {
+				// Full counts are split between the workers of the task pool.
+				StaffCountJob job = { current, query, { 0 }, NULL, { 0 } };
+				parallelFor((current->length+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS, HASH_TASK_PAGES, countPagesTask, &job);
+				value = 0;
+				for(int i = 0; i < POOL_THREADS_MAX; ++i) {
+					value += job.counts[i];
+				}
+			} else {
+				value = 0;
+				for(int i = 0; i < current->length && value < count->limit; i += CHECKSUM_PAGE_RECORDS) {
+					int len = current->length-i < CHECKSUM_PAGE_RECORDS ? current->length-i : CHECKSUM_PAGE_RECORDS;
+					value += countStaffArray(staffTableRecord(current, i), staffTableFolded(current, i), len, query, count->limit-value);
+				}
+			}
+			out = &value;
+			reply.length = sizeof(value);
+			break;
+		}
+		case SR_PIN:
+			reply.op = pinStaffVersion(table, client);
+			if(reply.op == 0) {
+				snapshot = (StaffSnapshot) { current->id, current->length };
+				out = &snapshot;
+				reply.length = sizeof(snapshot);
+			}
+			break;
+		case SR_READ: {
+			StaffRead* read = (StaffRead*) payload;
+			int pin = findStaffPin(table, client, read->version);
+			if(pin == -1 || read->first < 0 || read->count < 0) {
+				reply.op = -18;
+				break;
+			}
+
+			// Copy the records out of the pages into one reply.
+			StaffVersion* version = table->pins[pin].version;
+			int len = read->count < STAFF_STREAM_CHUNK ? read->count : STAFF_STREAM_CHUNK;
+			if(read->first >= version->length) {
+				len = 0;
+			} else if(len > version->length-read->first) {
+				len = version->length-read->first;
+			}
+			Staff* records = malloc(len*sizeof(Staff)+1);
+			if(records == NULL) {
+				reply.op = -4;
+				break;
+			}
+			for(int i = 0; i < len; ++i) {
+				records[i] = *staffTableRecord(version, read->first+i);
+			}
+			out = allocated = records;
+			reply.length = len*sizeof(Staff);
+			break;
+		}
+		case SR_UNPIN: {
+			int pin = findStaffPin(table, client, *(int*) payload);
+			if(pin == -1) {
+				reply.op = -18;
+			} else {
+				unpinStaffVersion(table, pin);
+			}
+			break;
+		}
+		case SR_ADD: {
+			int count = request.length/sizeof(Staff);
+			Staff* staffArr = (Staff*) payload;
+			int* records = malloc(count*sizeof(int));
+			allocated = records;
+			if(records == NULL) {
+				reply.op = -4;
+				break;
+			}
+
+			// Append and index every staff with a new ID first, in the order sent, so they are written at once.
+			int first = table->current->length;
+			int appendedLen = 0;
+			for(int i = 0; reply.op == 0 && i < count; ++i) {
+				Staff* staff = &staffArr[i];
+				staff->id[5] = '\0';
+				if(staffTableFind(table, staff->id) >= 0) {
+					// Also an earlier staff of the request.
+					records[i] = -16;
+					continue;
+				}
 
-		if(*listCursor > 0) {
-			printf(
-				"Delete List:\n"
-				"------------\n"
-			);
+				int record = first+appendedLen;
+				Staff* appended = staffTableUpdate(table, record);
+				if(appended == NULL) {
+					reply.op = -4;
+					break;
+				}
+				*appended = *staff;
+				foldStaff(staffTableFolded(table->current, record), appended);
+				reply.op = staffTableIndex(table, record);
+				if(reply.op != 0) {
+					break;
+				}
 
-			// Auto discard value if it's invalid or repeaated.
-			int displayed = displaySelectedStaff(&delOpt);
-			// In case where listCuror is at max and should not be incresed.
-			if(displayed < *listCursor) {
-				*listCursor = displayed;
+				// The appended staff are moved to the front, for the checksums.
+				staffArr[appendedLen++] = *appended;
+				records[i] = record;
 			}
 
-			if(*listCursor == 0) {
-				// Reprint again since table is empty.
-				continue;
-			} else if(*listCursor < 0) {
-				retval = *listCursor;
-				goto CLEANUP;
+			// Nothing is deleted, the departure index only moves on past the write. (See addDepartures())
+			StaffFileStamp before;
+			bool stamped = fflush(table->staffFile) != EOF && statStaffFile(table->staffFile, &before) == 0;
+			if(reply.op == 0 && appendedLen > 0) {
+				reply.op = staffTableWrite(table, first, appendedLen);
 			}
-			putchar('\n');
+			if(reply.op != 0) {
+				// Unindex in reverse, which never fails right after indexing them. Then drop the records, and the pages appended for them.
+				StaffVersion* version = table->current;
+				for(int i = appendedLen-1; i >= 0; --i) {
+					staffTableUnindex(table, first+i);
+				}
+				version->length = first;
+				while(version->pageLength > (version->length+CHECKSUM_PAGE_RECORDS-1)/CHECKSUM_PAGE_RECORDS) {
+					StaffPage* page = version->pages[--version->pageLength];
+					if(--page->refs == 0) {
+						free(page);
+					}
+				}
+				break;
+			}
+
+			int* appendedRecords = malloc(appendedLen*sizeof(int)+1);
+			for(int i = 0; appendedRecords != NULL && i < appendedLen; ++i) {
+				appendedRecords[i] = first+i;
+			}
+			if(appendedLen > 0 && (appendedRecords == NULL || updateChecksums(appendedRecords, NULL, staffArr, appendedLen) != 0)) {
+				perror("Error (Updating page checksums)");
+			}
+			free(appendedRecords);
+			if(appendedLen > 0 && stampStaffIdIndex(table->staffFile, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating staff ID index)");
+			}
+			if(appendedLen > 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating departure index)");
+			}
+			out = records;
+			reply.length = count*sizeof(int);
+			break;
 		}
+		case SR_MODIFY: {
+			int count = request.length/sizeof(StaffModification);
+			StaffModification* modifications = (StaffModification*) payload;
+			if(count == 0) {
+				reply.op = -18;
+				break;
+			}
+			int* statuses = malloc(count*sizeof(int));
+			int* applied = malloc(count*sizeof(int));	// Indexes of the modifications applied to the table.
+			int* records = malloc(count*sizeof(int));
+			Staff* originals = malloc(count*sizeof(Staff));
+			Staff* modified = malloc(count*sizeof(Staff));
+			allocated = statuses;
+			if(statuses == NULL || applied == NULL || records == NULL || originals == NULL || modified == NULL) {
+				free(applied);
+				free(records);
+				free(originals);
+				free(modified);
+				reply.op = -4;
+				break;
+			}
 
-		printf(
-			"Employee List:\n"
-			"--------------\n"
-		);
+			// The new IDs are checked against the IDs before the request first, like the staff file is without the daemon,
+			// so two staff can not swap or pass on their IDs in one request.
+			for(int i = 0; i < count; ++i) {
+				modifications[i].modified.id[5] = '\0';
+				int other = staffTableFind(table, modifications[i].modified.id);
+				statuses[i] = other >= 0 && other != modifications[i].record ? -16 : 0;
+			}
 
-		disOpt.idListLen = *listCursor;
-		int res = displaySelectedStaff(&disOpt);
-		if(res < 0) {
-			retval = res;
-			goto CLEANUP;
-		}
+			// Apply every modification to the table first, in the order sent. (Sorted by record, see saveStaffModifications())
+			int appliedLen = 0;
+			for(int i = 0; i < count; ++i) {
+				StaffModification* modification = &modifications[i];
+				int record = modification->record;
+				// The password can not be modified, which also keeps the staff from being marked as deleted.
+				modification->modified.passHash = modification->original.passHash;
+
+				if(record < 0 || record >= table->current->length) {
+					statuses[i] = -18;
+				} else if(memcmp(staffTableRecord(table->current, record), &modification->original, sizeof(Staff)) != 0) {
+					statuses[i] = -17;
+				} else if(statuses[i] == 0) {
+					// Also given to an earlier staff of the request.
+					int other = staffTableFind(table, modification->modified.id);
+					statuses[i] = other >= 0 && other != record ? -16 : 0;
+				}
+				Staff* staff = statuses[i] == 0 ? staffTableUpdate(table, record) : NULL;
+				if(staff == NULL) {
+					statuses[i] = statuses[i] == 0 ? -4 : statuses[i];
+					continue;
+				}
 
-		printf(
-			"(Enter ':h' for help.)\n"
-			"(Enter ':q' for help.)\n"
-			"Enter command: "
-		);
+				// Index the staff again under its new ID. If that fails, it is indexed under its old ID again, which never fails.
+				bool renamed = strcmp(modification->modified.id, staff->id) != 0 && !isStaffDeleted(*staff);
+				if(renamed && staffTableUnindex(table, record) != 0) {
+					statuses[i] = -4;
+					continue;
+				}
+				*staff = modification->modified;
+				foldStaff(staffTableFolded(table->current, record), staff);
+				if(renamed && staffTableIndex(table, record) != 0) {
+					*staff = modification->original;
+					foldStaff(staffTableFolded(table->current, record), staff);
+					staffTableIndex(table, record);
+					statuses[i] = -4;
+					continue;
+				}
+				applied[appliedLen++] = i;
+			}
 
-		res = scanf("%7s", deleteList[*listCursor]);
+			// Terminals without the daemon find the staff under its new ID through the staff ID index, indexed before writing.
+			StaffIdIndexHeader header;
+			FILE* indexFile = NULL;
+			for(int i = 0; i < appliedLen; ++i) {
+				if(strcmp(modifications[applied[i]].modified.id, modifications[applied[i]].original.id) != 0) {
+					indexFile = openStaffIdIndex(table->staffFile, &header, NULL);
+					if(indexFile == NULL || indexStaffIds(table->staffFile, indexFile, &header, modifications, statuses, count) != 0) {
+						perror("Error (Updating staff ID index)");
+					}
+					break;
+				}
+			}
 
-		if(res == EOF) {
-			retval = EOF;
-			goto CLEANUP;
+			// Write every run of adjacent records at once, then sync the staff file once.
+			StaffFileStamp before;
+			bool stamped = fflush(table->staffFile) != EOF && statStaffFile(table->staffFile, &before) == 0;
+			int written = 0;
+			for(int i = 0, end; i < appliedLen; i = end) {
+				int first = modifications[applied[i]].record;
+				for(end = i+1; end < appliedLen && modifications[applied[end]].record == first+end-i; ++end);
+				if(staffTableWrite(table, first, end-i) != 0) {
+					perror("Error (Writing staff file)");
+					for(int ii = i; ii < end; ++ii) {
+						StaffModification* modification = &modifications[applied[ii]];
+						bool renamed = strcmp(modification->modified.id, modification->original.id) != 0 && !isStaffDeleted(modification->original);
+						if(renamed && staffTableUnindex(table, modification->record) != 0) {
+							// Other changes since may need more pages, reload the table from the staff file instead.
+							memset(&table->stamp, 0, sizeof(table->stamp));
+							renamed = false;
+						}
+						Staff* staff = staffTableUpdate(table, modification->record);
+						if(staff == NULL) {
+							// The table keeps the modified staff, reload it from the staff file instead.
+							memset(&table->stamp, 0, sizeof(table->stamp));
+							statuses[applied[ii]] = -4;
+							continue;
+						}
+						*staff = modification->original;
+						foldStaff(staffTableFolded(table->current, modification->record), staff);
+						if(renamed && staffTableIndex(table, modification->record) != 0) {
+							memset(&table->stamp, 0, sizeof(table->stamp));
+						}
+						statuses[applied[ii]] = -3;
+					}
+					continue;
+				}
+
+				for(int ii = i; ii < end; ++ii) {
+					StaffModification* modification = &modifications[applied[ii]];
+					originals[written] = modification->original;
+					modified[written] = *staffTableRecord(table->current, modification->record);
+					records[written++] = modification->record;
+				}
+			}
+			if(indexFile != NULL) {
+				fclose(indexFile);
+			}
+			if(written > 0 && syncStaff(table->staffFile) != 0) {
+				perror("Error (Syncing staff file)");
+			}
+			if(written > 0 && stampStaffIdIndex(table->staffFile, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating staff ID index)");
+			}
+			if(written > 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating departure index)");
+			}
+			if(written > 0 && updateChecksums(records, originals, modified, written) != 0) {
+				perror("Error (Updating page checksums)");
+			}
+			free(applied);
+			free(records);
+			free(originals);
+			free(modified);
+
+			out = statuses;
+			reply.length = count*sizeof(int);
+			break;
 		}
-		truncate();
+		case SR_DELETE: {
+			int count = request.length/6;
+			char (*ids)[6] = (char (*)[6]) payload;
+			int* records = malloc(count*sizeof(int)+1);
+			allocated = records;
+			if(records == NULL) {
+				reply.op = -4;
+				break;
+			}
 
-		// Check for overflow.
-		int inputLen = strlen(deleteList[*listCursor]);
-		if(deleteList[*listCursor][0] == '!' ? inputLen > ID_SIZE : inputLen > ID_SIZE-1) {
-			printf("Please enter a valid ID!\n");
-			pause();
-			continue;
+			// Find every staff first, so they are deleted in file order. IDs of staff already deleted are not found, and skipped.
+			int found = 0;
+			for(int i = 0; i < count; ++i) {
+				ids[i][5] = '\0';
+				int record = staffTableFind(table, ids[i]);
+				if(record >= 0) {
+					records[found++] = record;
+				}
+			}
+			qsort(records, found, sizeof(int), compareRecord);
+
+			out = records;
+			reply.length = staffTableDelete(table, records, found)*sizeof(int);
+			break;
 		}
+		case SR_PURGE: {
+			StaffQuery* queries = (StaffQuery*) payload;
+			int queriesLen = request.length/sizeof(StaffQuery);
+			for(int i = 0; i < queriesLen; ++i) {
+				queries[i].pattern[sizeof(queries[i].pattern)-1] = '\0';
+			}
 
-		// Check if it's numbers only.
-		bool isNumber = true;
-		for(char* i = deleteList[*listCursor]; *i; ++i) {
-			if(*i < '0' || *i > '9') {
-				isNumber = false;
+			// The queries are matched while holding the lock, so a staff changed since the client last read it is matched as it is now.
+			int* records = NULL;
+			int found = 0;
+			int capacity = 0;
+			for(int record = 0; record < table->current->length; ++record) {
+				if(!matchStaffQueries(staffTableRecord(table->current, record), staffTableFolded(table->current, record), queries, queriesLen)) {
+					continue;
+				}
+				if(found == capacity) {
+					capacity = capacity == 0 ? STAFF_STREAM_CHUNK : capacity*2;
+					int* grown = realloc(records, capacity*sizeof(int));
+					if(grown == NULL) {
+						reply.op = -4;
+						break;
+					}
+					records = grown;
+				}
+				records[found++] = record;
+			}
+			allocated = records;
+			if(reply.op != 0) {
 				break;
 			}
-		}
 
-		int selected = -1;
-		if(isNumber && atoi(deleteList[*listCursor]) <= len) {
-			selected = atoi(deleteList[*listCursor]);
-		}
-		if(selected == 0) {
-			selected = -1;
+			out = records;
+			reply.length = staffTableDelete(table, records, found)*sizeof(int);
+			break;
 		}
-
-		if(deleteListData[*listCursor][0] == ':') {
-			if(toupper(deleteListData[*listCursor][1]) == 'W') {
+		case SR_UPDATE: {
+			StaffUpdate* update = (StaffUpdate*) payload;
+			StaffQuery* queries = (StaffQuery*) (payload+sizeof(StaffUpdate));
+			int queriesLen = (request.length-sizeof(StaffUpdate))/sizeof(StaffQuery);
+			if(update->fields[SE_ID]) {
+				reply.op = -18;
 				break;
-			} else if(toupper(deleteListData[*listCursor][1]) == 'Q') {
-				retval = -2;
-				goto CLEANUP;
-			} else if(toupper(deleteListData[*listCursor][1]) == 'H') {
-				cls();
-				printf(
-					"HELP\n"
-					"====\n"
-					"  Enter a staff's ID to put it into delete list.\n"
-					"  Prefix a staff ID with an exclamation mark to remove it from delete list.\n"
-					"  Actions:\n"
-					"    S0001  (Insert to delete list.)\n"
-					"    !S0001 (Remove from delete list.)\n"
-					"    2      (Insert staff on row 2 to delete list.)\n"
-					"    :h     (Help.)\n"
-					"    :b     (Go back a page.)\n"
-					"    :n     (Next page.)\n"
-					"    :w     (Proceed to delete.)\n"
-					"    :q     (Abort delete.)\n\n"
-				);
-				pause();
-				continue;
-			} else if(toupper(deleteListData[*listCursor][1]) == 'N') {
-				// Out of bounds error are handled inside displaySelectedStaff();
-				++disOpt.page;
-			} else if (toupper(deleteListData[*listCursor][1]) == 'B') {
-				// Out of bounds error are handled inside displaySelectedStaff();
-				--disOpt.page;
-			} else {
-				printf("Invalid control code!\n");
-				pause();
 			}
-			continue;
-		} else if(deleteList[*listCursor][0] == '!' && *listCursor > 0) {
-			int i = 0;
-			for(; i < *listCursor; ++i) {
-				if(strcmp(deleteList[i], &deleteList[*listCursor][1]) == 0) {
-					break;
-				}
+			for(int field = 0; field < STAFF_ENUM_LENGTH; ++field) {
+				staffFieldText(&update->values, field)[STAFF_FIELD_SIZES[field]-1] = '\0';
+			}
+			for(int i = 0; i < queriesLen; ++i) {
+				queries[i].pattern[sizeof(queries[i].pattern)-1] = '\0';
 			}
 
-			if(i != *listCursor) {
-				// Matches.
-				if(i+1 != *listCursor) {
-					// Move (n-1)th staff to i.
-					// Only do it if there are data after i.
-					/* Demonstration:
-								i			n (cursor)
-						0	1	2	3	4	!2
-						(to remove 2, move 4 (n-1 th element) to 2.)
-								i			n
-						0	1	4	3	4	!2
-						(decrease cursor by one. to remove leftover and remove the remove command (!2).)
-								i		n
-						0	1	4	3	4	<uninit>
-						(original 4 will be overwritten next loop)
+			// Update the matching staff in one scan, keeping the originals to undo a failed write.
+			int* records = NULL;
+			Staff* originals = NULL;
+			Staff* modified = NULL;
+			int updated = 0;
+			int capacity = 0;
+			for(int record = 0; record < table->current->length; ++record) {
+				Staff staff = *staffTableRecord(table->current, record);
+				if(!matchStaffQueries(&staff, staffTableFolded(table->current, record), queries, queriesLen) || !applyStaffUpdate(&staff, update)) {
+					continue;
+				}
 
-						Q.E.D.
-					*/
-					memmove(deleteListData[i], deleteListData[*listCursor-1], ID_SIZE);
+				if(updated == capacity) {
+					capacity = capacity == 0 ? STAFF_STREAM_CHUNK : capacity*2;
+					int* grownRecords = realloc(records, capacity*sizeof(int));
+					records = grownRecords != NULL ? grownRecords : records;
+					Staff* grownOriginals = realloc(originals, capacity*sizeof(Staff));
+					originals = grownOriginals != NULL ? grownOriginals : originals;
+					Staff* grownModified = realloc(modified, capacity*sizeof(Staff));
+					modified = grownModified != NULL ? grownModified : modified;
+					if(grownRecords == NULL || grownOriginals == NULL || grownModified == NULL) {
+						reply.op = -4;
+						break;
+					}
 				}
-				--*listCursor;
+				Staff* writable = staffTableUpdate(table, record);
+				if(writable == NULL) {
+					reply.op = -4;
+					break;
+				}
+				originals[updated] = *writable;
+				modified[updated] = staff;
+				records[updated++] = record;
+				*writable = staff;
+				foldStaff(staffTableFolded(table->current, record), writable);
 			}
-			continue;
-		} else if(*listCursor >= ENTRIES_PER_PAGE) {
-			printf(
-				"\n"
-				"You have reached the maximum entries limit per deletion request!\n"
-				"To reduce the number of mistake that will occur, the deletion limit has been set to %d!\n", ENTRIES_PER_PAGE
-			);
-			pause();
-			continue; // So that $listCursor is not incremented.
-		} else if(selected != -1) {
-			// $acc should be guaranteed to be within bounds, I think.
-			int acc = 0;
-			int i = 0;
-			for(; acc != selected; ++i) {
-				if(!isStaffDeleted(staffArr[i])) {
-					// Check if the current staff is in delete list.
-					bool inDelete = false;
-					for(int ii = 0; ii < *listCursor; ++ii) {
-						if(strcmp(staffArr[i].id, deleteList[ii]) == 0) {
-							inDelete = true;
-							break;
+
+			// Write every run of adjacent records at once. The IDs are unchanged, so the ID index is too.
+			StaffFileStamp before;
+			bool stamped = fflush(table->staffFile) != EOF && statStaffFile(table->staffFile, &before) == 0;
+			int written = 0;
+			for(int i = 0, end; i < updated; i = end) {
+				for(end = i+1; end < updated && records[end] == records[end-1]+1; ++end);
+				if(staffTableWrite(table, records[i], end-i) != 0) {
+					perror("Error (Writing staff file)");
+					reply.op = -3;
+					for(int ii = i; ii < end; ++ii) {
+						Staff* staff = staffTableUpdate(table, records[ii]);
+						if(staff == NULL) {
+							// Reloaded by the next request.
+							memset(&table->stamp, 0, sizeof(table->stamp));
+							reply.op = -4;
+							continue;
 						}
+						*staff = originals[ii];
+						foldStaff(staffTableFolded(table->current, records[ii]), staff);
 					}
-					if(!inDelete) {
-						++acc;
-					}
+					continue;
 				}
+				memmove(&records[written], &records[i], (end-i)*sizeof(int));
+				memmove(&originals[written], &originals[i], (end-i)*sizeof(Staff));
+				memmove(&modified[written], &modified[i], (end-i)*sizeof(Staff));
+				written += end-i;
 			}
-			strcpy(deleteList[*listCursor], staffArr[i-1].id);
+			if(written > 0 && stampStaffIdIndex(table->staffFile, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating staff ID index)");
+			}
+			if(written > 0 && addDepartures(NULL, 0, stamped ? &before : NULL) != 0) {
+				perror("Error (Updating departure index)");
+			}
+			if(written > 0 && updateChecksums(records, originals, modified, written) != 0) {
+				perror("Error (Updating page checksums)");
+			}
+			free(records);
+			free(originals);
+			free(modified);
+
+			value = written;
+			out = &value;
+			reply.length = sizeof(value);
+			break;
+		}
+	}
+
+	if(view != NULL) {
+		leaveStaffView(table, reader);
+	} else {
+		if(next != NULL) {
+			publishStaffView(table, next);
+		}
+		pthread_mutex_unlock(&table->lock);
+	}
+
+	if(reply.op != 0) {
+		reply.length = 0;
+	}
+	int retval = sendAll(client, &reply, sizeof(reply));
+	if(retval == 0) {
+		retval = sendAll(client, out, reply.length);
+	}
+
+	free(payload);
+	free(allocated);
+	return retval;
+}
+
+
+int loadStaffTable(StaffTable* table) {
+	*table = (StaffTable) { 0 };
+	pthread_mutex_init(&table->lock, NULL);
+	atomic_init(&table->epoch, 1);
+	for(int i = 0; i < DAEMON_CLIENTS_MAX; ++i) {
+		atomic_init(&table->readers[i], 0);
+	}
+	atomic_init(&table->view, NULL);
+
+	table->staffFile = fopen("staff.bin", "rb+");
+	if(table->staffFile == NULL) {
+		return -3;
+	}
+
+	int retval = readStaffTable(table);
+	if(retval != 0) {
+		return retval;
+	}
+
+	StaffView* view = malloc(sizeof(StaffView));
+	if(view == NULL) {
+		return -4;
+	}
+	publishStaffView(table, view);
+	return 0;
+}
+
+
+int readStaffTable(StaffTable* table) {
+	int retval = 0;
+	StaffVersion* old = table->current;
+	StaffIdPage** oldIds = table->ids;
+	int oldCapacity = table->idCapacity;
+	int oldLength = table->idLength;
+	table->current = NULL;
+	table->ids = NULL;
+
+	// Stamp the file before reading it, so a write while reading it is reloaded again.
+	StaffFileStamp stamp;
+	long size;
+	if(statStaffFile(table->staffFile, &stamp) != 0 || fseek(table->staffFile, 0, SEEK_END) != 0 || (size = ftell(table->staffFile)) == -1) {
+		retval = -3;
+		goto CLEANUP;
+	}
+	rewind(table->staffFile);
+
+	table->current = calloc(1, sizeof(StaffVersion));
+	if(table->current == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+	table->current->id = table->versions++;
+	table->current->pins = 1;
+
+	// Read the staff file page by page, appending a page allocates it.
+	int length = size/sizeof(Staff);
+	for(int i = 0; i < length; i += CHECKSUM_PAGE_RECORDS) {
+		if(staffTableUpdate(table, i) == NULL) {
+			retval = -4;
+			goto CLEANUP;
+		}
+		int len = length-i < CHECKSUM_PAGE_RECORDS ? length-i : CHECKSUM_PAGE_RECORDS;
+		if(freadStaff(staffTableRecord(table->current, i), len, table->staffFile) != (size_t) len) {
+			retval = -3;
+			goto CLEANUP;
 		}
+		foldStaffArray(staffTableFolded(table->current, i), staffTableRecord(table->current, i), len);
+		table->current->length = i+len;
+	}
 
-		++*listCursor;
+	// Size the index for every record, so it is not grown while indexing them.
+	table->idCapacity = ID_INDEX_PAGE_SLOTS;
+	while(table->idCapacity < length*2) {
+		table->idCapacity *= 2;
 	}
-	retval = *listCursor;
-	
-	// Modify staff's $passHash to zero.
-	int acc = 0;
-	for(int i = 0; i < len; ++i) {
-		bool match = false;
-		for(int ii = 0; ii < *listCursor; ++ii) {
-			if(!isStaffDeleted(staffArr[i]) != 0 && strcmp(staffArr[i].id, deleteListData[ii]) == 0) {
-				match = true;
-				// Remove deleteListData[ii]. Staff ID is unique, so continue to next staff.
-				deleteListData[ii][0] = '\0';
-				break;
-			}
+	table->idLength = 0;
+	table->ids = allocStaffIds(table->idCapacity);
+	if(table->ids == NULL) {
+		retval = -4;
+		goto CLEANUP;
+	}
+
+	for(int i = 0; i < length; ++i) {
+		if(!isStaffDeleted(*staffTableRecord(table->current, i))) {
+			staffTableIndex(table, i);
 		}
+	}
+	table->stamp = stamp;
 
-		if(match) {
-			staffArr[i].passHash = 0;
+CLEANUP:
+	if(retval != 0) {
+		// Keep serving the previous read.
+		if(table->current != NULL) {
+			releaseStaffVersion(table->current);
+		}
+		releaseStaffIds(table->ids, table->idCapacity);
+		table->current = old;
+		table->ids = oldIds;
+		table->idCapacity = oldCapacity;
+		table->idLength = oldLength;
+	} else {
+		// Versions pinned by readers and the published view (with its index) are kept until released.
+		if(old != NULL) {
+			releaseStaffVersion(old);
+		}
+		StaffView* view = atomic_load(&table->view);
+		if(view == NULL || view->ids != oldIds) {
+			releaseStaffIds(oldIds, oldCapacity);
+		}
+	}
+	return retval;
+}
 
-			time_t rawTime;
-			time(&rawTime);
 
-			struct tm* time = localtime(&rawTime);
-			staffArr[i].passHash |= (((short) time->tm_year)+1900) | (((char) time->tm_mon+1)<<16) | (((unsigned int) (char) time->tm_mday)<<24);
+int refreshStaffTable(StaffTable* table) {
+	StaffFileStamp stamp;
+	if(statStaffFile(table->staffFile, &stamp) != 0) {
+		return -3;
+	}
+	if(memcmp(&stamp, &table->stamp, sizeof(stamp)) == 0) {
+		return 0;
+	}
 
-			fseek(staffFile, sizeof(Staff)*acc, SEEK_CUR);
-			fwrite(&staffArr[i], sizeof(Staff), 1, staffFile);
-			acc = 0;
-		} else {
-			++acc;
-		}
+	StaffView* view = malloc(sizeof(StaffView));
+	if(view == NULL) {
+		return -4;
 	}
-	if(*listCursor == 0) {
-		printf("No staff record deleted!\n");
-	} else if(*listCursor == 1) {
-		printf("1 staff record deleted!\n");
-	} else {
-		printf("%d staff records deleted!\n", *listCursor);
+	int retval = readStaffTable(table);
+	if(retval != 0) {
+		free(view);
+		return retval;
 	}
-	pause();
+	publishStaffView(table, view);
+	return 0;
+}
 
-CLEANUP:
-	#undef ID_SIZE
-	free(staffArr);
 
-	if(staffFile != NULL && fclose(staffFile) == EOF) {
-		perror("Error (Closing staff file, file data might not be saved.) ");
-		pause();
-		retval = 1;
+void freeStaffTable(StaffTable* table) {
+	while(table->pinLength > 0) {
+		unpinStaffVersion(table, table->pinLength-1);
 	}
-	return retval;
+
+	// No reader is left, every view can be freed.
+	StaffView* view = atomic_load(&table->view);
+	if(view != NULL) {
+		view->ownsIds = view->ids != table->ids;
+		freeStaffView(view);
+	}
+	reclaimStaffViews(table);
+
+	if(table->current != NULL) {
+		releaseStaffVersion(table->current);
+	}
+	free(table->pins);
+	releaseStaffIds(table->ids, table->idCapacity);
+	if(table->staffFile != NULL) {
+		fclose(table->staffFile);
+	}
+	pthread_mutex_destroy(&table->lock);
+	*table = (StaffTable) { 0 };
 }
 
 
-int promptStaffDetails(char* buf, enum StaffModifiableFields selection) {
-	char* promptMessage;
-	int maxLen = STAFF_BUF_MAX;
-	bool valid = false;
+StaffView* enterStaffView(StaffTable* table, int reader) {
+	// Writers scan the reader slots after replacing the view, so either they see this slot, or this reader sees the new view.
+	atomic_store(&table->readers[reader], atomic_load(&table->epoch));
+	return atomic_load(&table->view);
+}
 
-	bool isFlipped = false;
-	selection = (selection&(1<<(sizeof(selection)*8-1))) != 0 ? isFlipped=true, ~selection : selection;
 
-	// All uses the same length as their buffer size to check for user input overflow.
-	switch(selection) {
-		case SE_ID:
-			promptMessage = "ID (S0001)";
-			maxLen = 6;
-			break;
-		case SE_NAME:
-			promptMessage = "Name (John Smith)";
-			maxLen = 128;
-			break;
-		case SE_POSITION:
-			promptMessage = "Position (Admin)";
-			maxLen = 32;
-			break;
-		case SE_PHONE:
-			promptMessage = "Phone (0123456789)";
-			maxLen = 16;
-			break;
-		case SE_IC:
-			promptMessage = "IC (000101070000)";
-			maxLen = 15;
-			break;
-		default:
-			printf("Error (Unimplemented)\n");
-			return -15;
-	};
+void leaveStaffView(StaffTable* table, int reader) {
+	atomic_store(&table->readers[reader], 0);
+}
 
-	while(!valid) {
-		valid = true;
-		if(!isFlipped) {
-			printf("Staff's %s: ", promptMessage);
-		}
 
-		// Scan for input. Also discards any leading spaces.
-		int i = 0;
-		int c = 0;
-		while((c = getchar(), c != '\r' && c != '\n') && i < maxLen) {
-			if(i == 0 && c == ' ') {
-				continue;
-			}
-			if(c == EOF) {
-				return EOF;
-			}
+void publishStaffView(StaffTable* table, StaffView* view) {
+	StaffView* old = atomic_load(&table->view);
 
-			buf[i++] = c;
-		}
-		if(c != '\n') {
-			truncate();
+	*view = (StaffView) { table->current, table->ids, table->idCapacity, table->idLength, false, table->stamp, 0, NULL };
+	++table->current->pins;
+	atomic_store(&table->view, view);
+
+	if(old != NULL) {
+		// Readers entering from the new epoch on load the new view.
+		old->ownsIds = old->ids != view->ids;
+		old->retired = atomic_fetch_add(&table->epoch, 1)+1;
+		old->next = table->retired;
+		table->retired = old;
+	}
+	reclaimStaffViews(table);
+}
+
+
+void reclaimStaffViews(StaffTable* table) {
+	unsigned long oldest = ULONG_MAX;
+	for(int i = 0; i < DAEMON_CLIENTS_MAX; ++i) {
+		unsigned long epoch = atomic_load(&table->readers[i]);
+		if(epoch != 0 && epoch < oldest) {
+			oldest = epoch;
 		}
+	}
 
-		if(i == maxLen) {
-			printf("Please enter a shorter value!\n\n");
-			valid = false;
+	// A view retired in an epoch can only be read by readers that entered before it.
+	StaffView** link = &table->retired;
+	while(*link != NULL) {
+		StaffView* view = *link;
+		if(view->retired <= oldest) {
+			*link = view->next;
+			freeStaffView(view);
+		} else {
+			link = &view->next;
 		}
-		// Remove trailing spaces.
-		while(buf[--i] == ' ');
-		buf[i+1] = 0;
+	}
+}
 
-		// Control characters detection.
-		if(buf[0] == ':') {
-			if(toupper(buf[1]) == 'Q' || toupper(buf[1]) == 'W') {
-				return -2;
-			} else if(toupper(buf[1]) == 'H') {
-				printf(
-					"HELP: Enter a value according to what is prompted.\n"
-					"      It shows the prompted item, and an example of it enclosed in brackets.\n\n"
-				);
-				return promptStaffDetails(buf, selection^~(isFlipped-1));
+
+void freeStaffView(StaffView* view) {
+	releaseStaffVersion(view->version);
+	if(view->ownsIds) {
+		releaseStaffIds(view->ids, view->idCapacity);
+	}
+	free(view);
+}
+
+
+int unshareStaffIds(StaffTable* table) {
+	StaffView* view = atomic_load(&table->view);
+	if(view == NULL || view->ids != table->ids) {
+		return 0;
+	}
+
+	int pages = table->idCapacity/ID_INDEX_PAGE_SLOTS;
+	StaffIdPage** ids = malloc(pages*sizeof(StaffIdPage*));
+	if(ids == NULL) {
+		return -4;
+	}
+	memcpy(ids, table->ids, pages*sizeof(StaffIdPage*));
+	for(int i = 0; i < pages; ++i) {
+		++ids[i]->refs;
+	}
+	table->ids = ids;
+	return 0;
+}
+
+
+int unshareStaffIdRun(StaffTable* table, unsigned int slot) {
+	unsigned int mask = table->idCapacity-1;
+	for(unsigned int i = slot;; i = (i+1)&mask) {
+		StaffIdPage** page = &table->ids[i/ID_INDEX_PAGE_SLOTS];
+		if((*page)->refs > 1) {
+			StaffIdPage* copy = malloc(sizeof(StaffIdPage));
+			if(copy == NULL) {
+				return -4;
 			}
+			*copy = **page;
+			copy->refs = 1;
+			--(*page)->refs;
+			*page = copy;
 		}
 
-		if(buf[0] == 0) {
-			printf("Please enter a value!\n\n");
-			valid = false;
+		// The index is at most half full, so an empty slot always ends the run.
+		if(i != slot && (*page)->slots[i%ID_INDEX_PAGE_SLOTS] == -1) {
+			return 0;
 		}
+	}
+}
 
-		if(valid) {
-			switch(selection) {
-				case SE_ID:
-					if(buf[0] == 's') {
-						valid = false;
-						printf("Please ensure that the alphabet entered is in uppercase!\n\n");
-						break;
-					} else if(buf[0] != 'S') {
-						valid = false;
-						printf("Invalid Staff ID format!\n\n");
-						break;
-					}
 
-					for(int i = 1; i < 5; ++i) {
-						if(buf[i] < '0' || buf[i] > '9') {
-							printf("Invalid Staff ID format!\n\n");
-							valid = false;
-							break;
-						}
-					}
-					break;
-				case SE_PHONE: { // Interesting... https://stackoverflow.com/questions/2036819/compile-error-with-switch-expected-expression-before
-					int i = 0;
-					if(buf[0] != '0') {
-						printf("Please enter a valid phone number!\n\n");
-						valid = false;
-					}
+StaffIdPage** allocStaffIds(int capacity) {
+	int pages = capacity/ID_INDEX_PAGE_SLOTS;
+	StaffIdPage** ids = calloc(pages, sizeof(StaffIdPage*));
+	if(ids == NULL) {
+		return NULL;
+	}
 
-					int phoneLen = strlen(buf);
-					int numbersLen = 0;
-
-					for(; buf[i] && valid; ++i) {
-						if(buf[i] == '-' || buf[i] == ' ') {
-							// Remove hyphens or space for the user.
-							memmove(buf+i, buf+i+1, phoneLen-numbersLen); // Moves the null character too.
-							--phoneLen;
-							--i; // Stay on the same index.
-						} else if(buf[i] < '0' || buf[i] > '9') {
-							printf("The phone number should only contain numbers!\n\n");
-							valid = false;
-							break;
-						} else {
-							++numbersLen;
-						}
-					}
+	for(int i = 0; i < pages; ++i) {
+		ids[i] = malloc(sizeof(StaffIdPage));
+		if(ids[i] == NULL) {
+			releaseStaffIds(ids, i*ID_INDEX_PAGE_SLOTS);
+			return NULL;
+		}
+		ids[i]->refs = 1;
+		memset(ids[i]->slots, 0xFF, sizeof(ids[i]->slots));
+	}
+	return ids;
+}
 
-					// All are numbers, but invalid length.
-					if(valid && (numbersLen < 9 || numbersLen > 12)) {
-						printf("Please enter a valid phone number!\n\n");
-						valid = false;
-					}
-					break;
-				}
-				case SE_IC: {
-					// Check if it's all numbers.
-					int icLen = strlen(buf);
-					int i = 0;
-					int numbersLen = 0;
-					for(i = 0; i < buf[i]; ++i) {
-						if(buf[i] == '-' || buf[i] == ' ') {
-							// Same method as phone number.
-							// O(n^2) but should be fast enough for n < 16.
-							memmove(buf+i, buf+i+1, icLen-numbersLen);
-							--icLen;
-							--i; // Stay on the same index.
-						} else if(buf[i] < '0' || buf[i] > '9') {
-							printf("IC number should only contain numbers!\n\n");
-							valid = false;
-							break;
-						} else {
-							++numbersLen;
-						}
-					}
-					if(valid && i != 12) {
-						printf("Please enter IC number with the correct length!\n\n");
-						valid = false;
-					}
 
-					if(valid) {
-						// Extract year.
-						char c = buf[2];
-						buf[2] = 0;
-						short year = atoi(buf);
-						buf[2] = c;
-
-						// Extract month.
-						c = buf[4];
-						buf[4] = 0;
-						short month = atoi(buf+2);
-						buf[4] = c;
-
-						// Extract day.
-						c = buf[6];
-						buf[6] = 0;
-						short day = atoi(buf+4);
-						buf[6] = c;
-
-						// Extract state code.
-						c = buf[8];
-						buf[8] = 0;
-						short state = atoi(buf+6);
-						buf[8] = c;
-
-						// NOTE: Year in IC is not validated since humans can live past 99 years old lol.
-
-						// Validate month.
-						if(valid && (month < 1 || month > 12)) {
-							printf("Please enter a valid month!\n\n");
-							valid = false;
-						}
+void releaseStaffIds(StaffIdPage** ids, int capacity) {
+	if(ids == NULL) {
+		return;
+	}
 
-						// Validate day.
-						if(
-							valid &&
-							(
-								day < 1 || // Day should not be less than 1.
-								(
-									month != 2 && (
-										(buf[3]+(buf[3] >= '8' || buf[2] == '1'))%2 == 1 ? // Months that have 31 days.
-											day > 31 :
-											day > 30
-									)
-								) ||
-								(
-									month == 2 && (
-										(
-											(year%100 == 0 && year%400 != 0) ? // End of century years that is not a leap year.
-											day > 28 :
-											day > 29
-										) ||
-										year%4 == 0 ? day > 29 : day > 28
-									)
-								)
-							)
-						) {
-							printf("Please enter a valid day of month!\n\n");
-							valid = false;
-						}
+	for(int i = 0; i < capacity/ID_INDEX_PAGE_SLOTS; ++i) {
+		if(--ids[i]->refs == 0) {
+			free(ids[i]);
+		}
+	}
+	free(ids);
+}
 
-						if(valid && (state == 0 || (state >= 17 && state <= 20) || state == 69 || state == 70 || state == 73 || state == 80 || state == 81 || (state >= 94 && state <= 97))) {
-							printf("Please enter a valid state number!\n\n");
-							valid = false;
-						}
-					}
-					break;
-				}
-				default:;
-					// Do nothing.
-			}
+
+int* staffIdSlot(StaffIdPage** ids, unsigned int slot) {
+	return &ids[slot/ID_INDEX_PAGE_SLOTS]->slots[slot%ID_INDEX_PAGE_SLOTS];
+}
+
+
+int staffTableFind(StaffTable* table, char* id) {
+	StaffView view = { table->current, table->ids, table->idCapacity, table->idLength, false, table->stamp, 0, NULL };
+	return staffViewFind(&view, id, false);
+}
+
+
+int staffViewFind(StaffView* view, char* id, bool ignoreCase) {
+	char key[6];
+	char other[6];
+	size_t len = strlen(id);
+	if(len >= sizeof(key)) {
+		return -1;
+	}
+	foldCase(key, id, len+1);
+
+	// reportHash() ignores case, so IDs differing in case are in the same probe sequence.
+	unsigned int mask = view->idCapacity-1;
+	for(unsigned int slot = reportHash(key, 0)&mask; *staffIdSlot(view->ids, slot) != -1; slot = (slot+1)&mask) {
+		int record = *staffIdSlot(view->ids, slot);
+		char* found = staffTableRecord(view->version, record)->id;
+		if(ignoreCase) {
+			foldCase(other, found, sizeof(other));
+			found = other;
 		}
-		// Hands back control to callee if enum is passed in with its bits flipped.
-		if(isFlipped && !valid) {
-			return -14;
+		if(strcmp(ignoreCase ? key : id, found) == 0) {
+			return record;
 		}
 	}
+	return -1;
+}
 
-	// No error.
+
+int staffTableIndex(StaffTable* table, int record) {
+	// Keep the index at most half full, so probe sequences stay short.
+	if((table->idLength+1)*2 > table->idCapacity) {
+		StaffIdPage** old = table->ids;
+		int oldCapacity = table->idCapacity;
+
+		// Every page of the grown index is new, so indexing the staff again never fails.
+		table->ids = allocStaffIds(oldCapacity*2);
+		if(table->ids == NULL) {
+			table->ids = old;
+			return -4;
+		}
+		table->idCapacity = oldCapacity*2;
+		table->idLength = 0;
+
+		for(int i = 0; i < oldCapacity; ++i) {
+			if(*staffIdSlot(old, i) != -1) {
+				staffTableIndex(table, *staffIdSlot(old, i));
+			}
+		}
+		releaseStaffIds(old, oldCapacity);
+	}
+
+	unsigned int mask = table->idCapacity-1;
+	unsigned int slot = reportHash(staffTableRecord(table->current, record)->id, 0)&mask;
+	while(*staffIdSlot(table->ids, slot) != -1) {
+		slot = (slot+1)&mask;
+	}
+	if(unshareStaffIdRun(table, slot) != 0) {
+		return -4;
+	}
+	*staffIdSlot(table->ids, slot) = record;
+	++table->idLength;
 	return 0;
 }
 
 
-DisplayStaffOptions displayStaffOptionsInit(void) {
-	return (DisplayStaffOptions) {
-		NULL,
-		NULL,
-		{ 0, 0, 0, 0, 0 },
-		0,
-		ENTRIES_PER_PAGE,
-		0,
-		true,
-		true,
-		false,
-		true,
-		{
-			0,
-			0,
-			0
+int staffTableUnindex(StaffTable* table, int record) {
+	unsigned int mask = table->idCapacity-1;
+	unsigned int slot = reportHash(staffTableRecord(table->current, record)->id, 0)&mask;
+	while(*staffIdSlot(table->ids, slot) != record) {
+		if(*staffIdSlot(table->ids, slot) == -1) {
+			// Not indexed.
+			return 0;
 		}
-	};
-}
+		slot = (slot+1)&mask;
+	}
 
+	// Only the slots up to the end of the run move.
+	if(unshareStaffIdRun(table, slot) != 0) {
+		return -4;
+	}
 
-int displaySelectedStaff(DisplayStaffOptions* options) {
-	int retval = 0;
-	FILE* staffFile = fopen("staff.bin", "rb");
-	Staff* staffArr = NULL;
-	char* includeFlag = NULL;
-	int* arrCursorHist = NULL;
+	// Backward shift deletion: move the later entries of the probe sequence into the hole,
+	// unless the hole is before their home slot. No tombstones are needed.
+	unsigned int next = slot;
+	while(1) {
+		next = (next+1)&mask;
+		int other = *staffIdSlot(table->ids, next);
+		if(other == -1) {
+			break;
+		}
 
-	if(staffFile == NULL) {
-		perror("Error (Opening staff file)");
-		pause();
-		retval = -3;
-		goto CLEANUP;
+		unsigned int home = reportHash(staffTableRecord(table->current, other)->id, 0)&mask;
+		if(((next-home)&mask) >= ((next-slot)&mask)) {
+			*staffIdSlot(table->ids, slot) = other;
+			slot = next;
+		}
 	}
+	*staffIdSlot(table->ids, slot) = -1;
+	--table->idLength;
+	return 0;
+}
 
-	if(fseek(staffFile, 0, SEEK_END) != 0) {
-		perror("Error (fseek staff file)");
-		pause();
-		// TODO: Design a backup solution along with malloc().
-		retval = -3;
-		goto CLEANUP;
-	} else {
-		int len = ftell(staffFile);
-		if(len == -1) {
-			// TODO: Design a backup solution.
-			perror("Error (ftell staff file)");
-			pause();
+
+int staffTableWrite(StaffTable* table, int record, int count) {
+	FILE* staffFile = table->staffFile;
+	if(lockStaff(staffFile, record, count, SL_EXCLUSIVE) != 0) {
+		return -3;
+	}
+
+	// Writing changes the stamp, so it is read again after writing, unless another program wrote the file in between.
+	StaffFileStamp before;
+	bool current = statStaffFile(staffFile, &before) == 0 && memcmp(&before, &table->stamp, sizeof(before)) == 0;
+
+	int retval = fseek(staffFile, record*(long) sizeof(Staff), SEEK_SET) != 0 ? -3 : 0;
+	for(int i = record; retval == 0 && i < record+count;) {
+		// The records of a page are adjacent in memory too.
+		int len = CHECKSUM_PAGE_RECORDS - i%CHECKSUM_PAGE_RECORDS;
+		len = len < record+count-i ? len : record+count-i;
+		if(fwrite(staffTableRecord(table->current, i), sizeof(Staff), len, staffFile) != (size_t) len) {
 			retval = -3;
-			goto CLEANUP;
 		}
-		rewind(staffFile);
-		options->metadata.totalBytes = len;
-		options->metadata.totalEntries = len / sizeof(Staff);
+		i += len;
+	}
+	if(fflush(staffFile) == EOF) {
+		retval = -3;
+	}
+	if(!current || statStaffFile(staffFile, &table->stamp) != 0) {
+		// Reloaded by the next request.
+		memset(&table->stamp, 0, sizeof(table->stamp));
 	}
 
-	// Allocate memory to hold the whole file.
-	staffArr = malloc(options->metadata.totalBytes*sizeof(Staff));
-	if(staffArr == NULL) {
+	// The write has to be flushed before unlocking.
+	lockStaff(staffFile, record, count, SL_UNLOCK);
+	return retval;
+}
+
+int staffTableDelete(StaffTable* table, int* records, int len) {
+	DepartureEntry* departures = malloc(len*sizeof(DepartureEntry)+1);
+	Staff* originals = malloc(len*sizeof(Staff)+1);
+	Staff* written = malloc(len*sizeof(Staff)+1);
+	if(departures == NULL || originals == NULL || written == NULL) {
+		free(departures);
+		free(originals);
+		free(written);
 		perror("Error (malloc)");
-		pause();
-		// Designing a backup solution really will do die me ah.
-		// TODO: Maybe if got time, remake a backup solution if malloc() fails.
-		retval = -4;
-		goto CLEANUP;
+		return 0;
 	}
 
-	fread(staffArr, sizeof(Staff), options->metadata.totalEntries, staffFile);
+	StaffFileStamp before;
+	bool stamped = fflush(table->staffFile) != EOF && statStaffFile(table->staffFile, &before) == 0;
 
-	// If isInclude, set all flag to false, else true.
-	// Include: Set all to exclude then build up include list.
-	// Exclude: Set all to include then build up exclude list.
-	// A bitset to record which ID to print.
-	if(options->isInclude) {
-		includeFlag = calloc((options->metadata.totalEntries+7)/8, 1);
-	} else {
-		includeFlag = malloc((options->metadata.totalEntries+7)/8);
-		if(includeFlag != NULL) {
-			memset(includeFlag, ~0, (options->metadata.totalEntries+7)/8);
+	// Tombstone every staff in the table first. $records is compacted in place, $marked never passes $i.
+	int marked = 0;
+	for(int i = 0; i < len; ++i) {
+		int record = records[i];
+		if(i > 0 && record == records[i-1]) {
+			continue;
 		}
-	}
-	
-	if(includeFlag == NULL) {
-		perror("Error (malloc bitset)");
-		pause();
-		retval = -4;
-		goto CLEANUP;
-	}
-
-	// Traverse the file and mark ith bit of $includeFlag as 0/1 to determine if it should be included/excluded from print.
-	int total = 0; // Total number of matches (Will be printed).
 
-	for(int i = 0; i < options->metadata.totalEntries; ++i) {
-		if(isStaffDeleted(staffArr[i]) ? !options->displayDeleted : !options->displayExisting) {
-			// Hide staff.
-			includeFlag[i/8] &= ~(1 << (i%8));
+		// Unindexed first, so a failed write indexes it again.
+		Staff* staff = staffTableUpdate(table, record);
+		if(staff == NULL || staffTableUnindex(table, record) != 0) {
+			perror("Error (malloc)");
 			continue;
 		}
+		originals[marked] = *staff;
+		markStaffDeleted(staff);
+		written[marked] = *staff;
+		records[marked++] = record;
+	}
 
-		for(int ii = 0; ii < options->idListLen; ++ii) {
-			if(strcmp(staffArr[i].id, options->idList[ii]) == 0) {
-				// If exclude mode, set bit as 0.
-				// If include mode, set bit as 1.
-				if(!options->isInclude) {
-					includeFlag[i/8] &= ~(1 << (i%8));
-				} else {
-					includeFlag[i/8] |= (1 << (i%8));
+	// Write every run of adjacent records at once.
+	int deleted = 0;
+	for(int i = 0, end; i < marked; i = end) {
+		for(end = i+1; end < marked && records[end] == records[end-1]+1; ++end);
+		if(staffTableWrite(table, records[i], end-i) != 0) {
+			perror("Error (Writing staff file)");
+			for(int ii = i; ii < end; ++ii) {
+				// The other runs may still be unindexed, so indexing can fail. The table is then reloaded by the next request.
+				Staff* staff = staffTableUpdate(table, records[ii]);
+				if(staff == NULL) {
+					memset(&table->stamp, 0, sizeof(table->stamp));
+					continue;
+				}
+				*staff = originals[ii];
+				if(staffTableIndex(table, records[ii]) != 0) {
+					memset(&table->stamp, 0, sizeof(table->stamp));
 				}
-				break; // Marked as include, don't need to check against other IDs.
 			}
+			continue;
 		}
-	}
 
-	for(int i = 0; i < options->metadata.totalEntries; ++i) {
-		if((includeFlag[i/8]&(1<<(i%8))) != 0) {
-			++total;
+		for(int ii = i; ii < end; ++ii) {
+			originals[deleted] = originals[ii];
+			written[deleted] = written[ii];
+			departures[deleted] = (DepartureEntry) { staffDepartureDate(written[ii]), records[ii] };
+			records[deleted++] = records[ii];
 		}
 	}
-	options->metadata.matchedLength = total;
 
-	// Handle page out of bounds.
-	if(options->page < 0) {
-		options->page = 0;
-	} else if(options->page * options->entriesPerPage >= total) {
-		options->page = options->metadata.matchedLength/(options->entriesPerPage+1);
+	if(deleted > 0 && stampStaffIdIndex(table->staffFile, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating staff ID index)");
 	}
 
-	// Stores each starting position of the page. Indexed with $curPage.
-	arrCursorHist = calloc(1, sizeof(int) * ((options->metadata.totalEntries+(options->entriesPerPage-1))/options->entriesPerPage));
-	if(arrCursorHist == NULL) {
-		perror("Error (malloc $arrCursorHist)");
-		pause();
-		retval = -4;
-		goto CLEANUP;
+	// Every staff is deleted today, so the departures are sorted by record too.
+	if(addDepartures(departures, deleted, stamped ? &before : NULL) != 0) {
+		perror("Error (Updating departure index)");
 	}
-	arrCursorHist[0] = 0;
+	if(deleted > 0 && updateChecksums(records, originals, written, deleted) != 0) {
+		perror("Error (Updating page checksums)");
+	}
+	free(departures);
+	free(originals);
+	free(written);
+	return deleted;
+}
 
-	// Fill in each starting index of match from staff file to each page.
-	for(int i = 0, acc = 0, curPage = 1; i < options->metadata.totalEntries; ++i) {
-		if((includeFlag[i/8] & (1<<(i%8))) != 0) {
-			if(++acc > options->entriesPerPage) {
-				arrCursorHist[curPage] = i;
-				acc = 1; // Already included staffArr[i].
 
-				++curPage;
-			}
-		}
-	}
+Staff* staffTableRecord(StaffVersion* version, int record) {
+	return &version->pages[record/CHECKSUM_PAGE_RECORDS]->records[record%CHECKSUM_PAGE_RECORDS];
+}
 
-	if(options->isInteractive) {
-		cls();
+
+StaffFolded* staffTableFolded(StaffVersion* version, int record) {
+	return &version->pages[record/CHECKSUM_PAGE_RECORDS]->folded[record%CHECKSUM_PAGE_RECORDS];
+}
+
+
+void countPagesTask(void* arg, int worker, long first, long count) {
+	StaffCountJob* job = arg;
+	// LIKE() writes to the pattern temporarily, so every task matches with its own copy.
+	StaffQuery query = *job->query;
+
+	for(long page = first; page < first+count; ++page) {
+		int record = page*CHECKSUM_PAGE_RECORDS;
+		int len = job->version->length-record < CHECKSUM_PAGE_RECORDS ? job->version->length-record : CHECKSUM_PAGE_RECORDS;
+		job->counts[worker] += countStaffArray(job->version->pages[page]->records, job->version->pages[page]->folded, len, &query, 0);
 	}
+}
 
-	while(1) {
-		if(options->header != NULL) {
-			printf("%s", options->header);
-		}
-		// ith index stores the width of dashes.
-		// i+1th index stores the width of the column (including the dashes).
-		short printWidth[STAFF_ENUM_LENGTH*2] = {
-			8, 8,
-			4, 30,
-			8, 15,
-			5, 13,
-			2, 14
-		};
 
-		int cols = 0;
-		// Print headers.
-		printf("Number    "); // Column of the number of current row.
-		for(int i = 0; i < STAFF_ENUM_LENGTH; ++i) {
-			if(!options->displayList[i]) {
-				continue;
-			}
-			++cols;
+Staff* staffTableUpdate(StaffTable* table, int record) {
+	StaffVersion* version = table->current;
+	int page = record/CHECKSUM_PAGE_RECORDS;
 
-			switch(i) {
-				case SE_ID:
-					printf("STAFF ID");
-					break;
-				case SE_NAME:
-					// Allocate a width of 30 cols for name.
-					// If a name exceeds 27 characters (excluding null), ellipsis will be added.
-					printf("%-30s", "NAME");
-					break;
-				case SE_POSITION:
-					printf("%-15s", "POSITION");
-					break;
-				case SE_PHONE:
-					// <16 because of max valid phone length.
-					// Two additional characters to prettify print.
-					printf("%-13s", "PHONE");
-					break;
-				case SE_IC:
-					printf("%-14s", "IC");
-				default:;
-					// Do nothing.
-			}
-			printf("    ");
+	if(version->pins > 1) {
+		// A reader pinned the current version, continue in a copy sharing every page.
+		StaffVersion* copy = malloc(sizeof(StaffVersion));
+		StaffPage** pages = malloc(version->pageCapacity*sizeof(StaffPage*)+1);
+		if(copy == NULL || pages == NULL) {
+			free(copy);
+			free(pages);
+			return NULL;
 		}
-		if(options->displayDeleted) {
-			printf("DELETED");
+		memcpy(pages, version->pages, version->pageLength*sizeof(StaffPage*));
+		for(int i = 0; i < version->pageLength; ++i) {
+			++pages[i]->refs;
 		}
-		putchar('\n');
 
-		#ifdef __linux__
-		// Straight from DOS but Windows still doesn't support it.
-		#define printDiv(n) do{ for(int _i = (n); _i; _i--) printf("─"); } while(0)
-		#else
-		#define printDiv(n) do{ for(int _i = (n); _i; _i--) putchar('-'); } while(0)
-		#endif
+		*copy = *version;
+		copy->id = table->versions++;
+		copy->pins = 1;
+		copy->pages = pages;
+		releaseStaffVersion(version);
+		table->current = version = copy;
+	}
 
-		// Print header and content divider.
-		printDiv(6); // Divider for number column.
-		printf("    ");
-		for(int i = 0; i < STAFF_ENUM_LENGTH*2; i += 2) {
-			if(!options->displayList[i/2]) {
-				continue;
+	if(page == version->pageLength) {
+		// Appending to a full page, allocate the next one.
+		if(version->pageLength == version->pageCapacity) {
+			int capacity = version->pageCapacity == 0 ? 16 : version->pageCapacity*2;
+			StaffPage** pages = realloc(version->pages, capacity*sizeof(StaffPage*));
+			if(pages == NULL) {
+				return NULL;
 			}
+			version->pages = pages;
+			version->pageCapacity = capacity;
+		}
 
-			printDiv(printWidth[i]);
-
-			// Plus 4 for row divider.
-			for(int ii = printWidth[i]; ii < printWidth[i+1]+4; ++ii) {
-				putchar(' ');
-			}
+		StaffPage* appended = malloc(sizeof(StaffPage));
+		if(appended == NULL) {
+			return NULL;
 		}
-		if(options->displayDeleted) {
-			printDiv(7);
+		appended->refs = 1;
+		version->pages[version->pageLength++] = appended;
+	} else if(version->pages[page]->refs > 1) {
+		// Another version shares the page.
+		StaffPage* copy = malloc(sizeof(StaffPage));
+		if(copy == NULL) {
+			return NULL;
 		}
-		putchar('\n');
-
-		// Print staff details from staffArray.
-		int arrCursor = arrCursorHist[options->page];
-		int read = options->page * options->entriesPerPage;
+		*copy = *version->pages[page];
+		copy->refs = 1;
+		--version->pages[page]->refs;
+		version->pages[page] = copy;
+	}
 
-		// If this is the last page, read until $total, else read until before the starting index of another page.
-		for(; (total-(options->page*options->entriesPerPage) <= options->entriesPerPage) ? (read < total) : (arrCursor < arrCursorHist[options->page+1]); ++arrCursor) {
-			if((includeFlag[arrCursor/8]&(1<<(arrCursor%8))) == 0) {
-				continue;
-			}
+	if(record == version->length) {
+		++version->length;
+	}
+	return staffTableRecord(version, record);
+}
 
-			if(read != options->page*options->entriesPerPage) {
-				// Print newline first then staff data.
-				putchar('\n');
-			}
 
-			// Print column number.
-			printf("%6d    ", ++read);
+int pinStaffVersion(StaffTable* table, int client) {
+	if(table->pinLength == table->pinCapacity) {
+		int capacity = table->pinCapacity == 0 ? 16 : table->pinCapacity*2;
+		StaffPin* pins = realloc(table->pins, capacity*sizeof(StaffPin));
+		if(pins == NULL) {
+			return -4;
+		}
+		table->pins = pins;
+		table->pinCapacity = capacity;
+	}
 
+	++table->current->pins;
+	table->pins[table->pinLength++] = (StaffPin) { client, table->current };
+	return 0;
+}
 
-			for(int i = 0; i < STAFF_ENUM_LENGTH; ++i) {
-				if(!options->displayList[i]) {
-					continue;
-				}
-				switch(i) {
-					case SE_ID:
-						printf("%s   ", staffArr[arrCursor].id);
-						break;
-					case SE_NAME:
-						if(strlen(staffArr[arrCursor].details.name) > 28) {
-							int c = staffArr[arrCursor].details.name[28];
-							staffArr[arrCursor].details.name[28] = 0;
-							printf("%s..", staffArr[arrCursor].details.name);
-							staffArr[arrCursor].details.name[28] = c;
-						} else {
-							printf("%-28s  ", staffArr[arrCursor].details.name);
-						}
-						break;
-					case SE_POSITION:
-						if(strlen(staffArr[arrCursor].details.position) > 13) {
-							int c = staffArr[arrCursor].details.position[13];
-							staffArr[arrCursor].details.position[13] = 0;
-							printf("%s..", staffArr[arrCursor].details.position);
-							staffArr[arrCursor].details.position[13] = c;
-						} else {
-							printf("%-13s  ", staffArr[arrCursor].details.position);
-						}
-						break;
-					case SE_PHONE:
-						if(staffArr[arrCursor].details.phone[1] != '1') {
-							putchar('0');
-							putchar(staffArr[arrCursor].details.phone[1]);
-							putchar(' ');
-							putchar(' ');
-
-							int remaining = strlen(staffArr[arrCursor].details.phone+2);
-							for(int i = 2; i < 2+remaining/2; ++i) {
-								putchar(staffArr[arrCursor].details.phone[i]);
-							}
-							if(remaining != 8) {
-								putchar(' ');
-							}
-							printf(" %-4s", staffArr[arrCursor].details.phone+2+remaining/2);
-						} else {
-							putchar('0');
-							putchar(staffArr[arrCursor].details.phone[1]);
-							putchar(staffArr[arrCursor].details.phone[2]);
-							putchar(' ');
-
-							int remaining = strlen(staffArr[arrCursor].details.phone+3);
-							for(int i = 3; i < 3+remaining/2; ++i) {
-								putchar(staffArr[arrCursor].details.phone[i]);
-							}
-							if(remaining != 8) {
-								putchar(' ');
-							}
-							printf(" %-4s", staffArr[arrCursor].details.phone+3+remaining/2);
-						}
-						break;
-					case SE_IC:
-						for(int i = 0; i < 6; ++i) {
-							printf("%c", staffArr[arrCursor].details.ic[i]);
-						}
-						putchar('-');
-						for(int i = 6; i < 8; ++i) {
-							printf("%c", staffArr[arrCursor].details.ic[i]);
-						}
-						putchar('-');
-						for(int i = 8; i < 12; ++i) {
-							printf("%c", staffArr[arrCursor].details.ic[i]);
-						}
-					default:;
-						// Do nothing.
-				}
-				printf("    ");
-			}
 
-			if(options->displayDeleted) {
-				if(isStaffDeleted(staffArr[arrCursor])) {
-					printf(
-						"%04llu-%02llu-%02llu",
-						staffArr[arrCursor].passHash&0xFFFF,
-						(staffArr[arrCursor].passHash&0xFF0000)>>16,
-						(staffArr[arrCursor].passHash&0xFF000000)>>24
-					);
-				} else {
-					printf("False");
-				}
-			}
-			putchar('\n');
+int findStaffPin(StaffTable* table, int client, int version) {
+	for(int i = 0; i < table->pinLength; ++i) {
+		if(table->pins[i].client == client && table->pins[i].version->id == version) {
+			return i;
 		}
+	}
+	return -1;
+}
 
-		if(total == 0) {
-			printf("  No matching entries!\n");
-		}
 
-		// Print table border
-		for(int i = 1; i < STAFF_ENUM_LENGTH*2; i += 2) {
-			if(!options->displayList[i/2]) {
-				continue;
-			}
-			for(int ii = printWidth[i]+4*(i+1 != STAFF_ENUM_LENGTH*2 || options->displayDeleted); ii; --ii) {
-				printDiv(1);
-			}
-		}
-		printDiv(10); // Number column.
-		if(options->displayDeleted) {
-			printDiv(10);
+void unpinStaffVersion(StaffTable* table, int pin) {
+	releaseStaffVersion(table->pins[pin].version);
+	table->pins[pin] = table->pins[--table->pinLength];
+}
+
+
+void releaseStaffPins(StaffTable* table, int client) {
+	for(int i = table->pinLength-1; i >= 0; --i) {
+		if(table->pins[i].client == client) {
+			unpinStaffVersion(table, i);
 		}
-		putchar('\n');
+	}
+}
 
-		if(total <= 1) {
-			printf("Displaying %d entry", read);
-		} else {
-			printf("Displaying %d entries", read);
+
+void releaseStaffVersion(StaffVersion* version) {
+	if(--version->pins > 0) {
+		return;
+	}
+
+	for(int i = 0; i < version->pageLength; ++i) {
+		if(--version->pages[i]->refs == 0) {
+			free(version->pages[i]);
 		}
+	}
+	free(version->pages);
+	free(version);
+}
+#endif
 
-		if(options->metadata.totalEntries >= 0) {
-			printf(" of %d entr%s.", total, total < 2 ? "y" : "ies");
+
+bool useStaffDaemon(void) {
+	#ifdef STAFF_DAEMON
+	if(staffDaemonFd == -2) {
+		struct sockaddr_un address = { 0 };
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, STAFF_SOCKET, sizeof(address.sun_path)-1);
+
+		// A socket file left behind by a killed daemon refuses the connection.
+		staffDaemonFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(staffDaemonFd != -1 && connect(staffDaemonFd, (struct sockaddr*) &address, sizeof(address)) != 0) {
+			close(staffDaemonFd);
+			staffDaemonFd = -1;
 		}
-		printf(" (Page %d)\n", options->page+1);
+	}
+	return staffDaemonFd >= 0;
+	#else
+	return false;
+	#endif
+}
 
-		if(options->isInteractive) {
-			// To keep the system consistent, precedes with a colon. (Optional now).
-			printf("\nEnter 'n' for next page, 'b' to go back a page, 'q' to quit: ");
-			char action[3];
 
-			if(scanf("%2s", action) == EOF) {
-				retval = EOF;
-				goto CLEANUP;
-			}
-			truncate();
-			if(action[0] == ':') {
-				action[0] = action[1];
-			}
+int requestStaff(int op, const void* payload, int length, void** reply, int* replyLength) {
+	int retval = 0;
+	char* buf = NULL;
+	StaffMessage message = { op, length };
 
-			if(toupper(action[0]) == 'Q') {
-				break;
-			} else if(toupper(action[0]) == 'B' && options->page > 0) {
-				--options->page;
-			} else if(toupper(action[0]) == 'N' && read < total) {
-				++options->page;
-			} else if(toupper(action[0]) == 'H') {
-				cls();
-				printf(
-					"HELP\n"
-					"====\n"
-					"  Uses 'n' or 'b' to turn to the next page or go back a page.\n"
-					"  Enter 'q' to quit interactive mode.\n"
-					"  Actions:\n"
-					"    n (Next page.)\n"
-					"    b (Go back a page.)\n"
-					"    q (Quit.)\n\n"
-				);
-				pause();
-			}
-			cls();
-		} else {
-			putchar('\n');
-			break;
+	if(reply != NULL) {
+		*reply = NULL;
+	}
+	if(replyLength != NULL) {
+		*replyLength = 0;
+	}
+
+	if(!useStaffDaemon()) {
+		return -3;
+	}
+
+	#ifdef STAFF_DAEMON
+	if(length > DAEMON_REQUEST_MAX) {
+		return -18;
+	}
+
+	if(op >= SR_PIN && op != SR_UNPIN && !staffDaemonLoggedIn) {
+		// Commands skip the login screen, they log in as $STAFF_ID with $STAFF_PASSWORD instead.
+		char* id = getenv("STAFF_ID");
+		char* password = getenv("STAFF_PASSWORD");
+		if(id != NULL && password != NULL) {
+			StaffLogin login = { "", computeHash(password) };
+			strncpy(login.id, id, sizeof(login.id)-1);
+			retval = requestStaff(SR_LOGIN, &login, sizeof(login), NULL, NULL);
+		}
+		if(id == NULL || password == NULL || retval == -15 || retval == -16) {
+			fprintf(stderr, "The staff daemon requires a login, set STAFF_ID and STAFF_PASSWORD to a valid staff ID and password.\n");
+		}
+		if(!useStaffDaemon()) {
+			return -3;
+		}
+		retval = 0;
+	}
+
+	if(sendAll(staffDaemonFd, &message, sizeof(message)) != 0 || sendAll(staffDaemonFd, payload, length) != 0 || recvAll(staffDaemonFd, &message, sizeof(message)) != 0 || message.length < 0) {
+		retval = -3;
+		goto CLEANUP;
+	}
+
+	if(message.length > 0) {
+		buf = malloc(message.length);
+		if(buf == NULL) {
+			// The reply can not be skipped, so the connection is out of sync.
+			retval = -4;
+			goto CLEANUP;
+		}
+		if(recvAll(staffDaemonFd, buf, message.length) != 0) {
+			retval = -3;
+			goto CLEANUP;
 		}
 	}
-	retval = total;
+
+	retval = message.op;
+	if(op == SR_LOGIN) {
+		staffDaemonLoggedIn = retval == 0;
+	}
+	if(replyLength != NULL) {
+		*replyLength = message.length;
+	}
+	if(reply != NULL) {
+		*reply = buf;
+		buf = NULL;
+	}
 
 CLEANUP:
-	#undef printDiv
-	free(staffArr);
-	free(includeFlag);
-	free(arrCursorHist);
-	if(staffFile != NULL) {
-		fclose(staffFile);
+	if(retval == -3 || retval == -4) {
+		// Use the staff file directly from now on.
+		close(staffDaemonFd);
+		staffDaemonFd = -1;
+		staffDaemonLoggedIn = false;
 	}
+	#endif
+	free(buf);
 	return retval;
 }
 
 
-Staff loginStaff(void) {
-	Staff s;
-	char buf[STAFF_BUF_MAX];
-	FILE* staffFile = fopen("staff.bin", "rb");
+int readStaffSnapshot(StaffSnapshot* snapshot, Staff* staffArr, int first, int count) {
+	int read = 0;
+	while(read < count) {
+		StaffRead request = { snapshot->version, first+read, count-read };
+		void* reply = NULL;
+		int bytes = 0;
+		int res = requestStaff(SR_READ, &request, sizeof(request), &reply, &bytes);
+		if(res != 0) {
+			return res == -4 ? -4 : -3;
+		}
 
-	if(staffFile == NULL) {
-		perror("Error (Opening staff file)");
-		// Do not pause(). The file may not been initialised and it is being done silently.
-		s.id[0] = 0;
-		s.id[1] = -3;
-		goto CLEANUP;
+		if(bytes == 0) {
+			// Past the end of the version.
+			free(reply);
+			break;
+		}
+		memcpy(staffArr+read, reply, bytes);
+		free(reply);
+		read += bytes/sizeof(Staff);
 	}
+	return read;
+}
 
-	while(1) {
-		printf(
-			"LOGIN\n"
-			"=====\n"
-		);
-		int res = promptStaffDetails(buf, SE_ID);
-		if(res == EOF) {
-			s.id[0] = 0;
-			s.id[1] = EOF;
-			goto CLEANUP;
-		}
 
-		// Do not allow abort.
-		if(res == -2) {
+int sendAll(int fd, const void* buf, size_t len) {
+	#ifdef STAFF_DAEMON
+	size_t sent = 0;
+	while(sent < len) {
+		// Report a closed connection instead of being killed by SIGPIPE.
+		ssize_t res = send(fd, (const char*) buf + sent, len - sent, MSG_NOSIGNAL);
+		if(res == -1 && errno == EINTR) {
 			continue;
 		}
+		if(res <= 0) {
+			return -3;
+		}
+		sent += res;
+	}
+	return 0;
+	#else
+	(void) fd, (void) buf;
+	return len == 0 ? 0 : -3;
+	#endif
+}
 
-		// Iterate through staff data and find the matching staff ID.
-		bool found = false;
 
-		rewind(staffFile);
-		while(fread(&s, sizeof(s), 1, staffFile) != 0) {
-			if(strcmp(s.id, buf) == 0) {
-				// Found matching staff details, stop searching.
-				found = true;
-				break;
-			}
+int recvAll(int fd, void* buf, size_t len) {
+	#ifdef STAFF_DAEMON
+	size_t received = 0;
+	while(received < len) {
+		ssize_t res = recv(fd, (char*) buf + received, len - received, 0);
+		if(res == -1 && errno == EINTR) {
+			continue;
+		}
+		if(res <= 0) {
+			return -3;
 		}
+		received += res;
+	}
+	return 0;
+	#else
+	(void) fd, (void) buf;
+	return len == 0 ? 0 : -3;
+	#endif
+}
 
-		if(found) {
-			bool match = false;
 
-			for(int i = 3; ~i; --i) {
-				printf("Password: ");
+// Precomputed runs of $FRAME_RUN_LENGTH glyphs, for frameDivider() and frameSpaces().
+const char FRAME_DIVIDERS[] = REPEAT4(REPEAT4(REPEAT4(DIVIDER_GLYPH)));
+const char FRAME_SPACES[] = REPEAT4(REPEAT4(REPEAT4(" ")));
 
-				if(scanf("%127[^\n]", buf) == EOF) {
-					s.id[0] = 0;
-					s.id[1] = EOF;
-					goto CLEANUP;
-				}
-				u64 enteredPassHash = computeHash(buf);
-				memset(buf, 0, STAFF_BUF_MAX); // Zero out sensitive data.
-				truncate();
 
-				if(enteredPassHash == s.passHash) {
-					// A valid password is entered.
-					match = true;
-					break;
-				} else if(i > 0) {
-					printf("Password incorrect! %d attempts left\n", i);
-				}
-			}
+void frameAppend(Frame* frame, const char* text, int len) {
+	if(len > 0 && growFrame(frame, len)) {
+		memcpy(frame->text+frame->length, text, len);
+		frame->length += len;
+	}
+}
 
-			if(match) {
-				// Password matches, break out of login loop.
-				printf("Logged in successfully.\n\n");
-				pause();
-				break;
-			} else {
-				printf("Password and staff ID does not match! Please try again!\n\n");
-				pause();
-			}
-		} else {
-			// Staff ID inputted not found in record, proceed to prompt again.
-			printf("Staff ID not found!\n\n");
-			pause();
-		}
+
+void framePrintf(Frame* frame, const char* format, ...) {
+	va_list args;
+	va_list copy;
+	va_start(args, format);
+	va_copy(copy, args);
+
+	// Measure the text first, then print it straight into the frame. (vsnprintf() also writes the NUL terminator)
+	int len = vsnprintf(NULL, 0, format, args);
+	if(len > 0 && growFrame(frame, len+1)) {
+		vsnprintf(frame->text+frame->length, len+1, format, copy);
+		frame->length += len;
 	}
 
-CLEANUP:
-	if(staffFile != NULL) {
-		fclose(staffFile);
+	va_end(copy);
+	va_end(args);
+}
+
+
+void frameDivider(Frame* frame, int n) {
+	int glyphBytes = sizeof(DIVIDER_GLYPH)-1;
+	for(; n > 0; n -= FRAME_RUN_LENGTH) {
+		frameAppend(frame, FRAME_DIVIDERS, (n < FRAME_RUN_LENGTH ? n : FRAME_RUN_LENGTH)*glyphBytes);
 	}
-	return s;
 }
 
 
-int menuStaff(Staff* loggedInUser) {
-	while(1) {
-		cls();
-		char action[3];
-		printf(
-			"STAFF MODULE\n"
-			"============\n"
-			"Welcome %s!\n\n"
-			"- Add\n"
-			"- Display\n"
-			"- Delete\n"
-			"- Modify\n"
-			"- Search\n"
-			"- Report\n\n"
-			"- Quit menu\n\n"
-			"Enter a function: ",
-			loggedInUser->details.name
-		);
+void frameSpaces(Frame* frame, int n) {
+	for(; n > 0; n -= FRAME_RUN_LENGTH) {
+		frameAppend(frame, FRAME_SPACES, n < FRAME_RUN_LENGTH ? n : FRAME_RUN_LENGTH);
+	}
+}
 
-		if(scanf("%2s", action) == EOF) {
-			return EOF;
-		}
-		truncate();
-		if(action[0] == ':') {
-			action[0] = action[1];
+
+void frameJSONString(Frame* frame, const char* text, int len) {
+	const char* end = text+len;
+	frameAppend(frame, "\"", 1);
+	while(text < end) {
+		// Copy the longest run that needs no escaping at once.
+		int run = 0;
+		while(text+run < end && (unsigned char) text[run] >= 0x20 && text[run] != '"' && text[run] != '\\') {
+			++run;
 		}
+		frameAppend(frame, text, run);
+		text += run;
 
-		switch(toupper(*action)) {
-			case 'A':
-				addStaff();
-				break;
-			case 'D':
-				if(action[1] == '\0') {
-					printf("\nPlease enter one more character (DI[SPLAY] / DE[LETE]) to distinguish between 2 similar functions!\n");
-					pause();
-				} else if(toupper(action[1]) == 'I') {
-					displayStaff();
-				} else if(toupper(action[1]) == 'E') {
-					deleteStaff();
-				} else {
-					printf("Please enter an existing function!\n");
-					pause();
-				}
-				break;
-			case 'M':
-				modifyStaff();
-				break;
-			case 'S':
-				searchStaff();
-				break;
-			case 'R':
-				reportStaff();
-				break;
-			case 'Q':
-				return 0;
-				// No break here because of return.
-			case 'H':
-				cls();
-				printf(
-					"HELP\n"
-					"====\n"
-					"  Choose one of the function of the staff module by typing the first few characters of the corresponding function.\n"
-					"  Action:\n"
-					"    :h (Help.)\n"
-					"    :q (Quit.)\n"
-					"    A  (Add staff page.)\n"
-					"  Examples:\n"
-					"    A\n"
-					"    (Goes to add staff page.)\n"
-					"    Se\n"
-					"    (Goes to search staff page.)\n\n"
-					"  (Congrats on finding this unindexed page!)\n\n"
-				);
-				pause();
-				break;
-			default:
-				printf("Please enter an existing function!\n");
-				pause();
+		if(text == end) {
+			break;
+		} else if(*text == '"' || *text == '\\') {
+			frameAppend(frame, "\\", 1);
+			frameAppend(frame, text++, 1);
+		} else {
+			framePrintf(frame, "\\u%04x", (unsigned char) *text++);
 		}
 	}
-	return 0;
+	frameAppend(frame, "\"", 1);
 }
 
 
-u64 computeHash(char* msg) {
-	// Define constants.
-	#define NN	8	// Hash size to be returned (bytes).
-	#define BB	128	// Block bytes.
-
-	// Initialisation vector constants from the BLAKE2 specification.
-	// Equivalent to the fractional part of the square root of the first 8 prime numbers.
-	u64 hash[] = {
-		0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
-		0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
-	};
-	
-	hash[0] ^= 0x01010000 ^ NN;
-
-	int len = strlen(msg);
-
-	// Split the message into $BB bytes each (and exclude the last block) and compress it.
-	for(int i = 0; i < (len+BB-1)/BB-1; ++i) {
-		BLAKE2bF(hash, &msg[i*BB], (i+1)*BB, false);
+void frameCSVField(Frame* frame, const char* text, int len) {
+	bool quoted = false;
+	for(int i = 0; i < len && !quoted; ++i) {
+		quoted = text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n';
+	}
+	if(!quoted) {
+		frameAppend(frame, text, len);
+		return;
 	}
 
-	// Compress final block.
-	char buf[BB] = { 0 };
-	// NOTE: Any bytes beyond the null terminator will not be used.
-	memcpy(buf, &msg[len/BB*BB], len%BB);
+	// Quotes are doubled, by copying each run up to and including a quote, then the quote again.
+	frameAppend(frame, "\"", 1);
+	const char* end = text+len;
+	while(text < end) {
+		const char* quote = memchr(text, '"', end-text);
+		const char* next = quote != NULL ? quote+1 : end;
+		frameAppend(frame, text, next-text);
+		if(quote != NULL) {
+			frameAppend(frame, "\"", 1);
+		}
+		text = next;
+	}
+	frameAppend(frame, "\"", 1);
+}
 
-	BLAKE2bF(hash, buf, len, true);
-	memset(buf, 0, BB); // Erase sensitive data.
 
-	#undef NN
-	#undef BB
+bool growFrame(Frame* frame, int more) {
+	if(frame->length+more <= frame->capacity) {
+		return true;
+	}
 
-	return hash[0];
+	int capacity = frame->capacity == 0 ? 4096 : frame->capacity;
+	while(capacity < frame->length+more) {
+		capacity *= 2;
+	}
+	char* text = realloc(frame->text, capacity);
+	if(text == NULL) {
+		frame->failed = true;
+		return false;
+	}
+	frame->text = text;
+	frame->capacity = capacity;
+	return true;
 }
 
 
-void BLAKE2bF(u64* hash, char* msg, u64 bytesCompressed, bool isLastBlock) {
-	// Sigma array taken from the BLAKE2 specification to determine which index of the msg to take and mix.
-	// Row 11 and 12 are equivalent to row 1 and 2.
-	const short SIGMA[12][16] = {
-		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
-		{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
-		{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
-		{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
-		{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
-		{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
-		{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
-		{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
-		{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
-		{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
-		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
-		{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
-	};
-	// Number of rounds to mix the message specified for BLAKE2b.
-	const int ROUNDS = 12;
+int flushFrame(Frame* frame) {
+	return writeFrame(frame, stdout);
+}
 
-	u64* m = (u64*) msg; // Interpret 128 bytes msg to a 16 chunks 8 bytes (64 bits) int.
 
-	u64 v[16] = {
-		hash[0], hash[1], hash[2], hash[3],
-		hash[4], hash[5], hash[6], hash[7],
-		0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
-		0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
-	};
+int writeFrame(Frame* frame, FILE* file) {
+	int retval = frame->failed ? -4 : 0;
 
-	v[12] ^= bytesCompressed;
-	// v[13] ^= bytesCompressed<<64; // Ignored because size of $bytesCompressed is limited to 8 bytes in this implementation.
+	// Text printed with stdio before the frame comes first.
+	if(fflush(file) == EOF) {
+		retval = -3;
+	}
 
-	if(isLastBlock) {
-		v[14] = ~v[14]; // Inverts all bits
+	#ifdef FRAME_WRITE
+	int fd = fileno(file);
+	for(int written = 0; written < frame->length;) {
+		ssize_t res = write(fd, frame->text+written, frame->length-written);
+		if(res == -1 && errno == EINTR) {
+			continue;
+		}
+		if(res <= 0) {
+			retval = -3;
+			break;
+		}
+		written += res;
 	}
+	#else
+	if(fwrite(frame->text, 1, frame->length, file) != (size_t) frame->length || fflush(file) == EOF) {
+		retval = -3;
+	}
+	#endif
 
-	for(int i = 0; i < ROUNDS; ++i) {
-		// Choose the specified sigma array for the current round.
-		const short* S = SIGMA[i];
+	frame->length = 0;
+	frame->failed = false;
+	return retval;
+}
+
+
+// The frame last shown by presentFrame(), its buffer is swapped with the next frame.
+Frame screenFrame = { 0 };
+
+// What is known of the screen, one of ScreenStates.
+int screenState = SS_UNKNOWN;
 
-		BLAKE2bG(v, 0, 4,  8, 12, m[S[ 0]], m[S[ 1]]);
-		BLAKE2bG(v, 1, 5,  9, 13, m[S[ 2]], m[S[ 3]]);
-		BLAKE2bG(v, 2, 6, 10, 14, m[S[ 4]], m[S[ 5]]);
-		BLAKE2bG(v, 3, 7, 11, 15, m[S[ 6]], m[S[ 7]]);
 
-		BLAKE2bG(v, 0, 5, 10, 15, m[S[ 8]], m[S[ 9]]);
-		BLAKE2bG(v, 1, 6, 11, 12, m[S[10]], m[S[11]]);
-		BLAKE2bG(v, 2, 7,  8, 13, m[S[12]], m[S[13]]);
-		BLAKE2bG(v, 3, 4,  9, 14, m[S[14]], m[S[15]]);
+int presentFrame(Frame* frame) {
+	#ifdef TERMINAL_ANSI
+	if(screenState == SS_UNKNOWN) {
+		return flushFrame(frame);
 	}
 
-	for(int i = 0; i < 8; ++i) {
-		hash[i] ^= v[i] ^ v[i+8];
+	Frame out = { 0 };
+	out.failed = frame->failed;
+
+	// A frame taller than the screen scrolls it, so the rows are not known afterwards.
+	int lines = 1;
+	for(int i = 0; i < frame->length; ++i) {
+		lines += frame->text[i] == '\n';
+	}
+	struct winsize size;
+	bool scrolls = ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && lines >= size.ws_row;
+
+	if(screenState == SS_DIRTY || scrolls) {
+		frameAppend(&out, "\x1b[H\x1b[2J\x1b[3J", 11);
+		frameAppend(&out, frame->text, frame->length);
+	} else {
+		const char* old = screenFrame.text;
+		const char* oldEnd = old+screenFrame.length;
+		const char* line = frame->text;
+		const char* end = line+frame->length;
+
+		for(int row = 1; ; ++row) {
+			const char* next = line < end ? memchr(line, '\n', end-line) : NULL;
+			const char* oldNext = old < oldEnd ? memchr(old, '\n', oldEnd-old) : NULL;
+			int len = (next != NULL ? next : end)-line;
+			// The last line of the old frame also shows what the user typed after it, it is always redrawn.
+			int oldLen = oldNext != NULL ? oldNext-old : -1;
+
+			if(next == NULL) {
+				// Clear what is left of the old frame, and leave the cursor after the last line.
+				framePrintf(&out, "\x1b[%d;1H\x1b[J", row);
+				frameAppend(&out, line, len);
+				break;
+			}
+			if(len != oldLen || memcmp(line, old, len) != 0) {
+				framePrintf(&out, "\x1b[%d;1H", row);
+				frameAppend(&out, line, len);
+				frameAppend(&out, "\x1b[K", 3);
+			}
+
+			line = next+1;
+			old = oldNext != NULL ? oldNext+1 : oldEnd;
+		}
 	}
+
+	// Keep the frame as shown, and hand its old buffer back to the caller.
+	Frame shown = screenFrame;
+	screenFrame = *frame;
+	*frame = shown;
+	frame->length = 0;
+	frame->failed = false;
+	screenState = scrolls ? SS_DIRTY : SS_SHOWN;
+
+	int retval = flushFrame(&out);
+	free(out.text);
+	return retval;
+	#else
+	return flushFrame(frame);
+	#endif
 }
 
 
-void BLAKE2bG(u64* v, u64 a, u64 b, u64 c, u64 d, u64 x, u64 y) {
-	#define rotateRight64Bits(a,n) ((a)>>(n))^((a)<<(64-(n)))
+void clearScreen(void) {
+	#ifdef TERMINAL_ANSI
+	printf("\x1b[H\x1b[2J\x1b[3J");
+	fflush(stdout);
 
-	v[a] += v[b] + x;
-	v[d] = rotateRight64Bits(v[d]^v[a], 32);
-	v[c] += v[d];
-	v[b] = rotateRight64Bits(v[b]^v[c], 24);
-	v[a] += v[b] + y;
-	v[d] = rotateRight64Bits(v[d]^v[a], 16);
-	v[c] += v[d];
-	v[b] = rotateRight64Bits(v[b]^v[c], 63);
+	// The frames are only diffed on a terminal, where the escape sequences are understood.
+	screenFrame.length = 0;
+	screenState = isatty(STDOUT_FILENO) ? SS_SHOWN : SS_UNKNOWN;
+	#else
+	system("clear || cls");
+	#endif
+}
 
-	#undef rotateRight64Bits
+
+void dirtyScreen(void) {
+	if(screenState == SS_SHOWN) {
+		screenState = SS_DIRTY;
+	}
 }
 
 
@@ -2471,8 +12028,18 @@ bool LIKE(char* text, char* query, bool ignoreCase) {
 	int lastWildcard = -1;	// Last index of '%', to locate the start of a '%' wildcard group.
 	bool match = true;
 
+	if(!ignoreCase) {
+		// Case sensitive (or pre-folded) text can compare the leading literal characters in one go.
+		int run = strcspn(query, "%_");
+		if(run > textLen || memcmp(query, text, run) != 0) {
+			match = false;
+		} else {
+			qIdx = textOffset = run;
+		}
+	}
+
 	// Compare the trivial part of the query.
-	for(; qIdx < queryLen && query[qIdx] != '%'; ++qIdx) {
+	for(; match && qIdx < queryLen && query[qIdx] != '%'; ++qIdx) {
 		if(query[qIdx] == '_' || (ignoreCase ? toupper(query[qIdx]) == toupper(text[textOffset]) : query[qIdx] == text[textOffset])) {
 			++textOffset;
 			if(textOffset > textLen) {
@@ -2542,12 +12109,21 @@ bool LIKE(char* text, char* query, bool ignoreCase) {
 					match = false;
 					break;
 				}
-				for(int r = 1; r <= queryLen-qIdx-1; ++r) {
-					if(query[queryLen-r] != '_' && (ignoreCase ? toupper(query[queryLen-r]) != toupper(text[textLen-r]) : query[queryLen-r] != text[textLen-r])) {
-						match = false;
-						break;
+				int suffixLen = queryLen-qIdx-1;
+				if(!ignoreCase && strchr(query+qIdx+1, '_') == NULL) {
+					// Literal suffix, compare it in one go.
+					match = memcmp(query+qIdx+1, text+textLen-suffixLen, suffixLen) == 0;
+				} else {
+					for(int r = 1; r <= suffixLen; ++r) {
+						if(query[queryLen-r] != '_' && (ignoreCase ? toupper(query[queryLen-r]) != toupper(text[textLen-r]) : query[queryLen-r] != text[textLen-r])) {
+							match = false;
+							break;
+						}
 					}
 				}
+				if(!match) {
+					break;
+				}
 				// Matched the whole string.
 				textOffset = textLen;
 			}
@@ -2575,10 +12151,71 @@ void menuFacility() {};
 void menuBooking() {};
 void menuUsage() {};
 
-int main(void) {
+int main(int argc, char** argv) {
 	Staff loggedInUser;
 	bool loggedIn = false;
 
+	// Maintenance modes and commands, these do not need a login.
+	if(argc > 1) {
+		int res = -18;
+		if(strcmp(argv[1], "--selftest") == 0) {
+			return testHash() == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "--bench") == 0) {
+			return benchHash() == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "--verify") == 0) {
+			return verifyChecksums() == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "--merkle-root") == 0) {
+			return printMerkleRoot() == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "--merkle-diff") == 0 && argc > 2) {
+			return diffMerkleTree(argv[2]) == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "--serve") == 0) {
+			return serveStaff() == 0 ? 0 : 1;
+		} else if(strcmp(argv[1], "search") == 0) {
+			res = exportStaffCommand(argc-2, argv+2, SX_TSV);
+		} else if(strcmp(argv[1], "export") == 0) {
+			res = exportStaffCommand(argc-2, argv+2, SX_CSV);
+		} else if(strcmp(argv[1], "add") == 0) {
+			res = addStaffCommand(argc-2, argv+2);
+		} else if(strcmp(argv[1], "import") == 0) {
+			res = importStaffCommand(argc-2, argv+2);
+		} else if(strcmp(argv[1], "delete") == 0) {
+			res = deleteStaffCommand(argc-2, argv+2);
+		} else if(strcmp(argv[1], "update") == 0) {
+			res = updateStaffCommand(argc-2, argv+2);
+		} else if(strcmp(argv[1], "report") == 0) {
+			res = reportStaffCommand(argc-2, argv+2);
+		}
+
+		if(res == -18) {
+			printf(
+				"Usage: %s [--selftest | --bench | --verify | --merkle-root | --merkle-diff FILE | --serve]\n"
+				"       %s search [--field FIELD (--like | --not-like) QUERY]...\n"
+				"       %s export [--field FIELD (--like | --not-like) QUERY]... [--fields FIELD,...] [--format csv | jsonl | tsv] [--output FILE]\n"
+				"       %s add --from FILE\n"
+				"       %s import FILE\n"
+				"       %s delete (ID... | [--field FIELD (--like | --not-like) QUERY]...)\n"
+				"       %s update (--set FIELD=VALUE)... (--field FIELD (--like | --not-like) QUERY)...\n"
+				"       %s report [--json]\n"
+				"  --selftest          (Check BLAKE2b against known answers.)\n"
+				"  --bench             (Measure BLAKE2b throughput.)\n"
+				"  --verify            (Check every page of the staff file against its checksum.)\n"
+				"  --merkle-root       (Print the root hash of the staff file.)\n"
+				"  --merkle-diff FILE  (List the pages that differ from another %s, e.g. of a backup.)\n"
+				"  --serve             (Serve the staff file to every terminal from memory, over %s.)\n"
+				"  search              (Print the staff matching every query, one per line with tab separated fields.)\n"
+				"  export              (Stream the staff matching every query as CSV (the default) or JSON Lines, with only the fields listed.)\n"
+				"  add                 (Add a staff per line of FILE (- for stdin): ID, name, position, phone, IC and password, tab separated.)\n"
+				"  import              (Add the staff of a CSV file (- for stdin) in bulk, with the fields of add as columns.)\n"
+				"  delete              (Delete the staff with the IDs, or every staff matching the queries.)\n"
+				"  update              (Set the fields of every staff matching the queries.)\n"
+				"  report              (Print the report summaries, as JSON with --json.)\n"
+				"While the staff daemon runs, the commands log in to it as STAFF_ID with STAFF_PASSWORD from the environment.\n",
+				argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], MERKLE_FILE, STAFF_SOCKET
+			);
+		}
+		return res == 0 ? 0 : 1;
+	}
+
 	// while(1) {
 	// char buf[30];
 	// char buf2[30];
@@ -2621,6 +12258,11 @@ PROMPT_LOGIN:
 				if(first) {
 					// Staff file not found. Insert a file with default value.
 					FILE* staffFile = fopen("staff.bin", "wb");
+					// Remove the index and checksums of a previous staff file, they will be rebuilt on first use.
+					remove(DEPARTURE_INDEX_FILE);
+					remove(STAFF_ID_INDEX_FILE);
+					remove(CHECKSUM_FILE);
+					remove(MERKLE_FILE);
 					if(staffFile != NULL) {
 						fwrite(&(Staff) { "S0000", { "ADMIN", "Admin", "0123456789", "000101010000" }, computeHash("ADMIN") }, sizeof(Staff), 1, staffFile);
 						fclose(staffFile);
@@ -2703,8 +12345,31 @@ EOF_EXIT:
 #undef STAFF_ENUM_LENGTH
 #undef STAFF_BUF_MAX
 #undef ENTRIES_PER_PAGE
+#undef BLAKE2B_KERNEL_LENGTH
+#undef BLAKE2B_BLOCK_BYTES
+#undef BLAKE2B_OUT_MAX
+#undef STAFF_STREAM_CHUNK
+#undef COMMAND_FLUSH_BYTES
+#undef COMMAND_LINE_MAX
+#undef SCAN_TASK_RECORDS
+#undef HASH_TASK_PAGES
+#undef POOL_THREADS_MAX
+#undef POOL_DEQUE_MAX
 #undef isStaffDeleted
+#undef staffDepartureDate
+#undef APPEND_LOCK_RECORD
+#undef DEPARTURE_INDEX_FILE
+#undef STAFF_ID_INDEX_FILE
+#undef CHECKSUM_FILE
+#undef CHECKSUM_PAGE_RECORDS
+#undef MERKLE_FILE
+#undef MERKLE_DIGEST_BYTES
+#undef STAFF_SOCKET
+#undef DAEMON_CLIENTS_MAX
 #undef truncate
 #undef pause
 #undef ENABLE_CLS
+#undef DIVIDER_GLYPH
+#undef REPEAT4
+#undef FRAME_RUN_LENGTH
 #undef cls